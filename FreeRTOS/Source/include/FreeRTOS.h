@@ -586,6 +586,14 @@
     #define traceTASK_INCREMENT_TICK( xTickCount )
 #endif
 
+#ifndef traceTASK_SUSPEND_ALL
+    #define traceTASK_SUSPEND_ALL()
+#endif
+
+#ifndef traceTASK_RESUME_ALL
+    #define traceTASK_RESUME_ALL()
+#endif
+
 #ifndef traceTIMER_CREATE
     #define traceTIMER_CREATE( pxNewTimer )
 #endif
@@ -800,6 +808,10 @@
     #define configUSE_TICKLESS_IDLE    0
 #endif
 
+#ifndef configTICKLESS_IDLE_ACTIVE
+    #define configTICKLESS_IDLE_ACTIVE()    ( 1 )
+#endif
+
 #ifndef configPRE_SUPPRESS_TICKS_AND_SLEEP_PROCESSING
     #define configPRE_SUPPRESS_TICKS_AND_SLEEP_PROCESSING( x )
 #endif
@@ -34,8 +34,8 @@
  * running are blocked in sigwait().
  *
  * Task switch is done by resuming the thread for the next task by
- * signaling the condition variable and then waiting on a condition variable
- * with the current thread.
+ * signaling its event and then waiting on the event of the current thread
+ * (a futex, see utils/wait_for_event.c).
  *
  * The timer interrupt uses SIGALRM and care is taken to ensure that
  * the signal handler runs only on the thread for the current task.
@@ -50,15 +50,23 @@
  * semaphore or mutex.
  *----------------------------------------------------------*/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* REG_* indices of the machine context. */
+#endif
+
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/times.h>
+#include <sys/syscall.h>
 #include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
 
 /* Scheduler includes. */
 #include "FreeRTOS.h"
@@ -72,7 +80,12 @@ extern pthread_t injectorThreadId;
 #define SIG_RESUME SIGUSR1
 #define SIG_INTERRUPT SIGUSR2
 
-static uint32_t (*interruptHandler)( void ) = NULL;
+/* Simulated interrupts: numbers 0 to portMAX_INTERRUPTS - 1. */
+#define portMAX_INTERRUPTS 32
+
+static uint32_t (*pxInterruptHandlers[ portMAX_INTERRUPTS ])( void );
+/* Raised and not served yet, one bit per interrupt number. */
+static volatile uint32_t ulPendingInterrupts = 0;
 
 typedef struct THREAD
 {
@@ -81,8 +94,28 @@ typedef struct THREAD
     void *pvParams;
     BaseType_t xDying;
     struct event *ev;
+    /* Snapshot support: the point where the thread parked itself, so that
+     * a fresh pthread can resume it in a forked copy of the process. */
+    ucontext_t *pxContext;
+    void *pvThreadStack;
+    void *pvResurrectStack;
+    volatile BaseType_t xParked;
+    BaseType_t xResurrected;
+    BaseType_t xOrphaned;
+    /* The tick interrupt parked the thread while it was executing code of a
+     * shared library, where it may hold a lock (e.g. in malloc()). */
+    BaseType_t xPreemptedInLibrary;
 } Thread_t;
 
+/* Upper bound on the number of task threads tracked (snapshots, reset). */
+#define portMAX_SNAPSHOT_THREADS 32
+
+/* With snapshots enabled the pthread stacks are owned by the port: glibc
+ * recycles the stacks it allocated for threads that do not exist in a forked
+ * child, while a snapshot needs them to stay untouched. */
+#define portSNAPSHOT_THREAD_STACK_SIZE ( 1024 * 1024 )
+#define portSNAPSHOT_RESURRECT_STACK_SIZE ( 64 * 1024 )
+
 /*
  * The additional per-thread data is stored at the beginning of the
  * task's stack.
@@ -99,23 +132,80 @@ StackType_t *pxTopOfStack = *(StackType_t **)xTask;
 static pthread_once_t hSigSetupThread = PTHREAD_ONCE_INIT;
 static sigset_t xResumeSignals;
 static sigset_t xAllSignals;
+/* Signals unblocked while interrupts are enabled. */
+static sigset_t xInterruptSignals;
 static sigset_t xSchedulerOriginalSignalMask;
 static pthread_t hMainThread = ( pthread_t )NULL;
 static volatile portBASE_TYPE uxCriticalNesting;
 /*-----------------------------------------------------------*/
 
 static portBASE_TYPE xSchedulerEnd = pdFALSE;
+static portBASE_TYPE xSchedulerStarted = pdFALSE;
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE xSnapshotsEnabled = pdFALSE;
+static Thread_t *pxSnapshotThreads[ portMAX_SNAPSHOT_THREADS ];
+static ucontext_t xMainContext;
+static volatile portBASE_TYPE xMainParked = pdFALSE;
+/* Context interrupted by the tick being handled, if any. */
+static ucontext_t *pxInterruptedContext = NULL;
+/*-----------------------------------------------------------*/
+
+/* Signals of the tick and of the simulated interrupts: one copy of the port
+ * per process uses the defaults, see vPortUseInstanceSignals() otherwise. */
+static int iTickSignal = SIGALRM;
+static int iInterruptSignal = SIG_INTERRUPT;
+static BaseType_t xInstanceSignals = pdFALSE;
+static timer_t xTickTimer;
+/*-----------------------------------------------------------*/
+
+/* Virtual time: the simulated clock only advances by one tick period at each
+ * tick, see vPortEnableVirtualTime(). */
+static BaseType_t xVirtualTime = pdFALSE;
+static volatile uint64_t ullVirtualTimeNs = 0;
+/*-----------------------------------------------------------*/
+
+/* Real time: ticks raised since the start of the scheduler, against the
+ * deadlines of the tick timer, see prvCatchUpTicks(). */
+static uint64_t ullTicksRaised = 0;
+static uint64_t ullMissedTicks = 0;
+static uint64_t ullMaxTickLagNs = 0;
+/*-----------------------------------------------------------*/
+
+/* External tick: ticks raised by vPortRaiseTicks() and not yet handled, and
+ * the time of the run-time counter once they are. */
+static BaseType_t xExternalTick = pdFALSE;
+static volatile UBaseType_t uxExternalTicks = 0;
+static volatile uint64_t ullExternalTimeNs = 0;
+/*-----------------------------------------------------------*/
+
+/* Called by the tick handler with the number of ticks it is about to raise
+ * (0 for the signal of a tick already raised). */
+#ifndef traceTICK_INTERRUPT
+    #define traceTICK_INTERRUPT( uxTicks )
+#endif
 /*-----------------------------------------------------------*/
 
 static void prvSetupSignalsAndSchedulerPolicy( void );
 static void prvSetupTimerInterrupt( void );
+static void prvSetupVirtualTimerInterrupt( void );
+static void prvRestartVirtualTick( void );
+static UBaseType_t prvCatchUpTicks( void );
 static void *prvWaitForStart( void * pvParams );
 static void prvSwitchThread( Thread_t * xThreadToResume,
                              Thread_t *xThreadToSuspend );
 static void prvSuspendSelf( Thread_t * thread);
 static void prvResumeThread( Thread_t * xThreadId );
+static void prvRequestExit( Thread_t *pxThread );
 static void vPortSystemTickHandler(int sig, siginfo_t *info, void *context);
+static void vPortInterruptsHandler( int sig, siginfo_t *info, void *context );
+static BaseType_t prvServeInterrupts( void );
+static void prvSwitchFromInterrupt( Thread_t *pxThreadToSuspend,
+                                    BaseType_t xInterruptedInExecutable );
 static void vPortStartFirstTask( void );
+static void prvRegisterThread( Thread_t *pxThread );
+static void prvUnregisterThread( Thread_t *pxThread );
+static BaseType_t prvInterruptedInExecutable( void );
 /*-----------------------------------------------------------*/
 
 static void prvFatalError( const char *pcCall, int iErrno )
@@ -148,10 +238,32 @@ int iRet;
     thread->pxCode = pxCode;
     thread->pvParams = pvParameters;
     thread->xDying = pdFALSE;
+    thread->xParked = pdFALSE;
+    thread->xResurrected = pdFALSE;
+    thread->xOrphaned = pdFALSE;
+    thread->xPreemptedInLibrary = pdFALSE;
+    thread->pxContext = NULL;
+    thread->pvThreadStack = NULL;
+    thread->pvResurrectStack = NULL;
 
     pthread_attr_init( &xThreadAttributes );
     pthread_attr_setstack( &xThreadAttributes, pxEndOfStack, ulStackSize );
 
+    if ( xSnapshotsEnabled )
+    {
+        thread->pxContext = malloc( sizeof( ucontext_t ) );
+        thread->pvThreadStack = mmap( NULL, portSNAPSHOT_THREAD_STACK_SIZE,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0 );
+        if ( thread->pvThreadStack == MAP_FAILED )
+        {
+            prvFatalError( "mmap", errno );
+        }
+        pthread_attr_setstack( &xThreadAttributes, thread->pvThreadStack,
+                               portSNAPSHOT_THREAD_STACK_SIZE );
+    }
+    prvRegisterThread( thread );
+
     thread->ev = event_create();
 
     vPortEnterCritical();
@@ -190,6 +302,11 @@ int iSignal;
 sigset_t xSignals;
 
     hMainThread = pthread_self();
+    xSchedulerStarted = pdTRUE;
+
+    ullTicksRaised = 0;
+    ullMissedTicks = 0;
+    ullMaxTickLagNs = 0;
 
     /* Start the timer that generates the tick ISR(SIGALRM).
        Interrupts are disabled here already. */
@@ -209,12 +326,20 @@ sigset_t xSignals;
         sigwait( &xSignals, &iSignal );
     }*/
 
+    if ( xSnapshotsEnabled )
+    {
+        /* A snapshot resumes the main thread from here. */
+        getcontext( &xMainContext );
+        xMainParked = pdTRUE;
+    }
+
     pthread_mutex_lock(&mutex);
     while ( !xSchedulerEnd )
     {
         //sigwait( &xSignals, &iSignal );
         pthread_cond_wait(&cv, &mutex);
     }
+    xMainParked = pdFALSE;
 
     /* Cancel the Idle task and free its resources */
 #if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
@@ -237,23 +362,20 @@ sigset_t xSignals;
 
 void vPortEndScheduler( void )
 {
-struct itimerval itimer;
 struct sigaction sigtick;
 Thread_t *xCurrentThread;
 
     /* Stop the timer and ignore any pending SIGALRMs that would end
      * up running on the main thread when it is resumed. */
-    itimer.it_value.tv_sec = 0;
-    itimer.it_value.tv_usec = 0;
-
-    itimer.it_interval.tv_sec = 0;
-    itimer.it_interval.tv_usec = 0;
-    (void)setitimer( ITIMER_REAL, &itimer, NULL );
+    if ( !xExternalTick )
+    {
+        timer_delete( xTickTimer );
+    }
 
     sigtick.sa_flags = 0;
     sigtick.sa_handler = SIG_IGN;
     sigemptyset( &sigtick.sa_mask );
-    sigaction( SIGALRM, &sigtick, NULL );
+    sigaction( iTickSignal, &sigtick, NULL );
 
     /* Signal the scheduler to exit its loop. */
     pthread_mutex_lock(&mutex);
@@ -326,7 +448,7 @@ void vPortDisableInterrupts( void )
 
 void vPortEnableInterrupts( void )
 {
-    pthread_sigmask( SIG_UNBLOCK, &xAllSignals, NULL );
+    pthread_sigmask( SIG_UNBLOCK, &xInterruptSignals, NULL );
 }
 /*-----------------------------------------------------------*/
 
@@ -353,42 +475,140 @@ struct timespec t;
 }
 
 static uint64_t prvStartTimeNs;
-/* commented as part of the code below in vPortSystemTickHandler,
- * to adjust timing according to full demo requirements */
-/* static uint64_t prvTickCount; */
+/*-----------------------------------------------------------*/
 
 /*
  * Setup the systick timer to generate the tick interrupts at the required
  * frequency.
+ *
+ * The tick is a POSIX timer on CLOCK_MONOTONIC rather than ITIMER_REAL,
+ * which is shared by the copies of the port in the process (see
+ * vPortUseInstanceSignals()). Its deadlines are absolute, start + N periods,
+ * so a late signal does not shift the following ones; the ticks whose signal
+ * got merged with a later one are raised by prvCatchUpTicks().
  */
 void prvSetupTimerInterrupt( void )
 {
-struct itimerval itimer;
-int iRet;
+struct sigevent xEvent;
+struct itimerspec xPeriod;
+uint64_t ullFirstDeadlineNs;
 
-    /* Initialise the structure with the current timer information. */
-    iRet = getitimer( ITIMER_REAL, &itimer );
-    if ( iRet )
+    if ( xVirtualTime )
     {
-        prvFatalError( "getitimer", errno );
+        prvSetupVirtualTimerInterrupt();
+        return;
     }
 
-    /* Set the interval between timer events. */
-    itimer.it_interval.tv_sec = 0;
-    itimer.it_interval.tv_usec = portTICK_RATE_MICROSECONDS;
+    if ( xExternalTick )
+    {
+        return;
+    }
 
-    /* Set the current count-down. */
-    itimer.it_value.tv_sec = 0;
-    itimer.it_value.tv_usec = portTICK_RATE_MICROSECONDS;
+    memset( &xEvent, 0, sizeof( xEvent ) );
+    xEvent.sigev_notify = SIGEV_SIGNAL;
+    xEvent.sigev_signo = iTickSignal;
 
-    /* Set-up the timer interrupt. */
-    iRet = setitimer( ITIMER_REAL, &itimer, NULL );
-    if ( iRet )
+    if ( timer_create( CLOCK_MONOTONIC, &xEvent, &xTickTimer ) )
+    {
+        prvFatalError( "timer_create", errno );
+    }
+
+    /* A snapshot restored later resumes at the tick it was taken: the time
+     * it was paused is not counted as missed ticks. */
+    prvStartTimeNs = prvGetTimeNs() - ullTicksRaised * ( portTICK_RATE_MICROSECONDS * 1000ull );
+    ullFirstDeadlineNs = prvStartTimeNs + ( ullTicksRaised + 1 ) * ( portTICK_RATE_MICROSECONDS * 1000ull );
+
+    xPeriod.it_interval.tv_sec = 0;
+    xPeriod.it_interval.tv_nsec = portTICK_RATE_MICROSECONDS * 1000;
+    xPeriod.it_value.tv_sec = ullFirstDeadlineNs / 1000000000ull;
+    xPeriod.it_value.tv_nsec = ullFirstDeadlineNs % 1000000000ull;
+
+    if ( timer_settime( xTickTimer, TIMER_ABSTIME, &xPeriod, NULL ) )
+    {
+        prvFatalError( "timer_settime", errno );
+    }
+}
+
+/*
+ * Number of ticks whose deadline has passed. A signal raised while the
+ * previous one is still pending is lost (and a loaded host may not run the
+ * process for several periods): those ticks are raised now, one after the
+ * other, so the tick count keeps up with the run-time counter.
+ */
+static UBaseType_t prvCatchUpTicks( void )
+{
+uint64_t ullPeriodNs = portTICK_RATE_MICROSECONDS * 1000ull;
+uint64_t ullNowNs = prvGetTimeNs();
+uint64_t ullExpectedTicks = ( ullNowNs - prvStartTimeNs ) / ullPeriodNs;
+uint64_t ullLagNs;
+UBaseType_t uxTicks;
+
+    if ( ullExpectedTicks <= ullTicksRaised )
+    {
+        /* Signal of a tick already raised by a previous catch-up. */
+        return 0;
+    }
+
+    ullLagNs = ullNowNs - ( prvStartTimeNs + ( ullTicksRaised + 1 ) * ullPeriodNs );
+    if ( ullLagNs > ullMaxTickLagNs )
     {
-        prvFatalError( "setitimer", errno );
+        ullMaxTickLagNs = ullLagNs;
     }
 
-    prvStartTimeNs = prvGetTimeNs();
+    ullMissedTicks += ullExpectedTicks - ullTicksRaised - 1;
+
+    uxTicks = ( UBaseType_t ) ( ullExpectedTicks - ullTicksRaised );
+    ullTicksRaised = ullExpectedTicks;
+
+    return uxTicks;
+}
+
+unsigned long ulPortGetMissedTicks( void )
+{
+    return ( unsigned long ) ullMissedTicks;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetMaxTickLagNs( void )
+{
+    return ( unsigned long ) ullMaxTickLagNs;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Virtual time: a tick period of CPU time consumed by the process, instead of
+ * wall-clock time, raises the tick. The budget restarts at every tick, so that
+ * a tick raised by the Idle task (see vPortVirtualTimeIdle()) does not leave a
+ * partial period to the next task.
+ */
+static void prvSetupVirtualTimerInterrupt( void )
+{
+struct sigevent xEvent;
+
+    memset( &xEvent, 0, sizeof( xEvent ) );
+    xEvent.sigev_notify = SIGEV_SIGNAL;
+    xEvent.sigev_signo = iTickSignal;
+
+    if ( timer_create( CLOCK_PROCESS_CPUTIME_ID, &xEvent, &xTickTimer ) )
+    {
+        prvFatalError( "timer_create", errno );
+    }
+
+    prvRestartVirtualTick();
+}
+
+static void prvRestartVirtualTick( void )
+{
+struct itimerspec xPeriod;
+
+    xPeriod.it_interval.tv_sec = 0;
+    xPeriod.it_interval.tv_nsec = portTICK_RATE_MICROSECONDS * 1000;
+    xPeriod.it_value = xPeriod.it_interval;
+
+    if ( timer_settime( xTickTimer, 0, &xPeriod, NULL ) )
+    {
+        prvFatalError( "timer_settime", errno );
+    }
 }
 
 void prvSetupGenericInterrupts() {
@@ -399,7 +619,7 @@ extern pthread_t injectorThreadId;
 
 static void* doSomething (void *arg) {
     Thread_t *pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
-    pthread_kill(pxThreadToSuspend->pthread, SIGALRM);
+    pthread_kill(pxThreadToSuspend->pthread, iTickSignal);
 }
 
 static void vPortSystemTickHandler(int sig, siginfo_t *info, void *context)
@@ -418,10 +638,11 @@ static void vPortSystemTickHandler(int sig, siginfo_t *info, void *context)
     }
 
 Thread_t *pxThreadToSuspend;
-Thread_t *pxThreadToResume;
-/* uint64_t xExpectedTicks; */
+BaseType_t xInterruptedInExecutable;
+UBaseType_t uxTicks;
 
     uxCriticalNesting++; /* Signals are blocked in this signal handler. */
+    pxInterruptedContext = context;
 
 #if ( configUSE_PREEMPTION == 1 )
     pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
@@ -429,26 +650,58 @@ Thread_t *pxThreadToResume;
 
     /* Tick Increment, accounting for any lost signals or drift in
      * the timer. */
-/*
- *      Comment code to adjust timing according to full demo requirements
- *      xExpectedTicks = (prvGetTimeNs() - prvStartTimeNs)
- *        / (portTICK_RATE_MICROSECONDS * 1000);
- * do { */
+    if ( xVirtualTime )
+    {
+        ullVirtualTimeNs += portTICK_RATE_MICROSECONDS * 1000ull;
+        prvRestartVirtualTick();
+        uxTicks = 1;
+    }
+    else if ( xExternalTick )
+    {
+        /* The ticks raised while this one was handled get their own signal. */
+        uxTicks = __atomic_exchange_n( &uxExternalTicks, 0, __ATOMIC_ACQ_REL );
+        ullVirtualTimeNs = ullExternalTimeNs;
+    }
+    else
+    {
+        uxTicks = prvCatchUpTicks();
+    }
+
+    traceTICK_INTERRUPT( uxTicks );
+
+    while ( uxTicks-- > 0 )
+    {
         xTaskIncrementTick();
-/*        prvTickCount++;
- *    } while (prvTickCount < xExpectedTicks);
-*/
+    }
+    xInterruptedInExecutable = prvInterruptedInExecutable();
+    pxInterruptedContext = NULL;
 
 #if ( configUSE_PREEMPTION == 1 )
-    /* Select Next Task. */
+    prvSwitchFromInterrupt( pxThreadToSuspend, xInterruptedInExecutable );
+#endif
+
+    uxCriticalNesting--;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Select the next task at the end of an interrupt, and switch to its thread.
+ */
+static void prvSwitchFromInterrupt( Thread_t *pxThreadToSuspend,
+                                    BaseType_t xInterruptedInExecutable )
+{
+Thread_t *pxThreadToResume;
+
     vTaskSwitchContext();
 
     pxThreadToResume = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
 
-    prvSwitchThread(pxThreadToResume, pxThreadToSuspend);
-#endif
+    if ( pxThreadToResume != pxThreadToSuspend )
+    {
+        pxThreadToSuspend->xPreemptedInLibrary = !xInterruptedInExecutable;
+    }
 
-    uxCriticalNesting--;
+    prvSwitchThread( pxThreadToResume, pxThreadToSuspend );
 }
 /*-----------------------------------------------------------*/
 
@@ -463,12 +716,31 @@ void vPortCancelThread( void *pxTaskToDelete )
 {
 Thread_t *pxThreadToCancel = prvGetThreadFromTask( pxTaskToDelete );
 
-    /*
-     * The thread has already been suspended so it can be safely cancelled.
-     */
-    pthread_cancel( pxThreadToCancel->pthread );
-    pthread_join( pxThreadToCancel->pthread, NULL );
+    if ( pxThreadToCancel->xOrphaned )
+    {
+        /* The thread only existed in the process the snapshot was taken
+         * from: there is nothing to join. */
+    }
+    else
+    {
+        /*
+         * The thread has already been suspended: ask it to exit. Unlike
+         * pthread_cancel(), this does not rely on the cancellation signal,
+         * whose handler is shared by all the copies of libc in the process,
+         * and also works for a resurrected thread, which runs on a stack it
+         * did not create and cannot be unwound.
+         */
+        prvRequestExit( pxThreadToCancel );
+    }
     event_delete( pxThreadToCancel->ev );
+
+    if ( pxThreadToCancel->pvThreadStack )
+    {
+        munmap( pxThreadToCancel->pvThreadStack, portSNAPSHOT_THREAD_STACK_SIZE );
+    }
+    free( pxThreadToCancel->pvResurrectStack );
+    free( pxThreadToCancel->pxContext );
+    prvUnregisterThread( pxThreadToCancel );
 }
 /*-----------------------------------------------------------*/
 
@@ -515,6 +787,11 @@ BaseType_t uxSavedCriticalNesting;
         prvResumeThread( pxThreadToResume );
         if ( pxThreadToSuspend->xDying )
         {
+            if ( pxThreadToSuspend->xResurrected )
+            {
+                /* See vPortCancelThread(). */
+                syscall( SYS_exit, 0 );
+            }
             pthread_exit( NULL );
         }
         if (pthread_equal(pthread_self(), pxThreadToSuspend->pthread)) {
@@ -529,7 +806,7 @@ BaseType_t uxSavedCriticalNesting;
 static void prvSuspendSelf( Thread_t *thread )
 {
     /*
-     * Suspend this thread by waiting for a pthread_cond_signal event.
+     * Suspend this thread by waiting for its event.
      *
      * A suspended thread must not handle signals (interrupts) so
      * all signals must be blocked by calling this from:
@@ -541,7 +818,36 @@ static void prvSuspendSelf( Thread_t *thread )
      *
      * - A thread with all signals blocked with pthread_sigmask().
         */
+    if ( thread->pxContext )
+    {
+        /* A snapshot resumes the thread from here. */
+        getcontext( thread->pxContext );
+    }
+
+    __atomic_store_n( &thread->xParked, pdTRUE, __ATOMIC_RELEASE );
     event_wait(thread->ev);
+    __atomic_store_n( &thread->xParked, pdFALSE, __ATOMIC_RELEASE );
+    thread->xPreemptedInLibrary = pdFALSE;
+
+    if ( thread->xDying )
+    {
+        /* See prvRequestExit(). */
+        if ( thread->xResurrected )
+        {
+            syscall( SYS_exit, 0 );
+        }
+        pthread_exit( NULL );
+    }
+}
+
+/*
+ * Ask a thread that is parked, or about to park or exit, to exit and join it.
+ */
+static void prvRequestExit( Thread_t *pxThread )
+{
+    pxThread->xDying = pdTRUE;
+    event_signal( pxThread->ev );
+    pthread_join( pxThread->pthread, NULL );
 }
 
 /*-----------------------------------------------------------*/
@@ -555,10 +861,73 @@ static void prvResumeThread( Thread_t *xThreadId )
 }
 /*-----------------------------------------------------------*/
 
-static void vPortInterruptsHandler () {
-    if (interruptHandler) {
-        interruptHandler();
+/*
+ * Simulated interrupts.
+ *
+ * While the scheduler runs, the interrupt signal is process-directed like
+ * the tick: it is handled by the thread of the running task as soon as it
+ * enables interrupts, and ends with a task switch if a handler asks for
+ * it. Once the scheduler has ended (e.g. the interrupt raised by the Idle
+ * task right before ending it), the main thread serves the interrupts left
+ * pending.
+ */
+static void vPortInterruptsHandler( int sig, siginfo_t *info, void *context )
+{
+Thread_t *pxThreadToSuspend;
+BaseType_t xSwitchRequired;
+BaseType_t xInterruptedInExecutable;
+
+    ( void ) sig;
+    ( void ) info;
+
+    if ( !xSchedulerStarted || xSchedulerEnd || pthread_equal( pthread_self(), hMainThread ) )
+    {
+        ( void ) prvServeInterrupts();
+        return;
+    }
+
+    uxCriticalNesting++; /* Signals are blocked in this signal handler. */
+    pxInterruptedContext = context;
+    pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+    xSwitchRequired = prvServeInterrupts();
+
+    xInterruptedInExecutable = prvInterruptedInExecutable();
+    pxInterruptedContext = NULL;
+
+#if ( configUSE_PREEMPTION == 1 )
+    if ( xSwitchRequired )
+    {
+        prvSwitchFromInterrupt( pxThreadToSuspend, xInterruptedInExecutable );
+    }
+#endif
+
+    uxCriticalNesting--;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Call the handler of each pending interrupt: whether one of them requires
+ * a task switch.
+ */
+static BaseType_t prvServeInterrupts( void )
+{
+uint32_t ulPending = __atomic_exchange_n( &ulPendingInterrupts, 0, __ATOMIC_ACQ_REL );
+BaseType_t xSwitchRequired = pdFALSE;
+
+    while ( ulPending != 0 )
+    {
+        uint32_t ulInterruptNumber = __builtin_ctz( ulPending );
+
+        ulPending &= ulPending - 1;
+        if ( pxInterruptHandlers[ ulInterruptNumber ] != NULL &&
+             pxInterruptHandlers[ ulInterruptNumber ]() != pdFALSE )
+        {
+            xSwitchRequired = pdTRUE;
+        }
     }
+
+    return xSwitchRequired;
 }
 
 pthread_barrier_t my_barrier, my_barrier2;
@@ -578,6 +947,11 @@ int iRet;
      * in a critical section. */
     sigdelset( &xAllSignals, SIGINT );
 
+    if ( !xInstanceSignals )
+    {
+        xInterruptSignals = xAllSignals;
+    }
+
     /*
      * Block all signals in this thread so all new threads
      * inherits this mask.
@@ -604,7 +978,7 @@ int iRet;
         prvFatalError( "sigaction", errno );
     }
 
-    iRet = sigaction( SIGALRM, &sigtick, NULL );
+    iRet = sigaction( iTickSignal, &sigtick, NULL );
     if ( iRet )
     {
         prvFatalError( "sigaction", errno );
@@ -614,11 +988,11 @@ int iRet;
      * Setup the signal handler for the generic interrupts
      */
     struct sigaction siginterrupt;
-    siginterrupt.sa_flags = 0;
-    siginterrupt.sa_handler = vPortInterruptsHandler;
-    // use SIG_INTERRUPT to signal generic interrupts
-    sigaddset(&siginterrupt.sa_mask, SIG_INTERRUPT);
-    iRet = sigaction(SIG_INTERRUPT, &siginterrupt, NULL);
+    siginterrupt.sa_flags = SA_SIGINFO;
+    siginterrupt.sa_sigaction = vPortInterruptsHandler;
+    // like the tick, an interrupt handler is not interrupted
+    sigfillset(&siginterrupt.sa_mask);
+    iRet = sigaction(iInterruptSignal, &siginterrupt, NULL);
     if (iRet)
     {
         prvFatalError("sigaction", errno);
@@ -627,17 +1001,409 @@ int iRet;
 
 void vPortGenerateSimulatedInterrupt(uint32_t ulInterruptNumber)
 {
-    // signal the main thread
-    pthread_kill(hMainThread, SIG_INTERRUPT);
+    if ( ulInterruptNumber >= portMAX_INTERRUPTS || !xSchedulerStarted )
+    {
+        return;
+    }
+
+    __atomic_fetch_or( &ulPendingInterrupts, 1UL << ulInterruptNumber, __ATOMIC_RELEASE );
+
+    if ( !xSchedulerEnd )
+    {
+        // the running task, see vPortInterruptsHandler()
+        kill( getpid(), iInterruptSignal );
+    }
+    else
+    {
+        // signal the main thread
+        pthread_kill( hMainThread, iInterruptSignal );
+    }
+}
+
+void vPortUseInstanceSignals( int iInstance )
+{
+    /* Signal dispositions and process-directed signals are shared by the
+     * whole process: each copy of the port loaded in it (one per dlmopen()
+     * namespace) needs its own tick and interrupt signals and must leave the
+     * ones of the other copies blocked. Each copy creates its own tick timer
+     * (a POSIX timer on CLOCK_MONOTONIC with absolute deadlines, see
+     * prvSetupTimerInterrupt()) delivering its own tick signal, and catches
+     * up the ticks whose signal it missed on its own. */
+    xInstanceSignals = pdTRUE;
+    iTickSignal = SIGRTMIN + 2 * iInstance;
+    iInterruptSignal = SIGRTMIN + 2 * iInstance + 1;
+
+    sigemptyset( &xInterruptSignals );
+    sigaddset( &xInterruptSignals, iTickSignal );
+    sigaddset( &xInterruptSignals, iInterruptSignal );
+
+    /* Like the main thread of a process, the caller handles the simulated
+     * interrupts once the scheduler has ended. */
+    pthread_sigmask( SIG_UNBLOCK, &xInterruptSignals, NULL );
+}
+
+void vPortEnableVirtualTime( void )
+{
+    /* Must be called before the scheduler is started. */
+    xVirtualTime = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortVirtualTimeEnabled( void )
+{
+    return xVirtualTime;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetVirtualTimeNs( void )
+{
+    return ( unsigned long ) ullVirtualTimeNs;
+}
+/*-----------------------------------------------------------*/
+
+void vPortUseExternalTick( void )
+{
+    /* Must be called before the scheduler is started. */
+    xExternalTick = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortExternalTickEnabled( void )
+{
+    return xExternalTick;
+}
+/*-----------------------------------------------------------*/
+
+void vPortRaiseTicks( UBaseType_t uxTicks, unsigned long ulTimeNs )
+{
+    /* The signal is directed to the process, like the one of the tick timer:
+     * it is handled by the thread of the running task once it enables the
+     * interrupts, whichever thread raised it. */
+    ullExternalTimeNs = ulTimeNs;
+    __atomic_fetch_add( &uxExternalTicks, uxTicks, __ATOMIC_ACQ_REL );
+    kill( getpid(), iTickSignal );
+}
+/*-----------------------------------------------------------*/
+
+void vPortVirtualTimeIdle( void )
+{
+    /* Nothing else is ready to run: raise the next tick at once instead of
+     * waiting for the timer. Interrupts are enabled in the Idle task, so the
+     * tick is handled on this thread before pthread_kill() returns. */
+    if ( xVirtualTime && xSchedulerStarted && !xSchedulerEnd )
+    {
+        pthread_kill( pthread_self(), iTickSignal );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPortIdleWait( void )
+{
+    /* The tick signal is process-directed and each task has a thread of its
+     * own: the Idle thread keeps running until it is suspended by a switch. */
+}
+/*-----------------------------------------------------------*/
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    /* Only the virtual clock can skip the idle ticks: on the wall clock the
+     * Idle task keeps running until the next tick. */
+    if ( !xVirtualTime || xSchedulerEnd )
+    {
+        return;
+    }
+
+    /* Called with the scheduler suspended: the tick cannot change the ready
+     * tasks until the tick count is consistent again. */
+    vPortEnterCritical();
+
+    if ( eTaskConfirmSleepModeStatus() == eAbortSleep )
+    {
+        vPortExitCritical();
+        return;
+    }
+
+    /* Jump to the tick before the next task to unblock, keeping the run-time
+     * counter in step with the tick count ... */
+    vTaskStepTick( xExpectedIdleTime - 1 );
+    ullVirtualTimeNs += ( xExpectedIdleTime - 1 ) * ( portTICK_RATE_MICROSECONDS * 1000ull );
+
+    vPortExitCritical();
+
+    /* ... and raise the last one, which unblocks it (and calls the tick hook)
+     * once the scheduler is resumed. */
+    pthread_kill( pthread_self(), iTickSignal );
 }
+/*-----------------------------------------------------------*/
 
 void vPortSetInterruptHandler( uint32_t ulInterruptNumber, uint32_t (*pvHandler)( void ) ) {
-    (void)ulInterruptNumber;
-    interruptHandler = pvHandler;
+    if ( ulInterruptNumber < portMAX_INTERRUPTS )
+    {
+        pxInterruptHandlers[ ulInterruptNumber ] = pvHandler;
+    }
 }
 
 /*-----------------------------------------------------------*/
 
+/*
+ * Snapshots.
+ *
+ * fork() only duplicates the calling thread, so a copy of a running
+ * simulation loses every other task thread. When snapshots are enabled each
+ * thread saves its context right before parking in prvSuspendSelf() (and the
+ * main thread before waiting for the end of the scheduler): the child of a
+ * fork() then resumes every parked thread on a fresh pthread that jumps back
+ * to the saved context, on the copy of the original stack.
+ *
+ * A snapshot is only consistent if every thread but the caller is parked,
+ * which is the case while a task runs (except around a context switch) or
+ * before the scheduler is started. From the tick interrupt the interrupted
+ * task must also be executing code of the application itself.
+ */
+static void prvRegisterThread( Thread_t *pxThread )
+{
+int i;
+
+    for ( i = 0; i < portMAX_SNAPSHOT_THREADS; i++ )
+    {
+        if ( pxSnapshotThreads[ i ] == NULL )
+        {
+            pxSnapshotThreads[ i ] = pxThread;
+            return;
+        }
+    }
+
+    prvFatalError( "prvRegisterThread", ENOMEM );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUnregisterThread( Thread_t *pxThread )
+{
+int i;
+
+    for ( i = 0; i < portMAX_SNAPSHOT_THREADS; i++ )
+    {
+        if ( pxSnapshotThreads[ i ] == pxThread )
+        {
+            pxSnapshotThreads[ i ] = NULL;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvInterruptedInExecutable( void )
+{
+/* Text of the object the port is linked into: the executable, or the
+ * shared kernel when it is loaded by sim-multi. */
+extern char __ehdr_start[], etext[];
+char *pcProgramCounter;
+
+    if ( pxInterruptedContext == NULL )
+    {
+        return pdTRUE;
+    }
+
+#if defined( __x86_64__ )
+    pcProgramCounter = ( char * ) pxInterruptedContext->uc_mcontext.gregs[ REG_RIP ];
+#elif defined( __i386__ )
+    pcProgramCounter = ( char * ) pxInterruptedContext->uc_mcontext.gregs[ REG_EIP ];
+#elif defined( __aarch64__ )
+    pcProgramCounter = ( char * ) pxInterruptedContext->uc_mcontext.pc;
+#else
+    return pdFALSE;
+#endif
+
+    /* Outside of the executable the task may be holding a lock of a shared
+     * library (e.g. in malloc()) that would never be released in the copy. */
+    return pcProgramCounter >= __ehdr_start && pcProgramCounter < etext;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableSnapshots( void )
+{
+    /* Must be called before the first task is created. */
+    xSnapshotsEnabled = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortSnapshotIsConsistent( void )
+{
+pthread_t xSelf = pthread_self();
+int i;
+
+    if ( !xSnapshotsEnabled )
+    {
+        return pdFALSE;
+    }
+
+    for ( i = 0; i < portMAX_SNAPSHOT_THREADS; i++ )
+    {
+        Thread_t *pxThread = pxSnapshotThreads[ i ];
+
+        if ( pxThread == NULL || pxThread->xDying || pthread_equal( pxThread->pthread, xSelf ) )
+        {
+            continue;
+        }
+
+        if ( !__atomic_load_n( &pxThread->xParked, __ATOMIC_ACQUIRE ) )
+        {
+            return pdFALSE;
+        }
+    }
+
+    if ( xSchedulerStarted && !pthread_equal( hMainThread, xSelf ) && !xMainParked )
+    {
+        return pdFALSE;
+    }
+
+    return prvInterruptedInExecutable();
+}
+/*-----------------------------------------------------------*/
+
+static void *prvResurrectThread( void *pvParams )
+{
+Thread_t *pxThread = pvParams;
+
+    pxThread->pthread = pthread_self();
+    setcontext( pxThread->pxContext );
+
+    /* setcontext() does not return. */
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvResurrectMainThread( void *pvParams )
+{
+    ( void ) pvParams;
+
+    hMainThread = pthread_self();
+    setcontext( &xMainContext );
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+void vPortRestoreSnapshot( void )
+{
+pthread_t xSelf = pthread_self();
+pthread_t xThread;
+pthread_attr_t xThreadAttributes;
+int i, iRet;
+
+    /* Called in the child of a fork() taken while xPortSnapshotIsConsistent()
+     * held, with interrupts disabled (or from the tick handler): the
+     * resurrected threads inherit the blocked signal mask until their saved
+     * context restores their own. */
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &cv, NULL );
+
+    for ( i = 0; i < portMAX_SNAPSHOT_THREADS; i++ )
+    {
+        Thread_t *pxThread = pxSnapshotThreads[ i ];
+
+        if ( pxThread == NULL || pthread_equal( pxThread->pthread, xSelf ) )
+        {
+            continue;
+        }
+
+        if ( pxThread->xDying )
+        {
+            pxThread->xOrphaned = pdTRUE;
+            continue;
+        }
+
+        /* The copy of the event may still record its waiter as parked in
+         * the parent process. */
+        event_reset( pxThread->ev );
+        pxThread->xResurrected = pdTRUE;
+        pxThread->pvResurrectStack = malloc( portSNAPSHOT_RESURRECT_STACK_SIZE );
+
+        pthread_attr_init( &xThreadAttributes );
+        pthread_attr_setstack( &xThreadAttributes, pxThread->pvResurrectStack,
+                               portSNAPSHOT_RESURRECT_STACK_SIZE );
+
+        iRet = pthread_create( &xThread, &xThreadAttributes, prvResurrectThread, pxThread );
+        if ( iRet )
+        {
+            prvFatalError( "pthread_create", iRet );
+        }
+        pthread_attr_destroy( &xThreadAttributes );
+    }
+
+    if ( xSchedulerStarted )
+    {
+        if ( !pthread_equal( hMainThread, xSelf ) )
+        {
+            /* The main thread runs on the process stack, which is never
+             * recycled: only its new pthread needs a stack. */
+            pthread_attr_init( &xThreadAttributes );
+            pthread_attr_setstack( &xThreadAttributes, malloc( portSNAPSHOT_RESURRECT_STACK_SIZE ),
+                                   portSNAPSHOT_RESURRECT_STACK_SIZE );
+
+            iRet = pthread_create( &xThread, &xThreadAttributes, prvResurrectMainThread, NULL );
+            if ( iRet )
+            {
+                prvFatalError( "pthread_create", iRet );
+            }
+            pthread_attr_destroy( &xThreadAttributes );
+        }
+
+        /* Interval timers are not inherited across fork(). */
+        prvSetupTimerInterrupt();
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Reset.
+ *
+ * Once the scheduler has ended, the threads of the tasks that were not
+ * deleted are still parked (and those of the tasks deleted but not yet
+ * cleaned up by the Idle task are exiting). Joining all of them lets the
+ * same process initialise the kernel again after restoring its globals.
+ */
+BaseType_t xPortResetThreads( void )
+{
+int i;
+
+    for ( i = 0; i < portMAX_SNAPSHOT_THREADS; i++ )
+    {
+        Thread_t *pxThread = pxSnapshotThreads[ i ];
+
+        if ( pxThread == NULL )
+        {
+            continue;
+        }
+
+        if ( __atomic_load_n( &pxThread->xParked, __ATOMIC_ACQUIRE ) &&
+             !pxThread->xPreemptedInLibrary && !pxThread->xResurrected )
+        {
+            /* Parked in prvSuspendSelf(): it exits when woken up. This
+             * includes the Idle task, deleted by xPortStartScheduler() but
+             * never resumed to exit. */
+            prvRequestExit( pxThread );
+        }
+        else if ( pxThread->xDying )
+        {
+            /* Exits right after resuming the next task or, if it ended the
+             * scheduler, as soon as it parks: the request wakes it up. */
+            prvRequestExit( pxThread );
+        }
+        else
+        {
+            /* Still running (e.g. the scheduler was ended by the injector),
+             * or cancelling it could leave a lock of a shared library held. */
+            return pdFALSE;
+        }
+
+        event_delete( pxThread->ev );
+        pxSnapshotThreads[ i ] = NULL;
+    }
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
 unsigned long ulPortGetRunTime( void )
 {
 struct tms xTimes;
@@ -110,6 +110,46 @@ extern void vPortCancelThread( void *pxTaskToDelete );
 #define portCLEAN_UP_TCB( pxTCB )	vPortCancelThread( pxTCB )
 /*-----------------------------------------------------------*/
 
+/* Snapshots of a running simulation, see port.c. */
+extern void vPortEnableSnapshots( void );
+extern BaseType_t xPortSnapshotIsConsistent( void );
+extern void vPortRestoreSnapshot( void );
+
+/* Join the task threads once the scheduler has ended, see port.c. */
+extern BaseType_t xPortResetThreads( void );
+
+/* Tick and interrupt signals of one of several copies of the port
+ * in the same process, see port.c. */
+extern void vPortUseInstanceSignals( int iInstance );
+
+/* Virtual time: ticks paced by the CPU time of the process, and raised at
+ * once when the kernel is idle, see port.c. */
+extern void vPortEnableVirtualTime( void );
+extern BaseType_t xPortVirtualTimeEnabled( void );
+extern unsigned long ulPortGetVirtualTimeNs( void );
+extern void vPortVirtualTimeIdle( void );
+
+/* Real time: ticks missed by the tick signal and raised late to catch up,
+ * and the largest delay of a tick behind its deadline, see port.c. */
+extern unsigned long ulPortGetMissedTicks( void );
+extern unsigned long ulPortGetMaxTickLagNs( void );
+
+/* Real time: called by the Idle task, wait for the next tick or interrupt
+ * instead of spinning, where the port can, see port.c. */
+extern void vPortIdleWait( void );
+
+/* External tick: no tick timer, the ticks are raised by vPortRaiseTicks()
+ * at the times it gives to the run-time counter, see port.c. */
+extern void vPortUseExternalTick( void );
+extern BaseType_t xPortExternalTickEnabled( void );
+extern void vPortRaiseTicks( UBaseType_t uxTicks, unsigned long ulTimeNs );
+
+/* Tickless idle: fast-forward the virtual clock to the next task to unblock,
+ * see port.c. */
+extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+/*-----------------------------------------------------------*/
+
 #define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
 #define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
 /*-----------------------------------------------------------*/
@@ -26,79 +26,216 @@
  *
  */
 
-#include <pthread.h>
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sched_getaffinity(). */
+#endif
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "wait_for_event.h"
 
+/*
+ * An event is a binary semaphore on a futex word, with a single waiter: the
+ * thread of a task, parked until the task is switched in again.
+ *
+ * Signalling an event nobody sleeps on costs no system call, and a parked
+ * thread is woken with a single FUTEX_WAKE. Before parking, a waiter spins
+ * for up to EVENT_SPIN_ITERATIONS in case the event is signalled from another
+ * CPU; it parks at once if the thread that created the event can only run
+ * on one CPU, where the signalling thread cannot run while it spins.
+ *
+ * The events are taken from a fixed pool, so the creation of a task and its
+ * deletion do not go through the heap; the pool only falls back to malloc()
+ * once all of its events are in use.
+ */
+
+#define EVENT_EMPTY        0
+#define EVENT_SIGNALLED    1
+#define EVENT_PARKED       2 /* empty, and its waiter sleeps on the futex */
+
+#ifndef EVENT_SPIN_ITERATIONS
+    #define EVENT_SPIN_ITERATIONS    1000
+#endif
+
+#define EVENT_POOL_SIZE    64
+
 struct event
 {
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    bool event_triggered;
+    uint32_t state;
+    unsigned int spin;
 };
 
+static struct event xEventPool[ EVENT_POOL_SIZE ];
+/* Bit i is set while xEventPool[ i ] is free. */
+static uint64_t ullFreeEvents = UINT64_MAX;
+
+static void prvInitEvent( struct event * ev );
+static bool prvTryConsume( struct event * ev );
+static bool prvWait( struct event * ev,
+                     const struct timespec * deadline );
+
 struct event * event_create()
 {
-    struct event * ev = malloc( sizeof( struct event ) );
+    struct event * ev = NULL;
+    uint64_t ullFree = __atomic_load_n( &ullFreeEvents, __ATOMIC_ACQUIRE );
+
+    while( ullFree != 0 )
+    {
+        int i = __builtin_ctzll( ullFree );
+
+        if( __atomic_compare_exchange_n( &ullFreeEvents, &ullFree, ullFree & ~( 1ULL << i ),
+                                         false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+        {
+            ev = &xEventPool[ i ];
+            break;
+        }
+    }
+
+    if( ev == NULL )
+    {
+        ev = malloc( sizeof( struct event ) );
+    }
 
-    ev->event_triggered = false;
-    pthread_mutex_init( &ev->mutex, NULL );
-    pthread_cond_init( &ev->cond, NULL );
+    prvInitEvent( ev );
     return ev;
 }
 
-void event_delete( struct event * ev )
+void event_reset( struct event * ev )
 {
-    pthread_mutex_destroy( &ev->mutex );
-    pthread_cond_destroy( &ev->cond );
-    free( ev );
+    prvInitEvent( ev );
 }
 
-bool event_wait( struct event * ev )
+void event_delete( struct event * ev )
 {
-    pthread_mutex_lock( &ev->mutex );
-
-    while( ev->event_triggered == false )
+    if( ( ev >= xEventPool ) && ( ev < xEventPool + EVENT_POOL_SIZE ) )
+    {
+        __atomic_fetch_or( &ullFreeEvents, 1ULL << ( ev - xEventPool ), __ATOMIC_RELEASE );
+    }
+    else
     {
-        pthread_cond_wait( &ev->cond, &ev->mutex );
+        free( ev );
     }
+}
 
-    ev->event_triggered = false;
-    pthread_mutex_unlock( &ev->mutex );
-    return true;
+bool event_wait( struct event * ev )
+{
+    return prvWait( ev, NULL );
 }
 bool event_wait_timed( struct event * ev,
                        time_t ms )
 {
     struct timespec ts;
-    int ret = 0;
 
-    clock_gettime( CLOCK_REALTIME, &ts );
-    //ts.tv_sec += ms;
-    ts.tv_nsec += (ms * 1000000);
-    pthread_mutex_lock( &ev->mutex );
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += ( ms % 1000 ) * 1000000;
 
-    while( (ev->event_triggered == false) && (ret == 0) )
+    if( ts.tv_nsec >= 1000000000 )
     {
-        ret = pthread_cond_timedwait( &ev->cond, &ev->mutex, &ts );
-
-        if( ( ret == -1 ) && ( errno == ETIMEDOUT ) )
-        {
-            return false;
-        }
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
     }
 
-    ev->event_triggered = false;
-    pthread_mutex_unlock( &ev->mutex );
-    return true;
+    return prvWait( ev, &ts );
 }
 
 void event_signal( struct event * ev )
 {
-    pthread_mutex_lock( &ev->mutex );
-    ev->event_triggered = true;
-    pthread_cond_signal( &ev->cond );
-    pthread_mutex_unlock( &ev->mutex );
+    if( __atomic_exchange_n( &ev->state, EVENT_SIGNALLED, __ATOMIC_RELEASE ) == EVENT_PARKED )
+    {
+        syscall( SYS_futex, &ev->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+    }
+}
+
+static void prvInitEvent( struct event * ev )
+{
+    cpu_set_t xCpus;
+
+    ev->state = EVENT_EMPTY;
+    ev->spin = 0;
+
+    if( ( sched_getaffinity( 0, sizeof( xCpus ), &xCpus ) == 0 ) && ( CPU_COUNT( &xCpus ) > 1 ) )
+    {
+        ev->spin = EVENT_SPIN_ITERATIONS;
+    }
+}
+
+static bool prvTryConsume( struct event * ev )
+{
+    uint32_t ulState = EVENT_SIGNALLED;
+
+    return __atomic_compare_exchange_n( &ev->state, &ulState, EVENT_EMPTY,
+                                        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED );
+}
+
+static bool prvWait( struct event * ev,
+                     const struct timespec * deadline )
+{
+    unsigned int i;
+
+    for( i = 0; i < ev->spin; i++ )
+    {
+        if( prvTryConsume( ev ) )
+        {
+            return true;
+        }
+
+        #if defined( __x86_64__ ) || defined( __i386__ )
+            __builtin_ia32_pause();
+        #endif
+    }
+
+    for( ; ; )
+    {
+        uint32_t ulState = EVENT_EMPTY;
+        struct timespec xTimeout, * pxTimeout = NULL;
+
+        if( prvTryConsume( ev ) )
+        {
+            return true;
+        }
+
+        /* Announce the waiter: fails if the event has just been signalled. */
+        if( !__atomic_compare_exchange_n( &ev->state, &ulState, EVENT_PARKED,
+                                          false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) &&
+            ( ulState != EVENT_PARKED ) )
+        {
+            continue;
+        }
+
+        if( deadline != NULL )
+        {
+            struct timespec xNow;
+
+            clock_gettime( CLOCK_MONOTONIC, &xNow );
+            xTimeout.tv_sec = deadline->tv_sec - xNow.tv_sec;
+            xTimeout.tv_nsec = deadline->tv_nsec - xNow.tv_nsec;
+
+            if( xTimeout.tv_nsec < 0 )
+            {
+                xTimeout.tv_sec--;
+                xTimeout.tv_nsec += 1000000000;
+            }
+
+            if( xTimeout.tv_sec < 0 )
+            {
+                /* Timed out: withdraw, unless signalled in the meantime. */
+                ulState = EVENT_PARKED;
+                return !__atomic_compare_exchange_n( &ev->state, &ulState, EVENT_EMPTY,
+                                                     false, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) &&
+                       prvTryConsume( ev );
+            }
+
+            pxTimeout = &xTimeout;
+        }
+
+        /* Returns at once if the event is not EVENT_PARKED anymore, and on
+         * EINTR, EAGAIN or ETIMEDOUT, all handled by the loop. */
+        syscall( SYS_futex, &ev->state, FUTEX_WAIT_PRIVATE, EVENT_PARKED, pxTimeout, NULL, 0 );
+    }
 }
@@ -36,6 +36,7 @@ struct event;
 
 struct event * event_create();
 void event_delete( struct event * );
+void event_reset( struct event * ev );
 bool event_wait( struct event * ev );
 bool event_wait_timed( struct event * ev,
                        time_t ms );
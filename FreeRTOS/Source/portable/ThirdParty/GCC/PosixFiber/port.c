@@ -0,0 +1,1318 @@
+/*
+ * FreeRTOS Kernel V10.4.4
+ * Copyright (C) 2020 Cambridge Consultants Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the Posix port,
+ * with the tasks run as fibers of a single thread.
+ *
+ * Each task is a user-level context (ucontext) on a stack mapped by the
+ * port, and all of them run on the thread that starts the scheduler. A task
+ * switch is a swapcontext() to the context of the next task: no other thread
+ * is woken up, and no condition variable or futex is involved.
+ *
+ * Critical sections only set a flag: the tick signal is never blocked while
+ * a task runs. The tick handler raises the tick at once if the interrupts
+ * are enabled, and leaves it pending otherwise, for vPortEnableInterrupts()
+ * to raise at the end of the critical section. The simulated interrupts
+ * raised by another thread follow the same path, on the interrupt signal.
+ *
+ * All the tasks share the locks of the C library held by the thread, which
+ * are recursive (stdio) or not (malloc()): a task preempted while it executes
+ * code of a shared library could break the state of a lock, or deadlock on
+ * it, in the next task. A tick that interrupts a task outside of the
+ * executable is left pending, and a short one-shot timer signals the thread
+ * again until the task is back in it. This is the safe point of the tick.
+ * Whatever is pending is also delivered before any task switch, so that the
+ * kernel always picks the next task with every tick and interrupt raised.
+ *
+ * On the wall clock the Idle task waits for the next signal instead of
+ * spinning: the thread of the fibers is the only one of the instance, and a
+ * spinning Idle task would keep the other instances off the CPU (and their
+ * ticks pending) for a whole time slice.
+ *
+ * The scheduler can be ended by another thread (the injector): the request
+ * is signalled to the thread of the fibers, which leaves them at its next
+ * safe point, whatever the state of their critical sections.
+ *----------------------------------------------------------*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* REG_* indices of the machine context. */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/times.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+/*-----------------------------------------------------------*/
+
+#define SIG_INTERRUPT SIGUSR2
+
+#ifndef sigev_notify_thread_id
+    #define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/* Simulated interrupts: numbers 0 to portMAX_INTERRUPTS - 1. */
+#define portMAX_INTERRUPTS 32
+
+static uint32_t (*pxInterruptHandlers[ portMAX_INTERRUPTS ])( void );
+
+typedef struct FIBER
+{
+    ucontext_t xContext;
+    pdTASK_CODE pxCode;
+    void *pvParams;
+    BaseType_t xDying;
+    void *pvStack;
+} Fiber_t;
+
+/* Upper bound on the number of task fibers tracked (reset). */
+#define portMAX_FIBERS 32
+
+/* Stack of a fiber, mapped on demand, with a guard page at its end: the stack
+ * of a task given by the kernel (configMINIMAL_STACK_SIZE) is far too small
+ * for the C library. */
+#define portFIBER_STACK_SIZE ( 1024 * 1024 )
+#define portFIBER_GUARD_SIZE ( 4096 )
+
+/* The one-shot timer that signals the thread again while a tick, or the end
+ * of the scheduler, waits for the running task to leave a shared library. */
+#define portRETRY_TIMER 1
+#define portRETRY_NS ( 50 * 1000 )
+
+/* Retries after which the end of the scheduler no longer waits for the task
+ * (e.g. it hangs in a shared library). */
+#define portMAX_END_RETRIES 2000
+
+/*
+ * The fiber is stored at the end of its own stack, and a pointer to it at
+ * the beginning of the task's stack.
+ */
+static inline Fiber_t *prvGetFiberFromTask( TaskHandle_t xTask )
+{
+StackType_t *pxTopOfStack = *( StackType_t ** ) xTask;
+
+    return *( Fiber_t ** ) ( pxTopOfStack + 1 );
+}
+/*-----------------------------------------------------------*/
+
+/* Thread running the fibers, and its context outside of them. */
+static pthread_t hSchedulerThread;
+static pid_t xSchedulerTid;
+static ucontext_t xSchedulerContext;
+static volatile BaseType_t xFibersRunning = pdFALSE;
+static Fiber_t *pxFibers[ portMAX_FIBERS ];
+/*-----------------------------------------------------------*/
+
+/* Interrupts of the running task: the critical section nesting and the
+ * interrupt flag are saved and restored at each switch, see prvSwitchFiber(). */
+static volatile portBASE_TYPE uxCriticalNesting;
+static volatile BaseType_t xInterruptsDisabled = pdFALSE;
+/* Signals received and not handled yet. */
+static volatile BaseType_t xTickPending = pdFALSE;
+static volatile BaseType_t xEndRequested = pdFALSE;
+/* One bit per simulated interrupt number. */
+static volatile uint32_t ulPendingInterrupts = 0;
+static volatile BaseType_t xRetryArmed = pdFALSE;
+/* The thread of the fibers signals itself, see prvRaiseTickSignal(), or
+ * waits for a signal in the Idle task, see vPortIdleWait(). */
+static volatile BaseType_t xSignallingSelf = pdFALSE;
+static volatile BaseType_t xIdleWaiting = pdFALSE;
+static unsigned long ulEndRetries = 0;
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE xSchedulerEnd = pdFALSE;
+static portBASE_TYPE xSchedulerStarted = pdFALSE;
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE xSnapshotsEnabled = pdFALSE;
+/* Context interrupted by the tick being handled, if any. */
+static ucontext_t *pxInterruptedContext = NULL;
+/*-----------------------------------------------------------*/
+
+/* Signals of the tick and of the simulated interrupts: one copy of the port
+ * per process uses the defaults, see vPortUseInstanceSignals() otherwise. */
+static int iTickSignal = SIGALRM;
+static int iInterruptSignal = SIG_INTERRUPT;
+static timer_t xTickTimer;
+static timer_t xRetryTimer;
+/*-----------------------------------------------------------*/
+
+/* Virtual time: the simulated clock only advances by one tick period at each
+ * tick, see vPortEnableVirtualTime(). */
+static BaseType_t xVirtualTime = pdFALSE;
+static volatile uint64_t ullVirtualTimeNs = 0;
+/* Ticks of the virtual clock signalled and not raised yet. */
+static volatile UBaseType_t uxVirtualTicks = 0;
+/*-----------------------------------------------------------*/
+
+/* Real time: ticks raised since the start of the scheduler, against the
+ * deadlines of the tick timer, see prvCatchUpTicks(). */
+static uint64_t ullTicksRaised = 0;
+static uint64_t ullMissedTicks = 0;
+static uint64_t ullMaxTickLagNs = 0;
+/*-----------------------------------------------------------*/
+
+/* External tick: ticks raised by vPortRaiseTicks() and not yet handled, and
+ * the time of the run-time counter once they are. */
+static BaseType_t xExternalTick = pdFALSE;
+static volatile UBaseType_t uxExternalTicks = 0;
+static volatile uint64_t ullExternalTimeNs = 0;
+/*-----------------------------------------------------------*/
+
+/* Called by the tick handler with the number of ticks it is about to raise
+ * (0 for the signal of a tick already raised). */
+#ifndef traceTICK_INTERRUPT
+    #define traceTICK_INTERRUPT( uxTicks )
+#endif
+/*-----------------------------------------------------------*/
+
+static void prvSetupSignals( void );
+static void prvSetupTimerInterrupt( void );
+static void prvSetupVirtualTimerInterrupt( void );
+static void prvSetupRetryTimer( void );
+static void prvCreateTimer( clockid_t xClock, int iValue, timer_t *pxTimer );
+static void prvRestartVirtualTick( void );
+static UBaseType_t prvCatchUpTicks( void );
+static void prvArmRetry( void );
+static void prvFiberStart( void );
+static void prvSwitchFiber( Fiber_t *pxFiberToResume,
+                            Fiber_t *pxFiberToSuspend );
+static void prvHandleInterrupts( ucontext_t *pxContext, BaseType_t xSafePoint );
+static void prvRaiseTickSignal( void );
+static void prvRaisePending( ucontext_t *pxContext );
+static BaseType_t prvDeliverPending( void );
+static void prvLeaveFibers( void );
+static BaseType_t prvServeInterrupts( void );
+static void prvTickSignalHandler( int iSignal, siginfo_t *pxInfo, void *pvContext );
+static void prvInterruptSignalHandler( int iSignal, siginfo_t *pxInfo, void *pvContext );
+static BaseType_t prvOnSchedulerThread( void );
+static void prvRegisterFiber( Fiber_t *pxFiber );
+static void prvUnregisterFiber( Fiber_t *pxFiber );
+static BaseType_t prvInterruptedInExecutable( ucontext_t *pxContext );
+/*-----------------------------------------------------------*/
+
+static void prvFatalError( const char *pcCall, int iErrno )
+{
+    fprintf( stderr, "%s: %s\n", pcCall, strerror( iErrno ) );
+    abort();
+}
+
+/*
+ * See header file for description.
+ */
+portSTACK_TYPE *pxPortInitialiseStack( portSTACK_TYPE *pxTopOfStack,
+                                       portSTACK_TYPE *pxEndOfStack,
+                                       pdTASK_CODE pxCode, void *pvParameters )
+{
+Fiber_t **ppxFiber;
+Fiber_t *pxFiber;
+char *pcStack;
+
+    ( void ) pxEndOfStack;
+
+    pcStack = mmap( NULL, portFIBER_STACK_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0 );
+    if ( pcStack == MAP_FAILED )
+    {
+        prvFatalError( "mmap", errno );
+    }
+    if ( mprotect( pcStack, portFIBER_GUARD_SIZE, PROT_NONE ) )
+    {
+        prvFatalError( "mprotect", errno );
+    }
+
+    pxFiber = ( Fiber_t * ) ( pcStack + portFIBER_STACK_SIZE ) - 1;
+    pxFiber->pxCode = pxCode;
+    pxFiber->pvParams = pvParameters;
+    pxFiber->xDying = pdFALSE;
+    pxFiber->pvStack = pcStack;
+
+    /* The fiber starts with the signal mask of the caller, but for the
+     * signals of the port, see prvFiberStart(). */
+    if ( getcontext( &pxFiber->xContext ) )
+    {
+        prvFatalError( "getcontext", errno );
+    }
+    pxFiber->xContext.uc_stack.ss_sp = pcStack + portFIBER_GUARD_SIZE;
+    pxFiber->xContext.uc_stack.ss_size = ( char * ) pxFiber - ( pcStack + portFIBER_GUARD_SIZE );
+    pxFiber->xContext.uc_link = NULL;
+    sigdelset( &pxFiber->xContext.uc_sigmask, iTickSignal );
+    sigdelset( &pxFiber->xContext.uc_sigmask, iInterruptSignal );
+    makecontext( &pxFiber->xContext, prvFiberStart, 0 );
+
+    prvRegisterFiber( pxFiber );
+
+    /*
+     * Store the pointer to the fiber at the start of the stack.
+     */
+    ppxFiber = ( Fiber_t ** ) ( pxTopOfStack + 1 ) - 1;
+    *ppxFiber = pxFiber;
+
+    return ( portSTACK_TYPE * ) ppxFiber - 1;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+portBASE_TYPE xPortStartScheduler( void )
+{
+Fiber_t *pxFirstFiber;
+sigset_t xSignals;
+sigset_t xOriginalSignalMask;
+
+    hSchedulerThread = pthread_self();
+    xSchedulerTid = ( pid_t ) syscall( SYS_gettid );
+    xSchedulerStarted = pdTRUE;
+
+    ullTicksRaised = 0;
+    ullMissedTicks = 0;
+    ullMaxTickLagNs = 0;
+    uxVirtualTicks = 0;
+    xTickPending = pdFALSE;
+    xEndRequested = pdFALSE;
+    xRetryArmed = pdFALSE;
+    ulEndRetries = 0;
+
+    prvSetupSignals();
+
+    /* Start the timer that generates the tick ISR, directed to this thread.
+       Interrupts are disabled here already. */
+    prvSetupTimerInterrupt();
+    prvSetupRetryTimer();
+
+    sigemptyset( &xSignals );
+    sigaddset( &xSignals, iTickSignal );
+    sigaddset( &xSignals, iInterruptSignal );
+    ( void ) pthread_sigmask( SIG_UNBLOCK, &xSignals, &xOriginalSignalMask );
+
+    /* Start the first task: back here once the scheduler has ended, see
+     * prvLeaveFibers(). */
+    pxFirstFiber = prvGetFiberFromTask( xTaskGetCurrentTaskHandle() );
+    xFibersRunning = pdTRUE;
+    if ( swapcontext( &xSchedulerContext, &pxFirstFiber->xContext ) )
+    {
+        prvFatalError( "swapcontext", errno );
+    }
+
+    uxCriticalNesting = 0;
+    xInterruptsDisabled = pdFALSE;
+
+    /* Cancel the Idle task and free its resources */
+#if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
+    vTaskDelete( xTaskGetIdleTaskHandle() );
+#endif
+
+    /* The simulated interrupts left pending when the scheduler was ended
+     * are served now, as by the main thread of the threaded port. */
+    ( void ) prvServeInterrupts();
+
+    /* Restore original signal mask. */
+    ( void ) pthread_sigmask( SIG_SETMASK, &xOriginalSignalMask, NULL );
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+    if ( !xFibersRunning )
+    {
+        return;
+    }
+
+    if ( prvOnSchedulerThread() )
+    {
+        prvLeaveFibers();
+    }
+
+    /* Called by another thread (e.g. the injector): the thread of the fibers
+     * leaves them at its next safe point. */
+    xEndRequested = pdTRUE;
+    pthread_kill( hSchedulerThread, iInterruptSignal );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+    if ( uxCriticalNesting == 0 )
+    {
+        vPortDisableInterrupts();
+    }
+    uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+    uxCriticalNesting--;
+
+    /* If we have reached 0 then re-enable the interrupts. */
+    if( uxCriticalNesting == 0 )
+    {
+        vPortEnableInterrupts();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldFromISR( void )
+{
+Fiber_t *pxFiberToSuspend;
+Fiber_t *pxFiberToResume;
+
+    pxFiberToSuspend = prvGetFiberFromTask( xTaskGetCurrentTaskHandle() );
+
+    /* A task yields from the kernel, a safe point: the ticks and interrupts
+     * left pending (e.g. in a critical section) come first, as they would
+     * preempt the switch on a target. */
+    if ( xFibersRunning && prvOnSchedulerThread() )
+    {
+        ( void ) prvDeliverPending();
+    }
+
+    vTaskSwitchContext();
+
+    pxFiberToResume = prvGetFiberFromTask( xTaskGetCurrentTaskHandle() );
+
+    prvSwitchFiber( pxFiberToResume, pxFiberToSuspend );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+    vPortEnterCritical();
+
+    vPortYieldFromISR();
+
+    vPortExitCritical();
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+    /* The interrupts of the fibers are not disabled by another thread, e.g.
+     * the injector ending the scheduler. */
+    if ( prvOnSchedulerThread() )
+    {
+        /* A call to the kernel is a safe point: a tick left pending in a
+         * shared library is raised before the kernel state changes. */
+        if ( !xInterruptsDisabled && ( xTickPending || ulPendingInterrupts || xEndRequested ) )
+        {
+            prvHandleInterrupts( NULL, pdTRUE );
+        }
+
+        xInterruptsDisabled = pdTRUE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+    if ( prvOnSchedulerThread() )
+    {
+        xInterruptsDisabled = pdFALSE;
+
+        /* Signals received in the critical section. */
+        if ( xTickPending || ulPendingInterrupts || xEndRequested )
+        {
+            prvHandleInterrupts( NULL, pdTRUE );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortSetInterruptMask( void )
+{
+    /* Interrupts are always disabled inside ISRs (signals
+       handlers). */
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMask( portBASE_TYPE xMask )
+{
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvOnSchedulerThread( void )
+{
+    return !xSchedulerStarted || pthread_equal( pthread_self(), hSchedulerThread );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetTimeNs(void)
+{
+struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static uint64_t prvStartTimeNs;
+/*-----------------------------------------------------------*/
+
+/*
+ * Timers of the port, whose signal is directed to the thread of the fibers:
+ * the tick signal can only be handled there.
+ */
+static void prvCreateTimer( clockid_t xClock, int iValue, timer_t *pxTimer )
+{
+struct sigevent xEvent;
+
+    memset( &xEvent, 0, sizeof( xEvent ) );
+    xEvent.sigev_notify = SIGEV_THREAD_ID;
+    xEvent.sigev_signo = iTickSignal;
+    xEvent.sigev_value.sival_int = iValue;
+    xEvent.sigev_notify_thread_id = xSchedulerTid;
+
+    if ( timer_create( xClock, &xEvent, pxTimer ) )
+    {
+        prvFatalError( "timer_create", errno );
+    }
+}
+
+/*
+ * Setup the systick timer to generate the tick interrupts at the required
+ * frequency.
+ *
+ * As in the threaded port, the deadlines of the tick are absolute, start + N
+ * periods: the ticks whose signal got merged with a later one, or that were
+ * left pending until a safe point, are raised by prvCatchUpTicks().
+ */
+static void prvSetupTimerInterrupt( void )
+{
+struct itimerspec xPeriod;
+uint64_t ullFirstDeadlineNs;
+
+    if ( xVirtualTime )
+    {
+        prvSetupVirtualTimerInterrupt();
+        return;
+    }
+
+    if ( xExternalTick )
+    {
+        return;
+    }
+
+    prvCreateTimer( CLOCK_MONOTONIC, 0, &xTickTimer );
+
+    /* A snapshot restored later resumes at the tick it was taken: the time
+     * it was paused is not counted as missed ticks. */
+    prvStartTimeNs = prvGetTimeNs() - ullTicksRaised * ( portTICK_RATE_MICROSECONDS * 1000ull );
+    ullFirstDeadlineNs = prvStartTimeNs + ( ullTicksRaised + 1 ) * ( portTICK_RATE_MICROSECONDS * 1000ull );
+
+    xPeriod.it_interval.tv_sec = 0;
+    xPeriod.it_interval.tv_nsec = portTICK_RATE_MICROSECONDS * 1000;
+    xPeriod.it_value.tv_sec = ullFirstDeadlineNs / 1000000000ull;
+    xPeriod.it_value.tv_nsec = ullFirstDeadlineNs % 1000000000ull;
+
+    if ( timer_settime( xTickTimer, TIMER_ABSTIME, &xPeriod, NULL ) )
+    {
+        prvFatalError( "timer_settime", errno );
+    }
+}
+
+static void prvSetupRetryTimer( void )
+{
+    xRetryArmed = pdFALSE;
+    prvCreateTimer( CLOCK_MONOTONIC, portRETRY_TIMER, &xRetryTimer );
+}
+
+static void prvArmRetry( void )
+{
+struct itimerspec xDelay;
+
+    if ( xRetryArmed )
+    {
+        return;
+    }
+
+    memset( &xDelay, 0, sizeof( xDelay ) );
+    xDelay.it_value.tv_nsec = portRETRY_NS;
+
+    xRetryArmed = pdTRUE;
+    if ( timer_settime( xRetryTimer, 0, &xDelay, NULL ) )
+    {
+        prvFatalError( "timer_settime", errno );
+    }
+}
+
+/*
+ * Number of ticks whose deadline has passed, see the threaded port.
+ */
+static UBaseType_t prvCatchUpTicks( void )
+{
+uint64_t ullPeriodNs = portTICK_RATE_MICROSECONDS * 1000ull;
+uint64_t ullNowNs = prvGetTimeNs();
+uint64_t ullExpectedTicks = ( ullNowNs - prvStartTimeNs ) / ullPeriodNs;
+uint64_t ullLagNs;
+UBaseType_t uxTicks;
+
+    if ( ullExpectedTicks <= ullTicksRaised )
+    {
+        /* Signal of a tick already raised by a previous catch-up. */
+        return 0;
+    }
+
+    ullLagNs = ullNowNs - ( prvStartTimeNs + ( ullTicksRaised + 1 ) * ullPeriodNs );
+    if ( ullLagNs > ullMaxTickLagNs )
+    {
+        ullMaxTickLagNs = ullLagNs;
+    }
+
+    ullMissedTicks += ullExpectedTicks - ullTicksRaised - 1;
+
+    uxTicks = ( UBaseType_t ) ( ullExpectedTicks - ullTicksRaised );
+    ullTicksRaised = ullExpectedTicks;
+
+    return uxTicks;
+}
+
+unsigned long ulPortGetMissedTicks( void )
+{
+    return ( unsigned long ) ullMissedTicks;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetMaxTickLagNs( void )
+{
+    return ( unsigned long ) ullMaxTickLagNs;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Virtual time: a tick period of CPU time consumed by the process raises the
+ * tick, see the threaded port.
+ */
+static void prvSetupVirtualTimerInterrupt( void )
+{
+    prvCreateTimer( CLOCK_PROCESS_CPUTIME_ID, 0, &xTickTimer );
+
+    prvRestartVirtualTick();
+}
+
+static void prvRestartVirtualTick( void )
+{
+struct itimerspec xPeriod;
+
+    xPeriod.it_interval.tv_sec = 0;
+    xPeriod.it_interval.tv_nsec = portTICK_RATE_MICROSECONDS * 1000;
+    xPeriod.it_value = xPeriod.it_interval;
+
+    if ( timer_settime( xTickTimer, 0, &xPeriod, NULL ) )
+    {
+        prvFatalError( "timer_settime", errno );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvTickSignalHandler( int iSignal, siginfo_t *pxInfo, void *pvContext )
+{
+BaseType_t xFromSelf = xSignallingSelf || xIdleWaiting;
+
+    ( void ) iSignal;
+    xSignallingSelf = pdFALSE;
+    xIdleWaiting = pdFALSE;
+
+    if ( pxInfo->si_code == SI_TIMER && pxInfo->si_value.sival_int == portRETRY_TIMER )
+    {
+        xRetryArmed = pdFALSE;
+    }
+    else
+    {
+        if ( xVirtualTime )
+        {
+            /* The budget of CPU time restarts now, even if the tick is only
+             * raised at the next safe point. */
+            ullVirtualTimeNs += portTICK_RATE_MICROSECONDS * 1000ull;
+            prvRestartVirtualTick();
+            uxVirtualTicks++;
+        }
+        xTickPending = pdTRUE;
+    }
+
+    prvHandleInterrupts( pvContext, xFromSelf );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInterruptSignalHandler( int iSignal, siginfo_t *pxInfo, void *pvContext )
+{
+BaseType_t xFromIdle = xIdleWaiting;
+
+    ( void ) iSignal;
+    ( void ) pxInfo;
+    xIdleWaiting = pdFALSE;
+
+    if ( xFibersRunning )
+    {
+        /* A simulated interrupt raised by another thread, or a request to
+         * end the scheduler, see vPortEndScheduler(). */
+        prvHandleInterrupts( pvContext, xFromIdle );
+    }
+    else
+    {
+        ( void ) prvServeInterrupts();
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Called by the signal handlers with the interrupted context, and by
+ * vPortEnableInterrupts() with NULL. xSafePoint if the interrupted code is
+ * known not to hold any lock of the C library.
+ */
+static void prvHandleInterrupts( ucontext_t *pxContext, BaseType_t xSafePoint )
+{
+BaseType_t xInExecutable;
+
+    if ( !xFibersRunning )
+    {
+        return;
+    }
+
+    /* Not through pxInterruptedContext: the interrupt signal may land here
+     * while the tick handler uses it. */
+    xInExecutable = xSafePoint || prvInterruptedInExecutable( pxContext );
+
+    if ( xEndRequested )
+    {
+        /* The fibers are abandoned: their critical sections do not matter,
+         * unlike the locks of the C library that the thread keeps using. */
+        if ( xInExecutable || ++ulEndRetries > portMAX_END_RETRIES )
+        {
+            prvLeaveFibers();
+        }
+        prvArmRetry();
+        return;
+    }
+
+    if ( ( !xTickPending && !ulPendingInterrupts ) || xInterruptsDisabled )
+    {
+        /* Raised by vPortEnableInterrupts() at the end of the critical
+         * section. */
+        return;
+    }
+
+    if ( !xInExecutable )
+    {
+        prvArmRetry();
+        return;
+    }
+
+    /* Including those signalled while this task was switched out. */
+    while ( ( xTickPending || ulPendingInterrupts ) && !xInterruptsDisabled && xFibersRunning )
+    {
+        prvRaisePending( pxContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvRaisePending( ucontext_t *pxContext )
+{
+Fiber_t *pxFiberToSuspend;
+BaseType_t xSwitchRequired;
+
+    uxCriticalNesting++;
+    xInterruptsDisabled = pdTRUE;
+    pxInterruptedContext = pxContext;
+
+    pxFiberToSuspend = prvGetFiberFromTask( xTaskGetCurrentTaskHandle() );
+    xSwitchRequired = prvDeliverPending();
+    pxInterruptedContext = NULL;
+
+#if ( configUSE_PREEMPTION == 1 )
+    if ( xSwitchRequired )
+    {
+        /* Select Next Task. */
+        vTaskSwitchContext();
+        prvSwitchFiber( prvGetFiberFromTask( xTaskGetCurrentTaskHandle() ), pxFiberToSuspend );
+    }
+#endif
+
+    uxCriticalNesting--;
+    xInterruptsDisabled = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Raise the pending ticks and serve the pending interrupts, with the
+ * interrupts disabled, until none is left: including those raised by the
+ * kernel hooks and the handlers meanwhile, and those signalled during the
+ * handling. Whether a task switch is required.
+ */
+static BaseType_t prvDeliverPending( void )
+{
+BaseType_t xSwitchRequired = pdFALSE;
+UBaseType_t uxTicks;
+
+    while ( xTickPending || ulPendingInterrupts )
+    {
+        if ( !xTickPending )
+        {
+            if ( prvServeInterrupts() )
+            {
+                xSwitchRequired = pdTRUE;
+            }
+            continue;
+        }
+
+        xTickPending = pdFALSE;
+
+        /* Tick Increment, accounting for the ticks signalled since the last
+         * safe point. */
+        if ( xVirtualTime )
+        {
+            uxTicks = __atomic_exchange_n( &uxVirtualTicks, 0, __ATOMIC_ACQ_REL );
+        }
+        else if ( xExternalTick )
+        {
+            uxTicks = __atomic_exchange_n( &uxExternalTicks, 0, __ATOMIC_ACQ_REL );
+            ullVirtualTimeNs = ullExternalTimeNs;
+        }
+        else
+        {
+            uxTicks = prvCatchUpTicks();
+        }
+
+        traceTICK_INTERRUPT( uxTicks );
+
+        while ( uxTicks-- > 0 )
+        {
+            xTaskIncrementTick();
+        }
+
+        /* As on the tick interrupt of a target, the next task is selected
+         * again after a tick. */
+        xSwitchRequired = pdTRUE;
+    }
+
+    return xSwitchRequired;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLeaveFibers( void )
+{
+struct sigaction sigtick;
+
+    xFibersRunning = pdFALSE;
+    xSchedulerEnd = pdTRUE;
+
+    /* Stop the timers and ignore any pending tick signal that would end up
+     * running once the scheduler context is restored. */
+    if ( !xExternalTick )
+    {
+        timer_delete( xTickTimer );
+    }
+    timer_delete( xRetryTimer );
+
+    sigtick.sa_flags = 0;
+    sigtick.sa_handler = SIG_IGN;
+    sigemptyset( &sigtick.sa_mask );
+    sigaction( iTickSignal, &sigtick, NULL );
+
+    /* Back to xPortStartScheduler(), with its signal mask. */
+    setcontext( &xSchedulerContext );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Signal a tick to the thread of the fibers. When the thread signals itself
+ * the signal interrupts pthread_kill(), which holds no lock of the C library
+ * in that case: it is handled as if it had interrupted the caller, instead
+ * of waiting for the retry timer.
+ */
+static void prvRaiseTickSignal( void )
+{
+    if ( pthread_equal( pthread_self(), hSchedulerThread ) )
+    {
+        xSignallingSelf = pdTRUE;
+        pthread_kill( hSchedulerThread, iTickSignal );
+        xSignallingSelf = pdFALSE;
+    }
+    else
+    {
+        pthread_kill( hSchedulerThread, iTickSignal );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Call the handler of each pending interrupt: whether one of them requires
+ * a task switch.
+ */
+static BaseType_t prvServeInterrupts( void )
+{
+uint32_t ulPending = __atomic_exchange_n( &ulPendingInterrupts, 0, __ATOMIC_ACQ_REL );
+BaseType_t xSwitchRequired = pdFALSE;
+
+    while ( ulPending != 0 )
+    {
+        uint32_t ulInterruptNumber = __builtin_ctz( ulPending );
+
+        ulPending &= ulPending - 1;
+        if ( pxInterruptHandlers[ ulInterruptNumber ] != NULL &&
+             pxInterruptHandlers[ ulInterruptNumber ]() != pdFALSE )
+        {
+            xSwitchRequired = pdTRUE;
+        }
+    }
+
+    return xSwitchRequired;
+}
+/*-----------------------------------------------------------*/
+
+void vPortThreadDying( void *pxTaskToDelete, volatile BaseType_t *pxPendYield )
+{
+Fiber_t *pxFiber = prvGetFiberFromTask( pxTaskToDelete );
+
+    pxFiber->xDying = pdTRUE;
+}
+
+void vPortCancelThread( void *pxTaskToDelete )
+{
+Fiber_t *pxFiberToCancel = prvGetFiberFromTask( pxTaskToDelete );
+
+    /* The fiber is not running (the Idle task cleans up the tasks that
+     * deleted themselves): its stack can go. */
+    prvUnregisterFiber( pxFiberToCancel );
+    munmap( pxFiberToCancel->pvStack, portFIBER_STACK_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFiberStart( void )
+{
+Fiber_t *pxFiber = prvGetFiberFromTask( xTaskGetCurrentTaskHandle() );
+
+    /* Resumed for the first time, with the interrupts enabled. */
+    uxCriticalNesting = 0;
+    vPortEnableInterrupts();
+
+    /* Call the task's entry point. */
+    pxFiber->pxCode( pxFiber->pvParams );
+
+    /* A function that implements a task must not exit or attempt to return to
+    * its caller as there is nothing to return to. If a task wants to exit it
+    * should instead call vTaskDelete( NULL ). Artificially force an assert()
+    * to be triggered if configASSERT() is defined, so application writers can
+        * catch the error. */
+    configASSERT( pdFALSE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSwitchFiber( Fiber_t *pxFiberToResume,
+                            Fiber_t *pxFiberToSuspend )
+{
+portBASE_TYPE uxSavedCriticalNesting;
+BaseType_t xSavedInterruptsDisabled;
+
+    if ( pxFiberToSuspend != pxFiberToResume )
+    {
+        /*
+         * Switch tasks.
+         *
+         * The critical section nesting and the interrupt flag are per-task,
+         * so save them on the stack of the current fiber, restoring them
+         * when we switch back to this task.
+         */
+        uxSavedCriticalNesting = uxCriticalNesting;
+        xSavedInterruptsDisabled = xInterruptsDisabled;
+
+        if ( pxFiberToSuspend->xDying )
+        {
+            /* Never resumed: the Idle task unmaps its stack. */
+            setcontext( &pxFiberToResume->xContext );
+        }
+
+        if ( swapcontext( &pxFiberToSuspend->xContext, &pxFiberToResume->xContext ) )
+        {
+            prvFatalError( "swapcontext", errno );
+        }
+
+        uxCriticalNesting = uxSavedCriticalNesting;
+        xInterruptsDisabled = xSavedInterruptsDisabled;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupSignals( void )
+{
+struct sigaction sigtick, siginterrupt;
+
+    /* Installed at each start: the tick signal is ignored once the scheduler
+     * has ended, see prvLeaveFibers(). */
+    sigtick.sa_flags = SA_SIGINFO;
+    sigtick.sa_sigaction = prvTickSignalHandler;
+    sigfillset( &sigtick.sa_mask );
+    /* Even a task that hangs in the tick handler can be left. */
+    sigdelset( &sigtick.sa_mask, iInterruptSignal );
+
+    if ( sigaction( iTickSignal, &sigtick, NULL ) )
+    {
+        prvFatalError( "sigaction", errno );
+    }
+
+    siginterrupt.sa_flags = SA_SIGINFO;
+    siginterrupt.sa_sigaction = prvInterruptSignalHandler;
+    sigfillset( &siginterrupt.sa_mask );
+
+    if ( sigaction( iInterruptSignal, &siginterrupt, NULL ) )
+    {
+        prvFatalError( "sigaction", errno );
+    }
+}
+
+void vPortGenerateSimulatedInterrupt(uint32_t ulInterruptNumber)
+{
+    if ( ulInterruptNumber >= portMAX_INTERRUPTS || !xSchedulerStarted )
+    {
+        return;
+    }
+
+    __atomic_fetch_or( &ulPendingInterrupts, 1UL << ulInterruptNumber, __ATOMIC_RELEASE );
+
+    if ( xFibersRunning && pthread_equal( pthread_self(), hSchedulerThread ) )
+    {
+        /* Raised by a task, a safe point: served at once, or at the end of
+         * its critical section. */
+        if ( !xInterruptsDisabled )
+        {
+            prvHandleInterrupts( NULL, pdTRUE );
+        }
+    }
+    else
+    {
+        /* Raised by another thread, or once the scheduler has ended. */
+        pthread_kill( hSchedulerThread, iInterruptSignal );
+    }
+}
+
+void vPortUseInstanceSignals( int iInstance )
+{
+    /* Signal dispositions are shared by the whole process: each copy of the
+     * port loaded in it (one per dlmopen() namespace) needs its own tick and
+     * interrupt signals. Its timers signal its own thread only. */
+    iTickSignal = SIGRTMIN + 2 * iInstance;
+    iInterruptSignal = SIGRTMIN + 2 * iInstance + 1;
+}
+
+void vPortEnableVirtualTime( void )
+{
+    /* Must be called before the scheduler is started. */
+    xVirtualTime = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortVirtualTimeEnabled( void )
+{
+    return xVirtualTime;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetVirtualTimeNs( void )
+{
+    return ( unsigned long ) ullVirtualTimeNs;
+}
+/*-----------------------------------------------------------*/
+
+void vPortUseExternalTick( void )
+{
+    /* Must be called before the scheduler is started. */
+    xExternalTick = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortExternalTickEnabled( void )
+{
+    return xExternalTick;
+}
+/*-----------------------------------------------------------*/
+
+void vPortRaiseTicks( UBaseType_t uxTicks, unsigned long ulTimeNs )
+{
+    /* Handled by the thread of the fibers at its next safe point, whichever
+     * thread raised it. */
+    ullExternalTimeNs = ulTimeNs;
+    __atomic_fetch_add( &uxExternalTicks, uxTicks, __ATOMIC_ACQ_REL );
+    prvRaiseTickSignal();
+}
+/*-----------------------------------------------------------*/
+
+void vPortVirtualTimeIdle( void )
+{
+    /* Nothing else is ready to run: raise the next tick at once instead of
+     * waiting for the timer. Interrupts are enabled in the Idle task, so the
+     * tick is handled before pthread_kill() returns. */
+    if ( xVirtualTime && xSchedulerStarted && !xSchedulerEnd )
+    {
+        prvRaiseTickSignal();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPortIdleWait( void )
+{
+sigset_t xSignals;
+sigset_t xOriginalSignalMask;
+sigset_t xWaitMask;
+
+    /* On the virtual clock the Idle task raises the next tick itself, see
+     * vPortVirtualTimeIdle(). */
+    if ( xVirtualTime || !xFibersRunning || !prvOnSchedulerThread() )
+    {
+        return;
+    }
+
+    /* Nothing can change the ready tasks until the next tick or interrupt:
+     * wait for its signal, as a target waits for an interrupt. The signals
+     * received before the wait are handled first. */
+    sigemptyset( &xSignals );
+    sigaddset( &xSignals, iTickSignal );
+    sigaddset( &xSignals, iInterruptSignal );
+    ( void ) pthread_sigmask( SIG_BLOCK, &xSignals, &xOriginalSignalMask );
+
+    if ( !xTickPending && !ulPendingInterrupts && !xEndRequested )
+    {
+        /* sigsuspend() holds no lock of the C library: the signal is handled
+         * as if it had interrupted the Idle task, see the signal handlers. */
+        xWaitMask = xOriginalSignalMask;
+        sigdelset( &xWaitMask, iTickSignal );
+        sigdelset( &xWaitMask, iInterruptSignal );
+        xIdleWaiting = pdTRUE;
+        sigsuspend( &xWaitMask );
+        xIdleWaiting = pdFALSE;
+    }
+
+    ( void ) pthread_sigmask( SIG_SETMASK, &xOriginalSignalMask, NULL );
+
+    /* Left pending if the Idle task was in a critical section. */
+    if ( !xInterruptsDisabled && ( xTickPending || ulPendingInterrupts || xEndRequested ) )
+    {
+        prvHandleInterrupts( NULL, pdTRUE );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    /* Only the virtual clock can skip the idle ticks: on the wall clock the
+     * Idle task keeps running until the next tick. */
+    if ( !xVirtualTime || xSchedulerEnd )
+    {
+        return;
+    }
+
+    /* Called with the scheduler suspended: the tick cannot change the ready
+     * tasks until the tick count is consistent again. */
+    vPortEnterCritical();
+
+    if ( eTaskConfirmSleepModeStatus() == eAbortSleep )
+    {
+        vPortExitCritical();
+        return;
+    }
+
+    /* Jump to the tick before the next task to unblock, keeping the run-time
+     * counter in step with the tick count ... */
+    vTaskStepTick( xExpectedIdleTime - 1 );
+    ullVirtualTimeNs += ( xExpectedIdleTime - 1 ) * ( portTICK_RATE_MICROSECONDS * 1000ull );
+
+    vPortExitCritical();
+
+    /* ... and raise the last one, which unblocks it (and calls the tick hook)
+     * once the scheduler is resumed. */
+    prvRaiseTickSignal();
+}
+/*-----------------------------------------------------------*/
+
+void vPortSetInterruptHandler( uint32_t ulInterruptNumber, uint32_t (*pvHandler)( void ) ) {
+    if ( ulInterruptNumber < portMAX_INTERRUPTS )
+    {
+        pxInterruptHandlers[ ulInterruptNumber ] = pvHandler;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Snapshots.
+ *
+ * The fibers are plain memory of the thread that runs them: the child of a
+ * fork() taken on that thread (before the scheduler is started, or from the
+ * tick interrupt) carries on with every task, and only needs timers of its
+ * own. From the tick interrupt the interrupted task must also be executing
+ * code of the application itself.
+ */
+static void prvRegisterFiber( Fiber_t *pxFiber )
+{
+int i;
+
+    for ( i = 0; i < portMAX_FIBERS; i++ )
+    {
+        if ( pxFibers[ i ] == NULL )
+        {
+            pxFibers[ i ] = pxFiber;
+            return;
+        }
+    }
+
+    prvFatalError( "prvRegisterFiber", ENOMEM );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUnregisterFiber( Fiber_t *pxFiber )
+{
+int i;
+
+    for ( i = 0; i < portMAX_FIBERS; i++ )
+    {
+        if ( pxFibers[ i ] == pxFiber )
+        {
+            pxFibers[ i ] = NULL;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvInterruptedInExecutable( ucontext_t *pxContext )
+{
+/* Text of the object the port is linked into: the executable, or the
+ * shared kernel when it is loaded by sim-multi. */
+extern char __ehdr_start[], etext[];
+char *pcProgramCounter;
+
+    if ( pxContext == NULL )
+    {
+        return pdTRUE;
+    }
+
+#if defined( __x86_64__ )
+    pcProgramCounter = ( char * ) pxContext->uc_mcontext.gregs[ REG_RIP ];
+#elif defined( __i386__ )
+    pcProgramCounter = ( char * ) pxContext->uc_mcontext.gregs[ REG_EIP ];
+#elif defined( __aarch64__ )
+    pcProgramCounter = ( char * ) pxContext->uc_mcontext.pc;
+#else
+    return pdFALSE;
+#endif
+
+    /* Outside of the executable the task may be holding a lock of a shared
+     * library (e.g. in malloc()), shared with the other tasks. */
+    return pcProgramCounter >= __ehdr_start && pcProgramCounter < etext;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableSnapshots( void )
+{
+    /* Must be called before the first task is created. */
+    xSnapshotsEnabled = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortSnapshotIsConsistent( void )
+{
+    if ( !xSnapshotsEnabled )
+    {
+        return pdFALSE;
+    }
+
+    /* fork() only duplicates the calling thread. */
+    if ( xFibersRunning && !pthread_equal( pthread_self(), hSchedulerThread ) )
+    {
+        return pdFALSE;
+    }
+
+    return prvInterruptedInExecutable( pxInterruptedContext );
+}
+/*-----------------------------------------------------------*/
+
+void vPortRestoreSnapshot( void )
+{
+    if ( xFibersRunning )
+    {
+        /* Interval timers are not inherited across fork(). */
+        hSchedulerThread = pthread_self();
+        xSchedulerTid = ( pid_t ) syscall( SYS_gettid );
+        prvSetupTimerInterrupt();
+        prvSetupRetryTimer();
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Reset.
+ *
+ * Once the scheduler has ended no fiber runs anymore: unmapping the stacks
+ * of the tasks that were not deleted lets the same process initialise the
+ * kernel again after restoring its globals.
+ */
+BaseType_t xPortResetThreads( void )
+{
+int i;
+
+    if ( xFibersRunning )
+    {
+        return pdFALSE;
+    }
+
+    for ( i = 0; i < portMAX_FIBERS; i++ )
+    {
+        if ( pxFibers[ i ] != NULL )
+        {
+            munmap( pxFibers[ i ]->pvStack, portFIBER_STACK_SIZE );
+            pxFibers[ i ] = NULL;
+        }
+    }
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetRunTime( void )
+{
+struct tms xTimes;
+
+    times( &xTimes );
+
+    return ( unsigned long ) xTimes.tms_utime;
+}
+/*-----------------------------------------------------------*/
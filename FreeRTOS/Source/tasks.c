@@ -2146,6 +2146,8 @@ void vTaskSuspendAll( void )
     /* Enforces ordering for ports and optimised compilers that may otherwise place
      * the above increment elsewhere. */
     portMEMORY_BARRIER();
+
+    traceTASK_SUSPEND_ALL();
 }
 /*----------------------------------------------------------*/
 
@@ -2229,6 +2231,7 @@ BaseType_t xTaskResumeAll( void )
     taskENTER_CRITICAL();
     {
         --uxSchedulerSuspended;
+        traceTASK_RESUME_ALL();
 
         if( uxSchedulerSuspended == ( UBaseType_t ) pdFALSE )
         {
@@ -3212,7 +3215,10 @@ BaseType_t xTaskRemoveFromEventList( const List_t * const pxEventList )
                  * tickless idling is used it might be more important to enter sleep mode
                  * at the earliest possible time - so reset xNextTaskUnblockTime here to
                  * ensure it is updated at the earliest possible time. */
-                prvResetNextTaskUnblockTime();
+                if( configTICKLESS_IDLE_ACTIVE() )
+                {
+                    prvResetNextTaskUnblockTime();
+                }
             }
         #endif
     }
@@ -3271,7 +3277,10 @@ void vTaskRemoveFromUnorderedEventList( ListItem_t * pxEventListItem,
              * tickless idling is used it might be more important to enter sleep mode
              * at the earliest possible time - so reset xNextTaskUnblockTime here to
              * ensure it is updated at the earliest possible time. */
-            prvResetNextTaskUnblockTime();
+            if( configTICKLESS_IDLE_ACTIVE() )
+            {
+                prvResetNextTaskUnblockTime();
+            }
         }
     #endif
 
@@ -3512,7 +3521,9 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
                  * valid. */
                 xExpectedIdleTime = prvGetExpectedIdleTime();
 
-                if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
+                /* While tickless idle is not active the Idle task runs as if
+                 * configUSE_TICKLESS_IDLE was 0. */
+                if( configTICKLESS_IDLE_ACTIVE() && ( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP ) )
                 {
                     vTaskSuspendAll();
                     {
@@ -4971,7 +4982,10 @@ TickType_t uxTaskResetEventItemValue( void )
                          * sleep mode at the earliest possible time - so reset
                          * xNextTaskUnblockTime here to ensure it is updated at the
                          * earliest possible time. */
-                        prvResetNextTaskUnblockTime();
+                        if( configTICKLESS_IDLE_ACTIVE() )
+                        {
+                            prvResetNextTaskUnblockTime();
+                        }
                     }
                 #endif
 
@@ -5437,6 +5451,11 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait,
 
 static target_t * read_TCB_targets(target_t *list);
 
+unsigned long get_received_ticks(void) {
+    // the ticks received while the scheduler is suspended are only pended
+    return (unsigned long)(xTickCount + xPendedTicks);
+}
+
 target_t * read_tasks_targets(target_t *target) {
 
     target = read_TCB_targets(target);
@@ -75,9 +75,21 @@
 
 #define configMAX_PRIORITIES					( 7 )
 
+#ifdef POSIX
+/* Tickless idle: on the virtual clock, the Idle task skips the ticks up to
+the next task to unblock, within the limits set by the simulator. On the wall
+clock it is not active, and the kernel runs as without tickless idle. */
+int isVirtualTime( void ); /* See vtime.h. */
+unsigned long limitIdleTicks( unsigned long ulExpectedIdleTicks ); /* See vtime.h. */
+#define configUSE_TICKLESS_IDLE					1
+#define configTICKLESS_IDLE_ACTIVE()			isVirtualTime()
+#define configPRE_SUPPRESS_TICKS_AND_SLEEP_PROCESSING( x ) ( x ) = limitIdleTicks( x )
+#endif
+
 /* Run time stats gathering configuration options. */
 unsigned long ulGetRunTimeCounterValue( void ); /* Prototype of function that returns run time counter. */
 void vConfigureTimerForRunTimeStats( void );	/* Prototype of function that initialises the run time counter. */
+void vRestoreTimerForRunTimeStats( unsigned long ulCounterValue );	/* Prototype of function that restarts the run time counter from a value. */
 #define configGENERATE_RUN_TIME_STATS			1
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() vConfigureTimerForRunTimeStats()
 #define portGET_RUN_TIME_COUNTER_VALUE() ulGetRunTimeCounterValue()
@@ -133,11 +145,28 @@ extern void vAssertCalled( unsigned long ulLine, const char * const pcFileName )
 
 /* Overriding Trace Hook Macros implemented in this file */
 #include "loggingUtils.h"
-#define traceTASK_SWITCHED_OUT() loggingFunction(0)
-#define traceTASK_SWITCHED_IN() loggingFunction(1)
-#define traceQUEUE_SEND_FAILED(pxQueue) loggingFunction(2)
-#define traceQUEUE_RECEIVE_FAILED(pxQueue) loggingFunction(3)
-#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue) loggingFunction(4)
-#define traceQUEUE_RECEIVE_FROM_ISR_FAILED(pxQueue) loggingFunction(5)
+#include "trigger.h"
+#include "replay.h"
+#define traceTASK_SWITCHED_OUT() do { loggingFunction(0); scheduleEvent(); triggerEvent(TRIGGER_EVENT_TASK_SWITCHED_OUT); } while (0)
+#define traceTASK_SWITCHED_IN() do { loggingFunction(1); scheduleSwitch(); triggerEvent(TRIGGER_EVENT_TASK_SWITCHED_IN); triggerEvent(TRIGGER_EVENT_TASK_IN); } while (0)
+#define traceQUEUE_SEND_FAILED(pxQueue) do { loggingFunction(2); scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_SEND_FAILED); } while (0)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) do { loggingFunction(3); scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_RECEIVE_FAILED); } while (0)
+#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue) do { loggingFunction(4); scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_SEND_FROM_ISR_FAILED); } while (0)
+#define traceQUEUE_RECEIVE_FROM_ISR_FAILED(pxQueue) do { loggingFunction(5); scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_RECEIVE_FROM_ISR_FAILED); } while (0)
+
+/* Hooks of the event triggers and of the schedule log only (see trigger.h and replay.h) */
+#define traceQUEUE_SEND(pxQueue) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_SEND); } while (0)
+#define traceQUEUE_RECEIVE(pxQueue) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_RECEIVE); } while (0)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_SEND_FROM_ISR); } while (0)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_QUEUE_RECEIVE_FROM_ISR); } while (0)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_BLOCKING_ON_QUEUE_SEND); } while (0)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_BLOCKING_ON_QUEUE_RECEIVE); } while (0)
+#define traceTASK_DELAY() do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_TASK_DELAY); } while (0)
+#define traceTASK_DELAY_UNTIL(xTimeToWake) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_TASK_DELAY_UNTIL); } while (0)
+#define traceTASK_INCREMENT_TICK(xTickCount) do { scheduleEvent(); triggerEvent(TRIGGER_EVENT_TASK_INCREMENT_TICK); } while (0)
+#define traceTICK_INTERRUPT(uxTicks) scheduleTick(uxTicks)
+/* A tick delivered while the scheduler is suspended is only pended (see replay.h) */
+#define traceTASK_SUSPEND_ALL() scheduleEvent()
+#define traceTASK_RESUME_ALL() scheduleEvent()
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,286 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "../simulator.h"
+
+#define SYSFS_CPU_DIR "/sys/devices/system/cpu"
+
+// inherited by the instances, across execv too
+#define INJECTOR_CPUS_ENV "SIM_INJECTOR_CPUS"
+
+/**
+ * State of the placement: the core sets the instances are pinned to
+ * and the number of running instances on each of them.
+ */
+static struct
+{
+    pthread_mutex_t lock;
+    int enabled;
+    cpu_set_t *coreSets;
+    int *nInstances;
+    int nCoreSets;
+    // affinity of the orchestrator before placement was enabled
+    cpu_set_t original;
+} placement = {PTHREAD_MUTEX_INITIALIZER};
+
+static int parseCpuList(const char *list, cpu_set_t *set);
+static int readCpuList(const char *path, cpu_set_t *set);
+
+int enableCpuPlacement(const char *reservedCpus)
+{
+    cpu_set_t allowed, online, reserved;
+    CPU_ZERO(&reserved);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ||
+        readCpuList(SYSFS_CPU_DIR "/online", &online) != 0)
+    {
+        ERR_PRINT("Couldn't read the CPU topology.\n");
+        return AFFINITY_FAILURE;
+    }
+
+    if (reservedCpus && parseCpuList(reservedCpus, &reserved) != 0)
+    {
+        ERR_PRINT("Invalid CPU list %s.\n", reservedCpus);
+        return AFFINITY_FAILURE;
+    }
+
+    // the CPUs the instances may use: allowed to the orchestrator and not reserved
+    cpu_set_t available;
+    CPU_AND(&available, &allowed, &online);
+    cpu_set_t reservedAvailable;
+    CPU_AND(&reservedAvailable, &available, &reserved);
+    CPU_XOR(&available, &available, &reservedAvailable);
+
+    cpu_set_t *coreSets = (cpu_set_t *)malloc(sizeof(cpu_set_t) * CPU_SETSIZE);
+    int nCoreSets = 0;
+
+    cpu_set_t assigned;
+    CPU_ZERO(&assigned);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &available) || CPU_ISSET(cpu, &assigned))
+            continue;
+
+        // the core set of cpu: its available SMT siblings (cpu alone if unknown)
+        char path[128];
+        snprintf(path, sizeof(path), SYSFS_CPU_DIR "/cpu%d/topology/thread_siblings_list", cpu);
+
+        cpu_set_t siblings;
+        if (readCpuList(path, &siblings) != 0)
+        {
+            CPU_ZERO(&siblings);
+        }
+        CPU_SET(cpu, &siblings);
+        CPU_AND(&siblings, &siblings, &available);
+
+        CPU_OR(&assigned, &assigned, &siblings);
+        coreSets[nCoreSets++] = siblings;
+    }
+
+    if (nCoreSets == 0)
+    {
+        ERR_PRINT("No CPU left for the instances.\n");
+        free(coreSets);
+        return AFFINITY_FAILURE;
+    }
+
+    pthread_mutex_lock(&placement.lock);
+
+    if (!placement.enabled)
+    {
+        placement.original = allowed;
+    }
+
+    free(placement.coreSets);
+    free(placement.nInstances);
+    placement.coreSets = coreSets;
+    placement.nInstances = (int *)calloc(nCoreSets, sizeof(int));
+    placement.nCoreSets = nCoreSets;
+    placement.enabled = 1;
+
+    pthread_mutex_unlock(&placement.lock);
+
+    // the threads of the orchestrator created from now on inherit its affinity
+    if (CPU_COUNT(&reservedAvailable) > 0)
+    {
+        sched_setaffinity(0, sizeof(reservedAvailable), &reservedAvailable);
+    }
+
+    DEBUG_PRINT("%d core sets for the instances, %d CPUs reserved.\n", nCoreSets, CPU_COUNT(&reservedAvailable));
+    return AFFINITY_SUCCESS;
+}
+
+void disableCpuPlacement(void)
+{
+    pthread_mutex_lock(&placement.lock);
+
+    if (placement.enabled)
+    {
+        sched_setaffinity(0, sizeof(placement.original), &placement.original);
+
+        free(placement.coreSets);
+        free(placement.nInstances);
+        placement.coreSets = NULL;
+        placement.nInstances = NULL;
+        placement.nCoreSets = 0;
+        placement.enabled = 0;
+    }
+
+    pthread_mutex_unlock(&placement.lock);
+}
+
+int acquireCoreSet(void)
+{
+    int coreSet = -1;
+
+    pthread_mutex_lock(&placement.lock);
+
+    for (int i = 0; placement.enabled && i < placement.nCoreSets; i++)
+    {
+        if (coreSet < 0 || placement.nInstances[i] < placement.nInstances[coreSet])
+            coreSet = i;
+    }
+
+    if (coreSet >= 0)
+        placement.nInstances[coreSet]++;
+
+    pthread_mutex_unlock(&placement.lock);
+
+    return coreSet;
+}
+
+void releaseCoreSet(int coreSet)
+{
+    pthread_mutex_lock(&placement.lock);
+
+    if (placement.enabled && coreSet >= 0 && coreSet < placement.nCoreSets)
+        placement.nInstances[coreSet]--;
+
+    pthread_mutex_unlock(&placement.lock);
+}
+
+void pinToCoreSet(int coreSet)
+{
+    // called right after fork(): the core sets are not modified by the only thread left
+    if (coreSet < 0 || coreSet >= placement.nCoreSets)
+    {
+        return;
+    }
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &placement.coreSets[coreSet]) != 0)
+    {
+        ERR_PRINT("Couldn't pin the instance to core set %d.\n", coreSet);
+    }
+}
+
+int countInstanceCpus(void)
+{
+    int nCpus = 0;
+
+    pthread_mutex_lock(&placement.lock);
+
+    for (int i = 0; placement.enabled && i < placement.nCoreSets; i++)
+        nCpus += CPU_COUNT(&placement.coreSets[i]);
+
+    pthread_mutex_unlock(&placement.lock);
+
+    cpu_set_t allowed;
+    if (nCpus == 0 && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+        nCpus = CPU_COUNT(&allowed);
+
+    return max(1, nCpus);
+}
+
+int setInjectorCpus(const char *cpus)
+{
+    cpu_set_t set;
+
+    if (parseCpuList(cpus, &set) != 0 || CPU_COUNT(&set) == 0)
+    {
+        ERR_PRINT("Invalid CPU list %s.\n", cpus);
+        return AFFINITY_FAILURE;
+    }
+
+    if (setenv(INJECTOR_CPUS_ENV, cpus, 1) != 0)
+    {
+        ERR_PRINT("Couldn't set the injector CPUs of the instances.\n");
+        return AFFINITY_FAILURE;
+    }
+
+    return AFFINITY_SUCCESS;
+}
+
+void pinInjectorThread(void)
+{
+    const char *cpus = getenv(INJECTOR_CPUS_ENV);
+    cpu_set_t set;
+
+    if (!cpus || parseCpuList(cpus, &set) != 0)
+    {
+        return;
+    }
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        ERR_PRINT("Couldn't pin the injector thread to CPUs %s.\n", cpus);
+    }
+}
+
+/**
+ * Parse a CPU list in the sysfs format, e.g. "0-3,8,10-11".
+ */
+static int parseCpuList(const char *list, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+
+    const char *p = list;
+    while (*p && *p != '\n')
+    {
+        char *end;
+        long first = strtol(p, &end, 10), last = first;
+        if (end == p)
+            return -1;
+
+        p = end;
+        if (*p == '-')
+        {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1)
+                return -1;
+            p = end;
+        }
+
+        if (first < 0 || last >= CPU_SETSIZE || first > last)
+            return -1;
+
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, set);
+
+        if (*p == ',')
+            p++;
+        else if (*p && *p != '\n')
+            return -1;
+    }
+
+    return 0;
+}
+
+static int readCpuList(const char *path, cpu_set_t *set)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        return -1;
+    }
+
+    char buffer[1024];
+    int ret = fgets(buffer, sizeof(buffer), fp) ? parseCpuList(buffer, set) : -1;
+
+    fclose(fp);
+    return ret;
+}
@@ -1 +1,8 @@
-#define ASM_NOP  __asm volatile ( "NOP" )
\ No newline at end of file
+#define ASM_NOP  __asm volatile ( "NOP" )
+
+// hint to the CPU that the thread is spinning
+#if defined(__x86_64__) || defined(__i386__)
+#define ASM_PAUSE __builtin_ia32_pause()
+#else
+#define ASM_PAUSE ASM_NOP
+#endif
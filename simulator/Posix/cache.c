@@ -0,0 +1,448 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <link.h>
+#include <elf.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../simulator.h"
+
+#define CACHE_MAGIC "SIMCACH1"
+
+// slots of a new cache (a power of two)
+#define CACHE_INITIAL_SLOTS (1UL << 14)
+
+#define FNV64_OFFSET 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+
+typedef struct
+{
+    char magic[8];
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t reserved[5];
+} cacheHeader_t;
+
+/**
+ * A slot of the table, free if its key is 0.
+ */
+typedef struct
+{
+    // hash of the fields of the key below
+    uint64_t key;
+    uint64_t buildId, golden, target;
+    uint64_t bucket;
+    uint32_t offsetByte, offsetBit;
+    // outcome
+    uint32_t exitCode;
+    uint32_t reserved;
+    uint64_t durationNs;
+    // of all the fields above
+    uint64_t checksum;
+} cacheSlot_t;
+
+static struct
+{
+    char *path;
+    int fd;
+    cacheHeader_t *header;
+    cacheSlot_t *slots;
+    size_t size;
+    // of this simulator and of its golden run
+    uint64_t buildId, golden;
+    pthread_mutex_t lock;
+} cache = {NULL, -1, NULL, NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+
+static int mapCache(const char *path, int fd, uint64_t capacity);
+static int growCache(void);
+static cacheSlot_t *findSlot(cacheSlot_t *slots, uint64_t capacity, const cacheSlot_t *key);
+static void fillKey(cacheSlot_t *slot, const injection_t *injection);
+static int readBuildId(uint64_t *buildId);
+static int hashFile(const char *path, uint64_t *hash);
+static uint64_t hashBytes(const void *data, size_t size, uint64_t hash);
+
+int openResultCache(const char *path, const char *goldenPath)
+{
+    if (readBuildId(&cache.buildId) != 0 || hashFile(goldenPath, &cache.golden) != 0)
+    {
+        ERR_PRINT("Couldn't identify the simulator or its golden run.\n");
+        return CACHE_FAILURE;
+    }
+
+    // the outcomes of the tick trigger are not those of the timed injections
+    if (isTickTrigger())
+    {
+        uint64_t nSwitches = getTriggerSwitches();
+        cache.golden = hashBytes(&nSwitches, sizeof(nSwitches), cache.golden ^ 1);
+    }
+
+    // nor are those of another timing mode or interrupt load
+    if (isVirtualTime())
+    {
+        cache.golden = hashBytes("virtual-time", strlen("virtual-time"), cache.golden ^ 2);
+    }
+
+    if (isIrqLoad())
+    {
+        const char *spec = getIrqLoadSpec();
+        cache.golden = hashBytes(spec, strlen(spec), cache.golden ^ 4);
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        ERR_PRINT("Couldn't open the result cache %s.\n", path);
+        return CACHE_FAILURE;
+    }
+
+    // a campaign at a time: the other ones run without the cache
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        ERR_PRINT("The result cache %s is used by another campaign.\n", path);
+        close(fd);
+        return CACHE_FAILURE;
+    }
+
+    struct stat st;
+    uint64_t capacity = CACHE_INITIAL_SLOTS;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        cacheHeader_t header;
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+            (header.capacity & (header.capacity - 1)) != 0 ||
+            (off_t)(sizeof(cacheHeader_t) + header.capacity * sizeof(cacheSlot_t)) != st.st_size)
+        {
+            ERR_PRINT("%s is not a result cache.\n", path);
+            close(fd);
+            return CACHE_FAILURE;
+        }
+
+        capacity = header.capacity;
+    }
+
+    if (mapCache(path, fd, capacity) != 0)
+    {
+        close(fd);
+        return CACHE_FAILURE;
+    }
+
+    cache.path = strdup(path);
+    return CACHE_SUCCESS;
+}
+
+int lookupCachedResult(const injection_t *injection, unsigned int *exitCode, unsigned long *durationNs)
+{
+    if (!cache.slots)
+    {
+        return 0;
+    }
+
+    cacheSlot_t key;
+    fillKey(&key, injection);
+
+    pthread_mutex_lock(&cache.lock);
+
+    cacheSlot_t *slot = findSlot(cache.slots, cache.header->capacity, &key);
+    int hit = slot && slot->key != 0;
+    if (hit)
+    {
+        *exitCode = slot->exitCode;
+        *durationNs = slot->durationNs;
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+
+    return hit;
+}
+
+void cacheResult(const injection_t *injection, unsigned int exitCode, unsigned long durationNs)
+{
+    if (!cache.slots)
+    {
+        return;
+    }
+
+    cacheSlot_t key;
+    fillKey(&key, injection);
+    key.exitCode = exitCode;
+    key.durationNs = durationNs;
+    key.checksum = hashBytes(&key, offsetof(cacheSlot_t, checksum), FNV64_OFFSET);
+
+    pthread_mutex_lock(&cache.lock);
+
+    if (4 * (cache.header->count + 1) > 3 * cache.header->capacity && growCache() != 0)
+    {
+        // the cache stays usable, without this outcome
+        pthread_mutex_unlock(&cache.lock);
+        return;
+    }
+
+    cacheSlot_t *slot = findSlot(cache.slots, cache.header->capacity, &key);
+    if (slot && slot->key == 0)
+    {
+        *slot = key;
+        cache.header->count++;
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+}
+
+unsigned long getCachedResults(void)
+{
+    return cache.header ? cache.header->count : 0;
+}
+
+void closeResultCache(void)
+{
+    if (cache.header)
+    {
+        msync(cache.header, cache.size, MS_SYNC);
+        munmap(cache.header, cache.size);
+        cache.header = NULL;
+        cache.slots = NULL;
+    }
+
+    if (cache.fd >= 0)
+    {
+        close(cache.fd);
+        cache.fd = -1;
+    }
+
+    free(cache.path);
+    cache.path = NULL;
+}
+
+/**
+ * Map the cache file of fd, with capacity slots, formatting it if it is empty.
+ */
+static int mapCache(const char *path, int fd, uint64_t capacity)
+{
+    size_t size = sizeof(cacheHeader_t) + capacity * sizeof(cacheSlot_t);
+
+    struct stat st;
+    int empty = fstat(fd, &st) != 0 || st.st_size == 0;
+    if (empty && ftruncate(fd, size) != 0)
+    {
+        ERR_PRINT("Couldn't allocate the result cache %s.\n", path);
+        return -1;
+    }
+
+    void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        ERR_PRINT("Couldn't map the result cache %s.\n", path);
+        return -1;
+    }
+
+    cache.fd = fd;
+    cache.header = (cacheHeader_t *)address;
+    cache.slots = (cacheSlot_t *)(cache.header + 1);
+    cache.size = size;
+
+    if (empty)
+    {
+        // the slots of the new file are zero, i.e. free
+        memcpy(cache.header->magic, CACHE_MAGIC, sizeof(cache.header->magic));
+        cache.header->capacity = capacity;
+        cache.header->count = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Rehash the cache into a new file of twice its capacity, which then
+ * replaces the cache file. Called with the lock held.
+ */
+static int growCache(void)
+{
+    char *tmpPath = (char *)malloc(strlen(cache.path) + 8);
+    sprintf(tmpPath, "%s.grow", cache.path);
+
+    int fd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        ERR_PRINT("Couldn't grow the result cache %s.\n", cache.path);
+        if (fd >= 0)
+            close(fd);
+        free(tmpPath);
+        return -1;
+    }
+
+    cacheHeader_t *oldHeader = cache.header;
+    cacheSlot_t *oldSlots = cache.slots;
+    size_t oldSize = cache.size;
+    int oldFd = cache.fd;
+
+    if (mapCache(tmpPath, fd, 2 * oldHeader->capacity) != 0)
+    {
+        cache.header = oldHeader;
+        cache.slots = oldSlots;
+        cache.size = oldSize;
+        cache.fd = oldFd;
+        close(fd);
+        unlink(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < oldHeader->capacity; i++)
+    {
+        cacheSlot_t *old = &oldSlots[i];
+        if (old->key == 0 || old->checksum != hashBytes(old, offsetof(cacheSlot_t, checksum), FNV64_OFFSET))
+            continue;
+
+        cacheSlot_t *slot = findSlot(cache.slots, cache.header->capacity, old);
+        if (slot && slot->key == 0)
+        {
+            *slot = *old;
+            cache.header->count++;
+        }
+    }
+
+    // the new table is complete on disk before it replaces the old one
+    msync(cache.header, cache.size, MS_SYNC);
+    if (rename(tmpPath, cache.path) != 0)
+    {
+        ERR_PRINT("Couldn't replace the result cache %s.\n", cache.path);
+    }
+
+    munmap(oldHeader, oldSize);
+    close(oldFd);
+    free(tmpPath);
+
+    return 0;
+}
+
+/**
+ * Find the slot of key: the slot holding it, or the free slot where it
+ * belongs. Returns NULL if the table is full.
+ */
+static cacheSlot_t *findSlot(cacheSlot_t *slots, uint64_t capacity, const cacheSlot_t *key)
+{
+    uint64_t mask = capacity - 1;
+
+    for (uint64_t n = 0, i = key->key & mask; n < capacity; n++, i = (i + 1) & mask)
+    {
+        cacheSlot_t *slot = &slots[i];
+
+        if (slot->key == 0)
+            return slot;
+
+        // a torn slot is skipped, as if it held another key
+        if (slot->key == key->key && slot->buildId == key->buildId && slot->golden == key->golden &&
+            slot->target == key->target && slot->bucket == key->bucket &&
+            slot->offsetByte == key->offsetByte && slot->offsetBit == key->offsetBit &&
+            slot->checksum == hashBytes(slot, offsetof(cacheSlot_t, checksum), FNV64_OFFSET))
+            return slot;
+    }
+
+    return NULL;
+}
+
+static void fillKey(cacheSlot_t *slot, const injection_t *injection)
+{
+    memset(slot, 0, sizeof(cacheSlot_t));
+
+    const char *target = injection->campaign->targetStructure;
+
+    slot->buildId = cache.buildId;
+    slot->golden = cache.golden;
+    slot->target = hashBytes(target, strlen(target), FNV64_OFFSET);
+    if (IS_EVENT_POINT(injection->injTime))
+        slot->bucket = injection->injTime;
+    else
+        slot->bucket = isTickTrigger() ? getTriggerTick(injection->injTime) : injection->injTime / CACHE_TIME_BUCKET_NS;
+    slot->offsetByte = (uint32_t)injection->offsetByte;
+    slot->offsetBit = (uint32_t)injection->offsetBit;
+
+    slot->key = hashBytes(&slot->buildId, offsetof(cacheSlot_t, exitCode) - offsetof(cacheSlot_t, buildId), FNV64_OFFSET);
+    if (slot->key == 0)
+        slot->key = 1;
+}
+
+static int findBuildIdNote(struct dl_phdr_info *info, size_t size, void *data)
+{
+    // the first object is the executable
+    for (int i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type != PT_NOTE)
+            continue;
+
+        const char *p = (const char *)(info->dlpi_addr + phdr->p_vaddr);
+        const char *end = p + phdr->p_memsz;
+
+        while (p + sizeof(ElfW(Nhdr)) <= end)
+        {
+            const ElfW(Nhdr) *note = (const ElfW(Nhdr) *)p;
+            const char *name = p + sizeof(ElfW(Nhdr));
+            const char *desc = name + ((note->n_namesz + 3) & ~3);
+
+            if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+            {
+                *(uint64_t *)data = hashBytes(desc, note->n_descsz, FNV64_OFFSET);
+                return 1;
+            }
+
+            p = desc + ((note->n_descsz + 3) & ~3);
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Identify the simulator by its build-id note, or by the hash of its
+ * executable if it was linked without one.
+ */
+static int readBuildId(uint64_t *buildId)
+{
+    *buildId = 0;
+    dl_iterate_phdr(&findBuildIdNote, buildId);
+
+    return *buildId ? 0 : hashFile("/proc/self/exe", buildId);
+}
+
+static int hashFile(const char *path, uint64_t *hash)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        return -1;
+    }
+
+    char buffer[4096];
+    size_t n;
+    *hash = FNV64_OFFSET;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        *hash = hashBytes(buffer, n, *hash);
+
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * FNV-1a hash (64 bits).
+ */
+static uint64_t hashBytes(const void *data, size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV64_PRIME;
+    }
+
+    return hash;
+}
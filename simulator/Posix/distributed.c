@@ -0,0 +1,712 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#include "../simulator.h"
+#include "utils.h"
+
+// pending connections of the listening socket
+#define COORDINATOR_BACKLOG 64
+
+// how long an idle worker waits before asking for a lease again
+#define LEASE_RETRY_MS 100
+
+// messages between the coordinator and the workers
+#define MSG_REQUEST 0 // worker: value is the number of free slots
+#define MSG_LEASE 1   // coordinator: value injections follow (0: none right now)
+#define MSG_RESULT 2  // worker: outcome of the injection with plan index value
+#define MSG_DONE 3    // coordinator: every injection has an outcome
+
+typedef struct
+{
+    int type;
+    int value;
+    unsigned int exitCode;
+} message_t;
+
+/**
+ * Injection descriptor sent to a worker, within a lease.
+ */
+typedef struct
+{
+    int index;
+    char target[256];
+    unsigned long time, offsetByte, offsetBit;
+} leasedInjection_t;
+
+/*
+ * On the wire, coordinator and workers may not share the same ABI: every
+ * field is serialized explicitly, with a fixed width in network byte order.
+ * A message is type, value and exit code (32 bits each); an injection is
+ * its plan index (32 bits), its target (256 bytes, NUL-padded), its time,
+ * byte and bit offsets (64 bits each).
+ */
+#define MESSAGE_WIRE_SIZE (3 * sizeof(uint32_t))
+#define INJECTION_WIRE_SIZE (sizeof(uint32_t) + 256 + 3 * sizeof(uint64_t))
+
+/**
+ * A connected worker, as seen by the coordinator.
+ */
+typedef struct
+{
+    int fd;
+    // injections leased to the worker and not completed yet
+    int nLeased;
+    // when the worker last received a lease or sent an outcome
+    unsigned long long lastProgressNs;
+} client_t;
+
+/**
+ * State of the coordinator.
+ */
+static struct
+{
+    injection_t *plan;
+    int size;
+    int chunk;
+    workerResult_t onResult;
+
+    // per plan index: client holding its lease (-1 if none) and whether it has an outcome
+    int *owner;
+    char *done;
+    int nDone;
+
+    // plan indices waiting for a lease (circular buffer of size entries)
+    int *queue;
+    int head, nQueued;
+
+    client_t *clients;
+    int nClients;
+} coordinator;
+
+static int openSocket(const char *address, int listening);
+static int readFull(int fd, void *buffer, size_t size);
+static int writeFull(int fd, const void *buffer, size_t size);
+static int sendMessage(int fd, int type, int value, unsigned int exitCode);
+static int receiveMessage(int fd, message_t *message);
+static void encodeInjection(unsigned char *wire, const leasedInjection_t *injection);
+static void decodeInjection(leasedInjection_t *injection, const unsigned char *wire);
+
+static void acceptClient(int listenFd);
+static int serveClient(int c);
+static int leaseInjections(int c, int nSlots);
+static void dropClient(int c);
+static void releaseLeases(int c);
+
+static int requestLease(int fd, int nSlots, leasedInjection_t **queue, int *nQueue);
+static int startLeasedInjection(freeRTOSInstance *instance, const leasedInjection_t *injection,
+                                int spawnMode, const char *injectorPath);
+
+int runCoordinator(injection_t *plan, int size, const char *address, int chunk,
+                   workerResult_t onResult)
+{
+    int listenFd = openSocket(address, 1);
+    if (listenFd < 0)
+    {
+        ERR_PRINT("Couldn't listen on %s.\n", address);
+        return DISTRIBUTED_FAILURE;
+    }
+
+    // a worker may disconnect while a lease is being sent
+    void (*sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    coordinator.plan = plan;
+    coordinator.size = size;
+    coordinator.chunk = chunk;
+    coordinator.onResult = onResult;
+    coordinator.owner = (int *)malloc(sizeof(int) * max(size, 1));
+    coordinator.done = (char *)calloc(max(size, 1), sizeof(char));
+    coordinator.queue = (int *)malloc(sizeof(int) * max(size, 1));
+    coordinator.nDone = 0;
+    coordinator.head = 0;
+    coordinator.nQueued = size;
+    coordinator.clients = NULL;
+    coordinator.nClients = 0;
+
+    for (int i = 0; i < size; i++)
+    {
+        coordinator.owner[i] = -1;
+        coordinator.queue[i] = i;
+    }
+
+    fprintf(stdout, "Coordinator listening on %s\n", address);
+
+    struct pollfd *fds = NULL;
+    int failed = 0;
+
+    while (coordinator.nDone < size && !failed)
+    {
+        fds = (struct pollfd *)realloc(fds, sizeof(struct pollfd) * (coordinator.nClients + 1));
+        fds[0].fd = listenFd;
+        fds[0].events = POLLIN;
+        for (int c = 0; c < coordinator.nClients; c++)
+        {
+            fds[c + 1].fd = coordinator.clients[c].fd;
+            fds[c + 1].events = POLLIN;
+        }
+
+        // wake up at least once a second to expire the leases
+        if (poll(fds, coordinator.nClients + 1, 1000) < 0 && errno != EINTR)
+        {
+            ERR_PRINT("poll failed\n");
+            failed = 1;
+            break;
+        }
+
+        int nPolled = coordinator.nClients;
+        unsigned long long now = monotonic_ns();
+
+        // backwards: a dropped client is replaced by the last one
+        for (int c = nPolled - 1; c >= 0; c--)
+        {
+            client_t *client = &coordinator.clients[c];
+
+            if (fds[c + 1].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                if (serveClient(c) != 0)
+                {
+                    DEBUG_PRINT("Worker %d disconnected, %d injections leased again.\n", client->fd, client->nLeased);
+                    dropClient(c);
+                }
+            }
+            else if (client->nLeased > 0 && now - client->lastProgressNs > LEASE_TIMEOUT_SEC * 1000000000ull)
+            {
+                // the connection is kept: a late outcome is still accepted
+                DEBUG_PRINT("The lease of worker %d expired, %d injections leased again.\n", client->fd, client->nLeased);
+                releaseLeases(c);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            acceptClient(listenFd);
+        }
+    }
+
+    // the workers see the connection closed once every injection has an outcome
+    for (int c = coordinator.nClients - 1; c >= 0; c--)
+    {
+        sendMessage(coordinator.clients[c].fd, MSG_DONE, 0, 0);
+        dropClient(c);
+    }
+
+    close(listenFd);
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        unlink(address + 5);
+    }
+
+    free(fds);
+    free(coordinator.clients);
+    free(coordinator.owner);
+    free(coordinator.done);
+    free(coordinator.queue);
+    signal(SIGPIPE, sigpipe);
+
+    return failed ? DISTRIBUTED_FAILURE : DISTRIBUTED_SUCCESS;
+}
+
+static void acceptClient(int listenFd)
+{
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    // outcomes are small messages, sent one at a time
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    coordinator.clients = (client_t *)realloc(coordinator.clients, sizeof(client_t) * (coordinator.nClients + 1));
+    client_t *client = &coordinator.clients[coordinator.nClients++];
+    client->fd = fd;
+    client->nLeased = 0;
+    client->lastProgressNs = monotonic_ns();
+
+    DEBUG_PRINT("Worker %d connected.\n", fd);
+}
+
+static int serveClient(int c)
+{
+    client_t *client = &coordinator.clients[c];
+
+    message_t message;
+    if (receiveMessage(client->fd, &message) != 0)
+    {
+        return -1;
+    }
+
+    if (message.type == MSG_REQUEST)
+    {
+        return leaseInjections(c, message.value);
+    }
+
+    if (message.type != MSG_RESULT || message.value < 0 || message.value >= coordinator.size)
+    {
+        ERR_PRINT("Unexpected message from worker %d.\n", client->fd);
+        return -1;
+    }
+
+    int index = message.value;
+    client->lastProgressNs = monotonic_ns();
+
+    if (coordinator.owner[index] == c)
+    {
+        coordinator.owner[index] = -1;
+        client->nLeased--;
+    }
+
+    // the injection may have been leased again after an expired lease: keep the first outcome
+    if (!coordinator.done[index])
+    {
+        coordinator.done[index] = 1;
+        coordinator.nDone++;
+        coordinator.onResult(&coordinator.plan[index], message.exitCode);
+    }
+
+    return 0;
+}
+
+static int leaseInjections(int c, int nSlots)
+{
+    client_t *client = &coordinator.clients[c];
+
+    int count = coordinator.chunk > 0 ? coordinator.chunk : 2 * max(nSlots, 1);
+    leasedInjection_t *lease = (leasedInjection_t *)calloc(count, sizeof(leasedInjection_t));
+    int n = 0;
+
+    while (n < count && coordinator.nQueued > 0)
+    {
+        int index = coordinator.queue[coordinator.head];
+        coordinator.head = (coordinator.head + 1) % coordinator.size;
+        coordinator.nQueued--;
+
+        // its lease expired but its outcome came in later
+        if (coordinator.done[index])
+            continue;
+
+        const injection_t *injection = &coordinator.plan[index];
+        lease[n].index = index;
+        strncpy(lease[n].target, injection->campaign->targetStructure, sizeof(lease[n].target) - 1);
+        lease[n].time = injection->injTime;
+        lease[n].offsetByte = injection->offsetByte;
+        lease[n].offsetBit = injection->offsetBit;
+
+        coordinator.owner[index] = c;
+        n++;
+    }
+
+    client->nLeased += n;
+    client->lastProgressNs = monotonic_ns();
+
+    unsigned char *wire = (unsigned char *)malloc(INJECTION_WIRE_SIZE * max(n, 1));
+    for (int i = 0; i < n; i++)
+    {
+        encodeInjection(wire + INJECTION_WIRE_SIZE * i, &lease[i]);
+    }
+
+    int ret = sendMessage(client->fd, MSG_LEASE, n, 0) != 0 ||
+              writeFull(client->fd, wire, INJECTION_WIRE_SIZE * n) != 0;
+
+    free(wire);
+    free(lease);
+    return ret ? -1 : 0;
+}
+
+static void releaseLeases(int c)
+{
+    for (int index = 0; index < coordinator.size; index++)
+    {
+        if (coordinator.owner[index] == c)
+        {
+            coordinator.owner[index] = -1;
+
+            if (!coordinator.done[index])
+            {
+                // leased again before the injections that were never leased
+                coordinator.head = (coordinator.head + coordinator.size - 1) % coordinator.size;
+                coordinator.queue[coordinator.head] = index;
+                coordinator.nQueued++;
+            }
+        }
+    }
+
+    coordinator.clients[c].nLeased = 0;
+}
+
+static void dropClient(int c)
+{
+    releaseLeases(c);
+    close(coordinator.clients[c].fd);
+
+    // the last client takes the place of the dropped one
+    int last = --coordinator.nClients;
+    if (c != last)
+    {
+        coordinator.clients[c] = coordinator.clients[last];
+        for (int index = 0; index < coordinator.size; index++)
+        {
+            if (coordinator.owner[index] == last)
+                coordinator.owner[index] = c;
+        }
+    }
+}
+
+int runDistributedWorker(const char *address, int parallelism, int spawnMode,
+                         const char *injectorPath)
+{
+    int fd = openSocket(address, 0);
+    if (fd < 0)
+    {
+        ERR_PRINT("Couldn't connect to the coordinator at %s.\n", address);
+        return DISTRIBUTED_FAILURE;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // the coordinator may close the connection at any time once it is done
+    void (*sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    freeRTOSInstance *instances = (freeRTOSInstance *)calloc(parallelism, sizeof(freeRTOSInstance));
+    int *running = (int *)calloc(parallelism, sizeof(int));
+
+    // the slots not in use are freeSlots[full..parallelism-1]
+    int *freeSlots = (int *)malloc(sizeof(int) * parallelism);
+    for (int i = 0; i < parallelism; i++)
+        freeSlots[i] = i;
+
+    leasedInjection_t *queue = NULL;
+    int nQueue = 0, next = 0;
+    int full = 0;
+    int done = 0, failed = 0;
+    unsigned long nCompleted = 0;
+
+    while (!failed && (!done || full > 0))
+    {
+        if (!done && next == nQueue && full < parallelism)
+        {
+            // the local queue is empty: ask for a new lease
+            next = 0;
+            int ret = requestLease(fd, parallelism - full, &queue, &nQueue);
+
+            if (ret < 0)
+            {
+                // the coordinator is gone: the outcomes of the running instances are lost
+                done = 1;
+            }
+            else if (ret == 0 && nQueue == 0 && full == 0)
+            {
+                // nothing to lease right now, but some leases may expire
+                struct timespec retry = {0, LEASE_RETRY_MS * 1000000L};
+                nanosleep(&retry, NULL);
+                continue;
+            }
+            else if (ret > 0)
+            {
+                done = 1;
+            }
+        }
+
+        while (next < nQueue && full < parallelism)
+        {
+            int slot = freeSlots[full];
+            if (startLeasedInjection(&instances[slot], &queue[next], spawnMode, injectorPath) < 0)
+            {
+                ERR_PRINT("Couldn't create child process.\n");
+                failed = 1;
+                break;
+            }
+
+            running[slot] = queue[next++].index;
+            full++;
+        }
+
+        if (full == 0)
+        {
+            continue;
+        }
+
+        int exitCode;
+        int pos = waitFreeRTOSInjections(instances, parallelism, &exitCode);
+        if (pos < 0)
+        {
+            ERR_PRINT("Couldn't wait for the child processes.\n");
+            failed = 1;
+            break;
+        }
+
+        full--;
+        freeSlots[full] = pos;
+        nCompleted++;
+
+        if (!done && sendMessage(fd, MSG_RESULT, running[pos], (unsigned int)exitCode) != 0)
+        {
+            done = 1;
+        }
+    }
+
+    // a failed worker leaves its instances to the watchdog
+    fprintf(stdout, "Worker completed %lu injections\n", nCompleted);
+
+    close(fd);
+    free(queue);
+    free(instances);
+    free(running);
+    free(freeSlots);
+    signal(SIGPIPE, sigpipe);
+
+    return failed ? DISTRIBUTED_FAILURE : DISTRIBUTED_SUCCESS;
+}
+
+/**
+ * Ask the coordinator for a lease. Returns 0 with the leased injections
+ * in queue (possibly none), 1 if the campaign is done, -1 on errors.
+ */
+static int requestLease(int fd, int nSlots, leasedInjection_t **queue, int *nQueue)
+{
+    message_t reply;
+
+    *nQueue = 0;
+
+    if (sendMessage(fd, MSG_REQUEST, nSlots, 0) != 0 ||
+        receiveMessage(fd, &reply) != 0)
+    {
+        return -1;
+    }
+
+    if (reply.type == MSG_DONE)
+    {
+        return 1;
+    }
+
+    if (reply.type != MSG_LEASE || reply.value < 0)
+    {
+        return -1;
+    }
+
+    *queue = (leasedInjection_t *)realloc(*queue, sizeof(leasedInjection_t) * max(reply.value, 1));
+    unsigned char *wire = (unsigned char *)malloc(INJECTION_WIRE_SIZE * max(reply.value, 1));
+
+    int ret = readFull(fd, wire, INJECTION_WIRE_SIZE * reply.value);
+    for (int i = 0; ret == 0 && i < reply.value; i++)
+    {
+        decodeInjection(&(*queue)[i], wire + INJECTION_WIRE_SIZE * i);
+    }
+
+    free(wire);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    *nQueue = reply.value;
+    return 0;
+}
+
+static int startLeasedInjection(freeRTOSInstance *instance, const leasedInjection_t *injection,
+                                int spawnMode, const char *injectorPath)
+{
+    if (spawnMode == SPAWN_ZYGOTE)
+        return runFreeRTOSInjectionFromZygote(instance, injection->target,
+                                              injection->time, injection->offsetByte, injection->offsetBit);
+
+    return runFreeRTOSInjection(instance, injectorPath, injection->target,
+                                injection->time, injection->offsetByte, injection->offsetBit);
+}
+
+/**
+ * Open a socket on address, "host:port" or "unix:/path": a listening
+ * socket for the coordinator, a connected one for a worker.
+ */
+static int openSocket(const char *address, int listening)
+{
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        struct sockaddr_un un;
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        strncpy(un.sun_path, address + 5, sizeof(un.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        if (listening)
+        {
+            // a stale socket left by a previous coordinator
+            unlink(un.sun_path);
+        }
+
+        if (listening ? bind(fd, (struct sockaddr *)&un, sizeof(un)) != 0 || listen(fd, COORDINATOR_BACKLOG) != 0
+                      : connect(fd, (struct sockaddr *)&un, sizeof(un)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    const char *colon = strrchr(address, ':');
+    if (!colon)
+    {
+        return -1;
+    }
+
+    char host[256];
+    snprintf(host, sizeof(host), "%.*s", (int)(colon - address), address);
+
+    struct addrinfo hints, *info;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+    if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &info) != 0)
+    {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = info; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        int one = 1;
+        if (listening)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if (listening ? bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, COORDINATOR_BACKLOG) != 0
+                      : connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(info);
+    return fd;
+}
+
+static int readFull(int fd, void *buffer, size_t size)
+{
+    char *p = (char *)buffer;
+    while (size > 0)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int writeFull(int fd, const void *buffer, size_t size)
+{
+    const char *p = (const char *)buffer;
+    while (size > 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static void putU32(unsigned char *wire, uint32_t value)
+{
+    value = htonl(value);
+    memcpy(wire, &value, sizeof(value));
+}
+
+static uint32_t getU32(const unsigned char *wire)
+{
+    uint32_t value;
+    memcpy(&value, wire, sizeof(value));
+    return ntohl(value);
+}
+
+static void putU64(unsigned char *wire, uint64_t value)
+{
+    putU32(wire, (uint32_t)(value >> 32));
+    putU32(wire + sizeof(uint32_t), (uint32_t)value);
+}
+
+static uint64_t getU64(const unsigned char *wire)
+{
+    return ((uint64_t)getU32(wire) << 32) | getU32(wire + sizeof(uint32_t));
+}
+
+static int sendMessage(int fd, int type, int value, unsigned int exitCode)
+{
+    unsigned char wire[MESSAGE_WIRE_SIZE];
+
+    putU32(wire, (uint32_t)type);
+    putU32(wire + 4, (uint32_t)value);
+    putU32(wire + 8, (uint32_t)exitCode);
+
+    return writeFull(fd, wire, sizeof(wire));
+}
+
+static int receiveMessage(int fd, message_t *message)
+{
+    unsigned char wire[MESSAGE_WIRE_SIZE];
+
+    if (readFull(fd, wire, sizeof(wire)) != 0)
+    {
+        return -1;
+    }
+
+    message->type = (int32_t)getU32(wire);
+    message->value = (int32_t)getU32(wire + 4);
+    message->exitCode = getU32(wire + 8);
+    return 0;
+}
+
+static void encodeInjection(unsigned char *wire, const leasedInjection_t *injection)
+{
+    putU32(wire, (uint32_t)injection->index);
+    // strncpy pads the target with NULs
+    strncpy((char *)wire + 4, injection->target, 256);
+    putU64(wire + 4 + 256, injection->time);
+    putU64(wire + 4 + 256 + 8, injection->offsetByte);
+    putU64(wire + 4 + 256 + 16, injection->offsetBit);
+}
+
+static void decodeInjection(leasedInjection_t *injection, const unsigned char *wire)
+{
+    injection->index = (int32_t)getU32(wire);
+    memcpy(injection->target, wire + 4, sizeof(injection->target));
+    injection->target[sizeof(injection->target) - 1] = '\0';
+    injection->time = (unsigned long)getU64(wire + 4 + 256);
+    injection->offsetByte = (unsigned long)getU64(wire + 4 + 256 + 8);
+    injection->offsetBit = (unsigned long)getU64(wire + 4 + 256 + 16);
+}
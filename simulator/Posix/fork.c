@@ -1,39 +1,166 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/prctl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/resource.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <stdint.h>
 #include <sched.h>
 #include <signal.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "../simulator.h"
 #include "fork_internal.h"
+#include "utils.h"
 
-#define WATCHDOG_TIMEOUT_SEC 1
+/**
+ * @brief Reserve the tag of a new instance.
+ * 
+ * The tag identifies the instance in its startup records: it is
+ * published in the STARTUP_TAG_ENV environment variable of the instance.
+ * 
+ * @return the tag, or -1 if no memory is left
+ */
+static int reserve_tag(void);
 
 /**
- * @brief Run a watchdog timer for the the requested process.
+ * @brief Watch a new instance from the event loop of the orchestrator.
  * 
- * Setup a watchdog timer that kills the child process running a
- * FreeRTOS simulation if it exceeds a maximum execution time.
- * The timeout is specified by WATCHDOG_TIMEOUT_SEC.
+ * Open a pidfd for the process running the FreeRTOS simulation and a
+ * timerfd that expires after WATCHDOG_TIMEOUT_SEC, and register both
+ * in the epoll instance. The events carry the address of the pidfd
+ * and timerfd fields of the instance, so the slot of the instance is
+ * found without scanning.
  * 
+ * @param instance is the instance to watch, with a reserved tag
  * @param pid is the identifier of the process to watch
- * @param timerId is a pointer to the timer
- * @return int is zero if the watchdog was created successfully, 
- * false otherwise
+ * @return int is zero if the instance is watched, non zero otherwise
  */
-static int run_watchdog_timer(pid_t pid, timer_t *timerId);
+static int watch_instance(freeRTOSInstance *instance, pid_t pid);
 
 /**
- * @brief A killer.
+ * @brief Reap a terminated instance, update the latency statistics and
+ * release its file descriptors and tag.
  * 
- * @param val is the pid of the process to kill
+ * @return the exit code of the instance, -1 if it crashed
+ */
+static int reap_instance(freeRTOSInstance *instance);
+
+/**
+ * @brief The watchdog of an instance expired: kill it.
+ */
+static void kill_instance(freeRTOSInstance *instance);
+
+/**
+ * @brief Create the pipe the instances use to notify when they are ready
+ * and the epoll instance of the calling thread.
+ * 
+ * The write end is inherited by every instance (across execv too),
+ * its descriptor is published in the STARTUP_FD_ENV environment variable.
+ */
+static void init_startup_pipe(void);
+
+/**
+ * @brief Close the epoll instance of a terminated thread.
+ */
+static void close_event_loop(void *fd);
+
+/**
+ * @brief Read the notifications in the startup pipe and store
+ * their timestamps in the instances they come from.
+ */
+static void read_startup_records(void);
+
+/**
+ * @brief Send a notification to the orchestrator, if any.
+ */
+static void send_startup_record(int event);
+
+/**
+ * @brief Add a sample to a latency statistics.
+ */
+static void record_latency(latencyStats_t *stats, unsigned long long latencyNs);
+
+#define STARTUP_FD_ENV "SIM_STARTUP_FD"
+#define STARTUP_TAG_ENV "SIM_STARTUP_TAG"
+#define STARTUP_PROBE_ENV "SIM_STARTUP_PROBE"
+
+// events notified by the instances
+#define STARTUP_READY 0   // ready to start the scheduler
+#define STARTUP_EXITING 1 // about to exit with the outcome of the simulation
+
+/**
+ * Notification sent by an instance through the startup pipe.
+ */
+typedef struct
+{
+    pid_t pid;
+    int tag;
+    int event;
+    unsigned long long ns;
+} startupRecord_t;
+
+static int startupFds[2] = {-1, -1};
+
+/**
+ * Instances of the orchestrator, which may be started and waited by
+ * several threads (see shards.h): every thread has its own epoll instance
+ * with the pidfds and the watchdog timerfds of the instances it started,
+ * plus the read end of the startup pipe. The rest is shared, under lock.
  */
-static void watchdog_func(union sigval val);
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_key_t epollKey;
+    // running instances, indexed by tag
+    freeRTOSInstance **instances;
+    int capacity;
+    // tags not in use
+    int *freeTags;
+    int nFreeTags;
+} loop = {PTHREAD_MUTEX_INITIALIZER};
+
+static __thread int epollFd = -1;
+
+static latencyStats_t startupLatency[SPAWN_MODES];
+static latencyStats_t reapingLatency;
+static latencyStats_t runTime;
+
+// spawn --run instances that exit as soon as they are ready
+static int probeStartup;
+
+/**
+ * Injection descriptor sent to the zygote
+ */
+typedef struct
+{
+    char target[256];
+    unsigned long time, offsetByte, offsetBit;
+    // tag of the instance in the startup records
+    int tag;
+    // core set of the instance
+    int coreSet;
+    // when the orchestrator sent the request (CLOCK_MONOTONIC, ns)
+    unsigned long long spawnNs;
+} zygoteRequest_t;
+
+static struct
+{
+    pid_t pid;
+    // requests to the zygote, pids of the forked instances from the zygote
+    int requestFd, responseFd;
+    // a request and its response are not interleaved with the ones of other threads
+    pthread_mutex_t lock;
+} zygote = {0, -1, -1, PTHREAD_MUTEX_INITIALIZER};
 
 
 int runFreeRTOSInjection(freeRTOSInstance *instance,
@@ -43,39 +170,62 @@ int runFreeRTOSInjection(freeRTOSInstance *instance,
                          const unsigned long offsetByte,
                          const unsigned long offsetBit)
 {
+    init_startup_pipe();
+
+    int tag = reserve_tag();
+    if (tag < 0)
+    {
+        return FREE_RTOS_FORK_FAILURE;
+    }
+
+    int coreSet = acquireCoreSet();
+    unsigned long long spawnNs = monotonic_ns();
+
     // fork a child process for the Free RTOS simulation
     pid_t pid = fork();
 
     if (pid < 0)
     {
+        releaseCoreSet(coreSet);
+        pthread_mutex_lock(&loop.lock);
+        loop.freeTags[loop.nFreeTags++] = tag;
+        pthread_mutex_unlock(&loop.lock);
         return FREE_RTOS_FORK_FAILURE;
     }
 
     // father process: simply return
     if (pid)
     {
-        if (run_watchdog_timer(pid, &instance->watchdog) != 0) {
-            // creation of the timer failed
-            // kill the child and return an error
-            kill(pid, SIGKILL);
+        instance->tag = tag;
+        instance->coreSet = coreSet;
+        instance->spawnMode = SPAWN_EXEC;
+        instance->spawnNs = spawnNs;
+
+        if (watch_instance(instance, pid) != 0) {
             return FREE_RTOS_FORK_FAILURE;
         }
 
-        instance->pid = pid;
         return FREE_RTOS_FORK_SUCCESS;
     }
 
-    // try to increase the scheduling priority of the threads
-    // of the current process to realtime (this requires root privileges)
-    struct sched_param p;
-    p.sched_priority = sched_get_priority_max(SCHED_RR);
-    sched_setscheduler(getpid(), SCHED_RR, &p); // fail silently
+    endForkPhase(spawnNs);
+    beginExecPhase();
+
+    // inherited across execv by all the threads of the instance
+    pinToCoreSet(coreSet);
+    raise_scheduling_priority();
+
+    if (probeStartup)
+    {
+        setenv(STARTUP_PROBE_ENV, "1", 1);
+    }
 
-    // increase the process's scheduling priority
-    setpriority(PRIO_PROCESS, getpid(), -20);
+    char tagBuffer[16];
+    sprintf(tagBuffer, "%d", tag);
+    setenv(STARTUP_TAG_ENV, tagBuffer, 1);
 
     char timeBuffer[16];
-    sprintf(timeBuffer, "%ld", time);
+    sprintf(timeBuffer, "%lu", time);
 
     char offsetByteBuffer[16];
     sprintf(offsetByteBuffer, "%ld", offsetByte);
@@ -97,97 +247,539 @@ int runFreeRTOSInjection(freeRTOSInstance *instance,
     return FREE_RTOS_FORK_FAILURE;
 }
 
-static int run_watchdog_timer(pid_t pid, timer_t *timerId) {
-    // setup an event that calls the watchdog function after
-    // the timeout expired
-    struct sigevent sig;
-    sig.sigev_notify = SIGEV_THREAD; // run the handler as a new thread
-    // when the timer expires watchdog_func is called
-    sig.sigev_notify_function = &watchdog_func;
-    // with pid as parameter
-    sig.sigev_value.sival_int = pid;
-    sig.sigev_notify_attributes = NULL;
-
-    // create the timer using the CLOCK_MONOTONIC clock (the same used
-    // by run-time-stats-utils)
-    if (timer_create(CLOCK_MONOTONIC, &sig, timerId) != 0) {
-        ERR_PRINT("timer_create failed");
-        return 1;
+int startFreeRTOSZygote(void (*setup)(void),
+                        void (*run)(const char *target, unsigned long time,
+                                    unsigned long offsetByte, unsigned long offsetBit))
+{
+    int requestFds[2], responseFds[2];
+
+    // the zygote hands the instances over to the orchestrator by
+    // double forking: make the orchestrator adopt its orphan descendants
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0)
+    {
+        ERR_PRINT("prctl(PR_SET_CHILD_SUBREAPER) failed\n");
+        return FREE_RTOS_FORK_FAILURE;
     }
 
-    // setup the timer duration
-    struct itimerspec in, out;
-    in.it_value.tv_sec = WATCHDOG_TIMEOUT_SEC;
-    in.it_value.tv_nsec = 0;
-    // this interval is NOT periodic
-    in.it_interval.tv_sec = 0;
-    in.it_interval.tv_nsec = 0;
+    init_startup_pipe();
 
-    if (timer_settime(*timerId, 0, &in, &out) != 0) {
-        ERR_PRINT("timer_settime failed");
-        return 1;
+    if (pipe(requestFds) != 0 || pipe(responseFds) != 0)
+    {
+        ERR_PRINT("pipe failed\n");
+        return FREE_RTOS_FORK_FAILURE;
     }
 
-    return 0;
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return FREE_RTOS_FORK_FAILURE;
+    }
+
+    if (pid)
+    {
+        close(requestFds[0]);
+        close(responseFds[1]);
+
+        zygote.pid = pid;
+        zygote.requestFd = requestFds[1];
+        zygote.responseFd = responseFds[0];
+        return FREE_RTOS_FORK_SUCCESS;
+    }
+
+    close(requestFds[1]);
+    close(responseFds[0]);
+
+    // initialise the simulator up to the start of the scheduler, once
+    vPortEnableSnapshots();
+    setup();
+
+    // the task threads park themselves right after being created
+    while (!xPortSnapshotIsConsistent())
+    {
+        sched_yield();
+    }
+
+    zygoteRequest_t request;
+    while (read(requestFds[0], &request, sizeof(request)) == sizeof(request))
+    {
+        pid_t intermediate = fork();
+
+        if (intermediate == 0)
+        {
+            if (fork() == 0)
+            {
+                endForkPhase(request.spawnNs);
+
+                pid_t self = getpid();
+                write(responseFds[1], &self, sizeof(self));
+
+                close(requestFds[0]);
+                close(responseFds[1]);
+
+                char tagBuffer[16];
+                sprintf(tagBuffer, "%d", request.tag);
+                setenv(STARTUP_TAG_ENV, tagBuffer, 1);
+
+                pinToCoreSet(request.coreSet);
+                raise_scheduling_priority();
+
+                // fork() only kept the calling thread
+                vPortRestoreSnapshot();
+
+                run(request.target, request.time, request.offsetByte, request.offsetBit);
+
+                // run should never return
+                _exit(GENERIC_ERROR_EXIT_CODE);
+            }
+            _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+        }
+
+        if (intermediate < 0)
+        {
+            // notify the failure to the orchestrator
+            pid_t none = -1;
+            write(responseFds[1], &none, sizeof(none));
+            continue;
+        }
+
+        waitpid(intermediate, NULL, 0);
+    }
+
+    // the orchestrator closed the request pipe
+    _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+}
+
+int runFreeRTOSInjectionFromZygote(freeRTOSInstance *instance,
+                                   const char *target,
+                                   const unsigned long time,
+                                   const unsigned long offsetByte,
+                                   const unsigned long offsetBit)
+{
+    zygoteRequest_t request;
+    memset(&request, 0, sizeof(request));
+    strncpy(request.target, target, sizeof(request.target) - 1);
+    request.time = time;
+    request.offsetByte = offsetByte;
+    request.offsetBit = offsetBit;
+
+    request.tag = reserve_tag();
+    if (request.tag < 0)
+    {
+        return FREE_RTOS_FORK_FAILURE;
+    }
+
+    init_startup_pipe();
+
+    request.coreSet = acquireCoreSet();
+    unsigned long long spawnNs = monotonic_ns();
+    request.spawnNs = spawnNs;
+
+    pid_t pid;
+    pthread_mutex_lock(&zygote.lock);
+    int failed = write(zygote.requestFd, &request, sizeof(request)) != sizeof(request) ||
+                 read(zygote.responseFd, &pid, sizeof(pid)) != sizeof(pid) ||
+                 pid < 0;
+    pthread_mutex_unlock(&zygote.lock);
+
+    if (failed)
+    {
+        releaseCoreSet(request.coreSet);
+        pthread_mutex_lock(&loop.lock);
+        loop.freeTags[loop.nFreeTags++] = request.tag;
+        pthread_mutex_unlock(&loop.lock);
+        return FREE_RTOS_FORK_FAILURE;
+    }
+
+    instance->tag = request.tag;
+    instance->coreSet = request.coreSet;
+    instance->spawnMode = SPAWN_ZYGOTE;
+    instance->spawnNs = spawnNs;
+
+    if (watch_instance(instance, pid) != 0) {
+        return FREE_RTOS_FORK_FAILURE;
+    }
+
+    return FREE_RTOS_FORK_SUCCESS;
+}
+
+void stopFreeRTOSZygote(void)
+{
+    if (zygote.pid <= 0)
+    {
+        return;
+    }
+
+    close(zygote.requestFd);
+    close(zygote.responseFd);
+    waitpid(zygote.pid, NULL, 0);
+
+    zygote.pid = 0;
 }
 
-static void watchdog_func(union sigval val) {
-    DEBUG_PRINT("Killing %d...\n", val.sival_int);
-    if (kill((pid_t) val.sival_int, SIGKILL) != 0) {
-        ERR_PRINT("watchdog timer failed to kill pid %d: this should not happen!\n", val.sival_int);
+void notifyFreeRTOSInstanceReady(void)
+{
+    send_startup_record(STARTUP_READY);
+
+    if (getenv(STARTUP_PROBE_ENV))
+    {
+        // startup latency probe: nothing else to do
+        notifyFreeRTOSInstanceExiting();
+        exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+    }
+}
+
+void notifyFreeRTOSInstanceExiting(void)
+{
+    send_startup_record(STARTUP_EXITING);
+}
+
+int probeFreeRTOSStartupLatency(const char *injectorPath, const char *target, int nProbes)
+{
+    for (int i = 0; i < nProbes; i++)
+    {
+        freeRTOSInstance instance;
+
+        probeStartup = 1;
+        int ret = runFreeRTOSInjection(&instance, injectorPath, target, 0, 0, 0);
+        probeStartup = 0;
+
+        if (ret < 0)
+        {
+            return FREE_RTOS_FORK_FAILURE;
+        }
+
+        waitFreeRTOSInjection(&instance);
     }
+
+    return FREE_RTOS_FORK_SUCCESS;
+}
+
+void getStartupLatency(int spawnMode, latencyStats_t *latency)
+{
+    pthread_mutex_lock(&loop.lock);
+    *latency = startupLatency[spawnMode];
+    pthread_mutex_unlock(&loop.lock);
+}
+
+void recordStartupLatency(int spawnMode, unsigned long long latencyNs)
+{
+    pthread_mutex_lock(&loop.lock);
+    record_latency(&startupLatency[spawnMode], latencyNs);
+    pthread_mutex_unlock(&loop.lock);
+}
+
+void getReapingLatency(latencyStats_t *latency)
+{
+    pthread_mutex_lock(&loop.lock);
+    *latency = reapingLatency;
+    pthread_mutex_unlock(&loop.lock);
+}
+
+void getRunTime(latencyStats_t *latency)
+{
+    pthread_mutex_lock(&loop.lock);
+    *latency = runTime;
+    pthread_mutex_unlock(&loop.lock);
+}
+
+void resetRunTime(void)
+{
+    pthread_mutex_lock(&loop.lock);
+    memset(&runTime, 0, sizeof(runTime));
+    pthread_mutex_unlock(&loop.lock);
+}
+
+unsigned long long getFreeRTOSInstanceRunTime(const freeRTOSInstance *instance)
+{
+    // the records of the instance were read when it was reaped
+    if (!instance->readyNs || instance->exitNs <= instance->readyNs || instance->killed)
+        return 0;
+
+    return instance->exitNs - instance->readyNs;
 }
 
-int waitFreeRTOSInjection(const freeRTOSInstance *instance)
+static void record_latency(latencyStats_t *stats, unsigned long long latencyNs)
 {
-    int exitCode;
-    
-    // wait for the instance to terminate
-    waitpid(instance->pid, &exitCode, 0);
+    if (stats->count == 0 || latencyNs < stats->minNs)
+        stats->minNs = latencyNs;
+    if (latencyNs > stats->maxNs)
+        stats->maxNs = latencyNs;
+    stats->sumNs += latencyNs;
+    stats->sumSquaresNs += (double)latencyNs * latencyNs;
+    stats->count++;
+}
+
+static void init_startup_pipe(void) {
+    if (epollFd >= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&loop.lock);
+
+    if (startupFds[0] < 0) {
+        if (pipe(startupFds) != 0) {
+            ERR_PRINT("pipe failed\n");
+            pthread_mutex_unlock(&loop.lock);
+            return;
+        }
+
+        // only the write end is inherited by the instances
+        fcntl(startupFds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(startupFds[0], F_SETFL, O_NONBLOCK);
+
+        char buffer[16];
+        sprintf(buffer, "%d", startupFds[1]);
+        setenv(STARTUP_FD_ENV, buffer, 1);
+
+        pthread_key_create(&loop.epollKey, &close_event_loop);
+    }
+
+    pthread_mutex_unlock(&loop.lock);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        ERR_PRINT("epoll_create1 failed\n");
+        return;
+    }
+
+    // the epoll instance is closed when the thread terminates
+    pthread_setspecific(loop.epollKey, (void *)(intptr_t)(epollFd + 1));
+
+    // any one of the threads drains the startup pipe
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.ptr = &startupFds[0];
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, startupFds[0], &event);
+}
+
+static void close_event_loop(void *fd) {
+    close((int)(intptr_t)fd - 1);
+}
+
+static void send_startup_record(int event) {
+    const char *fd = getenv(STARTUP_FD_ENV);
+    const char *tag = getenv(STARTUP_TAG_ENV);
+
+    if (fd && tag)
+    {
+        startupRecord_t record = {getpid(), atoi(tag), event, monotonic_ns()};
+        write(atoi(fd), &record, sizeof(record));
+    }
+}
+
+static void read_startup_records(void) {
+    // called with loop.lock held
+    if (startupFds[0] < 0) {
+        return;
+    }
+
+    startupRecord_t record;
+    while (read(startupFds[0], &record, sizeof(record)) == sizeof(record)) {
+        if (record.tag < 0 || record.tag >= loop.capacity) {
+            continue;
+        }
+
+        // the tag of a terminated instance may have been reused already
+        freeRTOSInstance *instance = loop.instances[record.tag];
+        if (!instance || instance->pid != record.pid) {
+            continue;
+        }
+
+        if (record.event == STARTUP_READY)
+            instance->readyNs = record.ns;
+        else
+            instance->exitNs = record.ns;
+    }
+}
+
+static int reserve_tag(void) {
+    pthread_mutex_lock(&loop.lock);
+
+    if (loop.nFreeTags == 0) {
+        // double the number of tags
+        int capacity = loop.capacity ? 2 * loop.capacity : 64;
+
+        freeRTOSInstance **instances = realloc(loop.instances, capacity * sizeof(freeRTOSInstance *));
+        int *freeTags = realloc(loop.freeTags, capacity * sizeof(int));
+        if (!instances || !freeTags) {
+            ERR_PRINT("Couldn't allocate the instance tags.\n");
+            pthread_mutex_unlock(&loop.lock);
+            return -1;
+        }
+
+        for (int tag = capacity - 1; tag >= loop.capacity; tag--) {
+            instances[tag] = NULL;
+            freeTags[loop.nFreeTags++] = tag;
+        }
+
+        loop.instances = instances;
+        loop.freeTags = freeTags;
+        loop.capacity = capacity;
+    }
+
+    int tag = loop.freeTags[--loop.nFreeTags];
+
+    pthread_mutex_unlock(&loop.lock);
+    return tag;
+}
 
-    // stop the watchdog timer
-    timer_delete(instance->watchdog);
+static int watch_instance(freeRTOSInstance *instance, pid_t pid) {
+    pthread_mutex_lock(&loop.lock);
+    instance->pid = pid;
+    instance->readyNs = 0;
+    instance->exitNs = 0;
+    instance->killed = 0;
+    loop.instances[instance->tag] = instance;
+    pthread_mutex_unlock(&loop.lock);
 
-    if (WIFEXITED(exitCode)) {
-        // instance exited normally => return the status code
-        return WEXITSTATUS(exitCode);
-    } else {
-        // instance crashed
-        return -1;
+    instance->pidfd = syscall(SYS_pidfd_open, pid, 0);
+    instance->watchdog = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+    // this interval is NOT periodic
+    struct itimerspec timeout;
+    timeout.it_value.tv_sec = WATCHDOG_TIMEOUT_SEC;
+    timeout.it_value.tv_nsec = 0;
+    timeout.it_interval.tv_sec = 0;
+    timeout.it_interval.tv_nsec = 0;
+
+    struct epoll_event pidEvent, timerEvent;
+    pidEvent.events = EPOLLIN;
+    pidEvent.data.ptr = &instance->pidfd;
+    timerEvent.events = EPOLLIN;
+    timerEvent.data.ptr = &instance->watchdog;
+
+    if (instance->pidfd < 0 || instance->watchdog < 0 ||
+        timerfd_settime(instance->watchdog, 0, &timeout, NULL) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, instance->pidfd, &pidEvent) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, instance->watchdog, &timerEvent) != 0) {
+        ERR_PRINT("Couldn't watch the instance %d\n", pid);
+        // kill the child and release the instance
+        kill(pid, SIGKILL);
+        reap_instance(instance);
+        return 1;
     }
+
+    return 0;
 }
 
-int waitFreeRTOSInjections(const freeRTOSInstance *instances, int size, int *exitCode) {
-    int _exitCode;
+static void kill_instance(freeRTOSInstance *instance) {
+    uint64_t expirations;
+    read(instance->watchdog, &expirations, sizeof(expirations));
 
-    // wait for any child process
-    pid_t pid = waitpid(-1, &_exitCode, 0);
-    if (pid < 0) {
-        // unexpected error of waitpid function
-        return -1;
+    DEBUG_PRINT("Killing %d...\n", instance->pid);
+    // unlike kill(), the pidfd cannot refer to a recycled pid
+    if (syscall(SYS_pidfd_send_signal, instance->pidfd, SIGKILL, NULL, 0) != 0) {
+        ERR_PRINT("watchdog timer failed to kill pid %d: this should not happen!\n", instance->pid);
     }
 
-    // find the corresponding pid in the instances array
-    int pos;
-    for (pos = 0; pos < size && instances[pos].pid != pid; pos++);
+    pthread_mutex_lock(&loop.lock);
+    instance->exitNs = monotonic_ns();
+    instance->killed = 1;
+    pthread_mutex_unlock(&loop.lock);
+}
+
+static int reap_instance(freeRTOSInstance *instance) {
+    int status = 0;
+    waitpid(instance->pid, &status, 0);
+
+    unsigned long long reapNs = monotonic_ns();
+
+    pthread_mutex_lock(&loop.lock);
+
+    // the notifications of the instance are already in the pipe
+    read_startup_records();
+
+    if (instance->readyNs)
+        record_latency(&startupLatency[instance->spawnMode], instance->readyNs - instance->spawnNs);
 
-    if (pos == size) {
-        // pid is not in the array: this is unexpected!
-        return -1;
+    // time from the exit (or the kill) of the instance to its reaping
+    if (instance->exitNs && reapNs > instance->exitNs)
+    {
+        record_latency(&reapingLatency, reapNs - instance->exitNs);
+        recordPhase(PHASE_REAP, reapNs - instance->exitNs);
     }
 
-    // stop the watchdog timer
-    timer_delete(instances[pos].watchdog);
+    if (instance->readyNs && instance->exitNs > instance->readyNs && !instance->killed)
+        record_latency(&runTime, instance->exitNs - instance->readyNs);
+
+    releaseCoreSet(instance->coreSet);
+
+    // closing the descriptors removes them from the epoll instance
+    if (instance->pidfd >= 0)
+        close(instance->pidfd);
+    if (instance->watchdog >= 0)
+        close(instance->watchdog);
+
+    loop.instances[instance->tag] = NULL;
+    loop.freeTags[loop.nFreeTags++] = instance->tag;
+    instance->pid = 0;
 
-    // check the exit code
-    if (WIFEXITED(_exitCode)) {
-        // instance exited normally => return the status code
-        *exitCode = WEXITSTATUS(_exitCode);
-    } else {
-        // instance crashed
-        *exitCode = -1; 
+    pthread_mutex_unlock(&loop.lock);
+
+    return (int)decodeExitCode(status);
+}
+
+int waitFreeRTOSInjection(freeRTOSInstance *instance)
+{
+    // wait for the instance to terminate, or for its watchdog to expire
+    struct pollfd fds[2] = {{instance->pidfd, POLLIN, 0}, {instance->watchdog, POLLIN, 0}};
+
+    while (!(fds[0].revents & POLLIN)) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            kill_instance(instance);
+            fds[1].fd = -1;
+        }
     }
 
-    // return the position of the child that returned
-    return pos;
-}
\ No newline at end of file
+    return reap_instance(instance);
+}
+
+int waitFreeRTOSInjections(freeRTOSInstance *instances, int size, int *exitCode) {
+    for (;;) {
+        // one event at a time: an event must not refer to an instance
+        // that has been reaped (and whose slot reused) in the meantime
+        struct epoll_event event;
+        int nEvents = epoll_wait(epollFd, &event, 1, -1);
+
+        if (nEvents < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (nEvents != 1) {
+            // unexpected error of epoll_wait function
+            return -1;
+        }
+
+        if (event.data.ptr == &startupFds[0]) {
+            pthread_mutex_lock(&loop.lock);
+            read_startup_records();
+            pthread_mutex_unlock(&loop.lock);
+            continue;
+        }
+
+        // the event points to the pidfd or to the watchdog of the instance
+        uintptr_t offset = (uintptr_t)event.data.ptr - (uintptr_t)instances;
+        int pos = offset / sizeof(freeRTOSInstance);
+
+        if ((uintptr_t)event.data.ptr < (uintptr_t)instances || pos >= size) {
+            // the instance is not in the array: this is unexpected!
+            return -1;
+        }
+
+        freeRTOSInstance *instance = &instances[pos];
+
+        if (event.data.ptr == &instance->watchdog) {
+            kill_instance(instance);
+            continue;
+        }
+
+        *exitCode = reap_instance(instance);
+
+        // return the position of the child that returned
+        return pos;
+    }
+}
@@ -3,14 +3,29 @@
 #include <unistd.h>
 #include <time.h>
 
+// maximum execution time of a FreeRTOS instance
+#define WATCHDOG_TIMEOUT_SEC 1
+
 /**
  * Posix implementation of a freeRTOSInstance 
  */
 typedef struct
 {
-    // watchdog timer used to kill the Free RTOS instance
+    // watchdog timerfd used to kill the Free RTOS instance
     // if it stops responding
-    timer_t watchdog;
-    // process identifier of the Free RTOS instance
+    int watchdog;
+    // process identifier of the Free RTOS instance (0 if the slot
+    // is free) and a pidfd that becomes readable when it terminates
     pid_t pid;
+    int pidfd;
+    // identifies the instance in its startup notifications
+    int tag;
+    // core set the instance is pinned to (-1 if none, see affinity.h)
+    int coreSet;
+    // how the instance was created (SPAWN_*) and when (CLOCK_MONOTONIC, ns)
+    int spawnMode;
+    unsigned long long spawnNs;
+    // when the instance was ready and when it exited or was killed (0 if unknown)
+    unsigned long long readyNs, exitNs;
+    int killed;
 } freeRTOSInstance;
\ No newline at end of file
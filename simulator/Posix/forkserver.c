@@ -0,0 +1,431 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+
+#include "../simulator.h"
+#include "fork_internal.h"
+#include "utils.h"
+
+/**
+ * Message sent by an injection instance to the orchestrator as soon as
+ * it is created, so that its exit code can be matched to the plan.
+ */
+typedef struct
+{
+    pid_t pid;
+    int index;
+} forkServerReport_t;
+
+/**
+ * State of the fork server. It is set up by the orchestrator before
+ * forking the master and inherited by the master, the checkpoints
+ * and the injection instances.
+ */
+static struct
+{
+    // sorted injection plan
+    injection_t *plan;
+    int size;
+
+    forkServerInjection_t startInjection;
+
+    // credits: a checkpoint consumes one byte before forking an injection
+    // instance, the orchestrator gives it back when the instance terminates
+    int creditFds[2];
+    // reports of the injection instances (forkServerReport_t)
+    int reportFds[2];
+
+    int isMaster;
+
+    // master only: index of the first injection not assigned to any checkpoint
+    // yet, and write end of the pipe of the last checkpoint (-1 if none)
+    int next;
+    int checkpointFd;
+    unsigned long lastCheckpoint;
+} server = {.checkpointFd = -1};
+
+static int compareInjectionTime(const void *a, const void *b);
+static void takeCheckpoint(unsigned long now);
+static void closeCheckpoint(int end);
+static int runCheckpoint(int windowFd, int start, unsigned long snapshotTime);
+static void runInjection(int index, unsigned long snapshotTime);
+static void armSelfWatchdog(void);
+static void drainReports(pid_t *pids);
+
+int runForkServerCampaign(injection_t *plan, int size, int parallelism,
+                          const char *injectorPath,
+                          forkServerMaster_t runMaster,
+                          forkServerInjection_t startInjection,
+                          forkServerResult_t onResult)
+{
+    if (size <= 0)
+    {
+        return FORK_SERVER_SUCCESS;
+    }
+
+    // checkpoints hand the injection instances over to the orchestrator
+    // by double forking: make the orchestrator adopt its orphan descendants
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0)
+    {
+        ERR_PRINT("prctl(PR_SET_CHILD_SUBREAPER) failed\n");
+        return FORK_SERVER_FAILURE;
+    }
+
+    if (pipe(server.creditFds) != 0 || pipe(server.reportFds) != 0)
+    {
+        ERR_PRINT("pipe failed\n");
+        return FORK_SERVER_FAILURE;
+    }
+    fcntl(server.reportFds[0], F_SETFL, O_NONBLOCK);
+
+    // credits may be given back after the last checkpoint is gone
+    void (*sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    // checkpoints are taken in time order => serve injections in time order
+    qsort(plan, size, sizeof(injection_t), compareInjectionTime);
+    server.plan = plan;
+    server.size = size;
+    server.startInjection = startInjection;
+
+    for (int i = 0; i < min(parallelism, size); i++)
+    {
+        write(server.creditFds[1], "c", 1);
+    }
+
+    pid_t master = fork();
+    if (master < 0)
+    {
+        ERR_PRINT("Couldn't create the fork server master.\n");
+        return FORK_SERVER_FAILURE;
+    }
+
+    if (master == 0)
+    {
+        close(server.creditFds[1]);
+        close(server.reportFds[0]);
+
+        server.isMaster = 1;
+        vPortEnableSnapshots();
+
+        runMaster();
+
+        // never executed: the master terminates in forkServerShutdown
+        _exit(GENERIC_ERROR_EXIT_CODE);
+    }
+
+    close(server.creditFds[0]);
+    close(server.reportFds[1]);
+
+    // pid of the instance running each injection (0: not started yet, -1: done)
+    pid_t *pids = (pid_t *)calloc(size, sizeof(pid_t));
+    int nCompleted = 0;
+
+    while (nCompleted < size)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // no more descendants: the fork server stopped
+            break;
+        }
+
+        // an instance reports its pid before doing anything else,
+        // hence the report of a terminated instance is already available
+        drainReports(pids);
+
+        int index;
+        for (index = 0; index < size && pids[index] != pid; index++);
+
+        if (index == size)
+        {
+            // master, checkpoint or intermediate process
+            continue;
+        }
+
+        pids[index] = -1;
+        nCompleted++;
+        onResult(&plan[index], decodeExitCode(status));
+
+        // give back the credit
+        write(server.creditFds[1], "c", 1);
+    }
+
+    // the master, if still running, only has spare checkpoints left
+    close(server.creditFds[1]);
+    kill(master, SIGKILL);
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR);
+
+    drainReports(pids);
+    close(server.reportFds[0]);
+    signal(SIGPIPE, sigpipe);
+
+    // fall back to a regular --run instance for the injections that were not served
+    for (int i = 0; i < size; i++)
+    {
+        if (pids[i] == -1)
+            continue;
+
+        if (pids[i] > 0)
+        {
+            // started but lost (e.g. the orchestrator was interrupted): count
+            // it as a crash like the regular spawn path does for killed instances
+            onResult(&plan[i], EXECUTION_RESULT_CRASH_EXIT_CODE);
+            continue;
+        }
+
+        DEBUG_PRINT("Fork server did not serve injection %d, falling back to --run\n", i);
+
+        freeRTOSInstance instance;
+        if (runFreeRTOSInjection(&instance, injectorPath, plan[i].campaign->targetStructure,
+                                 plan[i].injTime, plan[i].offsetByte, plan[i].offsetBit) < 0)
+        {
+            ERR_PRINT("Couldn't create child process.\n");
+            free(pids);
+            return FORK_SERVER_FAILURE;
+        }
+
+        int exitCode = waitFreeRTOSInjection(&instance);
+        onResult(&plan[i], exitCode < 0 ? EXECUTION_RESULT_CRASH_EXIT_CODE : exitCode);
+    }
+
+    free(pids);
+    return FORK_SERVER_SUCCESS;
+}
+
+int isForkServerMaster(void)
+{
+    return server.isMaster;
+}
+
+void forkServerStart(void)
+{
+    // the task threads park themselves right after being created
+    while (!xPortSnapshotIsConsistent())
+    {
+        sched_yield();
+    }
+
+    takeCheckpoint(0);
+}
+
+void forkServerCheckpoint(unsigned long now)
+{
+    if (server.next >= server.size && server.checkpointFd < 0)
+    {
+        // all the injections have been served
+        return;
+    }
+
+    // at most one checkpoint per tick
+    if (now < server.lastCheckpoint + portTICK_PERIOD_MS * 1000000ul)
+    {
+        return;
+    }
+
+    if (!xPortSnapshotIsConsistent())
+    {
+        return;
+    }
+
+    // the previous checkpoint serves the injections that precede this one
+    int end = server.next;
+    while (end < server.size && server.plan[end].injTime < now)
+    {
+        end++;
+    }
+    closeCheckpoint(end);
+
+    if (server.next < server.size)
+    {
+        takeCheckpoint(now);
+    }
+}
+
+void forkServerShutdown(void)
+{
+    // the last checkpoint serves the injections past the end of the golden run
+    closeCheckpoint(server.size);
+    _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+}
+
+static int compareInjectionTime(const void *a, const void *b)
+{
+    const injection_t *x = (const injection_t *)a, *y = (const injection_t *)b;
+
+    return (x->injTime > y->injTime) - (x->injTime < y->injTime);
+}
+
+static void takeCheckpoint(unsigned long now)
+{
+    int windowFds[2];
+
+    if (pipe(windowFds) != 0)
+    {
+        ERR_PRINT("pipe failed\n");
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        ERR_PRINT("Couldn't create a fork server checkpoint.\n");
+        close(windowFds[0]);
+        close(windowFds[1]);
+        return;
+    }
+
+    if (pid == 0)
+    {
+        close(windowFds[1]);
+        if (runCheckpoint(windowFds[0], server.next, now))
+        {
+            // injection instance: resume the snapshot
+            return;
+        }
+        _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+    }
+
+    close(windowFds[0]);
+    server.checkpointFd = windowFds[1];
+    server.lastCheckpoint = now;
+}
+
+static void closeCheckpoint(int end)
+{
+    if (server.checkpointFd < 0)
+    {
+        return;
+    }
+
+    write(server.checkpointFd, &end, sizeof(end));
+    close(server.checkpointFd);
+
+    server.checkpointFd = -1;
+    server.next = end;
+}
+
+/**
+ * Serve the window of injections assigned to a checkpoint.
+ * Returns nonzero in the injection instances, zero in the checkpoint.
+ */
+static int runCheckpoint(int windowFd, int start, unsigned long snapshotTime)
+{
+    int end;
+
+    server.isMaster = 0;
+
+    // wait until the master knows which injections precede the next checkpoint
+    if (read(windowFd, &end, sizeof(end)) != sizeof(end))
+    {
+        // the master died: the orchestrator runs the injections on its own
+        return 0;
+    }
+    close(windowFd);
+
+    for (int i = start; i < end; i++)
+    {
+        char credit;
+        if (read(server.creditFds[0], &credit, 1) != 1)
+        {
+            return 0;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // double fork: the injection instance is adopted by the orchestrator
+            if (fork() == 0)
+            {
+                runInjection(i, snapshotTime);
+                return 1;
+            }
+            _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+        }
+
+        if (pid > 0)
+        {
+            waitpid(pid, NULL, 0);
+        }
+    }
+
+    return 0;
+}
+
+static void runInjection(int index, unsigned long snapshotTime)
+{
+    forkServerReport_t report = {getpid(), index};
+
+    write(server.reportFds[1], &report, sizeof(report));
+    close(server.reportFds[1]);
+    close(server.creditFds[0]);
+
+    armSelfWatchdog();
+
+    // same scheduling parameters as the --run instances
+    raise_scheduling_priority();
+
+    // the checkpoint was paused: resume the simulated time where the snapshot was taken
+    vRestoreTimerForRunTimeStats(snapshotTime);
+    vPortRestoreSnapshot();
+
+    server.startInjection(&server.plan[index], snapshotTime);
+
+    // back to the tick interrupt (or to the scheduler start) of the snapshot
+}
+
+static void armSelfWatchdog(void)
+{
+    // the kernel delivers SIGKILL to this process when the timer expires,
+    // which works even if the simulation stops responding
+    struct sigevent sig;
+    memset(&sig, 0, sizeof(sig));
+    sig.sigev_notify = SIGEV_SIGNAL;
+    sig.sigev_signo = SIGKILL;
+
+    timer_t timerId;
+    if (timer_create(CLOCK_MONOTONIC, &sig, &timerId) != 0)
+    {
+        ERR_PRINT("timer_create failed");
+        _exit(GENERIC_ERROR_EXIT_CODE);
+    }
+
+    struct itimerspec in;
+    in.it_value.tv_sec = WATCHDOG_TIMEOUT_SEC;
+    in.it_value.tv_nsec = 0;
+    in.it_interval.tv_sec = 0;
+    in.it_interval.tv_nsec = 0;
+
+    if (timer_settime(timerId, 0, &in, NULL) != 0)
+    {
+        ERR_PRINT("timer_settime failed");
+        _exit(GENERIC_ERROR_EXIT_CODE);
+    }
+}
+
+static void drainReports(pid_t *pids)
+{
+    forkServerReport_t report;
+
+    while (read(server.reportFds[0], &report, sizeof(report)) == sizeof(report))
+    {
+        if (report.index >= 0 && report.index < server.size)
+        {
+            pids[report.index] = report.pid;
+        }
+    }
+}
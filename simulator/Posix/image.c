@@ -0,0 +1,88 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <link.h>
+
+#include "../simulator.h"
+#include "../image.h"
+
+// any writable object of this file: it identifies the object to save
+static dataImage_t *imageBeingSaved;
+
+static int findDataSegment(struct dl_phdr_info *info, size_t size, void *data);
+
+int saveDataImage(dataImage_t *image)
+{
+    image->start = NULL;
+    image->size = 0;
+    image->copy = NULL;
+
+    imageBeingSaved = image;
+    dl_iterate_phdr(&findDataSegment, image);
+
+    if (!image->start)
+    {
+        ERR_PRINT("Couldn't find the data segment.\n");
+        return IMAGE_FAILURE;
+    }
+
+    image->copy = (char *)malloc(image->size);
+    if (!image->copy)
+    {
+        ERR_PRINT("Couldn't allocate the image of the data segment.\n");
+        return IMAGE_FAILURE;
+    }
+
+    memcpy(image->copy, image->start, image->size);
+    return IMAGE_SUCCESS;
+}
+
+void restoreDataImage(const dataImage_t *image)
+{
+    memcpy(image->start, image->copy, image->size);
+}
+
+/*
+ * dl_iterate_phdr() callback: select the writable PT_LOAD segment that holds
+ * imageBeingSaved, minus its leading PT_GNU_RELRO part (.got, .dynamic...),
+ * which is read-only once relocated.
+ */
+static int findDataSegment(struct dl_phdr_info *info, size_t size, void *data)
+{
+    dataImage_t *image = (dataImage_t *)data;
+    uintptr_t self = (uintptr_t)&imageBeingSaved;
+    uintptr_t start = 0, end = 0, relroEnd = 0;
+
+    for (int i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+        uintptr_t segmentStart = info->dlpi_addr + phdr->p_vaddr;
+        uintptr_t segmentEnd = segmentStart + phdr->p_memsz;
+
+        if (phdr->p_type == PT_LOAD && (phdr->p_flags & PF_W) &&
+            self >= segmentStart && self < segmentEnd)
+        {
+            start = segmentStart;
+            end = segmentEnd;
+        }
+        else if (phdr->p_type == PT_GNU_RELRO)
+        {
+            relroEnd = segmentEnd;
+        }
+    }
+
+    if (!end)
+    {
+        return 0;
+    }
+
+    if (relroEnd > start && relroEnd < end)
+    {
+        start = relroEnd;
+    }
+
+    image->start = (char *)start;
+    image->size = end - start;
+    return 1;
+}
@@ -0,0 +1,432 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "../simulator.h"
+#include "queue.h"
+#include "semphr.h"
+
+// inherited by the instances, across execv too
+#define IRQ_LOAD_ENV "SIM_IRQ_LOAD"
+
+// above the tasks of the workload, below the timer task
+#define IRQLOAD_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+#define IRQLOAD_QUEUE_LENGTH 8
+#define IRQLOAD_MAX_RATE_HZ 1000000.0
+
+// the generator thread checks the scheduler at least this often
+#define IRQLOAD_POLL_NS 1000000ull
+
+// the Poisson sources draw their intervals from this seed (plus their index)
+#define IRQLOAD_SEED 0x9e3779b97f4a7c15ull
+
+extern void vPortSetInterruptHandler(uint32_t ulInterruptNumber, uint32_t (*pvHandler)(void));
+
+typedef struct
+{
+    int isQueue, isPoisson;
+    double rateHz;
+    QueueHandle_t queue;
+
+    // on the monotonic clock, or the virtual one (0: not drawn yet)
+    unsigned long long nextNs;
+    unsigned long long seed;
+
+    // raise of the pending interrupt (0: none)
+    unsigned long long raisedNs;
+    // virtual clock: occurrences raised and not served yet
+    unsigned long backlog;
+    unsigned long raised, served, dropped, consumed;
+    histogram_t latency;
+} irqSource_t;
+
+static irqSource_t sources[IRQLOAD_MAX_SOURCES];
+static int nSources = 0;
+static char *loadSpec = NULL;
+
+// start of the current generator thread: an older one exits
+static volatile uintptr_t generatorToken;
+
+static int parseIrqLoad(const char *spec);
+static uint32_t serveIrqSource(irqSource_t *source);
+static void raiseIrqSource(int source, unsigned long count);
+static unsigned long long drawInterval(irqSource_t *source);
+static void raiseDueSources(unsigned long long nowNs, unsigned long long *wakeNs);
+static void *generatorFunction(void *arg);
+static void irqLoadTask(void *params);
+
+// a handler per interrupt number: vPortSetInterruptHandler passes no argument
+#define IRQ_HANDLER(n) \
+    static uint32_t irqHandler##n(void) { return serveIrqSource(&sources[n]); }
+
+IRQ_HANDLER(0)
+IRQ_HANDLER(1)
+IRQ_HANDLER(2)
+IRQ_HANDLER(3)
+IRQ_HANDLER(4)
+IRQ_HANDLER(5)
+IRQ_HANDLER(6)
+IRQ_HANDLER(7)
+
+static uint32_t (*const irqHandlers[IRQLOAD_MAX_SOURCES])(void) = {
+    irqHandler0, irqHandler1, irqHandler2, irqHandler3,
+    irqHandler4, irqHandler5, irqHandler6, irqHandler7};
+
+int enableIrqLoad(const char *spec)
+{
+    if (parseIrqLoad(spec) != IRQLOAD_SUCCESS)
+    {
+        ERR_PRINT("Invalid interrupt load %s: expected (queue|semaphore):(periodic|poisson):RATE[,...], at most %d sources.\n",
+                  spec, IRQLOAD_MAX_SOURCES);
+        return IRQLOAD_FAILURE;
+    }
+
+    if (setenv(IRQ_LOAD_ENV, spec, 1) != 0)
+    {
+        ERR_PRINT("Couldn't enable the interrupt load for the instances.\n");
+        return IRQLOAD_FAILURE;
+    }
+
+    return IRQLOAD_SUCCESS;
+}
+
+void inheritIrqLoad(void)
+{
+    const char *spec = getenv(IRQ_LOAD_ENV);
+
+    if (spec && parseIrqLoad(spec) != IRQLOAD_SUCCESS)
+    {
+        ERR_PRINT("Ignoring the invalid interrupt load %s.\n", spec);
+    }
+}
+
+int isIrqLoad(void)
+{
+    return nSources > 0;
+}
+
+const char *getIrqLoadSpec(void)
+{
+    return nSources > 0 ? loadSpec : NULL;
+}
+
+int setupIrqLoad(void)
+{
+    char name[configMAX_TASK_NAME_LEN];
+
+    for (int i = 0; i < nSources; i++)
+    {
+        irqSource_t *source = &sources[i];
+
+        source->queue = source->isQueue ? xQueueCreate(IRQLOAD_QUEUE_LENGTH, sizeof(uint32_t))
+                                        : xSemaphoreCreateBinary();
+        snprintf(name, sizeof(name), "Irq%d", i);
+
+        if (!source->queue ||
+            xTaskCreate(irqLoadTask, name, configMINIMAL_STACK_SIZE, source, IRQLOAD_TASK_PRIORITY, NULL) != pdPASS)
+        {
+            ERR_PRINT("Couldn't create the interrupt source %d.\n", i);
+            return IRQLOAD_FAILURE;
+        }
+
+        vPortSetInterruptHandler(IRQLOAD_FIRST_INTERRUPT + i, irqHandlers[i]);
+    }
+
+    return IRQLOAD_SUCCESS;
+}
+
+void startIrqLoad(void)
+{
+    if (!nSources)
+    {
+        return;
+    }
+
+    // every run draws the same intervals
+    for (int i = 0; i < nSources; i++)
+    {
+        sources[i].nextNs = 0;
+        sources[i].seed = IRQLOAD_SEED + i;
+        sources[i].raisedNs = 0;
+        sources[i].backlog = 0;
+    }
+
+    if (isVirtualTime())
+    {
+        // raised by the tick hook
+        return;
+    }
+
+    // a worker restores the token of its image: the clock tells the runs apart
+    generatorToken = (uintptr_t)phaseClockNs();
+
+    pthread_attr_t attrs;
+    pthread_attr_init(&attrs);
+    pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+
+    // right below the injector thread, above the threads of the tasks
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    pthread_attr_setinheritsched(&attrs, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attrs, SCHED_FIFO);
+    pthread_attr_setschedparam(&attrs, &param);
+
+    // the interrupts are signals of the process: none of them for this thread
+    sigset_t allSignals, old;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_SETMASK, &allSignals, &old);
+
+    pthread_t thread;
+    int ret = pthread_create(&thread, &attrs, generatorFunction, (void *)generatorToken);
+    if (ret == EPERM)
+    {
+        // not privileged: inherit the scheduling of the process
+        pthread_attr_setinheritsched(&attrs, PTHREAD_INHERIT_SCHED);
+        ret = pthread_create(&thread, &attrs, generatorFunction, (void *)generatorToken);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_attr_destroy(&attrs);
+
+    if (ret != 0)
+    {
+        ERR_PRINT("Couldn't start the interrupt load.\n");
+    }
+}
+
+void tickIrqLoad(unsigned long nowNs)
+{
+    unsigned long long wakeNs = ~0ull;
+
+    raiseDueSources(nowNs, &wakeNs);
+}
+
+unsigned long getIrqLoadDeadline(void)
+{
+    unsigned long long deadlineNs = 0;
+
+    for (int i = 0; i < nSources; i++)
+    {
+        // not drawn yet: no tick is skipped before the first one
+        if (!sources[i].nextNs)
+            return 1;
+
+        if (!deadlineNs || sources[i].nextNs < deadlineNs)
+            deadlineNs = sources[i].nextNs;
+    }
+
+    return (unsigned long)deadlineNs;
+}
+
+int countIrqLoadSources(void)
+{
+    return nSources;
+}
+
+void getIrqLoadStats(int source, irqLoadStats_t *stats)
+{
+    const irqSource_t *s = &sources[source];
+
+    stats->kind = s->isQueue ? "queue" : "semaphore";
+    stats->process = s->isPoisson ? "poisson" : "periodic";
+    stats->rateHz = s->rateHz;
+    stats->raised = __atomic_load_n(&s->raised, __ATOMIC_RELAXED);
+    stats->served = __atomic_load_n(&s->served, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&s->dropped, __ATOMIC_RELAXED);
+    stats->consumed = s->consumed;
+    readHistogram(&s->latency, &stats->latency);
+}
+
+static int parseIrqLoad(const char *spec)
+{
+    char *copy = strdup(spec), *rest, *item;
+    int n = 0;
+
+    memset(sources, 0, sizeof(sources));
+    nSources = 0;
+
+    for (item = strtok_r(copy, ",", &rest); item; item = strtok_r(NULL, ",", &rest))
+    {
+        char *fields, *kind = strtok_r(item, ":", &fields);
+        char *process = strtok_r(NULL, ":", &fields);
+        char *rate = strtok_r(NULL, ":", &fields);
+        char *end;
+
+        if (n == IRQLOAD_MAX_SOURCES || !kind || !process || !rate || strtok_r(NULL, ":", &fields))
+            break;
+
+        sources[n].isQueue = strcmp(kind, "queue") == 0;
+        sources[n].isPoisson = strcmp(process, "poisson") == 0;
+        sources[n].rateHz = strtod(rate, &end);
+
+        if ((!sources[n].isQueue && strcmp(kind, "semaphore") != 0) ||
+            (!sources[n].isPoisson && strcmp(process, "periodic") != 0) ||
+            *end || !(sources[n].rateHz > 0 && sources[n].rateHz <= IRQLOAD_MAX_RATE_HZ))
+            break;
+
+        n++;
+    }
+
+    // every item was accepted
+    int ok = n > 0 && item == NULL;
+    free(copy);
+
+    if (!ok)
+    {
+        memset(sources, 0, sizeof(sources));
+        return IRQLOAD_FAILURE;
+    }
+
+    free(loadSpec);
+    loadSpec = strdup(spec);
+    nSources = n;
+    return IRQLOAD_SUCCESS;
+}
+
+static uint32_t serveIrqSource(irqSource_t *source)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    // left pending once the scheduler has ended
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+        return pdFALSE;
+
+    unsigned long long raisedNs = __atomic_exchange_n(&source->raisedNs, 0, __ATOMIC_ACQ_REL);
+    unsigned long long nowNs = phaseClockNs();
+    if (raisedNs && nowNs > raisedNs)
+        addToHistogram(&source->latency, nowNs - raisedNs);
+
+    unsigned long served = __atomic_add_fetch(&source->served, 1, __ATOMIC_RELAXED);
+
+    // a failed call from an ISR would mark the end of the run
+    if (source->isQueue && !xQueueIsQueueFullFromISR(source->queue))
+    {
+        uint32_t value = (uint32_t)served;
+        xQueueSendFromISR(source->queue, &value, &higherPriorityTaskWoken);
+    }
+    else if (!source->isQueue && uxQueueMessagesWaitingFromISR(source->queue) == 0)
+    {
+        xSemaphoreGiveFromISR(source->queue, &higherPriorityTaskWoken);
+    }
+    else
+    {
+        __atomic_fetch_add(&source->dropped, 1, __ATOMIC_RELAXED);
+    }
+
+    // the next occurrence due at the same tick, once this handler has returned
+    if (isVirtualTime() && __atomic_sub_fetch(&source->backlog, 1, __ATOMIC_ACQ_REL) > 0)
+    {
+        __atomic_store_n(&source->raisedNs, raisedNs, __ATOMIC_RELEASE);
+        vPortGenerateSimulatedInterrupt(IRQLOAD_FIRST_INTERRUPT + (source - sources));
+    }
+
+    return higherPriorityTaskWoken;
+}
+
+static void raiseIrqSource(int source, unsigned long count)
+{
+    unsigned long long none = 0;
+
+    __atomic_fetch_add(&sources[source].raised, count, __ATOMIC_RELAXED);
+
+    // merged with the pending interrupt: its latency is the one of the first raise
+    __atomic_compare_exchange_n(&sources[source].raisedNs, &none, phaseClockNs(), 0,
+                                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+    // virtual clock: each occurrence is an interrupt of its own, the handler
+    // raises the next one (see serveIrqSource)
+    if (isVirtualTime() && __atomic_fetch_add(&sources[source].backlog, count, __ATOMIC_ACQ_REL) > 0)
+        return;
+
+    vPortGenerateSimulatedInterrupt(IRQLOAD_FIRST_INTERRUPT + source);
+}
+
+static unsigned long long drawInterval(irqSource_t *source)
+{
+    double periodNs = 1e9 / source->rateHz;
+
+    if (!source->isPoisson)
+        return (unsigned long long)periodNs;
+
+    // xorshift64*, uniform in [0, 1)
+    source->seed ^= source->seed >> 12;
+    source->seed ^= source->seed << 25;
+    source->seed ^= source->seed >> 27;
+    double u = ((source->seed * 0x2545f4914f6cdd1dull) >> 11) * (1.0 / 9007199254740992.0);
+
+    return (unsigned long long)(-log(1.0 - u) * periodNs) + 1;
+}
+
+/**
+ * Raise the interrupts due at nowNs, and return the next deadline in wakeNs.
+ */
+static void raiseDueSources(unsigned long long nowNs, unsigned long long *wakeNs)
+{
+    for (int i = 0; i < nSources; i++)
+    {
+        irqSource_t *source = &sources[i];
+
+        if (!source->nextNs)
+            source->nextNs = nowNs + drawInterval(source);
+
+        unsigned long due = 0;
+        while (source->nextNs <= nowNs)
+        {
+            due++;
+            source->nextNs += drawInterval(source);
+        }
+
+        if (due)
+            raiseIrqSource(i, due);
+
+        *wakeNs = min(*wakeNs, source->nextNs);
+    }
+}
+
+static void *generatorFunction(void *arg)
+{
+    uintptr_t token = (uintptr_t)arg;
+    int running = 0;
+
+    while (generatorToken == token)
+    {
+        unsigned long long nowNs = phaseClockNs();
+        unsigned long long wakeNs = nowNs + IRQLOAD_POLL_NS;
+
+        if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+        {
+            running = 1;
+            raiseDueSources(nowNs, &wakeNs);
+        }
+        else if (running)
+        {
+            // the scheduler has ended
+            break;
+        }
+
+        struct timespec wake = {wakeNs / 1000000000ull, wakeNs % 1000000000ull};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+    }
+
+    return NULL;
+}
+
+static void irqLoadTask(void *params)
+{
+    irqSource_t *source = params;
+    uint32_t value;
+
+    for (;;)
+    {
+        // blocked with no timeout: the Idle task can end the run (see isIdleHighlander)
+        BaseType_t taken = source->isQueue ? xQueueReceive(source->queue, &value, portMAX_DELAY)
+                                           : xSemaphoreTake(source->queue, portMAX_DELAY);
+        if (taken == pdPASS)
+            source->consumed++;
+    }
+}
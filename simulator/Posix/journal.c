@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../simulator.h"
+
+#define JOURNAL_MAGIC "SIMJRNL1"
+
+// types of the entries
+#define ENTRY_PLANNED 1
+#define ENTRY_COMPLETED 2
+
+typedef struct
+{
+    char magic[8];
+    uint32_t seed;
+    uint32_t reserved;
+} journalHeader_t;
+
+typedef struct
+{
+    uint32_t type, exitCode;
+    // key of the injection: its position in the plan
+    uint64_t index;
+    // planned injection, to check that a resumed plan is the same
+    uint64_t injTime;
+    uint32_t offsetByte, offsetBit;
+    uint32_t target;
+    // of all the fields above
+    uint32_t checksum;
+} journalEntry_t;
+
+/**
+ * The open journal, and the completed injections queued for its writer.
+ */
+static struct
+{
+    int fd;
+    int resumed;
+    const injection_t *plan;
+    int size;
+
+    pthread_t writer;
+    int started, closing;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    journalEntry_t *queue;
+    int nQueued, capacity;
+} journal = {-1, 0, NULL, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static void *runWriter(void *arg);
+static int readEntries(workerResult_t onCompleted);
+static int writePlan(void);
+static void fillEntry(journalEntry_t *entry, uint32_t type, const injection_t *injection, unsigned int exitCode);
+static uint32_t hashBytes(const void *data, size_t size, uint32_t hash);
+static int writeAll(const void *data, size_t size);
+
+int openJournal(const char *path, int resume, unsigned int *seed)
+{
+    journalHeader_t header;
+
+    if (resume)
+    {
+        journal.fd = open(path, O_RDWR | O_CLOEXEC);
+        if (journal.fd < 0 || read(journal.fd, &header, sizeof(header)) != sizeof(header) ||
+            memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0)
+        {
+            ERR_PRINT("%s is not a campaign journal.\n", path);
+            closeJournal();
+            return JOURNAL_FAILURE;
+        }
+
+        *seed = header.seed;
+        journal.resumed = 1;
+        return JOURNAL_SUCCESS;
+    }
+
+    journal.fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (journal.fd < 0)
+    {
+        ERR_PRINT("Couldn't create the journal %s.\n", path);
+        return JOURNAL_FAILURE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.seed = *seed;
+
+    if (writeAll(&header, sizeof(header)) != 0)
+    {
+        ERR_PRINT("Couldn't write the journal %s.\n", path);
+        closeJournal();
+        return JOURNAL_FAILURE;
+    }
+
+    journal.resumed = 0;
+    return JOURNAL_SUCCESS;
+}
+
+int startJournal(const injection_t *plan, int size, workerResult_t onCompleted)
+{
+    if (journal.fd < 0)
+    {
+        return JOURNAL_FAILURE;
+    }
+
+    journal.plan = plan;
+    journal.size = size;
+
+    int ret = journal.resumed ? readEntries(onCompleted) : writePlan();
+    if (ret != 0)
+    {
+        return JOURNAL_FAILURE;
+    }
+
+    journal.closing = 0;
+    journal.started = pthread_create(&journal.writer, NULL, &runWriter, NULL) == 0;
+    if (!journal.started)
+    {
+        ERR_PRINT("Couldn't create the journal writer thread.\n");
+        return JOURNAL_FAILURE;
+    }
+
+    return JOURNAL_SUCCESS;
+}
+
+void journalResult(const injection_t *injection, unsigned int exitCode)
+{
+    if (!journal.started)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&journal.lock);
+
+    if (journal.nQueued == journal.capacity)
+    {
+        int capacity = journal.capacity ? 2 * journal.capacity : 256;
+        journalEntry_t *queue = (journalEntry_t *)realloc(journal.queue, capacity * sizeof(journalEntry_t));
+        if (!queue)
+        {
+            // the injection will be run again if the campaign is resumed
+            pthread_mutex_unlock(&journal.lock);
+            return;
+        }
+
+        journal.queue = queue;
+        journal.capacity = capacity;
+    }
+
+    fillEntry(&journal.queue[journal.nQueued++], ENTRY_COMPLETED, injection, exitCode);
+
+    pthread_cond_signal(&journal.cond);
+    pthread_mutex_unlock(&journal.lock);
+}
+
+void closeJournal(void)
+{
+    if (journal.started)
+    {
+        pthread_mutex_lock(&journal.lock);
+        journal.closing = 1;
+        pthread_cond_signal(&journal.cond);
+        pthread_mutex_unlock(&journal.lock);
+
+        pthread_join(journal.writer, NULL);
+        journal.started = 0;
+    }
+
+    if (journal.fd >= 0)
+    {
+        close(journal.fd);
+        journal.fd = -1;
+    }
+
+    free(journal.queue);
+    journal.queue = NULL;
+    journal.nQueued = journal.capacity = 0;
+}
+
+/**
+ * Writer thread: commit everything queued since the last commit at once.
+ */
+static void *runWriter(void *arg)
+{
+    journalEntry_t *batch = NULL;
+    int batchCapacity = 0;
+
+    pthread_mutex_lock(&journal.lock);
+
+    for (;;)
+    {
+        while (journal.nQueued == 0 && !journal.closing)
+            pthread_cond_wait(&journal.cond, &journal.lock);
+
+        if (journal.nQueued == 0)
+            break;
+
+        // swap the queues: the collecting threads fill the other one meanwhile
+        journalEntry_t *queue = journal.queue;
+        int nQueued = journal.nQueued, capacity = journal.capacity;
+        journal.queue = batch;
+        journal.capacity = batchCapacity;
+        journal.nQueued = 0;
+        batch = queue;
+        batchCapacity = capacity;
+
+        pthread_mutex_unlock(&journal.lock);
+
+        if (writeAll(batch, nQueued * sizeof(journalEntry_t)) != 0 || fdatasync(journal.fd) != 0)
+        {
+            ERR_PRINT("Couldn't write the journal.\n");
+        }
+
+        pthread_mutex_lock(&journal.lock);
+
+        // let the next batch grow, unless the journal is being closed
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += JOURNAL_COMMIT_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+
+        while (!journal.closing &&
+               pthread_cond_timedwait(&journal.cond, &journal.lock, &deadline) != ETIMEDOUT)
+            ;
+    }
+
+    pthread_mutex_unlock(&journal.lock);
+
+    free(batch);
+    return NULL;
+}
+
+/**
+ * Read the entries of a resumed journal: check its plan and replay its
+ * completed injections. The file is truncated after the last valid entry.
+ */
+static int readEntries(workerResult_t onCompleted)
+{
+    unsigned char *completed = (unsigned char *)calloc(journal.size > 0 ? journal.size : 1, 1);
+    off_t validSize = sizeof(journalHeader_t);
+    int nPlanned = 0, nCompleted = 0;
+
+    journalEntry_t entry;
+    while (read(journal.fd, &entry, sizeof(entry)) == sizeof(entry) &&
+           entry.checksum == hashBytes(&entry, offsetof(journalEntry_t, checksum), 2166136261u))
+    {
+        journalEntry_t expected;
+
+        if (entry.type == ENTRY_PLANNED && nCompleted == 0 && nPlanned < journal.size)
+        {
+            fillEntry(&expected, ENTRY_PLANNED, &journal.plan[nPlanned], 0);
+            if (memcmp(&entry, &expected, sizeof(entry)) != 0)
+            {
+                ERR_PRINT("The journal does not match the campaign (injection %d).\n", nPlanned);
+                free(completed);
+                return -1;
+            }
+
+            nPlanned++;
+        }
+        else if (entry.type == ENTRY_COMPLETED && nPlanned == journal.size && entry.index < (uint64_t)journal.size)
+        {
+            // the first outcome of an injection wins
+            if (!completed[entry.index])
+            {
+                completed[entry.index] = 1;
+                nCompleted++;
+                onCompleted(&journal.plan[entry.index], entry.exitCode);
+            }
+        }
+        else
+        {
+            // a valid entry, but not of this plan
+            ERR_PRINT("The journal does not match the campaign (%d injections planned).\n", journal.size);
+            free(completed);
+            return -1;
+        }
+
+        validSize += sizeof(entry);
+    }
+
+    free(completed);
+
+    if (nPlanned < journal.size)
+    {
+        // the orchestrator died while writing the plan
+        DEBUG_PRINT("The journal holds %d injections of %d: writing the plan again.\n", nPlanned, journal.size);
+        validSize = sizeof(journalHeader_t);
+    }
+
+    if (ftruncate(journal.fd, validSize) != 0 || lseek(journal.fd, validSize, SEEK_SET) != validSize)
+    {
+        ERR_PRINT("Couldn't truncate the journal.\n");
+        return -1;
+    }
+
+    DEBUG_PRINT("Resuming the journal: %d injections of %d completed.\n", nCompleted, journal.size);
+
+    return nPlanned < journal.size ? writePlan() : 0;
+}
+
+static int writePlan(void)
+{
+    journalEntry_t *entries = (journalEntry_t *)malloc((journal.size > 0 ? journal.size : 1) * sizeof(journalEntry_t));
+
+    for (int i = 0; i < journal.size; i++)
+        fillEntry(&entries[i], ENTRY_PLANNED, &journal.plan[i], 0);
+
+    int ret = writeAll(entries, journal.size * sizeof(journalEntry_t));
+    free(entries);
+
+    if (ret != 0 || fdatasync(journal.fd) != 0)
+    {
+        ERR_PRINT("Couldn't write the plan to the journal.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void fillEntry(journalEntry_t *entry, uint32_t type, const injection_t *injection, unsigned int exitCode)
+{
+    memset(entry, 0, sizeof(journalEntry_t));
+
+    entry->type = type;
+    entry->exitCode = exitCode;
+    entry->index = injection->index;
+    entry->injTime = injection->injTime;
+    entry->offsetByte = (uint32_t)injection->offsetByte;
+    entry->offsetBit = (uint32_t)injection->offsetBit;
+    entry->target = hashBytes(injection->campaign->targetStructure, strlen(injection->campaign->targetStructure), 2166136261u);
+    entry->checksum = hashBytes(entry, offsetof(journalEntry_t, checksum), 2166136261u);
+}
+
+/**
+ * FNV-1a hash.
+ */
+static uint32_t hashBytes(const void *data, size_t size, uint32_t hash)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static int writeAll(const void *data, size_t size)
+{
+    const char *p = (const char *)data;
+
+    while (size > 0)
+    {
+        ssize_t n = write(journal.fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#include "../simulator.h"
+#include "../instance.h"
+
+/**
+ * sim-multi: run simulations on several copies of the shared kernel
+ * (libsimkernel.so) loaded in the same process, one thread per copy.
+ *
+ * ./sim-multi N RUNS [target time offsetByte offsetBit]
+ *
+ * Every copy runs RUNS simulations, with the given injection or without any.
+ * golden.txt must have been written by sim --golden in the working directory.
+ */
+
+// each copy of libc in a namespace takes its share of the static TLS
+#define STATIC_TLS_TUNABLE "glibc.rtld.optional_static_tls=16384"
+
+#define N_OUTCOMES 5
+
+typedef struct
+{
+    int instance;
+    simRunInstance_t run;
+    int runs;
+    // outcomes of the completed runs, indexed as outcomeCodes
+    int nOutcomes[N_OUTCOMES], nOther, nCompleted;
+} copy_t;
+
+static const unsigned int outcomeCodes[N_OUTCOMES] = {
+    EXECUTION_RESULT_SILENT_EXIT_CODE, EXECUTION_RESULT_DELAY_EXIT_CODE,
+    EXECUTION_RESULT_ERROR_EXIT_CODE, EXECUTION_RESULT_HANG_EXIT_CODE,
+    EXECUTION_RESULT_CRASH_EXIT_CODE};
+static const char *outcomeNames[N_OUTCOMES] = {"silent", "delay", "error", "hang", "crash"};
+
+// optional injection, shared by all the copies
+static const char *target;
+static unsigned long injectionTime, offsetByte, offsetBit;
+
+static void *runCopy(void *arg);
+
+int main(int argc, char **argv)
+{
+    if (argc != 3 && argc != 7)
+    {
+        ERR_PRINT("Usage: %s N RUNS [target time offsetByte offsetBit]\n", argv[0]);
+        return INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE;
+    }
+
+    // the tunable is read by the dynamic loader: set it and start again
+    if (!getenv("GLIBC_TUNABLES"))
+    {
+        setenv("GLIBC_TUNABLES", STATIC_TLS_TUNABLE, 1);
+        execv("/proc/self/exe", argv);
+        ERR_PRINT("Couldn't restart with %s.\n", STATIC_TLS_TUNABLE);
+        return GENERIC_ERROR_EXIT_CODE;
+    }
+
+    int nCopies = atoi(argv[1]);
+    int runs = atoi(argv[2]);
+    if (nCopies < 1 || nCopies > SIM_MAX_INSTANCES || runs < 1)
+    {
+        ERR_PRINT("N must be in [1, %d] and RUNS positive.\n", SIM_MAX_INSTANCES);
+        return INVALID_PARAMETERS_EXIT_CODE;
+    }
+
+    if (argc == 7)
+    {
+        target = argv[3];
+        injectionTime = atol(argv[4]);
+        offsetByte = atol(argv[5]);
+        offsetBit = atol(argv[6]);
+    }
+
+    // the shared kernel is next to the executable
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length < 0)
+    {
+        ERR_PRINT("Couldn't locate the executable.\n");
+        return GENERIC_ERROR_EXIT_CODE;
+    }
+    path[length] = '\0';
+
+    char library[PATH_MAX];
+    snprintf(library, sizeof(library), "%s/libsimkernel.so", dirname(path));
+
+    copy_t *copies = (copy_t *)calloc(nCopies, sizeof(copy_t));
+    pthread_t *threads = (pthread_t *)calloc(nCopies, sizeof(pthread_t));
+
+    for (int i = 0; i < nCopies; i++)
+    {
+        void *handle = dlmopen(LM_ID_NEWLM, library, RTLD_NOW | RTLD_LOCAL);
+        if (!handle)
+        {
+            ERR_PRINT("Couldn't load copy %d of the kernel: %s\n", i, dlerror());
+            return GENERIC_ERROR_EXIT_CODE;
+        }
+
+        copies[i].instance = i;
+        copies[i].runs = runs;
+        copies[i].run = (simRunInstance_t)dlsym(handle, SIM_INSTANCE_ENTRY);
+        if (!copies[i].run)
+        {
+            ERR_PRINT("%s not found in %s\n", SIM_INSTANCE_ENTRY, library);
+            return GENERIC_ERROR_EXIT_CODE;
+        }
+    }
+
+    // every thread only unblocks the signals of its own copy
+    // (SIGINT and SIGTERM still terminate all of them)
+    sigset_t allSignals;
+    sigfillset(&allSignals);
+    sigdelset(&allSignals, SIGINT);
+    sigdelset(&allSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &allSignals, NULL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < nCopies; i++)
+    {
+        if (pthread_create(&threads[i], NULL, &runCopy, &copies[i]) != 0)
+        {
+            ERR_PRINT("Couldn't create the thread of copy %d.\n", i);
+            return GENERIC_ERROR_EXIT_CODE;
+        }
+    }
+
+    int nOutcomes[N_OUTCOMES] = {0}, nOther = 0, nCompleted = 0;
+    for (int i = 0; i < nCopies; i++)
+    {
+        pthread_join(threads[i], NULL);
+
+        for (int j = 0; j < N_OUTCOMES; j++)
+        {
+            nOutcomes[j] += copies[i].nOutcomes[j];
+        }
+        nOther += copies[i].nOther;
+        nCompleted += copies[i].nCompleted;
+
+        if (copies[i].nCompleted < runs)
+        {
+            fprintf(stdout, "Copy %d could not be reset after %d runs.\n", i, copies[i].nCompleted);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fprintf(stdout, "Copies: %d, runs: %d/%d\n", nCopies, nCompleted, nCopies * runs);
+    for (int j = 0; j < N_OUTCOMES; j++)
+    {
+        fprintf(stdout, "  %-8s%d\n", outcomeNames[j], nOutcomes[j]);
+    }
+    fprintf(stdout, "  %-8s%d\n", "other", nOther);
+    fprintf(stdout, "Elapsed: %.3f s, %.1f runs/s\n", elapsed, nCompleted / elapsed);
+
+    free(copies);
+    free(threads);
+
+    // the copies are not unloaded: a dlclose()d namespace leaks its static TLS
+    return SUCCESSFUL_EXECUTION_EXIT_CODE;
+}
+
+static void *runCopy(void *arg)
+{
+    copy_t *copy = (copy_t *)arg;
+
+    for (int i = 0; i < copy->runs; i++)
+    {
+        int reusable;
+        unsigned int exitCode = copy->run(copy->instance, target, injectionTime, offsetByte, offsetBit, &reusable);
+
+        int j = 0;
+        while (j < N_OUTCOMES && outcomeCodes[j] != exitCode)
+        {
+            j++;
+        }
+
+        if (j < N_OUTCOMES)
+        {
+            copy->nOutcomes[j]++;
+        }
+        else
+        {
+            copy->nOther++;
+        }
+        copy->nCompleted++;
+
+        if (!reusable)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
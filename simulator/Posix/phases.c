@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../simulator.h"
+#include "utils.h"
+
+// start of PHASE_EXEC, set by the child before execv
+#define PHASE_EXEC_ENV "SIM_PHASE_EXEC_NS"
+
+// exact buckets below 16 ns, then 8 buckets per power of two
+#define EXACT_BUCKETS 16
+#define SUB_BUCKETS 8
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "fork", "exec", "target", "setup", "start", "sleep",
+    "flip", "workload", "stop", "check", "reap"};
+
+// instance: start and duration of its phases
+static unsigned long long phaseStartNs[PHASE_COUNT];
+static unsigned long long phaseNs[PHASE_COUNT];
+
+// orchestrator: histogram of each phase, and of the injection latency
+static histogram_t histograms[PHASE_COUNT];
+static histogram_t latencyHistogram;
+
+static int bucketOf(unsigned long long ns);
+static unsigned long long bucketValue(int bucket);
+static unsigned long long percentile(const histogram_t *histogram, double p);
+
+unsigned long long phaseClockNs(void)
+{
+    return monotonic_ns();
+}
+
+void beginPhase(int phase)
+{
+    phaseStartNs[phase] = phaseClockNs();
+}
+
+void endPhase(int phase)
+{
+    if (phaseStartNs[phase])
+    {
+        unsigned long long now = phaseClockNs();
+        // 0 means not measured
+        phaseNs[phase] = now > phaseStartNs[phase] ? now - phaseStartNs[phase] : 1;
+        phaseStartNs[phase] = 0;
+    }
+}
+
+void resetPhases(void)
+{
+    // the fork of a zygote instance ends before it is given its run
+    unsigned long long forkNs = phaseNs[PHASE_FORK];
+
+    memset(phaseStartNs, 0, sizeof(phaseStartNs));
+    memset(phaseNs, 0, sizeof(phaseNs));
+    phaseNs[PHASE_FORK] = forkNs;
+}
+
+void endForkPhase(unsigned long long spawnNs)
+{
+    phaseStartNs[PHASE_FORK] = spawnNs;
+    endPhase(PHASE_FORK);
+}
+
+void beginExecPhase(void)
+{
+    // the fork, measured before execv, goes along
+    char buffer[48];
+    sprintf(buffer, "%llu %llu", phaseNs[PHASE_FORK], phaseClockNs());
+    setenv(PHASE_EXEC_ENV, buffer, 1);
+}
+
+void endExecPhase(void)
+{
+    const char *start = getenv(PHASE_EXEC_ENV);
+    if (start)
+    {
+        char *end;
+        phaseNs[PHASE_FORK] = strtoull(start, &end, 10);
+        phaseStartNs[PHASE_EXEC] = strtoull(end, NULL, 10);
+        endPhase(PHASE_EXEC);
+        unsetenv(PHASE_EXEC_ENV);
+    }
+}
+
+void getPhaseDurations(unsigned long long durations[PHASE_COUNT])
+{
+    memcpy(durations, phaseNs, sizeof(phaseNs));
+}
+
+void recordPhase(int phase, unsigned long long durationNs)
+{
+    addToHistogram(&histograms[phase], durationNs);
+}
+
+void getPhaseStats(int phase, phaseStats_t *stats)
+{
+    readHistogram(&histograms[phase], stats);
+}
+
+const char *getPhaseName(int phase)
+{
+    return phase >= 0 && phase < PHASE_COUNT ? phaseNames[phase] : "?";
+}
+
+void recordInjectionLatency(unsigned long long latencyNs)
+{
+    addToHistogram(&latencyHistogram, latencyNs);
+}
+
+void getInjectionLatencyStats(phaseStats_t *stats)
+{
+    readHistogram(&latencyHistogram, stats);
+}
+
+void addToHistogram(histogram_t *histogram, unsigned long long ns)
+{
+    __atomic_fetch_add(&histogram->buckets[bucketOf(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sumNs, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+
+    unsigned long long maxNs = __atomic_load_n(&histogram->maxNs, __ATOMIC_RELAXED);
+    while (ns > maxNs &&
+           !__atomic_compare_exchange_n(&histogram->maxNs, &maxNs, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void readHistogram(const histogram_t *histogram, phaseStats_t *stats)
+{
+    memset(stats, 0, sizeof(phaseStats_t));
+    stats->count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    if (stats->count == 0)
+    {
+        return;
+    }
+
+    stats->meanNs = histogram->sumNs / stats->count;
+    stats->maxNs = histogram->maxNs;
+    stats->p50Ns = min(percentile(histogram, 0.50), stats->maxNs);
+    stats->p90Ns = min(percentile(histogram, 0.90), stats->maxNs);
+    stats->p99Ns = min(percentile(histogram, 0.99), stats->maxNs);
+}
+
+static int bucketOf(unsigned long long ns)
+{
+    if (ns < EXACT_BUCKETS)
+    {
+        return (int)ns;
+    }
+
+    int exponent = 63 - __builtin_clzll(ns);
+    int sub = (int)(ns >> (exponent - 3)) & (SUB_BUCKETS - 1);
+
+    return EXACT_BUCKETS + (exponent - 4) * SUB_BUCKETS + sub;
+}
+
+/**
+ * Middle of the range of values of a bucket.
+ */
+static unsigned long long bucketValue(int bucket)
+{
+    if (bucket < EXACT_BUCKETS)
+    {
+        return bucket;
+    }
+
+    int exponent = 4 + (bucket - EXACT_BUCKETS) / SUB_BUCKETS;
+    int sub = (bucket - EXACT_BUCKETS) % SUB_BUCKETS;
+    unsigned long long width = 1ull << (exponent - 3);
+
+    return (SUB_BUCKETS + sub) * width + width / 2;
+}
+
+static unsigned long long percentile(const histogram_t *histogram, double p)
+{
+    unsigned long rank = (unsigned long)(p * histogram->count + 0.999999);
+    unsigned long seen = 0;
+
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        seen += histogram->buckets[bucket];
+        if (seen >= max(rank, 1))
+            return bucketValue(bucket);
+    }
+
+    return histogram->maxNs;
+}
@@ -0,0 +1,202 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../simulator.h"
+
+// descriptor of the ring, inherited by the --run instances through execv
+#define RUN_RECORDS_FD_ENV "SIM_RUN_RECORDS_FD"
+
+/**
+ * A slot of the ring. The slot of position pos is free when its sequence
+ * number is pos, and holds the record of pos once it is pos + 1; after
+ * consuming it the orchestrator makes it pos + capacity, i.e. free for the
+ * position that wraps around to it.
+ */
+typedef struct
+{
+    unsigned long seq;
+    runRecord_t record;
+} ringSlot_t;
+
+typedef struct
+{
+    unsigned long capacity;
+    // next position to reserve (instances) and to consume (orchestrator),
+    // on separate cache lines
+    unsigned long head __attribute__((aligned(64)));
+    unsigned long tail __attribute__((aligned(64)));
+    unsigned long dropped;
+    ringSlot_t slots[];
+} ring_t;
+
+static ring_t *ring;
+static size_t ringSize;
+
+static ring_t *mapInheritedRing(void);
+
+int createRunRecordRing(void)
+{
+    if (ring)
+    {
+        return RECORDS_SUCCESS;
+    }
+
+    size_t size = sizeof(ring_t) + RUN_RECORDS_CAPACITY * sizeof(ringSlot_t);
+
+    // not close-on-exec: the --run instances map it again
+    int fd = memfd_create("sim-run-records", 0);
+    if (fd < 0 || ftruncate(fd, size) != 0)
+    {
+        ERR_PRINT("Couldn't create the run records ring.\n");
+        if (fd >= 0)
+            close(fd);
+        return RECORDS_FAILURE;
+    }
+
+    void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        ERR_PRINT("Couldn't map the run records ring.\n");
+        close(fd);
+        return RECORDS_FAILURE;
+    }
+
+    ring = (ring_t *)address;
+    ringSize = size;
+    ring->capacity = RUN_RECORDS_CAPACITY;
+    for (unsigned long pos = 0; pos < ring->capacity; pos++)
+        ring->slots[pos].seq = pos;
+
+    char buffer[16];
+    sprintf(buffer, "%d", fd);
+    setenv(RUN_RECORDS_FD_ENV, buffer, 1);
+
+    return RECORDS_SUCCESS;
+}
+
+void destroyRunRecordRing(void)
+{
+    if (!ring)
+    {
+        return;
+    }
+
+    const char *fd = getenv(RUN_RECORDS_FD_ENV);
+    if (fd)
+    {
+        close(atoi(fd));
+        unsetenv(RUN_RECORDS_FD_ENV);
+    }
+
+    munmap(ring, ringSize);
+    ring = NULL;
+}
+
+int publishRunRecord(const runRecord_t *record)
+{
+    if (!ring && !(ring = mapInheritedRing()))
+    {
+        return RECORDS_FAILURE;
+    }
+
+    unsigned long mask = ring->capacity - 1;
+    unsigned long pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    ringSlot_t *slot;
+
+    for (;;)
+    {
+        slot = &ring->slots[pos & mask];
+        long diff = (long)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0)
+        {
+            // the slot is free: reserve pos, unless another instance did first
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // the orchestrator has not consumed the slot yet: the ring is full
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return RECORDS_FAILURE;
+        }
+        else
+        {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->record = *record;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return RECORDS_SUCCESS;
+}
+
+int consumeRunRecords(runRecordHandler_t onRecord, int final)
+{
+    if (!ring)
+    {
+        return 0;
+    }
+
+    unsigned long mask = ring->capacity - 1;
+    unsigned long tail = ring->tail;
+    int n = 0;
+
+    for (;;)
+    {
+        ringSlot_t *slot = &ring->slots[tail & mask];
+        unsigned long seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == tail + 1)
+        {
+            onRecord(&slot->record);
+            n++;
+        }
+        else if (final && tail < __atomic_load_n(&ring->head, __ATOMIC_RELAXED))
+        {
+            // reserved by an instance that died before publishing
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            break;
+        }
+
+        __atomic_store_n(&slot->seq, tail + ring->capacity, __ATOMIC_RELEASE);
+        tail++;
+    }
+
+    ring->tail = tail;
+    return n;
+}
+
+unsigned long getDroppedRunRecords(void)
+{
+    return ring ? __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) : 0;
+}
+
+static ring_t *mapInheritedRing(void)
+{
+    const char *fd = getenv(RUN_RECORDS_FD_ENV);
+    struct stat st;
+
+    if (!fd || fstat(atoi(fd), &st) != 0)
+    {
+        return NULL;
+    }
+
+    void *address = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, atoi(fd), 0);
+    if (address == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    ringSize = st.st_size;
+    return (ring_t *)address;
+}
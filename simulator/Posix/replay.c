@@ -0,0 +1,519 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../simulator.h"
+#include "utils.h"
+
+#define SCHEDULE_MAGIC "SIMSCHD1"
+
+// inherited by the instances, across execv too
+#define RECORD_DIR_ENV "SIM_RECORD_DIR"
+
+// entries of a log: its file is sized for them, and filled as the run goes
+#define SCHEDULE_CAPACITY (1 << 16)
+
+// types of the entries (the ticks raised by a tick signal are stored above)
+#define ENTRY_TICK 1
+#define ENTRY_SWITCH 2
+#define ENTRY_INJECTION 3
+#define ENTRY_END 4
+#define ENTRY_TYPE(entry) ((entry)->type & 0xFF)
+#define ENTRY_TICKS(entry) ((entry)->type >> 8)
+
+typedef struct
+{
+    char magic[8];
+    char target[64];
+    uint64_t injTime, offsetByte, offsetBit, timeoutNs;
+    uint32_t exitCode;
+    // entries appended so far (may exceed the capacity of the log)
+    uint32_t nEntries;
+} scheduleHeader_t;
+
+typedef struct
+{
+    uint32_t type;
+    // logical clock when the entry was logged
+    uint32_t events;
+    // run-time counter (tick, injection, end), or hash of the task switched in
+    uint64_t value;
+} scheduleEntry_t;
+
+// progress of a replay, shared with the process that reports it
+typedef struct
+{
+    unsigned long nextEntry;
+    unsigned long nReplayedTicks, nReplayedSwitches;
+    unsigned long divergedAt, nDivergences;
+} replayProgress_t;
+
+volatile int scheduleLogging = 0;
+
+// logical clock: kernel events since the injector was launched
+static volatile unsigned long nEvents = 0;
+
+// recording: directory of the logs, and the log of the current run
+static char recordDir[PATH_MAX];
+static char logPath[PATH_MAX];
+static int logFd = -1;
+static scheduleHeader_t *logHeader = NULL;
+static scheduleEntry_t *logEntries = NULL;
+
+// replay: the entries of the log, and the next one to replay
+static int replaying = 0;
+static scheduleHeader_t replayHeader;
+static scheduleEntry_t *replayEntries = NULL;
+static unsigned long nReplayEntries = 0;
+static replayProgress_t *progress = NULL;
+// delivery expected for the last tick raised
+static int tickRaised = 0;
+static unsigned long tickRaisedAt = 0;
+static volatile int replayEnded = 0;
+
+static void replayUntil(unsigned long events, int isSwitch, unsigned long task);
+static void diverge(unsigned long events);
+static void appendEntry(uint32_t type, unsigned long events, unsigned long value);
+static const char *outcomeName(unsigned int exitCode);
+static uint32_t hashTaskName(const char *name);
+
+int enableScheduleRecording(const char *dir)
+{
+    if (strlen(dir) >= sizeof(recordDir) - 128)
+    {
+        ERR_PRINT("The recording directory %s has a too long path.\n", dir);
+        return REPLAY_FAILURE;
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        ERR_PRINT("Couldn't create the recording directory %s.\n", dir);
+        return REPLAY_FAILURE;
+    }
+
+    if (setenv(RECORD_DIR_ENV, dir, 1) != 0)
+    {
+        ERR_PRINT("Couldn't enable the recording for the instances.\n");
+        return REPLAY_FAILURE;
+    }
+
+    strcpy(recordDir, dir);
+
+    return REPLAY_SUCCESS;
+}
+
+void inheritScheduleRecording(void)
+{
+    const char *dir = getenv(RECORD_DIR_ENV);
+    if (dir && strlen(dir) < sizeof(recordDir) - 128)
+    {
+        strcpy(recordDir, dir);
+    }
+}
+
+int isScheduleRecording(void)
+{
+    return recordDir[0] != '\0';
+}
+
+int loadScheduleReplay(const char *path, scheduleRun_t *run)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp || fread(&replayHeader, sizeof(replayHeader), 1, fp) != 1 ||
+        memcmp(replayHeader.magic, SCHEDULE_MAGIC, sizeof(replayHeader.magic)) != 0)
+    {
+        ERR_PRINT("%s is not a schedule log.\n", path);
+        if (fp)
+            fclose(fp);
+        return REPLAY_FAILURE;
+    }
+
+    // still readable once the instance that replays the log died
+    progress = (replayProgress_t *)mmap(NULL, sizeof(replayProgress_t), PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (progress == MAP_FAILED)
+    {
+        ERR_PRINT("Couldn't allocate the progress of the replay.\n");
+        progress = NULL;
+        fclose(fp);
+        return REPLAY_FAILURE;
+    }
+
+    unsigned long nEntries = min(replayHeader.nEntries, SCHEDULE_CAPACITY);
+    replayEntries = (scheduleEntry_t *)malloc((nEntries > 0 ? nEntries : 1) * sizeof(scheduleEntry_t));
+    nReplayEntries = replayEntries ? fread(replayEntries, sizeof(scheduleEntry_t), nEntries, fp) : 0;
+    fclose(fp);
+
+    // the entry being written when its instance died is left blank
+    for (unsigned long i = 0; i < nReplayEntries; i++)
+    {
+        if (ENTRY_TYPE(&replayEntries[i]) == 0)
+        {
+            nReplayEntries = i;
+            break;
+        }
+    }
+
+    if (replayHeader.nEntries > SCHEDULE_CAPACITY)
+    {
+        ERR_PRINT("The log holds the first %d entries of %u: the run is only replayed up to there.\n",
+                  SCHEDULE_CAPACITY, replayHeader.nEntries);
+    }
+
+    memset(run, 0, sizeof(scheduleRun_t));
+    memcpy(run->target, replayHeader.target, sizeof(run->target) - 1);
+    run->injTime = replayHeader.injTime;
+    run->offsetByte = replayHeader.offsetByte;
+    run->offsetBit = replayHeader.offsetBit;
+    run->timeoutNs = replayHeader.timeoutNs;
+    run->exitCode = replayHeader.exitCode;
+
+    // the tick is raised by the replay only
+    vPortUseExternalTick();
+    replaying = 1;
+
+    return REPLAY_SUCCESS;
+}
+
+int isReplaying(void)
+{
+    return replaying;
+}
+
+void startScheduleLog(const thData_t *data)
+{
+    nEvents = 0;
+
+    if (replaying)
+    {
+        memset(progress, 0, sizeof(replayProgress_t));
+        scheduleLogging = 1;
+        return;
+    }
+
+    if (!isScheduleRecording())
+    {
+        return;
+    }
+
+    // named after the injection, as in the --records= file
+    const char *name = data->target ? data->target->name : "";
+    char target[64];
+    snprintf(target, sizeof(target), "%s", name);
+    for (char *c = target; *c; c++)
+    {
+        if (!isalnum((unsigned char)*c) && *c != '_')
+            *c = '_';
+    }
+
+    snprintf(logPath, sizeof(logPath), "%s/%s-%lu-%lu-%lu.sched",
+             recordDir, target, data->injTime, data->offsetByte, data->offsetBit);
+
+    size_t size = sizeof(scheduleHeader_t) + SCHEDULE_CAPACITY * sizeof(scheduleEntry_t);
+    logFd = open(logPath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    void *address = MAP_FAILED;
+    if (logFd >= 0 && ftruncate(logFd, size) == 0)
+    {
+        address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, logFd, 0);
+    }
+
+    if (address == MAP_FAILED)
+    {
+        // the run goes on without its log
+        ERR_PRINT("Couldn't create the schedule log %s.\n", logPath);
+        if (logFd >= 0)
+        {
+            close(logFd);
+            unlink(logPath);
+            logFd = -1;
+        }
+        return;
+    }
+
+    logHeader = (scheduleHeader_t *)address;
+    logEntries = (scheduleEntry_t *)(logHeader + 1);
+
+    memcpy(logHeader->magic, SCHEDULE_MAGIC, sizeof(logHeader->magic));
+    snprintf(logHeader->target, sizeof(logHeader->target), "%s", name);
+    logHeader->injTime = data->injTime;
+    logHeader->offsetByte = data->offsetByte;
+    logHeader->offsetBit = data->offsetBit;
+    logHeader->timeoutNs = data->timeoutNs;
+
+    scheduleLogging = 1;
+}
+
+void closeScheduleLog(unsigned int exitCode)
+{
+    scheduleLogging = 0;
+
+    if (replaying)
+    {
+        // reported by the parent of the instance, see runScheduleReplay
+        return;
+    }
+
+    if (!logHeader)
+    {
+        return;
+    }
+
+    unsigned long nEntries = min(logHeader->nEntries, SCHEDULE_CAPACITY);
+    logHeader->exitCode = exitCode;
+    munmap(logHeader, sizeof(scheduleHeader_t) + SCHEDULE_CAPACITY * sizeof(scheduleEntry_t));
+    logHeader = NULL;
+    logEntries = NULL;
+
+    if (exitCode == EXECUTION_RESULT_SILENT_EXIT_CODE)
+    {
+        // nothing to investigate
+        unlink(logPath);
+    }
+    else if (ftruncate(logFd, sizeof(scheduleHeader_t) + nEntries * sizeof(scheduleEntry_t)) != 0)
+    {
+        ERR_PRINT("Couldn't truncate the schedule log %s.\n", logPath);
+    }
+
+    close(logFd);
+    logFd = -1;
+}
+
+void logScheduleInjection(void)
+{
+    if (scheduleLogging && !replaying)
+    {
+        appendEntry(ENTRY_INJECTION, __atomic_load_n(&nEvents, __ATOMIC_RELAXED), ulGetRunTimeCounterValue());
+    }
+}
+
+void logScheduleEnd(void)
+{
+    if (scheduleLogging && !replaying)
+    {
+        appendEntry(ENTRY_END, __atomic_load_n(&nEvents, __ATOMIC_RELAXED), ulGetRunTimeCounterValue());
+    }
+}
+
+unsigned int runScheduleReplay(void (*run)(const struct thData_s *), const struct thData_s *data, unsigned long watchdogNs)
+{
+    // the child inherits the buffered output otherwise
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        ERR_PRINT("Couldn't fork the instance of the replay.\n");
+        return (unsigned int)-1;
+    }
+
+    if (pid == 0)
+    {
+        // exits with the outcome of the run, or dies of the injection
+        run(data);
+        _exit(EXIT_FAILURE);
+    }
+
+    int status = 0, killed = 0;
+    unsigned long long deadlineNs = monotonic_ns() + watchdogNs;
+    pid_t waited;
+    while ((waited = waitpid(pid, &status, WNOHANG)) == 0)
+    {
+        if (!killed && monotonic_ns() >= deadlineNs)
+        {
+            // stuck where the injector cannot end it (e.g. the tick handler)
+            kill(pid, SIGKILL);
+            killed = 1;
+        }
+        sleepNanoseconds(VIRTUAL_TIMEOUT_POLL_NS);
+    }
+
+    unsigned int exitCode = waited == pid ? decodeExitCode(status) : (unsigned int)-1;
+
+    fprintf(stdout, "Replayed %lu entries of %lu: %lu tick signals, %lu task switches.\n",
+            progress->nextEntry, nReplayEntries, progress->nReplayedTicks, progress->nReplayedSwitches);
+    if (progress->nDivergences)
+        fprintf(stdout, "The replay diverged from the log at kernel event %lu (%lu mismatches).\n",
+                progress->divergedAt, progress->nDivergences);
+    else
+        fprintf(stdout, "The replay followed the log.\n");
+    if (killed)
+        fprintf(stdout, "The instance of the replay was killed after %lu ms.\n", watchdogNs / 1000000);
+    else if (waited == pid && WIFSIGNALED(status))
+        fprintf(stdout, "The instance of the replay died of signal %d (%s).\n", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    fprintf(stdout, "Outcome: recorded %s, replayed %s.\n", outcomeName(replayHeader.exitCode), outcomeName(exitCode));
+
+    return exitCode;
+}
+
+void waitScheduleReplay(unsigned long timeoutNs)
+{
+    unsigned long waitedNs = 0;
+
+    while (!replayEnded && waitedNs < timeoutNs)
+    {
+        sleepNanoseconds(VIRTUAL_TIMEOUT_POLL_NS);
+        waitedNs += VIRTUAL_TIMEOUT_POLL_NS;
+    }
+}
+
+void countScheduleEvent(int isSwitch)
+{
+    unsigned long events = __atomic_add_fetch(&nEvents, 1, __ATOMIC_RELAXED);
+    unsigned long task = isSwitch ? hashTaskName(pcTaskGetName(NULL)) : 0;
+
+    if (replaying)
+    {
+        replayUntil(events, isSwitch, task);
+    }
+    else if (isSwitch)
+    {
+        appendEntry(ENTRY_SWITCH, events, task);
+    }
+}
+
+void logScheduleTick(unsigned long nTicks)
+{
+    unsigned long events = __atomic_load_n(&nEvents, __ATOMIC_RELAXED);
+
+    if (!replaying)
+    {
+        appendEntry(ENTRY_TICK | (uint32_t)(nTicks << 8), events, ulGetRunTimeCounterValue());
+        return;
+    }
+
+    // the tick raised by the replay is delivered: no kernel event in between
+    if (!tickRaised || events != tickRaisedAt)
+    {
+        diverge(events);
+    }
+
+    tickRaised = 0;
+    progress->nReplayedTicks++;
+}
+
+/**
+ * Replay the entries logged up to the kernel event events, which is a task
+ * switched in (with the hash of its name) or not.
+ */
+static void replayUntil(unsigned long events, int isSwitch, unsigned long task)
+{
+    int switchLogged = 0;
+
+    while (progress->nextEntry < nReplayEntries && replayEntries[progress->nextEntry].events <= events)
+    {
+        // consumed before acting on it: the tick raised may be handled right away
+        const scheduleEntry_t *entry = &replayEntries[progress->nextEntry++];
+
+        switch (ENTRY_TYPE(entry))
+        {
+        case ENTRY_TICK:
+            if (entry->events < events)
+                diverge(events);
+
+            tickRaised = 1;
+            tickRaisedAt = entry->events;
+            vPortRaiseTicks(ENTRY_TICKS(entry), (unsigned long)entry->value);
+            break;
+
+        case ENTRY_SWITCH:
+            if (entry->events == events)
+                switchLogged = 1;
+
+            if (entry->events < events || !isSwitch || entry->value != task)
+                diverge(events);
+
+            progress->nReplayedSwitches++;
+            break;
+
+        case ENTRY_INJECTION:
+            injectOnReplay();
+            break;
+
+        case ENTRY_END:
+            replayEnded = 1;
+            break;
+        }
+    }
+
+    if (isSwitch && !switchLogged && progress->nextEntry < nReplayEntries)
+    {
+        // a task switched in that the recorded run did not switch to
+        diverge(events);
+    }
+}
+
+static void diverge(unsigned long events)
+{
+    if (progress->nDivergences++ == 0)
+    {
+        progress->divergedAt = events;
+    }
+}
+
+static void appendEntry(uint32_t type, unsigned long events, unsigned long value)
+{
+    scheduleHeader_t *header = logHeader;
+    if (!header)
+    {
+        return;
+    }
+
+    // the injector thread logs concurrently with the tasks
+    uint32_t index = __atomic_fetch_add(&header->nEntries, 1, __ATOMIC_RELAXED);
+    if (index < SCHEDULE_CAPACITY)
+    {
+        logEntries[index].events = (uint32_t)events;
+        logEntries[index].value = value;
+        __atomic_store_n(&logEntries[index].type, type, __ATOMIC_RELEASE);
+    }
+}
+
+static const char *outcomeName(unsigned int exitCode)
+{
+    switch (exitCode)
+    {
+    case EXECUTION_RESULT_SILENT_EXIT_CODE:
+        return "Silent";
+    case EXECUTION_RESULT_DELAY_EXIT_CODE:
+        return "Delay";
+    case EXECUTION_RESULT_ERROR_EXIT_CODE:
+        return "Error";
+    case EXECUTION_RESULT_HANG_EXIT_CODE:
+        return "Hang";
+    case EXECUTION_RESULT_CRASH_EXIT_CODE:
+        return "Crash";
+    // any other exit counts as a Crash in a campaign
+    case 0:
+    case (unsigned int)-1:
+        return "Crash (the instance died)";
+    default:
+        return "Crash (unexpected exit code)";
+    }
+}
+
+/**
+ * FNV-1a hash.
+ */
+static uint32_t hashTaskName(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    for (; *name; name++)
+    {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
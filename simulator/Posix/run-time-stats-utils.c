@@ -44,24 +44,43 @@
 /* Time at start of day (in ns). */
 static unsigned long ulStartTimeNs;
 
+static unsigned long prvGetTimeNs( void );
+
 /*-----------------------------------------------------------*/
 
 void vConfigureTimerForRunTimeStats( void )
 {
-    struct timespec xNow;
+    ulStartTimeNs = prvGetTimeNs();
+}
+/*-----------------------------------------------------------*/
 
-    clock_gettime( CLOCK_MONOTONIC, &xNow );
-    ulStartTimeNs = xNow.tv_sec * 1000000000ul + xNow.tv_nsec;
+void vRestoreTimerForRunTimeStats( unsigned long ulCounterValue )
+{
+    /* Restart counting from ulCounterValue, e.g. in a process forked from a
+     * snapshot that was paused in the meantime. */
+    ulStartTimeNs = prvGetTimeNs() - ulCounterValue;
 }
 /*-----------------------------------------------------------*/
 
 unsigned long ulGetRunTimeCounterValue( void )
+{
+    return prvGetTimeNs() - ulStartTimeNs;
+}
+/*-----------------------------------------------------------*/
+
+static unsigned long prvGetTimeNs( void )
 {
     struct timespec xNow;
 
-    /* Time at start. */
+    /* With virtual time or an external tick the counter only advances with
+     * the ticks. */
+    if( xPortVirtualTimeEnabled() || xPortExternalTickEnabled() )
+    {
+        return ulPortGetVirtualTimeNs();
+    }
+
     clock_gettime( CLOCK_MONOTONIC, &xNow );
 
-    return xNow.tv_sec * 1000000000ul + xNow.tv_nsec - ulStartTimeNs;
+    return xNow.tv_sec * 1000000000ul + xNow.tv_nsec;
 }
 /*-----------------------------------------------------------*/
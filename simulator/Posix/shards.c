@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../simulator.h"
+
+// how often the planner reports the progress of the campaign
+#define PROGRESS_INTERVAL_MS 100
+
+/**
+ * A manager thread and its shard of the campaign.
+ */
+typedef struct
+{
+    pthread_t thread;
+    int started;
+    // local queue: the plan indices [head, tail), whose back may be stolen by peers
+    int head, tail;
+    // instances of the slots of the shard and the plan index each one runs
+    int nSlots;
+    freeRTOSInstance *instances;
+    int *running;
+    // injections completed so far, set once the manager terminates
+    unsigned long nCompleted;
+    int done, failed;
+    pthread_mutex_t lock;
+} shard_t;
+
+/**
+ * State of the campaign, shared by the planner and the managers.
+ */
+static struct
+{
+    const injection_t *plan;
+    int spawnMode;
+    const char *injectorPath;
+    unsigned int *exitCodes;
+    workerResult_t onResult;
+
+    shard_t *shards;
+    int nShards;
+} campaign;
+
+static void *runManager(void *arg);
+static int nextInjection(shard_t *shard);
+static int stealInjections(shard_t *thief);
+static int startInjection(freeRTOSInstance *instance, int index);
+
+int runShardedCampaign(const injection_t *plan, int size, int parallelism, int nShards,
+                       int spawnMode, const char *injectorPath,
+                       unsigned int *exitCodes, workerResult_t onResult,
+                       shardsProgress_t progress)
+{
+    if (size <= 0)
+    {
+        return SHARDS_SUCCESS;
+    }
+
+    nShards = max(1, min(nShards, min(parallelism, size)));
+    shard_t *shards = (shard_t *)calloc(nShards, sizeof(shard_t));
+
+    campaign.plan = plan;
+    campaign.spawnMode = spawnMode;
+    campaign.injectorPath = injectorPath;
+    campaign.exitCodes = exitCodes;
+    campaign.onResult = onResult;
+    campaign.shards = shards;
+    campaign.nShards = nShards;
+
+    // the planner hands a contiguous range of the plan and of the slots to each shard
+    for (int k = 0; k < nShards; k++)
+    {
+        shard_t *shard = &shards[k];
+        shard->head = (int)((long long)size * k / nShards);
+        shard->tail = (int)((long long)size * (k + 1) / nShards);
+        shard->nSlots = parallelism / nShards + (k < parallelism % nShards);
+        shard->instances = (freeRTOSInstance *)calloc(shard->nSlots, sizeof(freeRTOSInstance));
+        shard->running = (int *)calloc(shard->nSlots, sizeof(int));
+        pthread_mutex_init(&shard->lock, NULL);
+    }
+
+    for (int k = 0; k < nShards; k++)
+    {
+        shard_t *shard = &shards[k];
+        shard->started = pthread_create(&shard->thread, NULL, &runManager, shard) == 0;
+
+        if (!shard->started)
+        {
+            // its local queue is left to the other managers
+            ERR_PRINT("Couldn't create the manager thread of shard %d.\n", k);
+            shard->done = 1;
+            shard->failed = 1;
+        }
+    }
+
+    unsigned long nCompleted;
+    int done, failed;
+
+    for (;;)
+    {
+        nCompleted = 0;
+        done = 1;
+        failed = 0;
+
+        for (int k = 0; k < nShards; k++)
+        {
+            pthread_mutex_lock(&shards[k].lock);
+            nCompleted += shards[k].nCompleted;
+            done = done && shards[k].done;
+            failed = failed || shards[k].failed;
+            pthread_mutex_unlock(&shards[k].lock);
+        }
+
+        if (progress)
+        {
+            progress(nCompleted);
+        }
+
+        if (done)
+        {
+            break;
+        }
+
+        struct timespec interval = {0, PROGRESS_INTERVAL_MS * 1000000L};
+        nanosleep(&interval, NULL);
+    }
+
+    for (int k = 0; k < nShards; k++)
+    {
+        shard_t *shard = &shards[k];
+
+        if (shard->started)
+        {
+            pthread_join(shard->thread, NULL);
+        }
+
+        DEBUG_PRINT("Shard %d completed %lu injections.\n", k, shard->nCompleted);
+
+        pthread_mutex_destroy(&shard->lock);
+        free(shard->instances);
+        free(shard->running);
+    }
+
+    free(shards);
+
+    return !failed && nCompleted == (unsigned long)size ? SHARDS_SUCCESS : SHARDS_FAILURE;
+}
+
+static void *runManager(void *arg)
+{
+    shard_t *shard = (shard_t *)arg;
+
+    // the slots not in use are freeSlots[full..nSlots-1]
+    int *freeSlots = (int *)malloc(sizeof(int) * shard->nSlots);
+    for (int i = 0; i < shard->nSlots; i++)
+        freeSlots[i] = i;
+
+    int full = 0;
+    int failed = 0;
+
+    for (;;)
+    {
+        while (full < shard->nSlots && !failed)
+        {
+            int index = nextInjection(shard);
+            if (index < 0)
+                index = stealInjections(shard);
+            if (index < 0)
+                break;
+
+            int slot = freeSlots[full];
+            if (startInjection(&shard->instances[slot], index) < 0)
+            {
+                ERR_PRINT("Couldn't create child process.\n");
+                failed = 1;
+                break;
+            }
+
+            shard->running[slot] = index;
+            full++;
+        }
+
+        if (full == 0)
+        {
+            // no injection left, neither here nor in the peers
+            break;
+        }
+
+        int exitCode;
+        int pos = waitFreeRTOSInjections(shard->instances, shard->nSlots, &exitCode);
+        if (pos < 0)
+        {
+            ERR_PRINT("Couldn't wait for the child processes.\n");
+            failed = 1;
+            break;
+        }
+
+        // every plan index is run by a single manager
+        campaign.exitCodes[shard->running[pos]] = (unsigned int)exitCode;
+        if (campaign.onResult)
+            campaign.onResult(&campaign.plan[shard->running[pos]], (unsigned int)exitCode);
+
+        full--;
+        freeSlots[full] = pos;
+
+        pthread_mutex_lock(&shard->lock);
+        shard->nCompleted++;
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    free(freeSlots);
+
+    pthread_mutex_lock(&shard->lock);
+    shard->done = 1;
+    shard->failed = failed;
+    pthread_mutex_unlock(&shard->lock);
+
+    return NULL;
+}
+
+static int nextInjection(shard_t *shard)
+{
+    int index = -1;
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->head < shard->tail)
+        index = shard->head++;
+    pthread_mutex_unlock(&shard->lock);
+
+    return index;
+}
+
+static int stealInjections(shard_t *thief)
+{
+    int self = (int)(thief - campaign.shards);
+
+    for (int i = 1; i < campaign.nShards; i++)
+    {
+        shard_t *victim = &campaign.shards[(self + i) % campaign.nShards];
+        int first = 0, last = 0;
+
+        // take the back half of the queue of the victim (at least one injection)
+        pthread_mutex_lock(&victim->lock);
+        int left = victim->tail - victim->head;
+        if (left > 0)
+        {
+            last = victim->tail;
+            first = last - (left + 1) / 2;
+            victim->tail = first;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (left > 0)
+        {
+            DEBUG_PRINT("Shard %d stole %d injections from shard %d.\n", self, last - first, (self + i) % campaign.nShards);
+
+            // the local queue of the thief is empty: the stolen range becomes its queue
+            pthread_mutex_lock(&thief->lock);
+            thief->head = first + 1;
+            thief->tail = last;
+            pthread_mutex_unlock(&thief->lock);
+            return first;
+        }
+    }
+
+    return -1;
+}
+
+static int startInjection(freeRTOSInstance *instance, int index)
+{
+    const injection_t *injection = &campaign.plan[index];
+
+    if (campaign.spawnMode == SPAWN_ZYGOTE)
+        return runFreeRTOSInjectionFromZygote(instance, injection->campaign->targetStructure,
+                                              injection->injTime, injection->offsetByte, injection->offsetBit);
+
+    return runFreeRTOSInjection(instance, campaign.injectorPath, injection->campaign->targetStructure,
+                                injection->injTime, injection->offsetByte, injection->offsetBit);
+}
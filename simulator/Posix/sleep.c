@@ -1,14 +1,22 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <errno.h>
 #include <signal.h>
 #include <pthread.h>
 #include "sleep.h"
 #include "wait_for_event.h"
+#include "simulator.h"
 
 #define ONE_SEC_IN_NS (1000 * 1000 * 1000)
 #define TIMESPEC_FROM_NS(ns) {ns / ONE_SEC_IN_NS, ns % ONE_SEC_IN_NS}
 
+// inherited by the instances, across execv too
+#define SPIN_MARGIN_ENV "SIM_SPIN_MARGIN_NS"
+
+static unsigned long spinMarginNs = DEFAULT_SPIN_MARGIN_NS;
+
 void sleepNanoseconds(unsigned long ns)
 {
     struct timespec request = TIMESPEC_FROM_NS(ns);
@@ -16,6 +24,56 @@ void sleepNanoseconds(unsigned long ns)
     nanosleep(&request, NULL);
 }
 
+void waitUntilCounter(unsigned long fromNs, unsigned long counterNs)
+{
+    if (counterNs > fromNs + spinMarginNs)
+    {
+        // an absolute deadline: an interrupted sleep resumes where it was
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+        unsigned long long deadlineNs = deadline.tv_sec * 1000000000ull + deadline.tv_nsec +
+                                        (counterNs - fromNs - spinMarginNs);
+        deadline.tv_sec = deadlineNs / ONE_SEC_IN_NS;
+        deadline.tv_nsec = deadlineNs % ONE_SEC_IN_NS;
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+            ;
+    }
+
+    // the counter reads the vDSO clock: no system call while spinning, but
+    // the run may end (see cancelThread) before the counter is reached
+    while (ulGetRunTimeCounterValue() < counterNs)
+    {
+        pthread_testcancel();
+        ASM_PAUSE;
+    }
+}
+
+int setSpinMargin(unsigned long marginNs)
+{
+    char buffer[24];
+    sprintf(buffer, "%lu", marginNs);
+
+    if (setenv(SPIN_MARGIN_ENV, buffer, 1) != 0)
+    {
+        ERR_PRINT("Couldn't set the spin margin of the instances.\n");
+        return SLEEP_FAILURE;
+    }
+
+    spinMarginNs = marginNs;
+    return SLEEP_SUCCESS;
+}
+
+void inheritSpinMargin(void)
+{
+    const char *marginNs = getenv(SPIN_MARGIN_ENV);
+    if (marginNs)
+    {
+        spinMarginNs = strtoul(marginNs, NULL, 10);
+    }
+}
+
 struct event *injectionEvent;
 
 void injectorWait () {
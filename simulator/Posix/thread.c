@@ -13,6 +13,10 @@ static void unmaskSignals();
 
 pthread_t injectorThreadId;
 
+// cancelThread and the action of runUnlessCancelled exclude each other
+static pthread_mutex_t cancelLock = PTHREAD_MUTEX_INITIALIZER;
+static int threadCancelled = 0;
+
 int launchInjectorThread(void *(*function)(void *),
                          const thData_t *injectionArgs,
                          thread_t *id)
@@ -22,7 +26,14 @@ int launchInjectorThread(void *(*function)(void *),
     pthread_attr_t attrs;
 
     pthread_attr_init(&attrs);
+
+    // above the threads of the tasks (see INSTANCE_PRIORITY), so that a
+    // flip due while they run is not delayed until their time slice ends
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_attr_setinheritsched(&attrs, PTHREAD_EXPLICIT_SCHED);
     pthread_attr_setschedpolicy(&attrs, SCHED_FIFO);
+    pthread_attr_setschedparam(&attrs, &param);
 
     // the injector thread should not receive signals
     // => mask all the signals before creating the new thread
@@ -31,8 +42,17 @@ int launchInjectorThread(void *(*function)(void *),
     pthread_sigmask(SIG_SETMASK, &xAllSignals, &old);
 
     // create a new thread for the injector
-    if (pthread_create(&injectorThreadId, &attrs, function, (void *)injectionArgs) != 0)
+    int ret = pthread_create(&injectorThreadId, &attrs, function, (void *)injectionArgs);
+    if (ret == EPERM)
+    {
+        // not privileged: inherit the scheduling of the process
+        ret = pthread_create(&injectorThreadId, NULL, function, (void *)injectionArgs);
+    }
+    pthread_attr_destroy(&attrs);
+
+    if (ret != 0)
     {
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
         return INJECTOR_THREAD_FAILURE;
     }
 
@@ -48,3 +68,40 @@ int detachThread(thread_t *id)
     pthread_detach(id->thread_id);
     return INJECTOR_THREAD_SUCCESS;
 }
+
+int cancelThread(thread_t *id)
+{
+    // from now on the injector flips nothing (see runUnlessCancelled)
+    pthread_mutex_lock(&cancelLock);
+    threadCancelled = 1;
+    pthread_mutex_unlock(&cancelLock);
+
+    // it waits in nanosleep and clock_nanosleep, which are cancellation
+    // points, or spins in waitUntilCounter, which tests for cancellation
+    pthread_cancel(id->thread_id);
+    pthread_join(id->thread_id, NULL);
+
+    // a worker launches the injector of its next run
+    threadCancelled = 0;
+    return INJECTOR_THREAD_SUCCESS;
+}
+
+int runUnlessCancelled(void (*action)(const thData_t *), const thData_t *data)
+{
+    int oldState;
+
+    // the lock must not be left held by a cancelled thread
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldState);
+    pthread_mutex_lock(&cancelLock);
+
+    int cancelled = threadCancelled;
+    if (!cancelled)
+    {
+        action(data);
+    }
+
+    pthread_mutex_unlock(&cancelLock);
+    pthread_setcancelstate(oldState, NULL);
+
+    return cancelled ? INJECTOR_THREAD_FAILURE : INJECTOR_THREAD_SUCCESS;
+}
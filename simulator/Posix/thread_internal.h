@@ -1,4 +1,8 @@
 #include <pthread.h>
+#include <sched.h>
+
+// real-time priority of the instances: the injector thread runs one above
+#define INSTANCE_PRIORITY (sched_get_priority_max(SCHED_RR) - 1)
 
 typedef struct {
     pthread_t thread_id;
@@ -0,0 +1,258 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef SIM_INSTRUMENT_KERNEL
+#include <dlfcn.h>
+#endif
+
+#include "../simulator.h"
+
+// inherited by the instances, across execv too
+#define TICK_TRIGGER_ENV "SIM_TICK_TRIGGER"
+
+// tasks whose name was compared with the one of a TASK: event
+#define TRIGGER_TASK_CACHE 16
+
+static int tickTrigger = 0;
+static unsigned long triggerSwitches = 0;
+
+static const char *eventNames[TRIGGER_EVENT_COUNT] = {
+    "NONE", "TASK_SWITCHED_OUT", "TASK_SWITCHED_IN",
+    "QUEUE_SEND_FAILED", "QUEUE_RECEIVE_FAILED",
+    "QUEUE_SEND_FROM_ISR_FAILED", "QUEUE_RECEIVE_FROM_ISR_FAILED",
+    "QUEUE_SEND", "QUEUE_RECEIVE", "QUEUE_SEND_FROM_ISR", "QUEUE_RECEIVE_FROM_ISR",
+    "BLOCKING_ON_QUEUE_SEND", "BLOCKING_ON_QUEUE_RECEIVE",
+    "TASK_DELAY", "TASK_DELAY_UNTIL", "TASK_INCREMENT_TICK",
+    "TASK", "FUNCTION"};
+
+volatile int armedTriggerEvent = TRIGGER_EVENT_NONE;
+
+// armed event: occurrences left, and its argument
+static unsigned long eventsLeft = 0;
+static unsigned long armedArgument = 0;
+#ifdef SIM_INSTRUMENT_KERNEL
+static void *armedFunction = NULL;
+#endif
+static TaskHandle_t seenTasks[TRIGGER_TASK_CACHE];
+static char seenTaskMatches[TRIGGER_TASK_CACHE];
+static int nSeenTasks = 0;
+
+static int currentTaskMatches(void);
+static unsigned long hashTaskName(const char *name);
+
+int enableTickTrigger(unsigned long nSwitches)
+{
+    char buffer[24];
+    sprintf(buffer, "%lu", nSwitches);
+
+    if (setenv(TICK_TRIGGER_ENV, buffer, 1) != 0)
+    {
+        ERR_PRINT("Couldn't enable the tick trigger for the instances.\n");
+        return TRIGGER_FAILURE;
+    }
+
+    tickTrigger = 1;
+    triggerSwitches = nSwitches;
+
+    return TRIGGER_SUCCESS;
+}
+
+void inheritTickTrigger(void)
+{
+    const char *nSwitches = getenv(TICK_TRIGGER_ENV);
+    if (nSwitches)
+    {
+        tickTrigger = 1;
+        triggerSwitches = strtoul(nSwitches, NULL, 10);
+    }
+}
+
+int isTickTrigger(void)
+{
+    return tickTrigger;
+}
+
+unsigned long getTriggerSwitches(void)
+{
+    return triggerSwitches;
+}
+
+unsigned long getTriggerTick(unsigned long injTimeNs)
+{
+    const unsigned long periodNs = 1000000000UL / configTICK_RATE_HZ;
+
+    return (injTimeNs + periodNs - 1) / periodNs;
+}
+
+void countTriggerEvent(int event)
+{
+    if (event == TRIGGER_EVENT_TASK_IN && !currentTaskMatches())
+    {
+        return;
+    }
+
+    if (--eventsLeft == 0)
+    {
+        armedTriggerEvent = TRIGGER_EVENT_NONE;
+        injectOnEvent();
+    }
+}
+
+int parseEventPoint(const char *spec, unsigned long *point)
+{
+    const char *at = strrchr(spec, '@');
+    const char *colon = strchr(spec, ':');
+    if (!at || (colon && colon > at))
+    {
+        ERR_PRINT("Invalid event point %s: EVENT[:name]@N expected.\n", spec);
+        return TRIGGER_FAILURE;
+    }
+
+    size_t nameLength = (colon ? colon : at) - spec;
+    int event = TRIGGER_EVENT_COUNT;
+    for (int i = 1; i < TRIGGER_EVENT_COUNT; i++)
+    {
+        if (strlen(eventNames[i]) == nameLength && strncmp(spec, eventNames[i], nameLength) == 0)
+            event = i;
+    }
+
+    char *end;
+    unsigned long occurrence = strtoul(at + 1, &end, 10);
+    if (event == TRIGGER_EVENT_COUNT || occurrence == 0 || occurrence > 0xFFFFFFFF || (*end != '\0' && *end != '\n'))
+    {
+        ERR_PRINT("Invalid event point %s: unknown event, or N is not in 1..2^32-1.\n", spec);
+        return TRIGGER_FAILURE;
+    }
+
+    // a TASK: or FUNCTION: event, and only those, take a name
+    int named = event == TRIGGER_EVENT_TASK_IN || event == TRIGGER_EVENT_FUNCTION;
+    if (named != (colon != NULL))
+    {
+        ERR_PRINT("Invalid event point %s: only TASK and FUNCTION take a name.\n", spec);
+        return TRIGGER_FAILURE;
+    }
+
+    char name[64] = "";
+    if (colon)
+    {
+        snprintf(name, sizeof(name), "%.*s", (int)(at - colon - 1), colon + 1);
+    }
+
+    unsigned long argument = 0;
+    if (event == TRIGGER_EVENT_TASK_IN)
+    {
+        argument = hashTaskName(name);
+    }
+    else if (event == TRIGGER_EVENT_FUNCTION)
+    {
+#ifdef SIM_INSTRUMENT_KERNEL
+        // the instances run the same image: the offset of the function in it is enough
+        Dl_info image;
+        void *function = dlsym(RTLD_DEFAULT, name);
+        if (!function || !dladdr(function, &image) || (char *)function - (char *)image.dli_fbase > 0xFFFFFF)
+        {
+            ERR_PRINT("Invalid event point %s: no kernel function %s.\n", spec, name);
+            return TRIGGER_FAILURE;
+        }
+
+        argument = (char *)function - (char *)image.dli_fbase;
+#else
+        ERR_PRINT("Invalid event point %s: FUNCTION events require a build with -DSIM_INSTRUMENT_KERNEL=ON.\n", spec);
+        return TRIGGER_FAILURE;
+#endif
+    }
+
+    *point = EVENT_POINT(event, argument, occurrence);
+    return TRIGGER_SUCCESS;
+}
+
+const char *getEventName(unsigned long point)
+{
+    int event = EVENT_POINT_EVENT(point);
+
+    return event < TRIGGER_EVENT_COUNT ? eventNames[event] : "?";
+}
+
+void armEventTrigger(unsigned long point)
+{
+    eventsLeft = EVENT_POINT_OCCURRENCE(point);
+    armedArgument = EVENT_POINT_ARGUMENT(point);
+    nSeenTasks = 0;
+
+#ifdef SIM_INSTRUMENT_KERNEL
+    if (EVENT_POINT_EVENT(point) == TRIGGER_EVENT_FUNCTION)
+    {
+        Dl_info image;
+        dladdr((void *)&armEventTrigger, &image);
+        armedFunction = (char *)image.dli_fbase + armedArgument;
+    }
+#endif
+
+    armedTriggerEvent = EVENT_POINT_EVENT(point);
+}
+
+void disarmEventTrigger(void)
+{
+    armedTriggerEvent = TRIGGER_EVENT_NONE;
+}
+
+#ifdef SIM_INSTRUMENT_KERNEL
+/**
+ * Called at the entry of every function of the kernel (-finstrument-functions).
+ */
+void __attribute__((no_instrument_function)) __cyg_profile_func_enter(void *function, void *callSite)
+{
+    if (function == armedFunction)
+        triggerEvent(TRIGGER_EVENT_FUNCTION);
+}
+
+void __attribute__((no_instrument_function)) __cyg_profile_func_exit(void *function, void *callSite)
+{
+}
+#endif
+
+/**
+ * Whether the task switched in is the one of the armed TASK: event. The
+ * names are only compared once per task.
+ */
+static int currentTaskMatches(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    for (int i = 0; i < nSeenTasks; i++)
+    {
+        if (seenTasks[i] == task)
+            return seenTaskMatches[i];
+    }
+
+    int match = hashTaskName(pcTaskGetName(task)) == armedArgument;
+    if (nSeenTasks < TRIGGER_TASK_CACHE)
+    {
+        seenTasks[nSeenTasks] = task;
+        seenTaskMatches[nSeenTasks] = (char)match;
+        nSeenTasks++;
+    }
+
+    return match;
+}
+
+/**
+ * FNV-1a hash of a task name, folded to the 24 bits of the argument. The
+ * kernel stores at most configMAX_TASK_NAME_LEN - 1 characters of a name
+ * (plus its terminator): a longer name is truncated the same way.
+ */
+static unsigned long hashTaskName(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; name[i] && i < configMAX_TASK_NAME_LEN - 1; i++)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+
+    return (hash ^ (hash >> 24)) & 0xFFFFFF;
+}
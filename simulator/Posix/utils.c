@@ -0,0 +1,40 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+
+#include "thread_internal.h"
+#include "utils.h"
+
+unsigned long long monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+unsigned int decodeExitCode(int status)
+{
+    if (WIFEXITED(status))
+    {
+        // instance exited normally => return the status code
+        return WEXITSTATUS(status);
+    }
+
+    // instance crashed (or was killed by its watchdog)
+    return (unsigned int)-1;
+}
+
+void raise_scheduling_priority(void)
+{
+    // try to increase the scheduling priority of the threads
+    // of the current process to realtime (this requires root privileges)
+    struct sched_param p;
+    p.sched_priority = INSTANCE_PRIORITY;
+    sched_setscheduler(getpid(), SCHED_RR, &p); // fail silently
+
+    // increase the process's scheduling priority
+    setpriority(PRIO_PROCESS, getpid(), -20);
+}
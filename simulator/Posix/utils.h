@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * Helpers shared by the spawn modes of the Posix implementation.
+ */
+
+/**
+ * @brief Time of CLOCK_MONOTONIC in nanoseconds.
+ */
+unsigned long long monotonic_ns(void);
+
+/**
+ * @brief Outcome of an instance from its wait status: its exit code, or -1
+ * if it crashed (or was killed by its watchdog).
+ */
+unsigned int decodeExitCode(int status);
+
+/**
+ * @brief Raise the scheduling priority of the calling FreeRTOS instance to
+ * realtime (this requires root privileges, fails silently otherwise).
+ */
+void raise_scheduling_priority(void);
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "../simulator.h"
+
+// inherited by the instances, across execv too
+#define VIRTUAL_TIME_ENV "SIM_VIRTUAL_TIME"
+
+static int virtualTime = 0;
+static unsigned long virtualTimeLimitNs = 0;
+static unsigned long virtualTimeEventNs = 0;
+
+static unsigned long ticksUntil(unsigned long timeNs, unsigned long nowNs);
+
+int enableVirtualTime(void)
+{
+    if (setenv(VIRTUAL_TIME_ENV, "1", 1) != 0)
+    {
+        ERR_PRINT("Couldn't enable virtual time for the instances.\n");
+        return VTIME_FAILURE;
+    }
+
+    vPortEnableVirtualTime();
+    virtualTime = 1;
+
+    return VTIME_SUCCESS;
+}
+
+void inheritVirtualTime(void)
+{
+    if (getenv(VIRTUAL_TIME_ENV))
+    {
+        vPortEnableVirtualTime();
+        virtualTime = 1;
+    }
+}
+
+int isVirtualTime(void)
+{
+    return virtualTime;
+}
+
+void limitVirtualTime(unsigned long limitNs)
+{
+    virtualTimeLimitNs = limitNs;
+}
+
+void markVirtualTime(unsigned long eventNs)
+{
+    virtualTimeEventNs = eventNs;
+}
+
+unsigned long limitIdleTicks(unsigned long expectedIdleTicks)
+{
+    if (!virtualTime)
+    {
+        return 0;
+    }
+
+    unsigned long nowNs = ulGetRunTimeCounterValue();
+
+    if (virtualTimeLimitNs)
+    {
+        expectedIdleTicks = min(expectedIdleTicks, ticksUntil(virtualTimeLimitNs, nowNs));
+    }
+
+    if (virtualTimeEventNs)
+    {
+        expectedIdleTicks = min(expectedIdleTicks, ticksUntil(virtualTimeEventNs, nowNs));
+    }
+
+    // the tick hook raises the interrupts of the load
+    unsigned long irqNs = getIrqLoadDeadline();
+    if (irqNs)
+    {
+        expectedIdleTicks = min(expectedIdleTicks, ticksUntil(irqNs, nowNs));
+    }
+
+    return expectedIdleTicks;
+}
+
+void idleVirtualTime(void)
+{
+    if (!virtualTime)
+    {
+        // on the wall clock, the port may wait for the next tick instead
+        vPortIdleWait();
+        return;
+    }
+
+    if (virtualTimeLimitNs && ulGetRunTimeCounterValue() >= virtualTimeLimitNs)
+    {
+        // the instances run with a real-time policy: let the injector end the run
+        sched_yield();
+        return;
+    }
+
+    vPortVirtualTimeIdle();
+}
+
+void getTickDrift(unsigned long *missedTicks, unsigned long *maxLagNs)
+{
+    *missedTicks = ulPortGetMissedTicks();
+    *maxLagNs = ulPortGetMaxTickLagNs();
+}
+
+/**
+ * Ticks from nowNs to the first tick at or past timeNs.
+ */
+static unsigned long ticksUntil(unsigned long timeNs, unsigned long nowNs)
+{
+    const unsigned long periodNs = 1000000000UL / configTICK_RATE_HZ;
+
+    return timeNs > nowNs ? (timeNs - nowNs + periodNs - 1) / periodNs : 0;
+}
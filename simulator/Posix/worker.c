@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+
+#include "../simulator.h"
+#include "../image.h"
+#include "fork_internal.h"
+#include "utils.h"
+
+/**
+ * Outcome of a run, sent by a worker to the orchestrator.
+ */
+typedef struct
+{
+    int index;
+    unsigned int exitCode;
+    // CLOCK_MONOTONIC instant the run was ready to start the scheduler (ns)
+    unsigned long long readyNs;
+    // the worker could not be reset and terminates after this record
+    int retiring;
+} workerRecord_t;
+
+/**
+ * A worker process, as seen by the orchestrator.
+ */
+typedef struct
+{
+    pid_t pid;
+    // plan indices to the worker, records from the worker
+    int requestFd, recordFd;
+    // injection being run (-1 if idle), when it was requested and its
+    // deadline (0 once the worker has been killed)
+    int index;
+    unsigned long long requestNs, deadlineNs;
+    int retiring;
+    // core set the worker is pinned to (see affinity.h)
+    int coreSet;
+} worker_t;
+
+/**
+ * State of the campaign. It is set up by the orchestrator before forking
+ * the workers, which find it in their pristine image as well.
+ */
+static struct
+{
+    injection_t *plan;
+    int size;
+
+    workerSetup_t setup;
+    workerRun_t run;
+
+    worker_t *workers;
+    int nWorkers;
+
+    // worker only: when the current run was ready to start the scheduler
+    unsigned long long readyNs;
+} campaign;
+
+static int startWorker(worker_t *worker);
+static void runWorker(int requestFd, int recordFd);
+static void stopWorker(worker_t *worker);
+
+int runWorkerCampaign(injection_t *plan, int size, int parallelism,
+                      workerSetup_t setup, workerRun_t run,
+                      workerResult_t onResult)
+{
+    if (size <= 0)
+    {
+        return WORKER_SUCCESS;
+    }
+
+    campaign.plan = plan;
+    campaign.size = size;
+    campaign.setup = setup;
+    campaign.run = run;
+
+    // a request may be written to a worker that just retired
+    void (*sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    int nWorkers = min(parallelism, size);
+    worker_t *workers = (worker_t *)calloc(nWorkers, sizeof(worker_t));
+    struct pollfd *fds = (struct pollfd *)calloc(nWorkers, sizeof(struct pollfd));
+    campaign.workers = workers;
+    campaign.nWorkers = nWorkers;
+
+    int next = 0, nCompleted = 0;
+    int failed = 0;
+
+    for (int i = 0; i < nWorkers && !failed; i++)
+    {
+        failed = startWorker(&workers[i]) != 0;
+    }
+
+    while (nCompleted < size && !failed)
+    {
+        unsigned long long now = monotonic_ns();
+        unsigned long long deadlineNs = 0;
+
+        for (int i = 0; i < nWorkers; i++)
+        {
+            worker_t *worker = &workers[i];
+
+            if (worker->pid > 0 && worker->index < 0 && !worker->retiring && next < size &&
+                write(worker->requestFd, &next, sizeof(next)) == sizeof(next))
+            {
+                worker->index = next++;
+                worker->requestNs = now;
+                worker->deadlineNs = now + WATCHDOG_TIMEOUT_SEC * 1000000000ull;
+            }
+
+            if (worker->pid > 0 && worker->index >= 0 && worker->deadlineNs &&
+                (deadlineNs == 0 || worker->deadlineNs < deadlineNs))
+            {
+                deadlineNs = worker->deadlineNs;
+            }
+
+            fds[i].fd = worker->pid > 0 ? worker->recordFd : -1;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        // wake up for the first watchdog deadline
+        int timeoutMs = -1;
+        if (deadlineNs)
+        {
+            timeoutMs = deadlineNs > now ? (int)((deadlineNs - now + 999999) / 1000000) : 0;
+        }
+
+        if (poll(fds, nWorkers, timeoutMs) < 0 && errno != EINTR)
+        {
+            ERR_PRINT("poll failed\n");
+            break;
+        }
+
+        now = monotonic_ns();
+
+        for (int i = 0; i < nWorkers; i++)
+        {
+            worker_t *worker = &workers[i];
+
+            if (worker->pid <= 0)
+            {
+                continue;
+            }
+
+            if (fds[i].revents & POLLIN)
+            {
+                workerRecord_t record;
+                if (read(worker->recordFd, &record, sizeof(record)) == sizeof(record))
+                {
+                    recordStartupLatency(SPAWN_WORKER, record.readyNs - worker->requestNs);
+
+                    worker->index = -1;
+                    worker->retiring = record.retiring;
+                    nCompleted++;
+                    onResult(&plan[record.index], record.exitCode);
+                    continue;
+                }
+            }
+
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                // the worker terminated: its exit status is the outcome of its run, if any
+                int status;
+                waitpid(worker->pid, &status, 0);
+                close(worker->requestFd);
+                close(worker->recordFd);
+                releaseCoreSet(worker->coreSet);
+                worker->pid = 0;
+
+                if (worker->index >= 0)
+                {
+                    nCompleted++;
+                    onResult(&plan[worker->index], decodeExitCode(status));
+                    worker->index = -1;
+                }
+
+                if (next < size && startWorker(worker) != 0)
+                {
+                    failed = 1;
+                    break;
+                }
+            }
+            else if (worker->index >= 0 && worker->deadlineNs && now >= worker->deadlineNs)
+            {
+                // watchdog: the record pipe is closed once the worker is gone
+                DEBUG_PRINT("Killing %d...\n", worker->pid);
+                kill(worker->pid, SIGKILL);
+                worker->deadlineNs = 0;
+            }
+        }
+    }
+
+    for (int i = 0; i < nWorkers; i++)
+    {
+        stopWorker(&workers[i]);
+    }
+
+    free(workers);
+    free(fds);
+    signal(SIGPIPE, sigpipe);
+
+    if (failed)
+    {
+        ERR_PRINT("Couldn't create a worker process.\n");
+        return WORKER_FAILURE;
+    }
+
+    return nCompleted == size ? WORKER_SUCCESS : WORKER_FAILURE;
+}
+
+void notifyWorkerReady(void)
+{
+    campaign.readyNs = monotonic_ns();
+}
+
+static int startWorker(worker_t *worker)
+{
+    int requestFds[2], recordFds[2];
+
+    if (pipe(requestFds) != 0)
+    {
+        ERR_PRINT("pipe failed\n");
+        return -1;
+    }
+
+    if (pipe(recordFds) != 0)
+    {
+        ERR_PRINT("pipe failed\n");
+        close(requestFds[0]);
+        close(requestFds[1]);
+        return -1;
+    }
+
+    int coreSet = acquireCoreSet();
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        releaseCoreSet(coreSet);
+        close(requestFds[0]);
+        close(requestFds[1]);
+        close(recordFds[0]);
+        close(recordFds[1]);
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        close(requestFds[1]);
+        close(recordFds[0]);
+
+        // the other workers must see their request pipe closed when the orchestrator closes it
+        for (int i = 0; i < campaign.nWorkers; i++)
+        {
+            if (campaign.workers[i].pid > 0 && &campaign.workers[i] != worker)
+            {
+                close(campaign.workers[i].requestFd);
+                close(campaign.workers[i].recordFd);
+            }
+        }
+
+        // inherited by all the threads the worker creates
+        pinToCoreSet(coreSet);
+
+        runWorker(requestFds[0], recordFds[1]);
+        _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+    }
+
+    close(requestFds[0]);
+    close(recordFds[1]);
+
+    worker->pid = pid;
+    worker->requestFd = requestFds[1];
+    worker->recordFd = recordFds[0];
+    worker->index = -1;
+    worker->retiring = 0;
+    worker->coreSet = coreSet;
+    return 0;
+}
+
+static void runWorker(int requestFd, int recordFd)
+{
+    campaign.setup();
+
+    // same scheduling parameters as the --run instances
+    raise_scheduling_priority();
+
+    // the image must not depend on the run: FreeRTOS is not initialised yet
+    dataImage_t image;
+    if (saveDataImage(&image) != IMAGE_SUCCESS)
+    {
+        _exit(GENERIC_ERROR_EXIT_CODE);
+    }
+
+    int index;
+    while (read(requestFd, &index, sizeof(index)) == sizeof(index))
+    {
+        workerRecord_t record;
+        record.index = index;
+        record.exitCode = campaign.run(&campaign.plan[index]);
+        record.readyNs = campaign.readyNs;
+
+        // the scheduler has ended, only the task threads are left
+        record.retiring = !xPortResetThreads();
+
+        if (write(recordFd, &record, sizeof(record)) != sizeof(record) || record.retiring)
+        {
+            break;
+        }
+
+        // every global back to its value before the first run
+        restoreDataImage(&image);
+    }
+
+    _exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+}
+
+static void stopWorker(worker_t *worker)
+{
+    if (worker->pid <= 0)
+    {
+        return;
+    }
+
+    // a closed request pipe makes the worker terminate
+    close(worker->requestFd);
+    close(worker->recordFd);
+    waitpid(worker->pid, NULL, 0);
+    releaseCoreSet(worker->coreSet);
+
+    worker->pid = 0;
+}
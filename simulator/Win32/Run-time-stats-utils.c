@@ -72,6 +72,16 @@ LARGE_INTEGER liPerformanceCounterFrequency, liInitialRunTimeValue;
 }
 /*-----------------------------------------------------------*/
 
+void vRestoreTimerForRunTimeStats( unsigned long ulCounterValue )
+{
+LARGE_INTEGER liCurrentCount;
+
+	/* Restart counting from ulCounterValue (in nanoseconds). */
+	QueryPerformanceCounter( &liCurrentCount );
+	llInitialRunTimeCounterValue = liCurrentCount.QuadPart - ( ( long long ) ( ulCounterValue / 10000UL ) ) * llTicksPerHundedthMillisecond;
+}
+/*-----------------------------------------------------------*/
+
 unsigned long ulGetRunTimeCounterValue( void )
 {
 LARGE_INTEGER liCurrentCount;
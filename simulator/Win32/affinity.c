@@ -0,0 +1,47 @@
+#include <windows.h>
+
+#include "../simulator.h"
+
+/*
+ * The placement reads the CPU topology from the Linux sysfs.
+ */
+
+int enableCpuPlacement(const char *reservedCpus)
+{
+    ERR_PRINT("CPU placement is not supported on Windows.\n");
+    return AFFINITY_FAILURE;
+}
+
+void disableCpuPlacement(void)
+{
+}
+
+int acquireCoreSet(void)
+{
+    return -1;
+}
+
+void releaseCoreSet(int coreSet)
+{
+}
+
+void pinToCoreSet(int coreSet)
+{
+}
+
+int setInjectorCpus(const char *cpus)
+{
+    ERR_PRINT("CPU placement is not supported on Windows.\n");
+    return AFFINITY_FAILURE;
+}
+
+void pinInjectorThread(void)
+{
+}
+
+int countInstanceCpus(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return max(1, (int)info.dwNumberOfProcessors);
+}
@@ -0,0 +1,30 @@
+#include "../simulator.h"
+
+/*
+ * The cache is a memory-mapped file identified by the build-id note of the
+ * ELF executable, which the Windows implementation does not provide.
+ */
+
+int openResultCache(const char *path, const char *goldenPath)
+{
+    ERR_PRINT("The result cache is not supported on Windows.\n");
+    return CACHE_FAILURE;
+}
+
+int lookupCachedResult(const injection_t *injection, unsigned int *exitCode, unsigned long *durationNs)
+{
+    return 0;
+}
+
+void cacheResult(const injection_t *injection, unsigned int exitCode, unsigned long durationNs)
+{
+}
+
+unsigned long getCachedResults(void)
+{
+    return 0;
+}
+
+void closeResultCache(void)
+{
+}
@@ -0,0 +1,20 @@
+#include "../simulator.h"
+
+/*
+ * The coordinator and the workers rely on Posix sockets and on the
+ * Posix event loop of fork.c.
+ */
+
+int runCoordinator(injection_t *plan, int size, const char *address, int chunk,
+                   workerResult_t onResult)
+{
+    ERR_PRINT("Distributed campaigns are not supported on Windows.\n");
+    return DISTRIBUTED_FAILURE;
+}
+
+int runDistributedWorker(const char *address, int parallelism, int spawnMode,
+                         const char *injectorPath)
+{
+    ERR_PRINT("Distributed campaigns are not supported on Windows.\n");
+    return DISTRIBUTED_FAILURE;
+}
@@ -69,7 +69,7 @@ int runFreeRTOSInjection(freeRTOSInstance *instance,
     return FREE_RTOS_FORK_SUCCESS;
 }
 
-int waitFreeRTOSInjection(const freeRTOSInstance *instance)
+int waitFreeRTOSInjection(freeRTOSInstance *instance)
 {
     while (WaitForSingleObjectEx(instance->procHandle, INFINITE, TRUE) == WAIT_IO_COMPLETION);
 
@@ -79,22 +79,31 @@ int waitFreeRTOSInjection(const freeRTOSInstance *instance)
     return (unsigned int)exitCode;
 }
 
-int waitFreeRTOSInjections(const freeRTOSInstance *instances, int size, int *exitCode)
+int waitFreeRTOSInjections(freeRTOSInstance *instances, int size, int *exitCode)
 {
-    // Copy the wrapped HANDLEs in an array of HANDLEs
+    // Copy the wrapped HANDLEs of the used slots in an array of HANDLEs
     HANDLE *instancesToWait;
     instancesToWait = (HANDLE *)malloc(sizeof(HANDLE) * 2 * size);
+    int *slots = (int *)malloc(sizeof(int) * size);
+    int nWaited = 0;
     for (int i = 0; i < size; ++i)
     {
+        if (instances[i].procHandle == NULL)
+        {
+            // free slot
+            continue;
+        }
+
         // even indices => proc handles
-        instancesToWait[2 * i] = instances[i].procHandle;
+        instancesToWait[2 * nWaited] = instances[i].procHandle;
         // odd indices => timer handles
-        instancesToWait[2 * i + 1] = instances[i].watchdog;
+        instancesToWait[2 * nWaited + 1] = instances[i].watchdog;
+        slots[nWaited++] = i;
     }
 
     // Wait for the first child process to exit
     DWORD waitReturnIndex;
-    while ((waitReturnIndex = WaitForMultipleObjects(2 * size, instancesToWait, FALSE, 20)) == WAIT_TIMEOUT);
+    while ((waitReturnIndex = WaitForMultipleObjects(2 * nWaited, instancesToWait, FALSE, 20)) == WAIT_TIMEOUT);
 
     if (waitReturnIndex == WAIT_FAILED)
     {
@@ -104,13 +113,14 @@ int waitFreeRTOSInjections(const freeRTOSInstance *instances, int size, int *exi
     }
 
     DWORD index = waitReturnIndex - WAIT_OBJECT_0;
-    if (index >= 2 * size || index < 0)
+    if (index >= 2 * nWaited || index < 0)
     {
         // HANDLE index is not in the array: this is unexpected!
         return -1;
     }
 
-    freeRTOSInstance *instance = instances + index / 2;
+    int pos = slots[index / 2];
+    freeRTOSInstance *instance = instances + pos;
     if (index % 2 == 1)
     {
         // odd index was signalled => watchdog expired => kill the corresponding process
@@ -124,10 +134,81 @@ int waitFreeRTOSInjections(const freeRTOSInstance *instances, int size, int *exi
     CancelWaitableTimer(instance->watchdog);
     CloseHandle(instance->watchdog);
 
+    // the slot is free again
+    CloseHandle(instance->procHandle);
+    instance->procHandle = NULL;
+
     free(instancesToWait);
+    free(slots);
 
     // return the position of the child that returned
-    return index / 2;
+    return pos;
+}
+
+int startFreeRTOSZygote(void (*setup)(void),
+                        void (*run)(const char *target, unsigned long time,
+                                    unsigned long offsetByte, unsigned long offsetBit))
+{
+    // a zygote relies on fork(), which has no equivalent on Windows
+    ERR_PRINT("The zygote is not supported on Windows.\n");
+    return FREE_RTOS_FORK_FAILURE;
+}
+
+int runFreeRTOSInjectionFromZygote(freeRTOSInstance *instance,
+                                   const char *target,
+                                   const unsigned long time,
+                                   const unsigned long offsetByte,
+                                   const unsigned long offsetBit)
+{
+    return FREE_RTOS_FORK_FAILURE;
+}
+
+void stopFreeRTOSZygote(void)
+{
+}
+
+void notifyFreeRTOSInstanceReady(void)
+{
+}
+
+void notifyFreeRTOSInstanceExiting(void)
+{
+}
+
+int probeFreeRTOSStartupLatency(const char *injectorPath, const char *target, int nProbes)
+{
+    return FREE_RTOS_FORK_FAILURE;
+}
+
+void getStartupLatency(int spawnMode, latencyStats_t *latency)
+{
+    // startup latency is not measured on Windows
+    memset(latency, 0, sizeof(latencyStats_t));
+}
+
+void recordStartupLatency(int spawnMode, unsigned long long latencyNs)
+{
+}
+
+void getReapingLatency(latencyStats_t *latency)
+{
+    // reaping latency is not measured on Windows
+    memset(latency, 0, sizeof(latencyStats_t));
+}
+
+void getRunTime(latencyStats_t *latency)
+{
+    // instances do not notify their exit on Windows
+    memset(latency, 0, sizeof(latencyStats_t));
+}
+
+void resetRunTime(void)
+{
+}
+
+unsigned long long getFreeRTOSInstanceRunTime(const freeRTOSInstance *instance)
+{
+    return 0;
 }
 
 static int runWatchdogTimer(LPHANDLE procHandle, LPHANDLE timerId)
@@ -0,0 +1,33 @@
+#include "../simulator.h"
+
+/*
+ * The fork server relies on fork() to clone a running FreeRTOS instance,
+ * which has no equivalent on Windows.
+ */
+
+int runForkServerCampaign(injection_t *plan, int size, int parallelism,
+                          const char *injectorPath,
+                          forkServerMaster_t runMaster,
+                          forkServerInjection_t startInjection,
+                          forkServerResult_t onResult)
+{
+    ERR_PRINT("The fork server is not supported on Windows.\n");
+    return FORK_SERVER_FAILURE;
+}
+
+int isForkServerMaster(void)
+{
+    return 0;
+}
+
+void forkServerStart(void)
+{
+}
+
+void forkServerCheckpoint(unsigned long now)
+{
+}
+
+void forkServerShutdown(void)
+{
+}
@@ -0,0 +1,16 @@
+#include "../simulator.h"
+#include "../image.h"
+
+/*
+ * Reuse workers and the shared kernel are not supported on Windows.
+ */
+
+int saveDataImage(dataImage_t *image)
+{
+    ERR_PRINT("Data segment images are not supported on Windows.\n");
+    return IMAGE_FAILURE;
+}
+
+void restoreDataImage(const dataImage_t *image)
+{
+}
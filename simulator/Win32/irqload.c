@@ -0,0 +1,56 @@
+#include <string.h>
+
+#include "../simulator.h"
+
+/*
+ * The interrupt load relies on the signal-based simulated interrupts of the
+ * Posix port, raised by a thread of the process or by the tick hook.
+ */
+
+int enableIrqLoad(const char *spec)
+{
+    ERR_PRINT("The interrupt load is not supported on Windows.\n");
+    return IRQLOAD_FAILURE;
+}
+
+void inheritIrqLoad(void)
+{
+}
+
+int isIrqLoad(void)
+{
+    return 0;
+}
+
+const char *getIrqLoadSpec(void)
+{
+    return NULL;
+}
+
+int setupIrqLoad(void)
+{
+    return IRQLOAD_SUCCESS;
+}
+
+void startIrqLoad(void)
+{
+}
+
+void tickIrqLoad(unsigned long nowNs)
+{
+}
+
+unsigned long getIrqLoadDeadline(void)
+{
+    return 0;
+}
+
+int countIrqLoadSources(void)
+{
+    return 0;
+}
+
+void getIrqLoadStats(int source, irqLoadStats_t *stats)
+{
+    memset(stats, 0, sizeof(irqLoadStats_t));
+}
@@ -0,0 +1,25 @@
+#include "../simulator.h"
+
+/*
+ * The journal is committed by a writer thread with fdatasync, which the
+ * Windows implementation does not provide: a campaign cannot be resumed.
+ */
+
+int openJournal(const char *path, int resume, unsigned int *seed)
+{
+    ERR_PRINT("Campaign journals are not supported on Windows.\n");
+    return JOURNAL_FAILURE;
+}
+
+int startJournal(const injection_t *plan, int size, workerResult_t onCompleted)
+{
+    return JOURNAL_FAILURE;
+}
+
+void journalResult(const injection_t *injection, unsigned int exitCode)
+{
+}
+
+void closeJournal(void)
+{
+}
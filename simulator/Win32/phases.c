@@ -0,0 +1,76 @@
+#include "../simulator.h"
+
+/*
+ * The phases are timed with the monotonic clock of the Posix
+ * implementation, and aggregated from the run records of the instances,
+ * which the Windows implementation does not provide: no phase is measured.
+ */
+
+unsigned long long phaseClockNs(void)
+{
+    return 0;
+}
+
+void beginPhase(int phase)
+{
+}
+
+void endPhase(int phase)
+{
+}
+
+void resetPhases(void)
+{
+}
+
+void endForkPhase(unsigned long long spawnNs)
+{
+}
+
+void beginExecPhase(void)
+{
+}
+
+void endExecPhase(void)
+{
+}
+
+void getPhaseDurations(unsigned long long durations[PHASE_COUNT])
+{
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        durations[phase] = 0;
+}
+
+void recordPhase(int phase, unsigned long long durationNs)
+{
+}
+
+void getPhaseStats(int phase, phaseStats_t *stats)
+{
+    stats->count = 0;
+    stats->meanNs = stats->p50Ns = stats->p90Ns = stats->p99Ns = stats->maxNs = 0;
+}
+
+const char *getPhaseName(int phase)
+{
+    return "?";
+}
+
+void recordInjectionLatency(unsigned long long latencyNs)
+{
+}
+
+void addToHistogram(histogram_t *histogram, unsigned long long ns)
+{
+}
+
+void readHistogram(const histogram_t *histogram, phaseStats_t *stats)
+{
+    stats->count = 0;
+    stats->meanNs = stats->p50Ns = stats->p90Ns = stats->p99Ns = stats->maxNs = 0;
+}
+
+void getInjectionLatencyStats(phaseStats_t *stats)
+{
+    getPhaseStats(0, stats);
+}
@@ -0,0 +1,30 @@
+#include "../simulator.h"
+
+/*
+ * The ring is shared through a memfd inherited by the instances. On Windows
+ * the outcome of a run is only its exit code.
+ */
+
+int createRunRecordRing(void)
+{
+    return RECORDS_FAILURE;
+}
+
+void destroyRunRecordRing(void)
+{
+}
+
+int publishRunRecord(const runRecord_t *record)
+{
+    return RECORDS_FAILURE;
+}
+
+int consumeRunRecords(runRecordHandler_t onRecord, int final)
+{
+    return 0;
+}
+
+unsigned long getDroppedRunRecords(void)
+{
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "../simulator.h"
+
+/*
+ * The replay relies on the external tick of the Posix port.
+ */
+
+volatile int scheduleLogging = 0;
+
+int enableScheduleRecording(const char *dir)
+{
+    ERR_PRINT("Recording the schedules is not supported on Windows.\n");
+    return REPLAY_FAILURE;
+}
+
+void inheritScheduleRecording(void)
+{
+}
+
+int isScheduleRecording(void)
+{
+    return 0;
+}
+
+int loadScheduleReplay(const char *path, scheduleRun_t *run)
+{
+    ERR_PRINT("Replaying a schedule is not supported on Windows.\n");
+    return REPLAY_FAILURE;
+}
+
+int isReplaying(void)
+{
+    return 0;
+}
+
+void startScheduleLog(const thData_t *data)
+{
+}
+
+void closeScheduleLog(unsigned int exitCode)
+{
+}
+
+void logScheduleInjection(void)
+{
+}
+
+void logScheduleEnd(void)
+{
+}
+
+unsigned int runScheduleReplay(void (*run)(const thData_t *), const thData_t *data, unsigned long watchdogNs)
+{
+    return (unsigned int)-1;
+}
+
+void waitScheduleReplay(unsigned long timeoutNs)
+{
+}
+
+void countScheduleEvent(int isSwitch)
+{
+}
+
+void logScheduleTick(unsigned long nTicks)
+{
+}
@@ -0,0 +1,15 @@
+#include "../simulator.h"
+
+/*
+ * The manager threads rely on the thread-safe Posix event loop of
+ * fork.c, which the Windows implementation does not provide.
+ */
+
+int runShardedCampaign(const injection_t *plan, int size, int parallelism, int nShards,
+                       int spawnMode, const char *injectorPath,
+                       unsigned int *exitCodes, workerResult_t onResult,
+                       shardsProgress_t progress)
+{
+    ERR_PRINT("Sharded orchestrators are not supported on Windows.\n");
+    return SHARDS_FAILURE;
+}
@@ -12,6 +12,21 @@ void sleepNanoseconds(unsigned long ns)
 	return;
 }
 
+void waitUntilCounter(unsigned long fromNs, unsigned long counterNs)
+{
+	// sleepNanoseconds already spins on the counter
+	sleepNanoseconds(counterNs);
+}
+
+int setSpinMargin(unsigned long marginNs)
+{
+	return SLEEP_SUCCESS;
+}
+
+void inheritSpinMargin(void)
+{
+}
+
 void injectorWait(){
 	if(!eventIsSet){
 		wakeInjEv = CreateEvent(NULL, TRUE, FALSE, NULL);
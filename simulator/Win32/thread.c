@@ -28,4 +28,19 @@ int detachThread(thread_t *id)
 {
     CloseHandle(id->thread_id);
     return INJECTOR_THREAD_SUCCESS;
+}
+
+int cancelThread(thread_t *id)
+{
+    TerminateThread(id->thread_id, 0);
+    WaitForSingleObject(id->thread_id, INFINITE);
+    CloseHandle(id->thread_id);
+    return INJECTOR_THREAD_SUCCESS;
+}
+
+int runUnlessCancelled(void (*action)(const thData_t *), const thData_t *data)
+{
+    // TerminateThread stops the injector wherever it is
+    action(data);
+    return INJECTOR_THREAD_SUCCESS;
 }
\ No newline at end of file
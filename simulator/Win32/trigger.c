@@ -0,0 +1,58 @@
+#include "../simulator.h"
+
+/*
+ * The tick and event triggers rely on the hooks performing the injection,
+ * which the Posix port only supports.
+ */
+
+int enableTickTrigger(unsigned long nSwitches)
+{
+    ERR_PRINT("Tick triggers are not supported on Windows.\n");
+    return TRIGGER_FAILURE;
+}
+
+void inheritTickTrigger(void)
+{
+}
+
+int isTickTrigger(void)
+{
+    return 0;
+}
+
+unsigned long getTriggerSwitches(void)
+{
+    return 0;
+}
+
+unsigned long getTriggerTick(unsigned long injTimeNs)
+{
+    const unsigned long periodNs = 1000000000UL / configTICK_RATE_HZ;
+
+    return (injTimeNs + periodNs - 1) / periodNs;
+}
+
+volatile int armedTriggerEvent = TRIGGER_EVENT_NONE;
+
+void countTriggerEvent(int event)
+{
+}
+
+int parseEventPoint(const char *spec, unsigned long *point)
+{
+    ERR_PRINT("Event triggers are not supported on Windows.\n");
+    return TRIGGER_FAILURE;
+}
+
+const char *getEventName(unsigned long point)
+{
+    return "?";
+}
+
+void armEventTrigger(unsigned long point)
+{
+}
+
+void disarmEventTrigger(void)
+{
+}
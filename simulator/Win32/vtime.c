@@ -0,0 +1,44 @@
+#include "../simulator.h"
+
+/*
+ * Virtual time relies on the CPU-time timers and the signal-based tick of
+ * the Posix port.
+ */
+
+int enableVirtualTime(void)
+{
+    ERR_PRINT("Virtual time is not supported on Windows.\n");
+    return VTIME_FAILURE;
+}
+
+void inheritVirtualTime(void)
+{
+}
+
+int isVirtualTime(void)
+{
+    return 0;
+}
+
+void limitVirtualTime(unsigned long limitNs)
+{
+}
+
+void markVirtualTime(unsigned long eventNs)
+{
+}
+
+unsigned long limitIdleTicks(unsigned long expectedIdleTicks)
+{
+    return 0;
+}
+
+void idleVirtualTime(void)
+{
+}
+
+void getTickDrift(unsigned long *missedTicks, unsigned long *maxLagNs)
+{
+    *missedTicks = 0;
+    *maxLagNs = 0;
+}
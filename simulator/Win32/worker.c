@@ -0,0 +1,18 @@
+#include "../simulator.h"
+
+/*
+ * Reuse workers restore the data segment and rely on the Posix port to
+ * join the task threads, which the Windows port does not support.
+ */
+
+int runWorkerCampaign(injection_t *plan, int size, int parallelism,
+                      workerSetup_t setup, workerRun_t run,
+                      workerResult_t onResult)
+{
+    ERR_PRINT("Reuse workers are not supported on Windows.\n");
+    return WORKER_FAILURE;
+}
+
+void notifyWorkerReady(void)
+{
+}
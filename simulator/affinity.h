@@ -0,0 +1,66 @@
+#ifndef INJECTOR_AFFINITY_H
+#define INJECTOR_AFFINITY_H
+
+#define AFFINITY_SUCCESS 0
+#define AFFINITY_FAILURE -1
+
+/**
+ * Placement of the FreeRTOS instances on the CPUs.
+ *
+ * An instance is a process with several threads (one per task, the tick
+ * and the injector): once placement is enabled, each instance is pinned
+ * with all its threads to a core set, i.e. the SMT siblings of a physical
+ * core as read from /sys/devices/system/cpu. A new instance gets the core
+ * set with the fewest instances, so that instances do not share a core
+ * (and its siblings) until there are more instances than cores.
+ *
+ * The reserved CPUs are left to the orchestrator, which is pinned to them.
+ */
+
+/**
+ * Read the CPU topology and enable the placement of the new instances.
+ * reservedCpus is a CPU list such as "0,1" or "0-3" (NULL for none).
+ */
+int enableCpuPlacement(const char *reservedCpus);
+
+/**
+ * Disable the placement of the new instances and unpin the orchestrator.
+ */
+void disableCpuPlacement(void);
+
+/**
+ * Choose the core set of a new instance: returns -1 if placement is
+ * disabled. The core set must be released once the instance terminates.
+ */
+int acquireCoreSet(void);
+
+/**
+ * Release the core set of a terminated instance (-1 is ignored).
+ */
+void releaseCoreSet(int coreSet);
+
+/**
+ * Pin the calling process to a core set (-1 is ignored). Must be called
+ * by a new instance before it creates its threads, which inherit it.
+ */
+void pinToCoreSet(int coreSet);
+
+/**
+ * Number of CPUs the new instances may run on: the CPUs of the core
+ * sets if placement is enabled, else the CPUs of the orchestrator.
+ */
+int countInstanceCpus(void);
+
+/**
+ * Run the injector thread of the instances started from now on on the
+ * CPUs of a list, e.g. a core kept free of instances with --reserve-cpus,
+ * so that its wake-up does not wait for the other threads.
+ */
+int setInjectorCpus(const char *cpus);
+
+/**
+ * Called by the injector thread: pin itself to the injector CPUs, if any.
+ */
+void pinInjectorThread(void);
+
+#endif
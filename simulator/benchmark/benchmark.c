@@ -8,16 +8,51 @@
 #define UNLIMIT
 #define MAXARRAY 8000
 
+#define INPUT_FILE_PATH "simulator/input_data/input_small.dat"
+
 struct myStringStruct array[MAXARRAY];
 
+// content of the input file, if preloaded
+static char *input;
+static size_t inputSize;
+
 static int compare(const void *elem1, const void *elem2);
 
+void qsort_bench_preload()
+{
+    FILE *fp = fopen(INPUT_FILE_PATH, "rb");
+    if (fp == NULL)
+    {
+        ERR_PRINT("Error fopen in qsort_bench_preload\n");
+        return;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    inputSize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    input = (char *)malloc(inputSize);
+    if (fread(input, 1, inputSize, fp) != inputSize)
+    {
+        free(input);
+        input = NULL;
+    }
+
+    fclose(fp);
+}
+
 void qsort_bench()
 {
     FILE *fp;
     int count = 0;
 
-    fp = fopen("simulator/input_data/input_small.dat", "r");
+#ifdef POSIX
+    // parse the preloaded input, as the golden run parses the file
+    if (input)
+        fp = fmemopen(input, inputSize, "r");
+    else
+#endif
+        fp = fopen(INPUT_FILE_PATH, "r");
     if (fp == NULL)
     {
         ERR_PRINT("Error fopen in qsort_bench\n");
@@ -11,4 +11,10 @@ struct myStringStruct
 extern struct myStringStruct array[MAXARRAY];
 void qsort_bench();
 
+/**
+ * Read the input of qsort_bench in memory, so that the
+ * benchmark does not access the file system.
+ */
+void qsort_bench_preload();
+
 #endif
\ No newline at end of file
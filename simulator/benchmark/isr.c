@@ -0,0 +1,43 @@
+#include <string.h>
+#include "isr.h"
+#include "../simulator.h"
+
+// below the tasks of the sources: every interrupt preempts it
+#define ISR_BENCH_PRIORITY (tskIDLE_PRIORITY + 1)
+#define ISR_BENCH_SPIN 1000
+
+static isrBenchResults_t results;
+static unsigned long long busyNs;
+
+static void busyTaskFunction(void *params);
+
+void isr_bench_setup(unsigned long long durationNs)
+{
+    memset(&results, 0, sizeof(results));
+    busyNs = durationNs;
+
+    xTaskCreate(busyTaskFunction, "Busy", configMINIMAL_STACK_SIZE, NULL, ISR_BENCH_PRIORITY, NULL);
+}
+
+void isr_bench_results(isrBenchResults_t *out)
+{
+    *out = results;
+}
+
+static void busyTaskFunction(void *params)
+{
+    (void)params;
+
+    unsigned long long start = phaseClockNs(), now;
+    do
+    {
+        // mostly in the simulator: the fiber port defers an interrupt
+        // landing in the C library (e.g. in clock_gettime)
+        for (volatile int i = 0; i < ISR_BENCH_SPIN; i++)
+            ;
+        now = phaseClockNs();
+    } while (now - start < busyNs);
+    results.elapsedNs = now - start;
+
+    vTaskDelete(NULL);
+}
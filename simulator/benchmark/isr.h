@@ -0,0 +1,30 @@
+#ifndef ISR_BENCH_H
+#define ISR_BENCH_H
+
+/**
+ * Simulated-interrupt benchmark of the port.
+ *
+ * A task keeps the CPU busy for a given time while the sources of the
+ * interrupt load (see irqload.h) raise their interrupts, then deletes itself
+ * so that the Idle task ends the scheduler. The statistics of the sources
+ * give the latency of the dispatch (from the raise of an interrupt to its
+ * handler) and the throughput of the handlers.
+ */
+
+typedef struct
+{
+    unsigned long long elapsedNs;
+} isrBenchResults_t;
+
+/**
+ * Create the task of the benchmark, busy for durationNs.
+ * Must be called before the scheduler is started.
+ */
+void isr_bench_setup(unsigned long long durationNs);
+
+/**
+ * Time the task was busy, once the scheduler has ended.
+ */
+void isr_bench_results(isrBenchResults_t *results);
+
+#endif
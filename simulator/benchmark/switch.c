@@ -0,0 +1,83 @@
+#include <string.h>
+#include "switch.h"
+#include "../simulator.h"
+#include "queue.h"
+
+#define SWITCH_BENCH_PRIORITY (tskIDLE_PRIORITY + 1)
+
+static switchBenchResults_t results;
+static TaskHandle_t pingTask, pongTask;
+static QueueHandle_t pingQueue, pongQueue;
+
+static void pingTaskFunction(void *params);
+static void pongTaskFunction(void *params);
+
+void switch_bench_setup(unsigned long nRounds)
+{
+    memset(&results, 0, sizeof(results));
+    results.nRounds = nRounds;
+
+    pingQueue = xQueueCreate(1, sizeof(unsigned long));
+    pongQueue = xQueueCreate(1, sizeof(unsigned long));
+
+    // ping is created first: it runs first, and measures all the phases
+    xTaskCreate(pingTaskFunction, "Ping", configMINIMAL_STACK_SIZE, NULL, SWITCH_BENCH_PRIORITY, &pingTask);
+    xTaskCreate(pongTaskFunction, "Pong", configMINIMAL_STACK_SIZE, NULL, SWITCH_BENCH_PRIORITY, &pongTask);
+}
+
+void switch_bench_results(switchBenchResults_t *out)
+{
+    *out = results;
+}
+
+static void pingTaskFunction(void *params)
+{
+    (void)params;
+
+    unsigned long long start = phaseClockNs();
+    for (unsigned long i = 0; i < results.nRounds; i++)
+        taskYIELD();
+    results.yieldNs = phaseClockNs() - start;
+
+    start = phaseClockNs();
+    for (unsigned long i = 0; i < results.nRounds; i++)
+    {
+        xTaskNotifyGive(pongTask);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    results.notifyNs = phaseClockNs() - start;
+
+    start = phaseClockNs();
+    for (unsigned long i = 0; i < results.nRounds; i++)
+    {
+        unsigned long value;
+        xQueueSend(pongQueue, &i, portMAX_DELAY);
+        xQueueReceive(pingQueue, &value, portMAX_DELAY);
+    }
+    results.queueNs = phaseClockNs() - start;
+
+    vTaskDelete(NULL);
+}
+
+static void pongTaskFunction(void *params)
+{
+    (void)params;
+
+    for (unsigned long i = 0; i < results.nRounds; i++)
+        taskYIELD();
+
+    for (unsigned long i = 0; i < results.nRounds; i++)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xTaskNotifyGive(pingTask);
+    }
+
+    for (unsigned long i = 0; i < results.nRounds; i++)
+    {
+        unsigned long value;
+        xQueueReceive(pongQueue, &value, portMAX_DELAY);
+        xQueueSend(pingQueue, &value, portMAX_DELAY);
+    }
+
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,31 @@
+#ifndef SWITCH_BENCH_H
+#define SWITCH_BENCH_H
+
+/**
+ * Context-switch microbenchmark of the port.
+ *
+ * Two tasks of the same priority hand the CPU to each other, first with
+ * taskYIELD() (one switch per yield), then with task notifications and
+ * finally with a queue of each direction (a round trip blocks each task
+ * once, i.e. two switches through the blocking path of the kernel). Both delete themselves once done, so that the Idle task
+ * ends the scheduler.
+ */
+
+typedef struct
+{
+    unsigned long nRounds;
+    unsigned long long yieldNs, notifyNs, queueNs;
+} switchBenchResults_t;
+
+/**
+ * Create the tasks of the benchmark, nRounds yields and round trips each.
+ * Must be called before the scheduler is started.
+ */
+void switch_bench_setup(unsigned long nRounds);
+
+/**
+ * Time taken by each phase, once the scheduler has ended.
+ */
+void switch_bench_results(switchBenchResults_t *results);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef INJECTOR_CACHE_H
+#define INJECTOR_CACHE_H
+
+#include "injector.h"
+
+#define CACHE_SUCCESS 0
+#define CACHE_FAILURE -1
+
+// injections within the same tick of the scheduler share their outcome
+#define CACHE_TIME_BUCKET_NS (1000000000UL / configTICK_RATE_HZ)
+
+/**
+ * Persistent cache of injection outcomes, shared by all the campaigns run
+ * with the same cache file.
+ *
+ * The outcome of an injection is keyed by the build-id of the simulator,
+ * a hash of the golden file, the trigger, the timing mode and the
+ * interrupt load of the runs, the name of the target, the tick of the
+ * injection time and the flipped bit: a campaign that overlaps one run
+ * before answers the injections it has in common without running them.
+ * Rebuilding the simulator or running --golden again invalidates the
+ * cached outcomes.
+ *
+ * The cache is an open-addressing hash table in a memory-mapped file; a
+ * table that gets 3/4 full is rehashed into a file of twice the size,
+ * which replaces the old one atomically. Each slot carries a checksum, so
+ * a slot torn by a crash is ignored. The file is locked by the campaign
+ * that uses it.
+ */
+
+/**
+ * Open (or create) the cache at path, for the outcomes of the golden run
+ * in goldenPath.
+ */
+int openResultCache(const char *path, const char *goldenPath);
+
+/**
+ * Look up the outcome of an injection. Returns 1 and stores its exit code
+ * and the run time of its instance on a hit, 0 otherwise.
+ */
+int lookupCachedResult(const injection_t *injection, unsigned int *exitCode, unsigned long *durationNs);
+
+/**
+ * Store the outcome of an injection (the first outcome of a key is kept).
+ * May be called by any thread.
+ */
+void cacheResult(const injection_t *injection, unsigned int exitCode, unsigned long durationNs);
+
+/**
+ * Number of outcomes in the cache.
+ */
+unsigned long getCachedResults(void);
+
+/**
+ * Flush and close the cache.
+ */
+void closeResultCache(void);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef INJECTOR_DISTRIBUTED_H
+#define INJECTOR_DISTRIBUTED_H
+
+#include "injector.h"
+#include "worker.h"
+
+#define DISTRIBUTED_SUCCESS 0
+#define DISTRIBUTED_FAILURE -1
+
+// address of the coordinator if --listen= is not given
+#define DEFAULT_COORDINATOR_ADDRESS "127.0.0.1:5555"
+
+// a lease whose worker sent no outcome for this long goes back to the queue
+#define LEASE_TIMEOUT_SEC (10 * WATCHDOG_TIMEOUT_SEC)
+
+/**
+ * Distributed execution of an injection campaign.
+ *
+ * The coordinator draws the whole plan (the same plan as a single-node
+ * campaign with the same --seed) and serves it to any number of workers
+ * connected through a TCP ("host:port") or Unix ("unix:/path") socket.
+ * A worker asks for a lease when it has free slots and an empty queue,
+ * and gets a chunk of injections (target, time, byte and bit), which it
+ * runs with its own parallelism. It sends the outcome of each run back as
+ * soon as the run completes.
+ *
+ * A worker that disconnects, or that sends no outcome for LEASE_TIMEOUT_SEC,
+ * loses its leases: the injections it did not complete go back to the queue
+ * and are leased again. Only the first outcome of an injection is kept.
+ */
+
+/**
+ * Serve the plan on address until every injection has an outcome,
+ * which is passed to onResult. Leases hold up to chunk injections
+ * (if chunk is 0, twice the free slots of the worker).
+ */
+int runCoordinator(injection_t *plan, int size, const char *address, int chunk,
+                   workerResult_t onResult);
+
+/**
+ * Connect to the coordinator at address and run its leases on parallelism
+ * slots, with the instances created according to spawnMode (SPAWN_EXEC or
+ * SPAWN_ZYGOTE, whose zygote must be running already).
+ */
+int runDistributedWorker(const char *address, int parallelism, int spawnMode,
+                         const char *injectorPath);
+
+#endif
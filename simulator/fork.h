@@ -6,6 +6,25 @@
 #define FREE_RTOS_FORK_SUCCESS 1
 #define FREE_RTOS_FORK_FAILURE -1
 
+// how a FreeRTOS instance is created
+#define SPAWN_EXEC 0       // fork + execv of the --run command
+#define SPAWN_ZYGOTE 1     // fork of a pre-initialised zygote
+#define SPAWN_WORKER 2     // run by a reuse worker (see worker.h)
+#define SPAWN_FORKSERVER 3 // fork of a snapshot (see forkserver.h)
+#define SPAWN_MODES 4
+
+/**
+ * Latency statistics, e.g. the startup latency (time between the request
+ * of a new instance and the instant it is ready to start the scheduler).
+ */
+typedef struct
+{
+    unsigned long count;
+    unsigned long long sumNs, minNs, maxNs;
+    // for the standard deviation
+    double sumSquaresNs;
+} latencyStats_t;
+
 /**
  * Create a new FreeRTOS instance.
  * 
@@ -32,18 +51,103 @@ int runFreeRTOSInjection(freeRTOSInstance *instance,
 /**
  * Wait for a FreeRTOS instance to complete
  */
-int waitFreeRTOSInjection(const freeRTOSInstance *instance);
+int waitFreeRTOSInjection(freeRTOSInstance *instance);
 
 /**
  * Wait for one FreeRTOS instance to complete.
  * 
- * const freeRTOSInstance *instances is the array of instances to wait
+ * freeRTOSInstance *instances is the array of instances to wait: the slots
+ * of the running instances must not move until they are waited, free
+ * slots must be zeroed
  * int size is the number of elements in the instances array
  * int *exitCode is a pointer to the exit code of the terminated instance
  * 
- * The function returns the position of the instance that terminated.
+ * The function returns the position of the instance that terminated,
+ * whose slot is free again.
  * In case of errors, -1 is returned.
  */
-int waitFreeRTOSInjections(const freeRTOSInstance *instances, int size, int *exitCode);
+int waitFreeRTOSInjections(freeRTOSInstance *instances, int size, int *exitCode);
+
+/**
+ * Start the zygote: a process that runs setup once (everything up to
+ * the start of the scheduler) and then forks a pre-initialised copy
+ * of itself for each injection request. The copies call run with the
+ * injection descriptor and must terminate with the outcome of the
+ * simulation.
+ * 
+ * Return value:
+ *  - ret > 0: the zygote was created successfully
+ *  - ret < 0: an error occured (or zygotes are not supported)
+ */
+int startFreeRTOSZygote(void (*setup)(void),
+                        void (*run)(const char *target, unsigned long time,
+                                    unsigned long offsetByte, unsigned long offsetBit));
+
+/**
+ * Same as runFreeRTOSInjection, with the instance forked from the zygote.
+ */
+int runFreeRTOSInjectionFromZygote(freeRTOSInstance *instance,
+                                   const char *target,
+                                   const unsigned long time,
+                                   const unsigned long offsetByte,
+                                   const unsigned long offsetBit);
+
+/**
+ * Terminate the zygote.
+ */
+void stopFreeRTOSZygote(void);
+
+/**
+ * Called by an instance when it is ready to start the scheduler.
+ */
+void notifyFreeRTOSInstanceReady(void);
+
+/**
+ * Called by an instance right before exiting with the outcome
+ * of the simulation.
+ */
+void notifyFreeRTOSInstanceExiting(void);
+
+/**
+ * Measure the startup latency of nProbes --run instances on target,
+ * which terminate as soon as they are ready to start the scheduler.
+ */
+int probeFreeRTOSStartupLatency(const char *injectorPath, const char *target, int nProbes);
+
+/**
+ * Read the startup latency statistics of the instances created
+ * with spawnMode (SPAWN_*) and waited so far.
+ */
+void getStartupLatency(int spawnMode, latencyStats_t *latency);
+
+/**
+ * Add the startup latency of an instance created with spawnMode.
+ */
+void recordStartupLatency(int spawnMode, unsigned long long latencyNs);
+
+/**
+ * Read the reaping latency statistics: time between the exit of an
+ * instance (or its kill by the watchdog) and the instant the orchestrator
+ * collected its exit code.
+ */
+void getReapingLatency(latencyStats_t *latency);
+
+/**
+ * Read the run time statistics: time between the instant an instance was
+ * ready to start the scheduler and its exit, for the instances that were
+ * not killed by the watchdog.
+ */
+void getRunTime(latencyStats_t *latency);
+
+/**
+ * Clear the run time statistics.
+ */
+void resetRunTime(void);
+
+/**
+ * Run time of an instance that has just been waited (same definition as
+ * getRunTime), or 0 if it is unknown or the instance was killed.
+ */
+unsigned long long getFreeRTOSInstanceRunTime(const freeRTOSInstance *instance);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef INJECTOR_FORKSERVER_H
+#define INJECTOR_FORKSERVER_H
+
+#include "injector.h"
+
+#define FORK_SERVER_SUCCESS 0
+#define FORK_SERVER_FAILURE -1
+
+/**
+ * Fork-server execution of an injection campaign.
+ *
+ * A master instance runs the golden workload once and takes snapshots of
+ * itself (forked checkpoint processes) before the scheduler starts and then
+ * at most once per tick, whenever the port reports a consistent state. Each injection
+ * is forked from the latest checkpoint that precedes its injection time, so it
+ * inherits the already-executed prefix copy-on-write and only runs the bit flip
+ * and the suffix of the workload.
+ */
+
+/**
+ * Run the master instance of the fork server. Called in the master process
+ * with snapshots already enabled: initialise FreeRTOS, call
+ * forkServerStart() and start the scheduler. In an injection instance the
+ * function continues after the scheduler ends and must terminate the process
+ * with the outcome of the simulation.
+ */
+typedef void (*forkServerMaster_t)(void);
+
+/**
+ * Prepare and launch the injector in an injection instance, right after it has
+ * been restored from a checkpoint taken at snapshotTime (run-time counter, ns).
+ */
+typedef void (*forkServerInjection_t)(const injection_t *injection, unsigned long snapshotTime);
+
+/**
+ * Collect the exit code of a completed injection instance.
+ */
+typedef void (*forkServerResult_t)(const injection_t *injection, unsigned int exitCode);
+
+/**
+ * Run all the injections in plan through the fork server, at most
+ * parallelism at a time. The plan is sorted by injection time.
+ * Injections that the fork server could not serve fall back to
+ * runFreeRTOSInjection (injectorPath --run).
+ *
+ * Returns FORK_SERVER_SUCCESS, or FORK_SERVER_FAILURE if the fork
+ * server is not supported or could not be started.
+ */
+int runForkServerCampaign(injection_t *plan, int size, int parallelism,
+                          const char *injectorPath,
+                          forkServerMaster_t runMaster,
+                          forkServerInjection_t startInjection,
+                          forkServerResult_t onResult);
+
+/**
+ * Nonzero in the master instance of the fork server.
+ */
+int isForkServerMaster(void);
+
+/**
+ * Take the first checkpoint, before the scheduler is started.
+ */
+void forkServerStart(void);
+
+/**
+ * Take a checkpoint at run-time counter value now, if the system is in a
+ * consistent state. Must be called from the tick hook.
+ */
+void forkServerCheckpoint(unsigned long now);
+
+/**
+ * The golden workload is over: hand the remaining injections to the last
+ * checkpoint and terminate the master.
+ */
+void forkServerShutdown(void);
+
+#endif
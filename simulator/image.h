@@ -0,0 +1,33 @@
+#ifndef INJECTOR_IMAGE_H
+#define INJECTOR_IMAGE_H
+
+#include <stddef.h>
+
+#define IMAGE_SUCCESS 0
+#define IMAGE_FAILURE -1
+
+/**
+ * Copy of the writable data segment (.data and .bss) of the object the
+ * simulator is linked into: the sim executable, or one copy of the shared
+ * kernel loaded by sim-multi. Restoring it sets every global back to its
+ * value when the image was saved.
+ */
+typedef struct
+{
+    char *start;
+    size_t size;
+    char *copy;
+} dataImage_t;
+
+/**
+ * Save the writable data segment into image.
+ * Returns IMAGE_SUCCESS, or IMAGE_FAILURE if it is not supported.
+ */
+int saveDataImage(dataImage_t *image);
+
+/**
+ * Restore a data segment saved by saveDataImage().
+ */
+void restoreDataImage(const dataImage_t *image);
+
+#endif
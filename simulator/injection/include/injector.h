@@ -22,6 +22,15 @@ typedef struct injectionResults
     int nCrash, nHang, nSilent, nDelay, nError;
 } injectionResults_t;
 
+/**
+ * @brief Duration of the completed runs of an injection campaign
+ */
+typedef struct injectionDurations
+{
+    unsigned long count;
+    unsigned long long sumNs, maxNs;
+} injectionDurations_t;
+
 /**
  * @brief An injection campaign with its results
  */
@@ -32,14 +41,33 @@ typedef struct injectionCampaign
     // number of injections to be performed
     int nInjections;
     // time instant of the injection, possibly with variance
+    // (with an event trigger, the occurrence of the event)
     unsigned long medTimeRange, variance;
+    // event trigger of the injections, as an event point without its
+    // occurrence (0: the injections are triggered by time, see trigger.h)
+    unsigned long eventPoint;
     // results of the injection
     injectionResults_t res;
+    // duration of the runs completed so far, learnt during the campaign
+    injectionDurations_t durations;
     // a character representing the time distribution of
     // the injection ('u': uniform, 'g': gaussian)
     char distribution;
 } injectionCampaign_t;
 
+/**
+ * @brief A single injection drawn from an injection campaign
+ */
+typedef struct injection
+{
+    // campaign the injection belongs to
+    injectionCampaign_t *campaign;
+    // injection time (ns) and position of the flipped bit
+    unsigned long injTime, offsetByte, offsetBit;
+    // position of the injection in the plan of the campaign
+    unsigned long index;
+} injection_t;
+
 #define INJECTOR_ENABLED 1
 
 #define TYPE_STRUCT_VALUE 1
@@ -103,6 +131,14 @@ typedef struct target_s target_t;
  */
 target_t *read_tasks_targets(target_t *list);
 
+/**
+ * @brief Number of tick interrupts received by the kernel: the tick count,
+ * plus the ticks pended while the scheduler is suspended
+ * 
+ * @return unsigned long is the number of ticks
+ */
+unsigned long get_received_ticks(void);
+
 /**
  * @brief Read injection targets (global variables) from timers.c
  * 
@@ -167,6 +203,18 @@ void freeInjectionTargets(target_t *target);
         target = create_target(nameof(var), (void *)&(var), type, sizeof(var), NULL, target, parent, 1); \
     };
 
+/**
+ * @brief Run-time counter value at which the injector flipped the bit
+ * (0 if the injection has not been performed yet)
+ */
+extern unsigned long performedInjTime;
+
+/**
+ * @brief Tick count at which the bit was flipped, with the tick trigger
+ * (see trigger.h)
+ */
+extern unsigned long performedInjTick;
+
 /**
  * @brief Injector thread function
  * 
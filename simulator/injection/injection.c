@@ -6,6 +6,24 @@
 #include "simulator.h"
 
 int mustEnd = 0;
+unsigned long performedInjTime = 0;
+unsigned long performedInjTick = 0;
+
+// virtual time or tick trigger: injection performed by the hooks, see injectOnTick
+static const thData_t *hookInjection = NULL;
+
+// tick trigger: tick of the injection, and task switches left after it
+// (counted once the tick is reached)
+static unsigned long triggerTick = 0;
+static unsigned long switchesLeft = 0;
+static int countingSwitches = 0;
+
+// replay: injection flipped at the recorded point only
+static const thData_t *replayInjection = NULL;
+
+static void injectFromHook(const thData_t *data, unsigned long currentTime);
+static void flipBit(const thData_t *data);
+static void waitVirtualTimeout(const thData_t *data);
 
 void *injectorFunction(void *arg)
 {
@@ -16,14 +34,171 @@ void *injectorFunction(void *arg)
     DEBUG_PRINT("Requested injection offset byte: %lu\n", data->offsetByte);
     DEBUG_PRINT("Requested injection offset bit: %lu\n", data->offsetBit);
 
-    sleepNanoseconds(data->injTime);
-    //injectorWait ();
+    pinInjectorThread();
+
+    if (isReplaying())
+    {
+        // the replay flips the bit, and ends the run where the recorded one was
+        waitScheduleReplay(data->timeoutNs);
+    }
+    else if (isVirtualTime())
+    {
+        // the tick hook flips the bit: only the timeout is left to this thread
+        waitVirtualTimeout(data);
+    }
+    else if (isTickTrigger() || IS_EVENT_POINT(data->injTime))
+    {
+        // the hooks flip the bit
+        unsigned long currentTime = ulGetRunTimeCounterValue();
+        if (data->timeoutNs > currentTime)
+            sleepNanoseconds(data->timeoutNs - currentTime);
+    }
+    else
+    {
+        beginPhase(PHASE_SLEEP);
+        waitUntilCounter(data->startTime, data->injTime);
+        //injectorWait ();
+        endPhase(PHASE_SLEEP);
+
+        unsigned long long currentTime = ulGetRunTimeCounterValue();
 
-    unsigned long long currentTime = ulGetRunTimeCounterValue();
+        DEBUG_PRINT("Performing the injection at time %lu...\n", currentTime);
+        DEBUG_PRINT("Injection delay: %d (%d - %d) \n", ((signed)currentTime - (signed)data->injTime), (signed)currentTime, (signed)data->injTime);
 
-    DEBUG_PRINT("Performing the injection at time %lu...\n", currentTime);
-    DEBUG_PRINT("Injection delay: %d (%d - %d) \n", ((signed)currentTime - (signed)data->injTime), (signed)currentTime, (signed)data->injTime);
+        // the run may have ended while the injector was waiting: no flip past it
+        beginPhase(PHASE_FLIP);
+        int flipped = runUnlessCancelled(flipBit, data) == INJECTOR_THREAD_SUCCESS;
+        endPhase(PHASE_FLIP);
+        if (!flipped)
+        {
+            return NULL;
+        }
+        performedInjTime = currentTime;
+        logScheduleInjection();
+        DEBUG_PRINT("Injection completed\n");
 
+        DEBUG_PRINT("Waiting the execution timeout\n");
+        sleepNanoseconds(data->timeoutNs - currentTime);
+    }
+
+    DEBUG_PRINT("The execution timeout expired\n");
+    logScheduleEnd();
+
+    // timeout expired => generate a simulated interrupt
+    // and end the scheduler
+    vPortGenerateSimulatedInterrupt(5);
+    vTaskEndScheduler();
+
+    // vTaskEndScheduler should NOT return
+    DEBUG_PRINT("injectorFunction is executing past vTaskEndScheduler!!!\n");
+
+    return NULL;
+}
+
+void scheduleHookInjection(const thData_t *data)
+{
+    countingSwitches = 0;
+    hookInjection = data;
+    limitVirtualTime(data->timeoutNs);
+
+    if (IS_EVENT_POINT(data->injTime))
+    {
+        markVirtualTime(0);
+        armEventTrigger(data->injTime);
+        return;
+    }
+
+    triggerTick = getTriggerTick(data->injTime);
+    switchesLeft = getTriggerSwitches();
+    // on the virtual clock, tick N is raised at N periods
+    markVirtualTime(isTickTrigger() ? triggerTick * (1000000000UL / configTICK_RATE_HZ) : data->injTime);
+}
+
+void injectOnTick(unsigned long currentTime)
+{
+    const thData_t *data = hookInjection;
+
+    if (!data || IS_EVENT_POINT(data->injTime))
+    {
+        return;
+    }
+
+    if (!isTickTrigger())
+    {
+        if (currentTime >= data->injTime)
+            injectFromHook(data, currentTime);
+    }
+    else if (!countingSwitches && get_received_ticks() >= triggerTick)
+    {
+        if (switchesLeft == 0)
+            injectFromHook(data, currentTime);
+        else
+            countingSwitches = 1;
+    }
+}
+
+void injectOnSwitch(void)
+{
+    const thData_t *data = hookInjection;
+
+    if (data && countingSwitches && --switchesLeft == 0)
+    {
+        countingSwitches = 0;
+        injectFromHook(data, ulGetRunTimeCounterValue());
+    }
+}
+
+void injectOnEvent(void)
+{
+    const thData_t *data = hookInjection;
+
+    if (data)
+    {
+        injectFromHook(data, ulGetRunTimeCounterValue());
+    }
+}
+
+void scheduleReplayInjection(const thData_t *data)
+{
+    replayInjection = data;
+}
+
+void injectOnReplay(void)
+{
+    const thData_t *data = replayInjection;
+
+    if (data)
+    {
+        replayInjection = NULL;
+        injectFromHook(data, ulGetRunTimeCounterValue());
+    }
+}
+
+/**
+ * Flip the bit of an injection scheduled on the hooks.
+ */
+static void injectFromHook(const thData_t *data, unsigned long currentTime)
+{
+    hookInjection = NULL;
+    markVirtualTime(0);
+
+    performedInjTick = get_received_ticks();
+
+    DEBUG_PRINT("Performing the injection at time %lu (tick %lu)...\n", currentTime, performedInjTick);
+
+    beginPhase(PHASE_FLIP);
+    flipBit(data);
+    endPhase(PHASE_FLIP);
+    // 0 means not performed: an event may occur at time 0 on the virtual clock
+    performedInjTime = max(currentTime, 1);
+    logScheduleInjection();
+}
+
+/**
+ * Flip the requested bit of the injection target.
+ */
+static void flipBit(const thData_t *data)
+{
     if (data->isList)
     {
         // a list's size is not known at compile time
@@ -76,21 +251,20 @@ void *injectorFunction(void *arg)
         // Standard case: sum the injection address and the offset byte.
         *((char *)data->address + data->offsetByte) ^= (1 << data->offsetBit);
     }
+}
 
-    DEBUG_PRINT("Injection completed\n");
-
-    DEBUG_PRINT("Waiting the execution timeout\n");
-    sleepNanoseconds(data->timeoutNs - currentTime);
-
-    DEBUG_PRINT("The execution timeout expired\n");
-
-    // timeout expired => generate a simulated interrupt
-    // and end the scheduler
-    vPortGenerateSimulatedInterrupt(5);
-    vTaskEndScheduler();
-
-    // vTaskEndScheduler should NOT return
-    DEBUG_PRINT("injectorFunction is executing past vTaskEndScheduler!!!\n");
+/**
+ * Wait until the virtual clock reaches the timeout of the run. The clock
+ * stops if the kernel never re-enables the interrupts: the same timeout on
+ * the wall clock ends such a run.
+ */
+static void waitVirtualTimeout(const thData_t *data)
+{
+    unsigned long waitedNs = 0;
 
-    return NULL;
-}
\ No newline at end of file
+    while (ulGetRunTimeCounterValue() < data->timeoutNs && waitedNs < data->timeoutNs)
+    {
+        sleepNanoseconds(VIRTUAL_TIMEOUT_POLL_NS);
+        waitedNs += VIRTUAL_TIMEOUT_POLL_NS;
+    }
+}
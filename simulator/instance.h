@@ -0,0 +1,40 @@
+#ifndef INJECTOR_INSTANCE_H
+#define INJECTOR_INSTANCE_H
+
+/**
+ * Shared-kernel build of the simulator (SIM_SHARED_KERNEL).
+ *
+ * libsimkernel.so holds FreeRTOS, the port and the workload. sim-multi loads
+ * one copy of it per dlmopen() namespace, so every copy has its own globals
+ * (kernel lists, heap_5 regions, loggerTrace...) and its own libc, and runs
+ * one simulation at a time on a thread of sim-multi.
+ *
+ * The copies share the address space: a crash or an exit() in one of them
+ * terminates all of them. Injection campaigns keep relying on process
+ * isolation (--spawn=exec|zygote|worker|forkserver); the shared kernel is
+ * meant for the runs that are not expected to crash, e.g. golden replicas.
+ */
+
+#define SIM_INSTANCE_ENTRY "simRunInstance"
+
+/**
+ * Maximum number of copies of the shared kernel in a process: glibc supports
+ * 16 namespaces (the base one included) and each copy of libc takes static
+ * TLS, see sim-multi.
+ */
+#define SIM_MAX_INSTANCES 15
+
+/**
+ * Run a simulation in the copy of the kernel this function belongs to.
+ *
+ * instance is the index of the copy (0..SIM_MAX_INSTANCES-1): it selects the
+ * tick and interrupt signals of the port. target is the injection target, or
+ * NULL for a run without injection. Returns the exit code a --run instance
+ * would terminate with; *reusable is set to 0 if the copy could not be reset
+ * and must not be used anymore.
+ */
+typedef unsigned int (*simRunInstance_t)(int instance, const char *target, unsigned long time,
+                                         unsigned long offsetByte, unsigned long offsetBit,
+                                         int *reusable);
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef INJECTOR_IRQLOAD_H
+#define INJECTOR_IRQLOAD_H
+
+#include "phases.h"
+
+#define IRQLOAD_SUCCESS 0
+#define IRQLOAD_FAILURE -1
+
+// at most 8 sources, raising the simulated interrupts 8 to 15
+// (5 tells a crash from a hang at the end of a run, see main.c)
+#define IRQLOAD_MAX_SOURCES 8
+#define IRQLOAD_FIRST_INTERRUPT 8
+
+/**
+ * Simulated-interrupt load.
+ *
+ * Besides the interrupt raised at the end of a run, the workload can run
+ * under a load of simulated interrupts, from a few sources described by
+ * kind:process:rate[,...]:
+ * - kind: the handler of the source sends to a queue (queue) or gives a
+ *   binary semaphore (semaphore), from the ISR, and a task of its own,
+ *   above the tasks of the workload, takes them back;
+ * - process: the source raises its interrupt at a fixed period (periodic),
+ *   or at exponential intervals (poisson, drawn from a fixed seed);
+ * - rate: the mean number of interrupts per second.
+ *
+ * On the wall clock a thread of the process raises the interrupts of all
+ * the sources, and an interrupt raised again before it is served is merged
+ * with the pending one. On the virtual clock the tick hook raises the ones
+ * due at the tick, each occurrence as an interrupt of its own. A handler finding its queue full (or its semaphore
+ * given) drops the interrupt instead of failing the call: a failed send
+ * or receive from an ISR marks the end of the run (see loggingUtils.c).
+ *
+ * The golden run must be executed with the same load as the injections.
+ */
+
+typedef struct
+{
+    // "queue" or "semaphore", "periodic" or "poisson"
+    const char *kind, *process;
+    double rateHz;
+    // interrupts raised, served by the handler, dropped by the handler,
+    // and taken back by the task of the source
+    unsigned long raised, served, dropped, consumed;
+    // from the raise of an interrupt to its handler
+    phaseStats_t latency;
+} irqLoadStats_t;
+
+/**
+ * Run this process and the instances it starts under the load described by
+ * spec. Must be called before the scheduler is started.
+ */
+int enableIrqLoad(const char *spec);
+
+/**
+ * Run under the load of the process that started this one, if any.
+ */
+void inheritIrqLoad(void);
+
+/**
+ * Whether the workload runs under a simulated-interrupt load.
+ */
+int isIrqLoad(void);
+
+/**
+ * Description of the load, as given to enableIrqLoad (NULL if none).
+ */
+const char *getIrqLoadSpec(void);
+
+/**
+ * Called by mainSetup: create the queue or semaphore and the task of each
+ * source, and install its handler.
+ */
+int setupIrqLoad(void);
+
+/**
+ * Called when a run is started (golden or injected): start raising the
+ * interrupts once the scheduler runs, until it ends.
+ */
+void startIrqLoad(void);
+
+/**
+ * Virtual time: called by the tick hook, raise the interrupts due at nowNs
+ * on the virtual clock.
+ */
+void tickIrqLoad(unsigned long nowNs);
+
+/**
+ * Virtual time: the next time an interrupt is due on the virtual clock, for
+ * tickless idle not to skip it (0: none).
+ */
+unsigned long getIrqLoadDeadline(void);
+
+/**
+ * Number of sources, and the statistics of each of them.
+ */
+int countIrqLoadSources(void);
+void getIrqLoadStats(int source, irqLoadStats_t *stats);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef INJECTOR_JOURNAL_H
+#define INJECTOR_JOURNAL_H
+
+#include "injector.h"
+#include "worker.h"
+
+#define JOURNAL_SUCCESS 0
+#define JOURNAL_FAILURE -1
+
+// the completed injections are committed to disk at most this often
+#define JOURNAL_COMMIT_INTERVAL_MS 200
+
+/**
+ * Crash-safe journal of an injection campaign.
+ *
+ * The journal is an append-only binary file: a header with the seed of the
+ * campaign, one entry per injection of the plan (the plan is a function of
+ * the seed, and the index of an injection in the plan is its key), then one
+ * entry per completed injection with its exit code. Each entry carries a
+ * checksum: a torn entry at the end of the file (the orchestrator died
+ * while writing it) is discarded on resume.
+ *
+ * The completed injections are queued by the thread that collects their
+ * outcome and written by a dedicated thread, which appends everything
+ * queued since its last commit with a single write and fdatasync
+ * (group commit), at most every JOURNAL_COMMIT_INTERVAL_MS. An outcome
+ * collected less than that before a crash may be lost: its injection is
+ * simply run again on resume.
+ */
+
+/**
+ * Open the journal at path. A new journal is created (or truncated) for
+ * the campaign drawn from *seed; a journal is resumed (resume != 0) with
+ * the seed it was created with, which is stored in *seed.
+ */
+int openJournal(const char *path, int resume, unsigned int *seed);
+
+/**
+ * Bind the journal to the plan drawn from the seed and start the writer
+ * thread. A new journal records the plan; a resumed journal must hold the
+ * same plan, and the outcome of every injection it completed is passed to
+ * onCompleted (at most once per injection).
+ */
+int startJournal(const injection_t *plan, int size, workerResult_t onCompleted);
+
+/**
+ * Queue the outcome of an injection of the plan. Does not block on I/O,
+ * and may be called by any thread.
+ */
+void journalResult(const injection_t *injection, unsigned int exitCode);
+
+/**
+ * Commit the queued outcomes, stop the writer thread and close the journal.
+ */
+void closeJournal(void);
+
+#endif
@@ -8,12 +8,15 @@
 #pragma warning(disable : 4996) // _CRT_SECURE_NO_WARNINGS
 
 signed char loggerTrace[TRACELEN][LENBUF];
+unsigned long loggerContextSwitches;
+int loggerReceivedISR;
 
 extern unsigned long injTime;
 extern int eventIsSet;
 
+static void completeWorkload(void);
+
 void loggingFunction(int logCause) {
-    static int didReceiveISR = 0;
     unsigned long runTimeCounterValue = ulGetRunTimeCounterValue();
     static signed char bufferTCB[LENBUF];
 
@@ -21,7 +24,7 @@ void loggingFunction(int logCause) {
     static signed char bufferStr[2 * LENBUF];
     vTaskGetCurrentTCBStats(bufferTCB);
 
-    if (didReceiveISR)
+    if (loggerReceivedISR)
         // an event 'send|receive from isr' signals that the execution is completed
         // no need to record new events
         return;
@@ -34,6 +37,14 @@ void loggingFunction(int logCause) {
     case 1: // task switched in
         sprintf(bufferStr, "%lu\t[IN]\t%s", runTimeCounterValue, bufferTCB);
         writeToLoggerTrace(bufferStr);
+        if (loggerContextSwitches++ == 0)
+        {
+            // the scheduler started the first task
+            endPhase(PHASE_START);
+            beginPhase(PHASE_WORKLOAD);
+        }
+        // tick trigger: the injection may be due at this switch
+        injectOnSwitch();
         break;
     case 2: // queue send failed
         sprintf(bufferStr, "%lu\t[QSF]\t%s", runTimeCounterValue, bufferTCB);
@@ -46,12 +57,12 @@ void loggingFunction(int logCause) {
     case 4: // queue send from isr
         sprintf(bufferStr, "%lu\t[SIF]\t%s", runTimeCounterValue, bufferTCB);
         writeToLoggerTrace(bufferStr);
-        didReceiveISR++;
+        completeWorkload();
         break;
     case 5: // queue receive from isr
         sprintf(bufferStr, "%lu\t[RIF]\t%s", runTimeCounterValue, bufferTCB);
         writeToLoggerTrace(bufferStr);
-        didReceiveISR++;
+        completeWorkload();
         break;
     default:
         printf("Trace Hook macro called logger with an invalid argument\n");
@@ -59,6 +70,15 @@ void loggingFunction(int logCause) {
     }
 }
 
+static void completeWorkload(void) {
+    // only the first completion event splits the workload from the stop,
+    // whatever the events logged after it
+    if (loggerReceivedISR++ == 0) {
+        endPhase(PHASE_WORKLOAD);
+        beginPhase(PHASE_STOP);
+    }
+}
+
 void writeToLoggerTrace(signed char *strToWrite) {
     static int index = 0;
 
@@ -5,6 +5,13 @@
 
 extern signed char loggerTrace[TRACELEN][LENBUF];
 
+/**
+ * Number of tasks switched in, and whether an event from the ISR (which
+ * completes the execution) was logged.
+ */
+extern unsigned long loggerContextSwitches;
+extern int loggerReceivedISR;
+
 /**
  * @brief Write a log entry to the trace.
  *  
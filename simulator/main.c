@@ -5,6 +5,7 @@
 #include <string.h>
 #include <time.h>
 #include <limits.h>
+#include <math.h>
 #pragma warning(disable : 4996) // _CRT_SECURE_NO_WARNINGS
 
 /* FreeRTOS kernel includes. */
@@ -14,6 +15,13 @@
 
 #include "simulator.h"
 #include "benchmark/benchmark.h"
+#include "benchmark/switch.h"
+#include "benchmark/isr.h"
+
+#ifdef SIM_SHARED_KERNEL
+#include "image.h"
+#include "instance.h"
+#endif
 
 extern struct myStringStruct array[MAXARRAY];
 extern signed char loggerTrace[TRACELEN][LENBUF];
@@ -95,22 +103,78 @@ static void printInjectionTarget(FILE *output, target_t *target, int depth);
 thData_t *getInjectionTarget(target_t *target, const char *toSearch);
 
 static void runSimulator(const thData_t *injectionArgs);
+static void launchInjector(const thData_t *injectionArgs, thread_t *injectorThread);
+static void classifySimulation(const thData_t *injectionArgs);
+static unsigned int classifyOutcome(const thData_t *injectionArgs);
 static void writeGoldenFile();
 
 static void execCmdList(int argc, char **argv);
 static void execCmdRun(int argc, char **argv);
+static void execCmdReplay(int argc, char **argv);
 static void execCmdGolden(int argc, char **argv);
 static void execInjectionCampaign(int argc, char **argv);
+static void execCmdWorker(int argc, char **argv);
+static void execCmdBenchPinning(int argc, char **argv);
+static void execCmdBenchSwitch(int argc, char **argv);
+static void execCmdBenchIrq(int argc, char **argv);
+static int parseTriggerSwitches(const char *spec, unsigned long *nSwitches);
 
 static int readGoldenExecutionTime(unsigned long *value);
+static void formatGoldenMode(char *mode, size_t size);
+static int checkGoldenMode(FILE *goldenfp);
 static int readInjectionCampaignList(const char *filename, injectionCampaign_t **campaignList);
 
 static int traceOutputIsCorrect();
 static int executionResultIsCorrect();
 
+static void drawInjection(injectionCampaign_t *campaign, const thData_t *inj, unsigned long nanoGoldenEx, injection_t *injection);
+static int drawInjectionPlan(injectionCampaign_t *injectionCampaigns, int nInjectionCampaigns,
+							 unsigned long nanoGoldenEx, injection_t *plan);
+static int pickNextCampaign(const injectionCampaign_t *injectionCampaigns, int nInjectionCampaigns,
+							const int *nStarted, int order, unsigned long long unknownNs);
+static void updateCampaignDurations(injectionCampaign_t *campaign, unsigned long durationNs);
+static void updateCampaignResults(injectionCampaign_t *campaign, unsigned int exitCode);
+
+static void runForkServerMaster(void);
+static void startForkServerInjection(const injection_t *injection, unsigned long snapshotTime);
+static void collectPlannedResult(const injection_t *injection, unsigned int exitCode);
+static void collectTimedResult(const injection_t *injection, unsigned int exitCode, unsigned long durationNs);
+static void collectJournaledResult(const injection_t *injection, unsigned int exitCode);
+static void collectShardedResult(const injection_t *injection, unsigned int exitCode);
+static int settleCachedResult(const injection_t *injection);
+static unsigned long estimateRunTime(void);
+static void printResultCache(FILE *fp);
+static void printShardedProgress(unsigned long nCompleted);
+static void publishOutcome(const thData_t *injectionArgs, unsigned int exitCode);
+static void collectRunRecord(const runRecord_t *record);
+static void addTargetLatency(const char *name, unsigned long long latencyNs);
+static void drainRunRecords(int final);
+static void printRunRecords(FILE *fp);
+static void printPhaseTimings(FILE *fp);
+
+static void setupZygote(void);
+static void runZygoteInjection(const char *target, unsigned long time, unsigned long offsetByte, unsigned long offsetBit);
+
+static void setupWorker(void);
+static unsigned int runWorkerInjection(const injection_t *injection);
+
+#ifdef SIM_SHARED_KERNEL
+unsigned int simRunInstance(int instance, const char *target, unsigned long time,
+							unsigned long offsetByte, unsigned long offsetBit,
+							int *reusable);
+#endif
+
+static void loadGoldenOutput();
+static void printStartupLatency(FILE *fp, const char *label, int spawnMode);
+static void printLatency(FILE *fp, const char *title, const char *label, const latencyStats_t *latency);
+static void printMakespan(FILE *fp, int order, unsigned long makespanNs, const unsigned long *durations,
+						  const unsigned long *dispatched, unsigned long n, int parallelism);
+static double replayMakespan(const unsigned long *durations, const unsigned long *order, unsigned long n, int parallelism);
+
 static void printProgressBar(double percentage);
 static void printMany(FILE *fp, char c, int number);
 static void printStatistics(injectionCampaign_t *injectionCampaigns, int nInjectionCampaigns);
+static const char *formatInjectionPoint(const injectionCampaign_t *campaign, char *buffer, size_t size);
 
 /**
  * List of injection targets for the current instance of the 
@@ -119,10 +183,150 @@ static void printStatistics(injectionCampaign_t *injectionCampaigns, int nInject
  */
 static target_t *targets;
 
+/**
+ * Output of the golden execution, if preloaded by loadGoldenOutput.
+ */
+static struct myStringStruct *goldenOutput;
+
+/**
+ * Number of --run instances used to measure the startup latency
+ * of the exec path when the campaign runs with the zygote or the reuse workers.
+ */
+#define STARTUP_LATENCY_PROBES 5
+
+// order in which the injections of a campaign are started (--order=)
+#define ORDER_FIFO 0 // as listed in the input file
+#define ORDER_LPT 1	 // expected-longest runs first
+
+/**
+ * An injection run by a slot of the pool.
+ */
+typedef struct
+{
+	injection_t injection;
+	// position of the injection in the input file order
+	unsigned long seq;
+	// when its instance was started (run-time counter)
+	unsigned long startNs;
+	// -j=auto: golden run that measures the load, not an injection
+	int probe;
+} pendingInjection_t;
+
+/**
+ * Injection latency of the runs of a target, from their records.
+ */
+typedef struct
+{
+	char target[64];
+	unsigned long count;
+	unsigned long long sumNs, maxNs;
+} targetLatency_t;
+
+// -j=auto: at most this many instances per CPU
+#define AUTO_PARALLELISM_FACTOR 4
+// -j=auto: one golden probe every AUTO_PROBE_SPACING * limit injections
+#define AUTO_PROBE_SPACING 2
+// -j=auto: probes per decision on the limit
+#define AUTO_PROBE_WINDOW 10
+// -j=auto: the limit grows only while the p99 inflation of the probes stays
+// below this target, which leaves headroom below DELAY_THRESHOLD
+#define AUTO_TARGET_INFLATION (1.0 + 0.6 * (DELAY_THRESHOLD - 1.0))
+// -j=auto: decisions a limit that did not pay off stays the ceiling for
+#define AUTO_CEILING_EPOCHS 5
+
+/**
+ * A decision of -j=auto, kept to report the concurrency over time.
+ */
+typedef struct
+{
+	unsigned long timeNs;
+	int limit, nextLimit, nProbes;
+	double p99, throughput;
+} autoDecision_t;
+
+/**
+ * State of -j=auto. The pool runs up to limit instances. Every few injections
+ * one of them is replaced by a probe, a golden run that is never injected:
+ * its run time over the golden execution time is the inflation of the
+ * execution time under the current load, which turns Silent runs into
+ * Delay runs once it exceeds DELAY_THRESHOLD.
+ * 
+ * After AUTO_PROBE_WINDOW probes (an epoch) the limit is raised by one if
+ * the p99 inflation is within AUTO_TARGET_INFLATION and the throughput did
+ * not drop since the previous epoch, and lowered otherwise; a probe above
+ * DELAY_THRESHOLD ends the epoch at once. A limit that was lowered stays the
+ * ceiling for AUTO_CEILING_EPOCHS epochs.
+ */
+typedef struct
+{
+	int limit, maxLimit;
+	int ceiling, ceilingEpochs;
+	// inflation of the probes of the current epoch
+	double inflation[AUTO_PROBE_WINDOW];
+	int nProbes;
+	// a probe is running, injections completed since the last one started
+	int probing;
+	unsigned long sinceProbe;
+	// current epoch (run-time counter) and throughput of the previous one
+	unsigned long epochStartNs, epochCompleted;
+	double lastThroughput;
+	autoDecision_t *decisions;
+	int nDecisions;
+} autoParallelism_t;
+
+static void initAutoParallelism(autoParallelism_t *autoJ, int nCpus, unsigned long nowNs);
+static void updateAutoParallelism(autoParallelism_t *autoJ, double inflation, unsigned long nowNs);
+static void printAutoParallelism(FILE *fp, const autoParallelism_t *autoJ, unsigned long startNs);
+
+/**
+ * State shared by execInjectionCampaign with the fork-server, zygote and worker callbacks.
+ */
+static struct
+{
+	unsigned long goldenExecTime;
+	unsigned long nCompleted, nTotal;
+	int pgBarEnabled;
+	// injections of the plan settled before any instance runs (by the journal or the cache)
+	unsigned char *settled;
+	// planned injections answered by the result cache, and the run time they saved
+	unsigned long nCacheHits;
+	unsigned long long cacheSavedNs;
+	// wall-clock start of the runs, their slots, and the runs whose time was estimated
+	unsigned long long runsStartNs;
+	int nSlots;
+	unsigned long nEstimated;
+	// injection parameters of an instance forked by the fork server
+	thData_t injectionArgs;
+	// records consumed from the ring (see records.h), and --records= output: the
+	// injected runs include the event points reached, the timed ones have a latency
+	unsigned long nRecords, nInjected, nTimedInjected, nIsrReceived;
+	unsigned long long sumInjLatencyNs, maxInjLatencyNs, sumContextSwitches;
+	targetLatency_t *targetLatencies;
+	int nTargetLatencies;
+	// tick trigger: injections flipped after the requested tick, and by how many ticks
+	unsigned long nLateTriggers, maxLateTicks;
+	// event triggers: runs with an event point, and the ones that reached it
+	unsigned long nEventPoints, nEventsReached;
+	// drift of the tick: runs that missed ticks, how many, and the largest delay of a tick
+	unsigned long nDriftedRuns, sumMissedTicks, maxMissedTicks, maxTickLagNs;
+	FILE *recordsFile;
+	// optional reports: --phases[=FILE] (and its CSV file), --latency, --makespan
+	int reportPhases, reportLatency, reportMakespan;
+	const char *phasesPath;
+} spawner;
+
 /*-----------------------------------------------------------*/
 
 int main(int argc, char **argv)
 {
+	// a --run instance: the execv of its image ends here
+	endExecPhase();
+	inheritVirtualTime();
+	inheritTickTrigger();
+	inheritSpinMargin();
+	inheritScheduleRecording();
+	inheritIrqLoad();
+
 	setbuf(stdout, 0);
 	setbuf(stderr, 0);
 
@@ -132,7 +336,7 @@ int main(int argc, char **argv)
 	if (argc < 2)
 	{
 		// at least one argument is expected
-		ERR_PRINT("Please specify a command argument --(list|run|golden)\n");
+		ERR_PRINT("Please specify a command argument --(list|run|replay|golden|campaign|coordinator|worker|bench-pinning|bench-switch|bench-irq)\n");
 		return INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE;
 	}
 
@@ -151,14 +355,34 @@ int main(int argc, char **argv)
 	{
 		execCmdRun(argc, argv);
 	}
+	else if (strcmp(argv[1], CMD_REPLAY) == 0)
+	{
+		execCmdReplay(argc, argv);
+	}
 	else if (strcmp(argv[1], CMD_GOLDEN) == 0)
 	{
 		execCmdGolden(argc, argv);
 	}
-	else if (strcmp(argv[1], CMD_CAMPAIGN) == 0)
+	else if (strcmp(argv[1], CMD_CAMPAIGN) == 0 || strcmp(argv[1], CMD_COORDINATOR) == 0)
 	{
 		execInjectionCampaign(argc, argv);
-	} 
+	}
+	else if (strcmp(argv[1], CMD_WORKER) == 0)
+	{
+		execCmdWorker(argc, argv);
+	}
+	else if (strcmp(argv[1], CMD_BENCH_PINNING) == 0)
+	{
+		execCmdBenchPinning(argc, argv);
+	}
+	else if (strcmp(argv[1], CMD_BENCH_SWITCH) == 0)
+	{
+		execCmdBenchSwitch(argc, argv);
+	}
+	else if (strcmp(argv[1], CMD_BENCH_IRQ) == 0)
+	{
+		execCmdBenchIrq(argc, argv);
+	}
 	else 
 	{
 		printf("Unrecognized command!\n");
@@ -202,13 +426,51 @@ static void execCmdRun(int argc, char **argv)
 		fclose(golden);
 		exit(GENERIC_ERROR_EXIT_CODE);
 	}
+
+	if (checkGoldenMode(golden) != 0)
+	{
+		fclose(golden);
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
 	DEBUG_PRINT("Execution timeout is %lu\n", goldenExecTime);
 
-	injTime = atol(argv[3]);
+	// a time in ns, a tick trigger: Nt (tick N) or Nt+K (K-th switch after it),
+	// or an event point: EVENT[:name]@N
+	char *unit;
+	injTime = strtoul(argv[3], &unit, 10);
+	if (strchr(argv[3], '@'))
+	{
+		if (parseEventPoint(argv[3], &injTime) != TRIGGER_SUCCESS)
+		{
+			fclose(golden);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+	else if (*unit == 't')
+	{
+		unsigned long nSwitches;
+		if (parseTriggerSwitches(unit + 1, &nSwitches) != 0)
+		{
+			ERR_PRINT("Invalid injection tick %s.\n", argv[3]);
+
+			fclose(golden);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+
+		if (enableTickTrigger(nSwitches) != TRIGGER_SUCCESS)
+		{
+			fclose(golden);
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		injTime *= 1000000000UL / configTICK_RATE_HZ;
+	}
 	unsigned long offsetByte = atol(argv[4]);
 	unsigned long offsetBit = atol(argv[5]);
 
+	beginPhase(PHASE_TARGET);
 	thData_t *injection = getInjectionTarget(targets, argv[2]);
+	endPhase(PHASE_TARGET);
 
 	if (!injection)
 	{
@@ -229,29 +491,106 @@ static void execCmdRun(int argc, char **argv)
 	free(injection);
 }
 
+/**
+ * Execute the --replay command: run the injection of a schedule log
+ * recorded by --record=DIR again, with the same schedule.
+ *
+ * Expected parameters:
+ * ./sim --replay /path/to/log.sched
+ */
+static void execCmdReplay(int argc, char **argv)
+{
+	if (argc != 3)
+	{
+		ERR_PRINT("Invalid number of arguments for %s.\n", CMD_REPLAY);
+		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
+	}
+
+	// the outcome is checked against the local golden run
+	unsigned long goldenExecTime;
+	if (readGoldenExecutionTime(&goldenExecTime) != 0)
+	{
+		ERR_PRINT("%s not found. Be sure to execute the --golden command.\n", GOLDEN_FILE_PATH);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	scheduleRun_t run;
+	if (loadScheduleReplay(argv[2], &run) != REPLAY_SUCCESS)
+	{
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	thData_t *injection = getInjectionTarget(targets, run.target);
+	if (!injection)
+	{
+		ERR_PRINT("Cannot find the injection target %s\n", run.target);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	injTime = run.injTime;
+	injection->injTime = run.injTime;
+	injection->offsetByte = run.offsetByte;
+	injection->offsetBit = run.offsetBit;
+	// the timeout of the recorded run, on its run-time counter
+	injection->timeoutNs = run.timeoutNs;
+
+	// the instance may die of the injection: its parent reports the replay
+	unsigned int exitCode = runScheduleReplay(&runSimulator, injection, 2 * run.timeoutNs + 1000000000UL);
+
+	free(injection);
+	exit(exitCode == (unsigned int)-1 ? EXECUTION_RESULT_CRASH_EXIT_CODE : exitCode);
+}
+
+/**
+ * Execute the --golden command.
+ * 
+ * Expected parameters:
+ * ./sim --golden [--virtual-time] [--irq-load=SPEC]
+ */
 static void execCmdGolden(int argc, char **argv)
 {
-	if (argc != 2)
+	if (argc > 4)
 	{
-		ERR_PRINT("The --golden command does not support additional parameters");
+		ERR_PRINT("The --golden command only supports the --virtual-time and --irq-load parameters.\n");
 		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
 	}
 
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--virtual-time") == 0)
+		{
+			if (enableVirtualTime() != VTIME_SUCCESS)
+				exit(GENERIC_ERROR_EXIT_CODE);
+		}
+		else if (strncmp(argv[i], "--irq-load=", 11) == 0)
+		{
+			if (enableIrqLoad(argv[i] + 11) != IRQLOAD_SUCCESS)
+				exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+		else
+		{
+			ERR_PRINT("The --golden command only supports the --virtual-time and --irq-load parameters.\n");
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+
 	// run the simulator without specifying an injection target
 	runSimulator(NULL);
 }
 
 /**
- * Execute the --campaign command.
+ * Execute the --campaign command, or the --coordinator command that
+ * serves the same campaign to --worker processes.
  * 
  * Expected parameters:
- * ./sim --campaign /path/to/input/file.csv [-y] [--no-pg-bar] [--j=N]
+ * ./sim --campaign /path/to/input/file.csv [-y] [--no-pg-bar] [--j=N|auto] [--spawn=exec|zygote|worker|forkserver] [--order=fifo|lpt] [--shards=N] [--seed=S] [--pin] [--reserve-cpus=LIST] [--records=FILE] [--phases[=FILE]] [--latency] [--makespan] [--journal=FILE [--resume]] [--cache=FILE] [--virtual-time] [--trigger=tick[+K]] [--spin=US] [--injector-cpus=LIST] [--record=DIR] [--irq-load=SPEC]
+ * ./sim --coordinator /path/to/input/file.csv [-y] [--no-pg-bar] [--seed=S] [--listen=host:port|unix:/path] [--chunk=N] [--journal=FILE [--resume]] [--cache=FILE]
  */
 static void execInjectionCampaign(int argc, char **argv)
 {
-	if (argc < 3 || argc > 6)
+	if (argc < 3 || argc > 23)
 	{
-		ERR_PRINT("Invalid number of arguments for %s.\n", CMD_CAMPAIGN);
+		ERR_PRINT("Invalid number of arguments for %s.\n", argv[1]);
 		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
 	}
 
@@ -260,6 +599,27 @@ static void execInjectionCampaign(int argc, char **argv)
 	char confirm = '0';	  // auto confirm tests execution
 	int pgBarEnabled = 1; // enable|disable progress bar
 	int parallelism = 1;  // number of parallel execution
+	int autoParallelism = 0;	// -j=auto: parallelism is the initial limit
+	int spawnMode = SPAWN_EXEC; // how the injection instances are created
+	int order = ORDER_FIFO;		// which injection is started first
+	int nShards = 1;			// number of threads that start and wait the instances
+	unsigned int seed = (unsigned int)time(NULL); // seed of the injection plan
+	int seedGiven = 0;
+
+	int coordinator = strcmp(argv[1], CMD_COORDINATOR) == 0;
+	const char *listenAddress = NULL; // coordinator only: address for the workers
+	int chunk = 0;					  // coordinator only: injections per lease
+	int pin = 0;					  // pin each instance to its own core set
+	const char *reservedCpus = NULL;  // CPUs left to the orchestrator
+	const char *recordsPath = NULL;	  // CSV file of the run records
+	const char *journalPath = NULL;	  // journal of the completed injections
+	int resume = 0;					  // resume the campaign of the journal
+	const char *cachePath = NULL;	  // persistent cache of the outcomes
+	int virtualTime = 0;			  // run the instances on the virtual clock
+	int tickTrigger = 0;			  // inject at a tick, or at a task switch after it
+	unsigned long triggerSwitches = 0;
+	const char *recordDir = NULL;	  // schedule logs of the runs
+	const char *irqLoad = NULL;		  // simulated-interrupt load of the runs
 
 	for (int i = 3; i < argc; i++)
 	{
@@ -267,8 +627,167 @@ static void execInjectionCampaign(int argc, char **argv)
 			confirm = 'y';
 		else if (strcmp(argv[i], "--no-pg-bar") == 0)
 			pgBarEnabled = 0;
+		else if (strcmp(argv[i], "-j=auto") == 0)
+			autoParallelism = 1;
 		else if (strncmp(argv[i], "-j=", 3) == 0)
 			parallelism = atol(argv[i] + 3);
+		else if (strcmp(argv[i], "--spawn=exec") == 0)
+			spawnMode = SPAWN_EXEC;
+		else if (strcmp(argv[i], "--spawn=zygote") == 0)
+			spawnMode = SPAWN_ZYGOTE;
+		else if (strcmp(argv[i], "--spawn=worker") == 0)
+			spawnMode = SPAWN_WORKER;
+		else if (strcmp(argv[i], "--spawn=forkserver") == 0)
+			spawnMode = SPAWN_FORKSERVER;
+		else if (strcmp(argv[i], "--order=fifo") == 0)
+			order = ORDER_FIFO;
+		else if (strcmp(argv[i], "--order=lpt") == 0)
+			order = ORDER_LPT;
+		else if (strncmp(argv[i], "--shards=", 9) == 0)
+			nShards = atol(argv[i] + 9);
+		else if (strncmp(argv[i], "--seed=", 7) == 0)
+		{
+			seed = strtoul(argv[i] + 7, NULL, 10);
+			seedGiven = 1;
+		}
+		else if (coordinator && strncmp(argv[i], "--listen=", 9) == 0)
+			listenAddress = argv[i] + 9;
+		else if (coordinator && strncmp(argv[i], "--chunk=", 8) == 0)
+			chunk = atol(argv[i] + 8);
+		else if (strcmp(argv[i], "--pin") == 0)
+			pin = 1;
+		else if (strncmp(argv[i], "--reserve-cpus=", 15) == 0)
+			reservedCpus = argv[i] + 15;
+		else if (!coordinator && strncmp(argv[i], "--records=", 10) == 0)
+			recordsPath = argv[i] + 10;
+		else if (!coordinator && strcmp(argv[i], "--phases") == 0)
+			spawner.reportPhases = 1;
+		else if (!coordinator && strncmp(argv[i], "--phases=", 9) == 0)
+		{
+			spawner.reportPhases = 1;
+			spawner.phasesPath = argv[i] + 9;
+		}
+		else if (!coordinator && strcmp(argv[i], "--latency") == 0)
+			spawner.reportLatency = 1;
+		else if (!coordinator && strcmp(argv[i], "--makespan") == 0)
+			spawner.reportMakespan = 1;
+		else if (strncmp(argv[i], "--journal=", 10) == 0)
+			journalPath = argv[i] + 10;
+		else if (strcmp(argv[i], "--resume") == 0)
+			resume = 1;
+		else if (strncmp(argv[i], "--cache=", 8) == 0)
+			cachePath = argv[i] + 8;
+		else if (!coordinator && strcmp(argv[i], "--virtual-time") == 0)
+			virtualTime = 1;
+		else if (!coordinator && strncmp(argv[i], "--trigger=tick", 14) == 0 &&
+				 parseTriggerSwitches(argv[i] + 14, &triggerSwitches) == 0)
+			tickTrigger = 1;
+		else if (!coordinator && strncmp(argv[i], "--spin=", 7) == 0)
+		{
+			if (setSpinMargin(strtoul(argv[i] + 7, NULL, 10) * 1000) != SLEEP_SUCCESS)
+				exit(GENERIC_ERROR_EXIT_CODE);
+		}
+		else if (!coordinator && strncmp(argv[i], "--injector-cpus=", 16) == 0)
+		{
+			if (setInjectorCpus(argv[i] + 16) != AFFINITY_SUCCESS)
+				exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+		else if (!coordinator && strncmp(argv[i], "--record=", 9) == 0)
+			recordDir = argv[i] + 9;
+		else if (!coordinator && strncmp(argv[i], "--irq-load=", 11) == 0)
+			irqLoad = argv[i] + 11;
+		else
+		{
+			ERR_PRINT("Unrecognized option %s for %s.\n", argv[i], argv[1]);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+
+	if (order == ORDER_LPT && (spawnMode == SPAWN_WORKER || spawnMode == SPAWN_FORKSERVER))
+	{
+		// these modes draw their whole plan upfront
+		ERR_PRINT("--order=lpt requires --spawn=exec or --spawn=zygote.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (nShards < 1 ||
+		(nShards > 1 && (spawnMode == SPAWN_WORKER || spawnMode == SPAWN_FORKSERVER || order == ORDER_LPT)))
+	{
+		// the managers run a plan drawn upfront, with the instances of the exec or zygote modes
+		ERR_PRINT("--shards=N requires N > 0, and --spawn=exec or --spawn=zygote with --order=fifo if N > 1.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (autoParallelism && (spawnMode == SPAWN_WORKER || spawnMode == SPAWN_FORKSERVER || nShards > 1 || coordinator))
+	{
+		// the limit is enforced by the pool of execInjectionCampaign
+		ERR_PRINT("-j=auto requires --spawn=exec or --spawn=zygote without --shards.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if ((resume && !journalPath) || (resume && seedGiven))
+	{
+		// the plan of a resumed campaign is drawn from the seed of its journal
+		ERR_PRINT("--resume requires --journal=FILE, and takes the seed from the journal.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (virtualTime && autoParallelism)
+	{
+		// the outcome of a run on the virtual clock does not depend on the load
+		ERR_PRINT("-j=auto has no use with --virtual-time.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (recordDir && (virtualTime || spawnMode == SPAWN_FORKSERVER))
+	{
+		// a replay starts from scratch, on the wall clock
+		ERR_PRINT("--record requires the wall clock, and another --spawn mode than forkserver.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (irqLoad && (recordDir || spawnMode == SPAWN_FORKSERVER))
+	{
+		// the schedule log does not place the interrupts, and the fork server
+		// forks its instances from a run started without the load
+		ERR_PRINT("--irq-load is not supported with --record, nor with --spawn=forkserver.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	// before any instance (or the zygote, the workers, the fork server) is started
+	if ((virtualTime && enableVirtualTime() != VTIME_SUCCESS) ||
+		(tickTrigger && enableTickTrigger(triggerSwitches) != TRIGGER_SUCCESS) ||
+		(recordDir && enableScheduleRecording(recordDir) != REPLAY_SUCCESS) ||
+		(irqLoad && enableIrqLoad(irqLoad) != IRQLOAD_SUCCESS))
+	{
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	if (coordinator && (parallelism != 1 || spawnMode != SPAWN_EXEC || order != ORDER_FIFO || nShards != 1 || pin))
+	{
+		// the coordinator runs no injection: the workers choose their own options
+		ERR_PRINT("-j, --spawn, --order, --shards and --pin are options of the %s command.\n", CMD_WORKER);
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if ((reservedCpus && !pin) || (pin && spawnMode == SPAWN_FORKSERVER))
+	{
+		// the instances of the fork server descend from its master, which runs with the orchestrator
+		ERR_PRINT("--reserve-cpus requires --pin, which is not supported by --spawn=forkserver.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	// before the zygote and the workers are created: they run with the orchestrator
+	if (pin && enableCpuPlacement(reservedCpus) != AFFINITY_SUCCESS)
+	{
+		ERR_PRINT("Couldn't enable the CPU placement of the instances.\n");
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	// -j=auto starts from one instance per CPU left to the instances
+	if (autoParallelism)
+	{
+		parallelism = countInstanceCpus();
 	}
 
 	/**
@@ -303,9 +822,9 @@ static void execInjectionCampaign(int argc, char **argv)
 	 */
 	fprintf(stdout, "\nEstimated execution times:\n");
 
-	printMany(stdout, '-', 117);
-	fprintf(stdout, "\n| %-30s | %10s | %8s | %10s | %5s | %5s | %12s | %12s |\n",
-			"Target", "Time (ns)", "nExecs", "tMed", "var", "distr", "estTimeMin", "estTimeMax");
+	printMany(stdout, '-', 139);
+	fprintf(stdout, "\n| %-30s | %32s | %8s | %10s | %5s | %5s | %12s | %12s |\n",
+			"Target", "Time (ns) or event@occurrence", "nExecs", "tMed", "var", "distr", "estTimeMin", "estTimeMax");
 
 	for (int i = 0; i < nInjectionCampaigns; ++i)
 	{
@@ -322,21 +841,29 @@ static void execInjectionCampaign(int argc, char **argv)
 
 		// verify the median injection time does not exceed the
 		// execution time of the golden simulation
-		if (campaign->medTimeRange > nanoGoldenEx)
+		if (!campaign->eventPoint && campaign->medTimeRange > nanoGoldenEx)
 		{
 			ERR_PRINT("Invalid injection time for target %s\n", campaign->targetStructure);
 			exit(GENERIC_ERROR_EXIT_CODE);
 		}
 
+		if (campaign->eventPoint && spawnMode == SPAWN_FORKSERVER)
+		{
+			// the occurrences are counted from the start of the run, not from a snapshot
+			ERR_PRINT("The event trigger of target %s requires another --spawn mode than forkserver.\n", campaign->targetStructure);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+
 		// minimum time estimate: each run lasts as the golden run
 		double estTimeMin = (1.0 * campaign->nInjections * nanoGoldenEx) / (1000.0 * 1000.0 * 1000.0);
 		// 300% of golden execution time, for each injection in the campaign
 		double estTimeMax = estTimeMin * 3.0;
 
-		printMany(stdout, '-', 117);
-		fprintf(stdout, "\n| %-30s | %10ld | %8d | %10lu | %5lu | %5c | %10.2f s | %10.2f s |\n",
+		char point[64];
+		printMany(stdout, '-', 139);
+		fprintf(stdout, "\n| %-30s | %32s | %8d | %10lu | %5lu | %5c | %10.2f s | %10.2f s |\n",
 				campaign->targetStructure,
-				campaign->medTimeRange,
+				formatInjectionPoint(campaign, point, sizeof(point)),
 				campaign->nInjections,
 				campaign->medTimeRange,
 				campaign->variance,
@@ -348,8 +875,8 @@ static void execInjectionCampaign(int argc, char **argv)
 		nTotalInjections += campaign->nInjections;
 	}
 
-	printMany(stdout, '-', 117);
-	fprintf(stdout, "\n%-30s     %10s    %8s   %10s   %5s   %5s   %10.2f s   %10.2f s \n\n",
+	printMany(stdout, '-', 139);
+	fprintf(stdout, "\n%-30s     %32s    %8s   %10s   %5s   %5s   %10.2f s   %10.2f s \n\n",
 			"Total estimated time", "-", "-", "-", "-", "-", estTotTimeMin / parallelism, estTotTimeMax / parallelism);
 
 	// require user confirmation
@@ -366,7 +893,7 @@ static void execInjectionCampaign(int argc, char **argv)
 
 	/**
 	 * For each line in the input .csv, generate an injection campaign.
-	 *  - For each run, fork a new process. 
+	 *  - For each run, fork a new process, as soon as a slot of the pool is free. 
 	 *  - The child process launches a thread instance the injector. 
 	 *  - The orchestrator waits for the child: 
 	 *     - if the return value of the wait is different from 0, the forefather adds 1 to the "crash" entry for that campaign. 
@@ -377,173 +904,1583 @@ static void execInjectionCampaign(int argc, char **argv)
 	 * Completing injection campaigns advances a general completion bar.
 	 */
 
-	// initialize the random seed
-	srand((unsigned int)time(NULL));
-	
-	int nCurrentInjection = 0; // total number of indipendent runs
+	if (journalPath && openJournal(journalPath, resume, &seed) != JOURNAL_SUCCESS)
+	{
+		ERR_PRINT("Couldn't open the journal %s.\n", journalPath);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	// initialize the random seed: the same seed draws the same plan
+	fprintf(stdout, "Random seed: %u\n", seed);
+	srand(seed);
+
+	// the instances write their run record to the ring: it must exist before any of them
+	if (!coordinator && createRunRecordRing() != RECORDS_SUCCESS && (recordsPath || spawner.reportPhases || spawner.reportLatency))
+	{
+		ERR_PRINT("Run records are not supported on this platform.\n");
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	if (recordsPath)
+	{
+		spawner.recordsFile = fopen(recordsPath, "w");
+		if (!spawner.recordsFile)
+		{
+			ERR_PRINT("Couldn't open %s.\n", recordsPath);
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		fprintf(spawner.recordsFile, "pid,target,injTime,offsetByte,offsetBit,performedInjTime,performedInjTick,endTime,tickCount,missedTicks,maxTickLagNs,contextSwitches,isrReceived,exitCode\n");
+		fflush(spawner.recordsFile);
+	}
+
+	/**
+	 * The whole plan is drawn upfront, in the order of the input file, so
+	 * that every mode runs the same injections for the same seed; the index
+	 * of an injection in the plan is its key in the journal.
+	 */
+	injection_t *plan = (injection_t *)malloc(sizeof(injection_t) * nTotalInjections);
+	int nPlanned = drawInjectionPlan(injectionCampaigns, nInjectionCampaigns, nanoGoldenEx, plan);
+
+	spawner.goldenExecTime = nanoGoldenEx;
+	spawner.nCompleted = 0;
+	spawner.nTotal = nTotalInjections;
+	spawner.pgBarEnabled = pgBarEnabled;
+	spawner.settled = (unsigned char *)calloc(nTotalInjections + 1, sizeof(unsigned char));
+
+	// the outcomes of a resumed journal are counted before any injection runs
+	if (journalPath && startJournal(plan, nPlanned, &collectJournaledResult) != JOURNAL_SUCCESS)
+	{
+		ERR_PRINT("Couldn't start the journal %s.\n", journalPath);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	if (resume)
+	{
+		fprintf(stdout, "Resuming the campaign: %lu of %lu injections already completed.\n",
+				spawner.nCompleted, nTotalInjections);
+	}
+
+	if (cachePath && openResultCache(cachePath, GOLDEN_FILE_PATH) != CACHE_SUCCESS)
+	{
+		ERR_PRINT("Couldn't open the result cache %s.\n", cachePath);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	// injections left to run, in plan order: the cached ones are answered right away
+	injection_t *todo = (injection_t *)malloc(sizeof(injection_t) * (nTotalInjections + 1));
+	int nTodo = 0;
+	for (int i = 0; i < nPlanned; i++)
+	{
+		if (!spawner.settled[i] && !settleCachedResult(&plan[i]))
+			todo[nTodo++] = plan[i];
+	}
+
+	// the slots of the workers of a coordinator are not known: one is counted
+	spawner.runsStartNs = phaseClockNs();
+	spawner.nSlots = coordinator ? 1 : parallelism;
 
-	// simulations that are still running
+	if (coordinator)
+	{
+		// the workers are served the same plan as a single-node campaign
+		if (runCoordinator(todo, nTodo, listenAddress ? listenAddress : DEFAULT_COORDINATOR_ADDRESS,
+						   chunk, &collectPlannedResult) != DISTRIBUTED_SUCCESS)
+		{
+			ERR_PRINT("Couldn't run the injection campaign with the workers.\n");
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		closeJournal();
+		free(plan);
+		free(todo);
+		free(spawner.settled);
+
+		printStatistics(injectionCampaigns, nInjectionCampaigns);
+		printResultCache(stdout);
+		return;
+	}
+
+	if (spawnMode == SPAWN_FORKSERVER || spawnMode == SPAWN_WORKER)
+	{
+		// neither mode is sharded, and a coordinator campaign has returned above: each one
+		// runs the whole plan on its own slots, and the fork server sorts it by injection time
+		if (pgBarEnabled)
+		{
+			printProgressBar((double)spawner.nCompleted / spawner.nTotal);
+		}
+
+		if (spawnMode == SPAWN_WORKER)
+		{
+			if (runWorkerCampaign(todo, nTodo, parallelism,
+								  &setupWorker, &runWorkerInjection,
+								  &collectPlannedResult) != WORKER_SUCCESS)
+			{
+				ERR_PRINT("Couldn't run the injection campaign with the reuse workers.\n");
+				exit(GENERIC_ERROR_EXIT_CODE);
+			}
+		}
+		else if (runForkServerCampaign(todo, nTodo, parallelism, argv[0],
+									   &runForkServerMaster, &startForkServerInjection,
+									   &collectPlannedResult) != FORK_SERVER_SUCCESS)
+		{
+			ERR_PRINT("Couldn't run the injection campaign with the fork server.\n");
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		closeJournal();
+		free(plan);
+		free(todo);
+		free(spawner.settled);
+
+		// measure the exec path as well, for comparison
+		if (spawnMode == SPAWN_WORKER && spawner.reportLatency)
+			probeFreeRTOSStartupLatency(argv[0], injectionCampaigns[0].targetStructure, STARTUP_LATENCY_PROBES);
+
+		printStatistics(injectionCampaigns, nInjectionCampaigns);
+		printRunRecords(stdout);
+		printResultCache(stdout);
+		printPhaseTimings(stdout);
+
+		if (spawnMode == SPAWN_WORKER)
+		{
+			printStartupLatency(stdout, "exec (probe)", SPAWN_EXEC);
+			printStartupLatency(stdout, "worker", SPAWN_WORKER);
+		}
+		return;
+	}
+
+	if (spawnMode == SPAWN_ZYGOTE && startFreeRTOSZygote(&setupZygote, &runZygoteInjection) < 0)
+	{
+		ERR_PRINT("Couldn't create the zygote process.\n");
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	if (nShards > 1)
+	{
+		/**
+		 * This thread only reports the progress: the manager threads start
+		 * the instances, wait for them and collect their exit codes (and
+		 * journal them), which are merged into the campaign results once
+		 * all the shards are done.
+		 */
+		unsigned int *exitCodes = (unsigned int *)calloc(nTodo + 1, sizeof(unsigned int));
+
+		if (runShardedCampaign(todo, nTodo, parallelism, nShards, spawnMode, argv[0],
+							   exitCodes, &collectShardedResult, &printShardedProgress) != SHARDS_SUCCESS)
+		{
+			ERR_PRINT("Couldn't run the injection campaign with the manager threads.\n");
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		for (int i = 0; i < nTodo; i++)
+			updateCampaignResults(todo[i].campaign, exitCodes[i]);
+
+		closeJournal();
+		free(plan);
+		free(todo);
+		free(spawner.settled);
+		free(exitCodes);
+
+		if (spawnMode == SPAWN_ZYGOTE)
+		{
+			stopFreeRTOSZygote();
+			if (spawner.reportLatency)
+				probeFreeRTOSStartupLatency(argv[0], injectionCampaigns[0].targetStructure, STARTUP_LATENCY_PROBES);
+		}
+
+		printStatistics(injectionCampaigns, nInjectionCampaigns);
+		printRunRecords(stdout);
+		printResultCache(stdout);
+		printPhaseTimings(stdout);
+
+		printStartupLatency(stdout, spawnMode == SPAWN_ZYGOTE ? "exec (probe)" : "exec", SPAWN_EXEC);
+		printStartupLatency(stdout, "zygote", SPAWN_ZYGOTE);
+
+		latencyStats_t reaping;
+		getReapingLatency(&reaping);
+		printLatency(stdout, "Reaping latency", "", &reaping);
+		return;
+	}
+
+	// the runs are timed on the wall clock: the run-time counter of the
+	// orchestrator stands still on the virtual clock
+	unsigned long campaignStartNs = phaseClockNs();
+
+	// -j=auto: the pool has room for the maximum limit, of which only limit slots are used
+	autoParallelism_t autoJ;
+	initAutoParallelism(&autoJ, autoParallelism ? parallelism : 0, campaignStartNs);
+	int limit = parallelism;
+	if (autoParallelism)
+		parallelism = autoJ.maxLimit;
+
+	// simulations that are still running: an instance keeps its slot until it is waited
 	freeRTOSInstance *pendingSimulations;
-	pendingSimulations = (freeRTOSInstance *)malloc(sizeof(freeRTOSInstance) * parallelism);
+	pendingSimulations = (freeRTOSInstance *)calloc(parallelism, sizeof(freeRTOSInstance));
+
+	// injection run by each slot, to attribute its outcome to the right campaign
+	pendingInjection_t *pendingInjections = (pendingInjection_t *)calloc(parallelism, sizeof(pendingInjection_t));
+
+	// the slots of pendingSimulations not in use are freeSlots[full..parallelism-1]
+	int *freeSlots = (int *)malloc(sizeof(int) * parallelism);
+	for (int i = 0; i < parallelism; i++)
+		freeSlots[i] = i;
 
 	int full = 0; // number of pending simulations in the pendingSimulations array
 
-	for (int i = 0; i < nInjectionCampaigns; ++i)
+	// per campaign: injections started (or completed by the journal) so far
+	// and position in the plan of the next injection to start
+	int *nCampaignStarted = (int *)calloc(nInjectionCampaigns, sizeof(int));
+	unsigned long *nextSeq = (unsigned long *)calloc(nInjectionCampaigns, sizeof(unsigned long));
+
+	for (int i = 0; i < nInjectionCampaigns; ++i)
+	{
+		memset(&injectionCampaigns[i].durations, 0, sizeof(injectionDurations_t));
+
+		if (i > 0)
+			nextSeq[i] = nextSeq[i - 1] + injectionCampaigns[i - 1].nInjections;
+	}
+
+	for (int i = 0; i < nPlanned; i++)
+	{
+		if (spawner.settled[i])
+			nCampaignStarted[plan[i].campaign - injectionCampaigns]++;
+	}
+
+	// duration of each run (by position in the input file order)
+	// and positions of the injections in the order they were started
+	unsigned long *durations = (unsigned long *)calloc(nTotalInjections, sizeof(unsigned long));
+	unsigned long *dispatched = (unsigned long *)calloc(nTotalInjections, sizeof(unsigned long));
+
+	/**
+	 * The injections of all the campaigns are streamed into the same pool:
+	 * a free slot is refilled with the next injection right away, even if it
+	 * belongs to the next campaign, so the pool only drains at the very end.
+	 * 
+	 * With --order=lpt the next injection comes from the campaign whose runs
+	 * lasted longer on average so far (longest processing time first), so that
+	 * the hangs do not pile up in the tail of the campaign. A campaign without
+	 * completed runs is assumed to hang until the timeout, so that every
+	 * campaign is sampled early.
+	 */
+	unsigned long nStarted = 0;
+
+	if (pgBarEnabled)
+	{
+		printProgressBar((double)spawner.nCompleted / spawner.nTotal);
+	}
+
+	while (spawner.nCompleted < nTotalInjections || full > 0)
+	{
+		while (full < limit && nStarted < (unsigned long)nTodo)
+		{
+			int slot = freeSlots[full];
+			pendingInjection_t *pending = &pendingInjections[slot];
+			freeRTOSInstance *instance = &pendingSimulations[slot];
+
+			if (autoParallelism && !autoJ.probing && autoJ.sinceProbe >= AUTO_PROBE_SPACING * (unsigned long)limit)
+			{
+				// golden probe: the injection time is past the timeout of the run
+				DEBUG_PRINT("Running a golden probe with %d slots...\n", limit);
+
+				pending->probe = 1;
+				pending->injection.campaign = NULL;
+				pending->injection.injTime = 3 * nanoGoldenEx;
+				pending->startNs = phaseClockNs();
+
+				int ret;
+				if (spawnMode == SPAWN_ZYGOTE)
+					ret = runFreeRTOSInjectionFromZygote(instance, injectionCampaigns[0].targetStructure,
+														 pending->injection.injTime, 0, 0);
+				else
+					ret = runFreeRTOSInjection(instance, argv[0], injectionCampaigns[0].targetStructure,
+											   pending->injection.injTime, 0, 0);
+				if (ret < 0)
+				{
+					ERR_PRINT("Couldn't create child process.\n");
+					exit(GENERIC_ERROR_EXIT_CODE);
+				}
+
+				autoJ.probing = 1;
+				autoJ.sinceProbe = 0;
+				full++;
+				continue;
+			}
+
+			int i = pickNextCampaign(injectionCampaigns, nInjectionCampaigns, nCampaignStarted,
+									 order, 3ull * nanoGoldenEx);
+			injectionCampaign_t *campaign = injectionCampaigns + i;
+
+			DEBUG_PRINT("Running injection n. %lu/%d...\n", nStarted + 1, nTodo);
+
+			// the next injection of the campaign that is not settled yet
+			while (spawner.settled[nextSeq[i]])
+				nextSeq[i]++;
+
+			injection_t *injection = &pending->injection;
+			*injection = plan[nextSeq[i]++];
+			nCampaignStarted[i]++;
+
+			pending->probe = 0;
+			pending->seq = injection->index;
+			pending->startNs = phaseClockNs();
+			dispatched[nStarted++] = pending->seq;
+
+			// start the simulation
+			int ret;
+			if (spawnMode == SPAWN_ZYGOTE)
+				ret = runFreeRTOSInjectionFromZygote(instance, campaign->targetStructure,
+													 injection->injTime, injection->offsetByte, injection->offsetBit);
+			else
+				ret = runFreeRTOSInjection(instance, argv[0], campaign->targetStructure,
+										   injection->injTime, injection->offsetByte, injection->offsetBit);
+			if (ret < 0)
+			{
+				ERR_PRINT("Couldn't create child process.\n");
+				exit(GENERIC_ERROR_EXIT_CODE);
+			}
+
+			full++;
+		}
+
+		unsigned int exitCode;
+
+		// waitFreeRTOSInjections waits for one of the instances in pendingSimulations to complete
+		// pos is the index of the simulation that just completed
+		int pos = waitFreeRTOSInjections(pendingSimulations, parallelism, &exitCode);
+		if (pos < 0)
+		{
+			ERR_PRINT("Couldn't wait for the child processes.\n");
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		pendingInjection_t *completed = &pendingInjections[pos];
+		unsigned long nowNs = phaseClockNs();
+		unsigned long durationNs = nowNs - completed->startNs;
+
+		// the slot of the simulation can be reused
+		full--;
+		freeSlots[full] = pos;
+
+		if (completed->probe)
+		{
+			// a probe that could not be timed (e.g. killed) counts as a hang
+			unsigned long long runTimeNs = getFreeRTOSInstanceRunTime(&pendingSimulations[pos]);
+			updateAutoParallelism(&autoJ, runTimeNs ? (double)runTimeNs / nanoGoldenEx : 3.0, nowNs);
+			limit = autoJ.limit;
+			continue;
+		}
+
+		durations[completed->seq] = durationNs;
+		updateCampaignDurations(completed->injection.campaign, durationNs);
+
+		// classify exit code and update the campaign of the injection
+		collectTimedResult(&completed->injection, exitCode, durationNs);
+
+		autoJ.sinceProbe++;
+		autoJ.epochCompleted++;
+	}
+
+	unsigned long makespanNs = phaseClockNs() - campaignStartNs;
+
+	closeJournal();
+	free(nCampaignStarted);
+	free(nextSeq);
+	free(plan);
+	free(todo);
+	free(spawner.settled);
+
+	if (spawnMode == SPAWN_ZYGOTE)
+	{
+		stopFreeRTOSZygote();
+
+		// measure the exec path as well, for comparison
+		if (nInjectionCampaigns > 0 && spawner.reportLatency)
+			probeFreeRTOSStartupLatency(argv[0], injectionCampaigns[0].targetStructure, STARTUP_LATENCY_PROBES);
+	}
+
+	printStatistics(injectionCampaigns, nInjectionCampaigns);
+	printRunRecords(stdout);
+	printResultCache(stdout);
+	printPhaseTimings(stdout);
+
+	free(pendingSimulations);
+	free(pendingInjections);
+	free(freeSlots);
+
+	printStartupLatency(stdout, spawnMode == SPAWN_ZYGOTE ? "exec (probe)" : "exec", SPAWN_EXEC);
+	printStartupLatency(stdout, "zygote", SPAWN_ZYGOTE);
+
+	latencyStats_t reaping;
+	getReapingLatency(&reaping);
+	printLatency(stdout, "Reaping latency", "", &reaping);
+
+	printMakespan(stdout, order, makespanNs, durations, dispatched, nStarted, limit);
+
+	if (autoParallelism)
+		printAutoParallelism(stdout, &autoJ, campaignStartNs);
+
+	free(autoJ.decisions);
+	free(durations);
+	free(dispatched);
+}
+
+/**
+ * Draw all the injections of the campaigns, in the order of the input file,
+ * and reset the results of the campaigns. Returns the number of injections.
+ */
+static int drawInjectionPlan(injectionCampaign_t *injectionCampaigns, int nInjectionCampaigns,
+							 unsigned long nanoGoldenEx, injection_t *plan)
+{
+	int nPlanned = 0;
+
+	for (int i = 0; i < nInjectionCampaigns; ++i)
+	{
+		injectionCampaign_t *campaign = injectionCampaigns + i;
+		memset(&campaign->res, 0, sizeof(injectionResults_t));
+
+		thData_t *inj = getInjectionTarget(targets, campaign->targetStructure);
+		for (int j = 0; j < campaign->nInjections; j++)
+		{
+			plan[nPlanned].index = nPlanned;
+			drawInjection(campaign, inj, nanoGoldenEx, &plan[nPlanned++]);
+		}
+		free(inj);
+	}
+
+	return nPlanned;
+}
+
+/**
+ * Pick the campaign of the next injection to start, among the ones with
+ * injections left: the first one of the input file (ORDER_FIFO) or the one
+ * with the longest expected run (ORDER_LPT). The expected run of a campaign
+ * without completed runs lasts unknownNs.
+ */
+static int pickNextCampaign(const injectionCampaign_t *injectionCampaigns, int nInjectionCampaigns,
+							const int *nStarted, int order, unsigned long long unknownNs)
+{
+	int next = -1;
+	unsigned long long nextNs = 0;
+
+	for (int i = 0; i < nInjectionCampaigns; ++i)
+	{
+		const injectionCampaign_t *campaign = injectionCampaigns + i;
+		if (nStarted[i] >= campaign->nInjections)
+			continue;
+
+		if (order == ORDER_FIFO)
+			return i;
+
+		unsigned long long expectedNs = unknownNs;
+		if (campaign->durations.count > 0)
+			expectedNs = campaign->durations.sumNs / campaign->durations.count;
+
+		// ties keep the order of the input file
+		if (next < 0 || expectedNs > nextNs)
+		{
+			next = i;
+			nextNs = expectedNs;
+		}
+	}
+
+	return next;
+}
+
+/**
+ * Add the duration of a completed run to the statistics of its campaign.
+ */
+static void updateCampaignDurations(injectionCampaign_t *campaign, unsigned long durationNs)
+{
+	campaign->durations.count++;
+	campaign->durations.sumNs += durationNs;
+	if (durationNs > campaign->durations.maxNs)
+		campaign->durations.maxNs = durationNs;
+}
+
+/**
+ * Execute the --worker command: run the injections leased by a coordinator.
+ * 
+ * Expected parameters:
+ * ./sim --worker host:port|unix:/path [-j=N] [--spawn=exec|zygote] [--pin] [--reserve-cpus=LIST] [--virtual-time] [--trigger=tick[+K]] [--spin=US] [--injector-cpus=LIST] [--record=DIR] [--irq-load=SPEC]
+ */
+static void execCmdWorker(int argc, char **argv)
+{
+	if (argc < 3 || argc > 13)
+	{
+		ERR_PRINT("Invalid number of arguments for %s.\n", CMD_WORKER);
+		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
+	}
+
+	int parallelism = 1;
+	int spawnMode = SPAWN_EXEC;
+	int pin = 0;
+	const char *reservedCpus = NULL;
+	unsigned long nSwitches;
+
+	for (int i = 3; i < argc; i++)
+	{
+		if (strncmp(argv[i], "-j=", 3) == 0)
+			parallelism = atol(argv[i] + 3);
+		else if (strcmp(argv[i], "--spawn=exec") == 0)
+			spawnMode = SPAWN_EXEC;
+		else if (strcmp(argv[i], "--spawn=zygote") == 0)
+			spawnMode = SPAWN_ZYGOTE;
+		else if (strcmp(argv[i], "--pin") == 0)
+			pin = 1;
+		else if (strncmp(argv[i], "--reserve-cpus=", 15) == 0)
+			reservedCpus = argv[i] + 15;
+		else if (strcmp(argv[i], "--virtual-time") == 0)
+		{
+			if (enableVirtualTime() != VTIME_SUCCESS)
+				exit(GENERIC_ERROR_EXIT_CODE);
+		}
+		else if (strncmp(argv[i], "--trigger=tick", 14) == 0 &&
+				 parseTriggerSwitches(argv[i] + 14, &nSwitches) == 0)
+		{
+			if (enableTickTrigger(nSwitches) != TRIGGER_SUCCESS)
+				exit(GENERIC_ERROR_EXIT_CODE);
+		}
+		else if (strncmp(argv[i], "--spin=", 7) == 0)
+		{
+			if (setSpinMargin(strtoul(argv[i] + 7, NULL, 10) * 1000) != SLEEP_SUCCESS)
+				exit(GENERIC_ERROR_EXIT_CODE);
+		}
+		else if (strncmp(argv[i], "--injector-cpus=", 16) == 0)
+		{
+			if (setInjectorCpus(argv[i] + 16) != AFFINITY_SUCCESS)
+				exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+		else if (strncmp(argv[i], "--record=", 9) == 0)
+		{
+			if (isVirtualTime() || enableScheduleRecording(argv[i] + 9) != REPLAY_SUCCESS)
+			{
+				ERR_PRINT("--record requires the wall clock.\n");
+				exit(INVALID_PARAMETERS_EXIT_CODE);
+			}
+		}
+		else if (strncmp(argv[i], "--irq-load=", 11) == 0)
+		{
+			if (enableIrqLoad(argv[i] + 11) != IRQLOAD_SUCCESS)
+				exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+		else
+		{
+			ERR_PRINT("Unrecognized option %s for %s.\n", argv[i], CMD_WORKER);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+
+	if (parallelism < 1 || (reservedCpus && !pin))
+	{
+		ERR_PRINT("Invalid parallelism or CPU placement for %s.\n", CMD_WORKER);
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (isIrqLoad() && isScheduleRecording())
+	{
+		ERR_PRINT("--irq-load is not supported with --record.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	// the instances of every worker compare their output with the local golden run
+	unsigned long nanoGoldenEx = 0;
+	if (readGoldenExecutionTime(&nanoGoldenEx) != 0)
+	{
+		ERR_PRINT("Couldn't open golden execution results file.\n");
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	spawner.goldenExecTime = nanoGoldenEx;
+
+	if (pin && enableCpuPlacement(reservedCpus) != AFFINITY_SUCCESS)
+	{
+		ERR_PRINT("Couldn't enable the CPU placement of the instances.\n");
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	if (spawnMode == SPAWN_ZYGOTE && startFreeRTOSZygote(&setupZygote, &runZygoteInjection) < 0)
+	{
+		ERR_PRINT("Couldn't create the zygote process.\n");
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	int ret = runDistributedWorker(argv[2], parallelism, spawnMode, argv[0]);
+
+	if (spawnMode == SPAWN_ZYGOTE)
+		stopFreeRTOSZygote();
+
+	if (ret != DISTRIBUTED_SUCCESS)
+	{
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+}
+
+/**
+ * Execute the --bench-pinning command: measure the variance of the golden
+ * execution time of parallel instances, with and without CPU placement.
+ * 
+ * Each run is a --run instance whose injection time is past the end of the
+ * simulation, i.e. a golden run that is classified like an injection run.
+ * 
+ * Expected parameters:
+ * ./sim --bench-pinning [-j=N] [--runs=R] [--reserve-cpus=LIST]
+ */
+static void execCmdBenchPinning(int argc, char **argv)
+{
+	if (argc > 5)
+	{
+		ERR_PRINT("Invalid number of arguments for %s.\n", CMD_BENCH_PINNING);
+		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
+	}
+
+	int parallelism = 1;
+	int nRuns = 100;
+	const char *reservedCpus = NULL;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (strncmp(argv[i], "-j=", 3) == 0)
+			parallelism = atol(argv[i] + 3);
+		else if (strncmp(argv[i], "--runs=", 7) == 0)
+			nRuns = atol(argv[i] + 7);
+		else if (strncmp(argv[i], "--reserve-cpus=", 15) == 0)
+			reservedCpus = argv[i] + 15;
+		else
+		{
+			ERR_PRINT("Unrecognized option %s for %s.\n", argv[i], CMD_BENCH_PINNING);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+
+	unsigned long nanoGoldenEx = 0;
+	if (parallelism < 1 || nRuns < 1 || readGoldenExecutionTime(&nanoGoldenEx) != 0)
+	{
+		ERR_PRINT("Invalid parameters, or golden execution results file not found.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	// all the runs belong to a campaign on the first target, never injected
+	injectionCampaign_t campaign;
+	memset(&campaign, 0, sizeof(campaign));
+	campaign.targetStructure = targets->name;
+	campaign.nInjections = nRuns;
+
+	injection_t *plan = (injection_t *)calloc(nRuns, sizeof(injection_t));
+	unsigned int *exitCodes = (unsigned int *)calloc(nRuns, sizeof(unsigned int));
+	for (int i = 0; i < nRuns; i++)
+	{
+		plan[i].campaign = &campaign;
+		plan[i].injTime = 3 * nanoGoldenEx;
+	}
+
+	fprintf(stdout, "%d golden runs, %d in parallel, golden time %.3f ms\n", nRuns, parallelism, nanoGoldenEx / 1e6);
+
+	for (int pinned = 0; pinned <= 1; pinned++)
+	{
+		if (pinned && enableCpuPlacement(reservedCpus) != AFFINITY_SUCCESS)
+		{
+			ERR_PRINT("Couldn't enable the CPU placement of the instances.\n");
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		resetRunTime();
+		memset(&campaign.res, 0, sizeof(injectionResults_t));
+
+		if (runShardedCampaign(plan, nRuns, parallelism, 1, SPAWN_EXEC, argv[0], exitCodes, NULL, NULL) != SHARDS_SUCCESS)
+		{
+			ERR_PRINT("Couldn't run the benchmark.\n");
+			exit(GENERIC_ERROR_EXIT_CODE);
+		}
+
+		for (int i = 0; i < nRuns; i++)
+			updateCampaignResults(&campaign, exitCodes[i]);
+
+		latencyStats_t runTime;
+		getRunTime(&runTime);
+
+		double mean = runTime.count ? (double)runTime.sumNs / runTime.count : 0;
+		double variance = runTime.count ? runTime.sumSquaresNs / runTime.count - mean * mean : 0;
+		double stddev = variance > 0 ? sqrt(variance) : 0;
+
+		fprintf(stdout, "Pinning %-3s %6lu runs, mean %9.3f ms, stddev %8.3f ms (%5.2f%%), min %9.3f ms, max %9.3f ms, silent %d, delay %d, other %d\n",
+				pinned ? "on" : "off", runTime.count,
+				mean / 1e6, stddev / 1e6, mean > 0 ? 100.0 * stddev / mean : 0.0,
+				runTime.minNs / 1e6, runTime.maxNs / 1e6,
+				campaign.res.nSilent, campaign.res.nDelay,
+				campaign.res.nError + campaign.res.nHang + campaign.res.nCrash);
+	}
+
+	disableCpuPlacement();
+
+	free(plan);
+	free(exitCodes);
+}
+
+/**
+ * Execute the --bench-switch command: measure the cost of a context switch
+ * with the port of the kernel the simulator is built with (see SIM_POSIX_PORT
+ * in CMakeLists.txt), between two tasks that yield to each other, then
+ * notify each other.
+ *
+ * Expected parameters:
+ * ./sim --bench-switch [--rounds=N]
+ */
+static void execCmdBenchSwitch(int argc, char **argv)
+{
+	if (argc > 3)
+	{
+		ERR_PRINT("Invalid number of arguments for %s.\n", CMD_BENCH_SWITCH);
+		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
+	}
+
+	unsigned long nRounds = 100000;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--rounds=", 9) == 0)
+			nRounds = strtoul(argv[i] + 9, NULL, 10);
+		else
+		{
+			ERR_PRINT("Unrecognized option %s for %s.\n", argv[i], CMD_BENCH_SWITCH);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+
+	if (nRounds < 1)
+	{
+		ERR_PRINT("Invalid number of rounds.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	prvInitialiseHeap();
+	switch_bench_setup(nRounds);
+	vTaskStartScheduler();
+
+	switchBenchResults_t results;
+	switch_bench_results(&results);
+
+	fprintf(stdout, "Port %s, %lu rounds: yield %.1f ns per switch, notification %.1f ns per switch, queue %.1f ns per switch\n",
+			SIM_KERNEL_PORT, results.nRounds,
+			results.yieldNs / (2.0 * results.nRounds),
+			results.notifyNs / (2.0 * results.nRounds),
+			results.queueNs / (2.0 * results.nRounds));
+
+	exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+}
+
+/**
+ * Execute the --bench-irq command: measure the latency of the dispatch of
+ * the simulated interrupts, and the throughput of their handlers, with the
+ * port of the kernel the simulator is built with, while a task keeps the
+ * CPU busy under the interrupt load (see irqload.h).
+ *
+ * Expected parameters:
+ * ./sim --bench-irq [--irq-load=SPEC] [--duration=MS]
+ */
+static void execCmdBenchIrq(int argc, char **argv)
+{
+	if (argc > 4)
+	{
+		ERR_PRINT("Invalid number of arguments for %s.\n", CMD_BENCH_IRQ);
+		exit(INVALID_NUMBER_OF_PARAMETERS_EXIT_CODE);
+	}
+
+	const char *irqLoad = "queue:periodic:1000,semaphore:poisson:1000";
+	unsigned long durationMs = 1000;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--irq-load=", 11) == 0)
+			irqLoad = argv[i] + 11;
+		else if (strncmp(argv[i], "--duration=", 11) == 0)
+			durationMs = strtoul(argv[i] + 11, NULL, 10);
+		else
+		{
+			ERR_PRINT("Unrecognized option %s for %s.\n", argv[i], CMD_BENCH_IRQ);
+			exit(INVALID_PARAMETERS_EXIT_CODE);
+		}
+	}
+
+	if (durationMs < 1)
+	{
+		ERR_PRINT("Invalid duration.\n");
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	if (enableIrqLoad(irqLoad) != IRQLOAD_SUCCESS)
+	{
+		exit(INVALID_PARAMETERS_EXIT_CODE);
+	}
+
+	prvInitialiseHeap();
+	if (setupIrqLoad() != IRQLOAD_SUCCESS)
+	{
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+	isr_bench_setup(durationMs * 1000000ull);
+	startIrqLoad();
+	vTaskStartScheduler();
+
+	isrBenchResults_t results;
+	isr_bench_results(&results);
+
+	fprintf(stdout, "Port %s, busy for %.1f ms:\n", SIM_KERNEL_PORT, results.elapsedNs / 1e6);
+
+	unsigned long nServed = 0;
+	for (int i = 0; i < countIrqLoadSources(); i++)
+	{
+		irqLoadStats_t stats;
+		getIrqLoadStats(i, &stats);
+		nServed += stats.served;
+
+		// a raise while its interrupt is pending is merged with it
+		fprintf(stdout, "  interrupt %d (%s, %s, %.0f Hz): raised %lu, served %lu (%lu merged), dropped %lu, consumed %lu, latency mean %llu ns, p50 %llu ns, p99 %llu ns, max %llu ns\n",
+				IRQLOAD_FIRST_INTERRUPT + i, stats.kind, stats.process, stats.rateHz,
+				stats.raised, stats.served, stats.raised - min(stats.served, stats.raised), stats.dropped, stats.consumed,
+				stats.latency.meanNs, stats.latency.p50Ns, stats.latency.p99Ns, stats.latency.maxNs);
+	}
+
+	fprintf(stdout, "Throughput: %.0f interrupts served per second\n", results.elapsedNs ? nServed * 1e9 / results.elapsedNs : 0.0);
+
+	exit(SUCCESSFUL_EXECUTION_EXIT_CODE);
+}
+
+/**
+ * Draw the parameters of the next injection of a campaign: the byte and the bit
+ * of the target to flip and the injection time, according to the distribution
+ * of the campaign.
+ */
+static void drawInjection(injectionCampaign_t *campaign, const thData_t *inj, unsigned long nanoGoldenEx, injection_t *injection)
+{
+	target_t *injTarget = inj->target;
+
+	unsigned long offsetByte;
+	if (inj->isList)
+	{
+		offsetByte = rand() % sizeof(ListItem_t); //select byte to inject
+	}
+	else if (IS_TYPE_POINTER(inj->target->type) && !inj->isPointer)
+	{
+		offsetByte = rand() % (sizeof(char *)); //select byte to inject
+	}
+	else
+	{
+		offsetByte = rand() % injTarget->size; //select byte to inject
+	}
+
+	unsigned long offsetBit = rand() % 8; //select bit to inject
+	unsigned long injTime;
+
+	// an event occurrence is not bounded by the golden run
+	if (campaign->eventPoint)
+		nanoGoldenEx = campaign->medTimeRange + campaign->variance;
+
+	double total = 0;
+
+	// pick a distribution
+	switch (campaign->distribution)
+	{
+	case 'g':
+
+		//gaussian distribution approximated starting from the Irwin-Hall distribution
+		for (int gaussian = 0; gaussian < 12; ++gaussian)
+		{
+			total += rand() % 1000;
+		}
+		total = (total - 6000) / 1000;
+
+		injTime = total * campaign->variance / 6 + campaign->medTimeRange;
+
+		if (injTime < 0)
+		{
+			injTime = injTime + campaign->variance / 2;
+		}
+
+		break;
+
+	case 't':
+
+		//triangular distribution
+		for (int gaussian = 0; gaussian < 12; ++gaussian)
+		{
+			total += rand() % 1000;
+		}
+		total = (total - 1000) / 1000;
+
+		injTime = total * campaign->variance + campaign->medTimeRange;
+
+		if (injTime < 0)
+		{
+			injTime = injTime + campaign->variance / 2;
+		}
+
+		break;
+
+	case 'u':
+	default:
+		injTime = campaign->medTimeRange;
+
+		// compute the width of the injection time range
+		int lowerWidth = min(campaign->medTimeRange, campaign->variance);
+		int upperWidth = min(campaign->variance, nanoGoldenEx - campaign->medTimeRange);
+		int range = max(1, lowerWidth + upperWidth);
+		injTime = (rand() % range) - lowerWidth + (signed)campaign->medTimeRange;
+	}
+
+	if (campaign->eventPoint)
+		injTime = campaign->eventPoint | EVENT_POINT_OCCURRENCE(max(injTime, 1));
+
+	injection->campaign = campaign;
+	injection->injTime = injTime;
+	injection->offsetByte = offsetByte;
+	injection->offsetBit = offsetBit;
+}
+
+/**
+ * Classify the exit code of a simulation and update the campaign results.
+ */
+static void updateCampaignResults(injectionCampaign_t *campaign, unsigned int exitCode)
+{
+	switch (exitCode)
+	{
+	case EXECUTION_RESULT_HANG_EXIT_CODE:
+		campaign->res.nHang++;
+		break;
+	case EXECUTION_RESULT_ERROR_EXIT_CODE:
+		campaign->res.nError++;
+		break;
+	case EXECUTION_RESULT_DELAY_EXIT_CODE:
+		campaign->res.nDelay++;
+		break;
+	case EXECUTION_RESULT_SILENT_EXIT_CODE:
+		campaign->res.nSilent++;
+		break;
+	case EXECUTION_RESULT_CRASH_EXIT_CODE:
+	default:
+		// printf("%u\n", exitCode);
+		campaign->res.nCrash++;
+	}
+}
+
+/**
+ * Master instance of the fork server: a golden run that takes snapshots
+ * of itself. Injection instances forked from a snapshot continue here
+ * once their scheduler ends.
+ */
+static void runForkServerMaster(void)
+{
+	prvInitialiseHeap();
+
+	DEBUG_PRINT("Calling mainSetup...\n");
+	mainSetup();
+	DEBUG_PRINT("Call to mainSetup completed\n");
+
+	// snapshot before the scheduler starts
+	forkServerStart();
+
+	DEBUG_PRINT("Calling mainRun...\n");
+	mainRun();
+	DEBUG_PRINT("Call to mainRun completed\n");
+
+	classifySimulation(&spawner.injectionArgs);
+}
+
+static void startForkServerInjection(const injection_t *injection, unsigned long snapshotTime)
+{
+	// same random sequence as a freshly started --run instance
+	srand(1);
+	resetPhases();
+
+	beginPhase(PHASE_TARGET);
+	thData_t *inj = getInjectionTarget(targets, injection->campaign->targetStructure);
+	endPhase(PHASE_TARGET);
+	if (!inj)
+	{
+		ERR_PRINT("Cannot find the injection target %s\n", injection->campaign->targetStructure);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	spawner.injectionArgs = *inj;
+	free(inj);
+
+	injTime = injection->injTime;
+	spawner.injectionArgs.injTime = injection->injTime;
+	spawner.injectionArgs.offsetByte = injection->offsetByte;
+	spawner.injectionArgs.offsetBit = injection->offsetBit;
+	spawner.injectionArgs.timeoutNs = 3 * spawner.goldenExecTime;
+	spawner.injectionArgs.startTime = snapshotTime;
+
+	launchInjector(&spawner.injectionArgs, NULL);
+}
+
+static void collectPlannedResult(const injection_t *injection, unsigned int exitCode)
+{
+	collectTimedResult(injection, exitCode, 0);
+}
+
+/**
+ * Collect the outcome of a planned injection whose run lasted durationNs
+ * (0 if it was not measured).
+ */
+static void collectTimedResult(const injection_t *injection, unsigned int exitCode, unsigned long durationNs)
+{
+	spawner.nCompleted++;
+	DEBUG_PRINT("Injection n. %lu/%lu completed with exit code %u...\n\n", spawner.nCompleted, spawner.nTotal, exitCode);
+
+	updateCampaignResults(injection->campaign, exitCode);
+	journalResult(injection, exitCode);
+	cacheResult(injection, exitCode, durationNs ? durationNs : estimateRunTime());
+
+	// the record of the run, if any, was published before its exit
+	drainRunRecords(0);
+
+	if (spawner.pgBarEnabled)
+	{
+		printProgressBar(((double)spawner.nCompleted / spawner.nTotal));
+	}
+}
+
+/**
+ * Replay the outcome of an injection completed before the campaign was resumed.
+ */
+static void collectJournaledResult(const injection_t *injection, unsigned int exitCode)
+{
+	spawner.settled[injection->index] = 1;
+	spawner.nCompleted++;
+
+	updateCampaignResults(injection->campaign, exitCode);
+}
+
+/**
+ * Outcome of a sharded campaign, stored by a manager thread: the campaign
+ * results are merged once all the shards are done.
+ */
+static void collectShardedResult(const injection_t *injection, unsigned int exitCode)
+{
+	journalResult(injection, exitCode);
+	cacheResult(injection, exitCode, estimateRunTime());
+}
+
+/**
+ * Answer a planned injection from the result cache, if it holds its outcome.
+ */
+static int settleCachedResult(const injection_t *injection)
+{
+	unsigned int exitCode;
+	unsigned long durationNs;
+
+	if (!lookupCachedResult(injection, &exitCode, &durationNs))
+	{
+		return 0;
+	}
+
+	spawner.settled[injection->index] = 1;
+	spawner.nCompleted++;
+	spawner.nCacheHits++;
+	spawner.cacheSavedNs += durationNs;
+
+	updateCampaignResults(injection->campaign, exitCode);
+	journalResult(injection, exitCode);
+
+	return 1;
+}
+
+/**
+ * Wall-clock run time of an instance that was not measured, called once it
+ * completed: the time the slots have been busy so far, shared among the runs
+ * they completed. The golden time is no measure of it on the virtual clock.
+ * May be called by the manager threads of a sharded campaign.
+ */
+static unsigned long estimateRunTime(void)
+{
+	unsigned long nRuns = __atomic_add_fetch(&spawner.nEstimated, 1, __ATOMIC_RELAXED);
+	unsigned long long elapsedNs = phaseClockNs() - spawner.runsStartNs;
+
+	return (unsigned long)(elapsedNs * spawner.nSlots / nRuns);
+}
+
+/**
+ * Report the hits of the result cache, if any, and close it.
+ */
+static void printResultCache(FILE *fp)
+{
+	unsigned long nEntries = getCachedResults();
+	closeResultCache();
+
+	if (nEntries == 0 && spawner.nCacheHits == 0)
+	{
+		return;
+	}
+
+	fprintf(fp, "Result cache    %lu hits of %lu planned injections (%.1f%%), %.2f CPU-seconds saved, %lu outcomes cached\n",
+			spawner.nCacheHits, spawner.nTotal, spawner.nTotal ? 100.0 * spawner.nCacheHits / spawner.nTotal : 0.0,
+			spawner.cacheSavedNs / 1e9, nEntries);
+}
+
+/**
+ * Progress of a sharded campaign, reported by the planner thread.
+ * spawner.nCompleted only counts the injections completed by the journal.
+ */
+static void printShardedProgress(unsigned long nCompleted)
+{
+	drainRunRecords(0);
+
+	if (spawner.pgBarEnabled)
+	{
+		printProgressBar(((double)(spawner.nCompleted + nCompleted) / spawner.nTotal));
+	}
+}
+
+/**
+ * Publish the record of the run of an instance, before it exits with exitCode.
+ */
+static void publishOutcome(const thData_t *injectionArgs, unsigned int exitCode)
+{
+	runRecord_t record;
+	memset(&record, 0, sizeof(record));
+
+	record.pid = (int)getpid();
+	record.exitCode = exitCode;
+	if (injectionArgs->target)
+		strncpy(record.target, injectionArgs->target->name, sizeof(record.target) - 1);
+	record.injTime = injectionArgs->injTime;
+	record.offsetByte = injectionArgs->offsetByte;
+	record.offsetBit = injectionArgs->offsetBit;
+	record.performedInjTime = performedInjTime;
+	record.performedInjTick = performedInjTick;
+	sscanf(loggerTrace[TRACELEN - 1], "%lu", &record.endTime);
+	record.tickCount = (unsigned long)xTaskGetTickCount();
+	getTickDrift(&record.missedTicks, &record.maxTickLagNs);
+	record.nContextSwitches = loggerContextSwitches;
+	record.isrReceived = loggerReceivedISR != 0;
+	getPhaseDurations(record.phaseNs);
+
+	publishRunRecord(&record);
+
+	// the schedule log of the run is complete as well
+	closeScheduleLog(exitCode);
+}
+
+/**
+ * Add a run record to the statistics of the campaign, and to the
+ * --records= file.
+ */
+static void collectRunRecord(const runRecord_t *record)
+{
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		if (record->phaseNs[phase])
+			recordPhase(phase, record->phaseNs[phase]);
+	}
+
+	spawner.nRecords++;
+	spawner.sumContextSwitches += record->nContextSwitches;
+	spawner.nIsrReceived += record->isrReceived;
+
+	if (record->missedTicks)
+	{
+		spawner.nDriftedRuns++;
+		spawner.sumMissedTicks += record->missedTicks;
+		spawner.maxMissedTicks = max(spawner.maxMissedTicks, record->missedTicks);
+	}
+	spawner.maxTickLagNs = max(spawner.maxTickLagNs, record->maxTickLagNs);
+
+	if (IS_EVENT_POINT(record->injTime))
+	{
+		// an event point has no latency: whether its occurrence was reached matters
+		spawner.nEventPoints++;
+		if (record->performedInjTime)
+		{
+			spawner.nEventsReached++;
+			spawner.nInjected++;
+		}
+	}
+	else if (record->performedInjTime)
+	{
+		// how late the injector flipped the bit
+		unsigned long long latencyNs = record->performedInjTime > record->injTime ? record->performedInjTime - record->injTime : 0;
+		spawner.nInjected++;
+		spawner.nTimedInjected++;
+		spawner.sumInjLatencyNs += latencyNs;
+		spawner.maxInjLatencyNs = max(spawner.maxInjLatencyNs, latencyNs);
+		recordInjectionLatency(latencyNs);
+		addTargetLatency(record->target, latencyNs);
+
+		// the tick trigger flips at the requested tick, unless it waits for task switches
+		unsigned long requestedTick = getTriggerTick(record->injTime);
+		if (isTickTrigger() && record->performedInjTick > requestedTick)
+		{
+			unsigned long lateTicks = record->performedInjTick - requestedTick;
+			spawner.nLateTriggers++;
+			spawner.maxLateTicks = max(spawner.maxLateTicks, lateTicks);
+		}
+	}
+
+	if (spawner.recordsFile)
+	{
+		fprintf(spawner.recordsFile, "%d,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d,%u\n",
+				record->pid, record->target, record->injTime, record->offsetByte, record->offsetBit,
+				record->performedInjTime, record->performedInjTick, record->endTime, record->tickCount,
+				record->missedTicks, record->maxTickLagNs, record->nContextSwitches,
+				record->isrReceived, record->exitCode);
+	}
+}
+
+/**
+ * Add the latency of an injection to the statistics of its target.
+ */
+static void addTargetLatency(const char *name, unsigned long long latencyNs)
+{
+	targetLatency_t *target = NULL;
+	for (int i = 0; i < spawner.nTargetLatencies && !target; i++)
+	{
+		if (strcmp(spawner.targetLatencies[i].target, name) == 0)
+			target = &spawner.targetLatencies[i];
+	}
+
+	if (!target)
+	{
+		targetLatency_t *targets = (targetLatency_t *)realloc(spawner.targetLatencies, (spawner.nTargetLatencies + 1) * sizeof(targetLatency_t));
+		if (!targets)
+			return;
+
+		spawner.targetLatencies = targets;
+		target = &targets[spawner.nTargetLatencies++];
+		memset(target, 0, sizeof(targetLatency_t));
+		strncpy(target->target, name, sizeof(target->target) - 1);
+	}
+
+	target->count++;
+	target->sumNs += latencyNs;
+	target->maxNs = max(target->maxNs, latencyNs);
+}
+
+/**
+ * Consume the records published so far.
+ */
+static void drainRunRecords(int final)
+{
+	// the instances forked later must not inherit lines still in the buffer
+	if (consumeRunRecords(&collectRunRecord, final) > 0 && spawner.recordsFile)
+		fflush(spawner.recordsFile);
+}
+
+/**
+ * Consume the records left in the ring and print their summary.
+ */
+static void printRunRecords(FILE *fp)
+{
+	drainRunRecords(1);
+	unsigned long nDropped = getDroppedRunRecords();
+
+	if (spawner.recordsFile)
+	{
+		fclose(spawner.recordsFile);
+		spawner.recordsFile = NULL;
+	}
+
+	destroyRunRecordRing();
+
+	if (spawner.nRecords == 0)
+		return;
+
+	fprintf(fp, "Run records %6lu received, %lu dropped, %lu injected (%lu timed, latency mean %.1f us, max %.1f us), %.1f context switches per run, ISR served in %.1f%% of the runs\n",
+			spawner.nRecords, nDropped, spawner.nInjected, spawner.nTimedInjected,
+			spawner.nTimedInjected ? spawner.sumInjLatencyNs / (1000.0 * spawner.nTimedInjected) : 0.0,
+			spawner.maxInjLatencyNs / 1000.0,
+			(double)spawner.sumContextSwitches / spawner.nRecords,
+			100.0 * spawner.nIsrReceived / spawner.nRecords);
+
+	phaseStats_t latency;
+	getInjectionLatencyStats(&latency);
+	if (latency.count && spawner.reportLatency)
+	{
+		fprintf(fp, "Latency     %6lu injections, p50 %10.1f us, p90 %10.1f us, p99 %10.1f us, max %10.1f us\n",
+				latency.count, latency.p50Ns / 1000.0, latency.p90Ns / 1000.0, latency.p99Ns / 1000.0, latency.maxNs / 1000.0);
+	}
+
+	for (int i = 0; spawner.reportLatency && i < spawner.nTargetLatencies; i++)
+	{
+		const targetLatency_t *target = &spawner.targetLatencies[i];
+		fprintf(fp, "  %-30s %6lu injections, latency mean %10.1f us, max %10.1f us\n",
+				target->target, target->count, target->sumNs / (1000.0 * target->count), target->maxNs / 1000.0);
+	}
+
+	free(spawner.targetLatencies);
+	spawner.targetLatencies = NULL;
+	spawner.nTargetLatencies = 0;
+
+	if (spawner.nEventPoints)
+	{
+		fprintf(fp, "Events      %6lu runs triggered by a kernel event, %lu reached their occurrence (%.1f%%)\n",
+				spawner.nEventPoints, spawner.nEventsReached, 100.0 * spawner.nEventsReached / spawner.nEventPoints);
+	}
+
+	if (isTickTrigger())
+	{
+		fprintf(fp, "Triggers    %6lu at tick N + %lu switches: %lu at the requested tick, %lu later (max %lu ticks)\n",
+				spawner.nTimedInjected, getTriggerSwitches(), spawner.nTimedInjected - spawner.nLateTriggers,
+				spawner.nLateTriggers, spawner.maxLateTicks);
+	}
+
+	if (!isVirtualTime())
+	{
+		fprintf(fp, "Ticks       %6lu runs missed ticks (%lu in total, max %lu per run), max delay of a tick %.1f us\n",
+				spawner.nDriftedRuns, spawner.sumMissedTicks, spawner.maxMissedTicks, spawner.maxTickLagNs / 1000.0);
+	}
+}
+
+/**
+ * With --phases, print the percentiles of the phases of the runs, and write
+ * them to the --phases= file if any.
+ */
+static void printPhaseTimings(FILE *fp)
+{
+	if (!spawner.reportPhases)
+		return;
+
+	FILE *csv = NULL;
+	if (spawner.phasesPath)
+	{
+		csv = fopen(spawner.phasesPath, "w");
+		if (csv)
+		{
+			fprintf(csv, "phase,count,meanNs,p50Ns,p90Ns,p99Ns,maxNs\n");
+		}
+		else
+		{
+			ERR_PRINT("Couldn't open %s.\n", spawner.phasesPath);
+		}
+	}
+
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		phaseStats_t stats;
+		getPhaseStats(phase, &stats);
+		if (stats.count == 0)
+			continue;
+
+		fprintf(fp, "Phase %-14s %6lu runs, p50 %10.1f us, p90 %10.1f us, p99 %10.1f us, max %10.1f us\n",
+				getPhaseName(phase), stats.count,
+				stats.p50Ns / 1000.0, stats.p90Ns / 1000.0, stats.p99Ns / 1000.0, stats.maxNs / 1000.0);
+
+		if (csv)
+			fprintf(csv, "%s,%lu,%llu,%llu,%llu,%llu,%llu\n", getPhaseName(phase), stats.count,
+					stats.meanNs, stats.p50Ns, stats.p90Ns, stats.p99Ns, stats.maxNs);
+	}
+
+	if (csv)
+		fclose(csv);
+}
+
+/**
+ * Zygote setup: everything an instance does before starting the scheduler,
+ * except for the injection itself.
+ */
+static void setupZygote(void)
+{
+	loadGoldenOutput();
+	qsort_bench_preload();
+
+	prvInitialiseHeap();
+
+	DEBUG_PRINT("Calling mainSetup...\n");
+	mainSetup();
+	DEBUG_PRINT("Call to mainSetup completed\n");
+}
+
+static void runZygoteInjection(const char *target, unsigned long time, unsigned long offsetByte, unsigned long offsetBit)
+{
+	// same random sequence as a freshly started --run instance
+	srand(1);
+	resetPhases();
+
+	beginPhase(PHASE_TARGET);
+	thData_t *injection = getInjectionTarget(targets, target);
+	endPhase(PHASE_TARGET);
+	if (!injection)
+	{
+		ERR_PRINT("Cannot find the injection target %s\n", target);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
+
+	injTime = time;
+	injection->injTime = time;
+	injection->offsetByte = offsetByte;
+	injection->offsetBit = offsetBit;
+	injection->timeoutNs = 3 * spawner.goldenExecTime;
+
+	launchInjector(injection, NULL);
+	notifyFreeRTOSInstanceReady();
+
+	DEBUG_PRINT("Calling mainRun...\n");
+	beginPhase(PHASE_START);
+	mainRun();
+	endPhase(PHASE_STOP);
+	DEBUG_PRINT("Call to mainRun completed\n");
+
+	classifySimulation(injection);
+}
+
+/**
+ * Worker setup: everything that does not depend on the injection. FreeRTOS
+ * is initialised by each run, after the worker restored its globals.
+ */
+static void setupWorker(void)
+{
+	loadGoldenOutput();
+	qsort_bench_preload();
+}
+
+static unsigned int runWorkerInjection(const injection_t *injection)
+{
+	// same random sequence as a freshly started --run instance
+	srand(1);
+	resetPhases();
+
+	beginPhase(PHASE_TARGET);
+	thData_t *inj = getInjectionTarget(targets, injection->campaign->targetStructure);
+	endPhase(PHASE_TARGET);
+	if (!inj)
 	{
-		// For each injection campaign
-		injectionCampaign_t *campaign = injectionCampaigns + i;
-		memset(&campaign->res, 0, sizeof(injectionResults_t));
-
-		// at this stage, inj cannot be null
-		thData_t *inj = getInjectionTarget(targets, campaign->targetStructure);
+		ERR_PRINT("Cannot find the injection target %s\n", injection->campaign->targetStructure);
+		exit(GENERIC_ERROR_EXIT_CODE);
+	}
 
-		int j = 0; // index inside the campaign
-		int stop = 0;
+	injTime = injection->injTime;
+	inj->injTime = injection->injTime;
+	inj->offsetByte = injection->offsetByte;
+	inj->offsetBit = injection->offsetBit;
+	inj->timeoutNs = 3 * spawner.goldenExecTime;
 
-		while (!stop)
-		{
-			if (pgBarEnabled)
-			{
-				/* Progress bar */
-				printProgressBar(((double)nCurrentInjection / nTotalInjections));
-			}
+	beginPhase(PHASE_SETUP);
+	prvInitialiseHeap();
 
-			while (!stop && full < parallelism)
-			{
-				// For each injection in a campaign
-				nCurrentInjection++;
-				DEBUG_PRINT("Running injection n. %lu/%lu...\n", nCurrentInjection, nTotalInjections);
+	DEBUG_PRINT("Calling mainSetup...\n");
+	mainSetup();
+	DEBUG_PRINT("Call to mainSetup completed\n");
+	endPhase(PHASE_SETUP);
 
-				target_t *injTarget = inj->target;
+	thread_t injectorThread;
+	launchInjector(inj, &injectorThread);
+	notifyWorkerReady();
 
-				unsigned long offsetByte;
-				if (inj->isList)
-				{
-					offsetByte = rand() % sizeof(ListItem_t); //select byte to inject
-				}
-				else if (IS_TYPE_POINTER(inj->target->type) && !inj->isPointer)
-				{
-					offsetByte = rand() % (sizeof(char *)); //select byte to inject
-				}
-				else
-				{
-					offsetByte = rand() % injTarget->size; //select byte to inject
-				}
+	DEBUG_PRINT("Calling mainRun...\n");
+	beginPhase(PHASE_START);
+	mainRun();
+	endPhase(PHASE_STOP);
+	DEBUG_PRINT("Call to mainRun completed\n");
 
-				unsigned long offsetBit = rand() % 8; //select bit to inject
-				unsigned long injTime;
+	// a --run instance terminates here: no injection past the end of the run
+	cancelThread(&injectorThread);
 
-				double total = 0;
+	beginPhase(PHASE_CHECK);
+	unsigned int exitCode = classifyOutcome(inj);
+	endPhase(PHASE_CHECK);
+	publishOutcome(inj, exitCode);
+	free(inj);
 
-				// pick a distribution
-				switch (campaign->distribution)
-				{
-				case 'g':
+	return exitCode;
+}
 
-					//gaussian distribution approximated starting from the Irwin-Hall distribution
-					for (int gaussian = 0; gaussian < 12; ++gaussian)
-					{
-						total += rand() % 1000;
-					}
-					total = (total - 6000) / 1000;
+#ifdef SIM_SHARED_KERNEL
+/**
+ * Pristine image of this copy of the shared kernel, saved by its first run.
+ */
+static dataImage_t instanceImage;
 
-					injTime = total * campaign->variance / 6 + campaign->medTimeRange;
+/**
+ * Entry point of a copy of the shared kernel, see instance.h: the same as
+ * runWorkerInjection, with the worker setup done by the first call.
+ */
+unsigned int simRunInstance(int instance, const char *target, unsigned long time,
+							unsigned long offsetByte, unsigned long offsetBit,
+							int *reusable)
+{
+	*reusable = 1;
 
-					if (injTime < 0)
-					{
-						injTime = injTime + campaign->variance / 2;
-					}
+	if (!instanceImage.copy)
+	{
+		targets = read_tasks_targets(NULL);
+		targets = read_timer_targets(targets);
 
-					break;
+		if (readGoldenExecutionTime(&spawner.goldenExecTime) != 0)
+		{
+			ERR_PRINT("%s not found. Be sure to execute the --golden command.\n", GOLDEN_FILE_PATH);
+			*reusable = 0;
+			return GENERIC_ERROR_EXIT_CODE;
+		}
 
-				case 't':
+		setupWorker();
 
-					//triangular distribution
-					for (int gaussian = 0; gaussian < 12; ++gaussian)
-					{
-						total += rand() % 1000;
-					}
-					total = (total - 1000) / 1000;
+		if (saveDataImage(&instanceImage) != IMAGE_SUCCESS)
+		{
+			*reusable = 0;
+			return GENERIC_ERROR_EXIT_CODE;
+		}
+	}
 
-					injTime = total * campaign->variance + campaign->medTimeRange;
+	vPortUseInstanceSignals(instance);
 
-					if (injTime < 0)
-					{
-						injTime = injTime + campaign->variance / 2;
-					}
+	// same random sequence as a freshly started --run instance
+	srand(1);
 
-					break;
+	// a run without injection is classified against the golden execution
+	thData_t replica;
+	memset(&replica, 0, sizeof(replica));
+	replica.timeoutNs = 3 * spawner.goldenExecTime;
 
-				case 'u':
-				default:
-					injTime = campaign->medTimeRange;
+	thData_t *inj = NULL;
+	if (target)
+	{
+		inj = getInjectionTarget(targets, target);
+		if (!inj)
+		{
+			ERR_PRINT("Cannot find the injection target %s\n", target);
+			return GENERIC_ERROR_EXIT_CODE;
+		}
 
-					// compute the width of the injection time range
-					int lowerWidth = min(campaign->medTimeRange, campaign->variance);
-					int upperWidth = min(campaign->variance, nanoGoldenEx - campaign->medTimeRange);
-					int range = max(1, lowerWidth + upperWidth);
-					injTime = (rand() % range) - lowerWidth + (signed)campaign->medTimeRange;
-				}
+		injTime = time;
+		inj->injTime = time;
+		inj->offsetByte = offsetByte;
+		inj->offsetBit = offsetBit;
+		inj->timeoutNs = replica.timeoutNs;
+	}
 
-				// start the simulation
-				int ret = runFreeRTOSInjection(&pendingSimulations[full], argv[0], campaign->targetStructure, injTime, offsetByte, offsetBit);
-				if (ret < 0)
-				{
-					ERR_PRINT("Couldn't create child process.\n");
-					exit(GENERIC_ERROR_EXIT_CODE);
-				}
+	prvInitialiseHeap();
 
-				full++;
-				if (++j == campaign->nInjections)
-					stop = 1;
-			}
+	DEBUG_PRINT("Calling mainSetup...\n");
+	mainSetup();
+	DEBUG_PRINT("Call to mainSetup completed\n");
 
-			// Father process
-			do
-			{
-				unsigned int exitCode;
-				
-				// waitFreeRTOSInjections waits for one of the instances in pendingSimulations to complete
-				// pos is the index of the simulation that just completed
-				int pos = waitFreeRTOSInjections(pendingSimulations, full, &exitCode);
+	thread_t injectorThread;
+	if (inj)
+	{
+		launchInjector(inj, &injectorThread);
+	}
 
-				DEBUG_PRINT("Injection n. %lu/%lu completed with exit code %u...\n\n", nCurrentInjection, nTotalInjections, exitCode);
+	DEBUG_PRINT("Calling mainRun...\n");
+	mainRun();
+	DEBUG_PRINT("Call to mainRun completed\n");
 
-				// classify exit code and update campaign
-				switch (exitCode)
-				{
-				case EXECUTION_RESULT_HANG_EXIT_CODE:
-					campaign->res.nHang++;
-					break;
-				case EXECUTION_RESULT_ERROR_EXIT_CODE:
-					campaign->res.nError++;
-					break;
-				case EXECUTION_RESULT_DELAY_EXIT_CODE:
-					campaign->res.nDelay++;
-					break;
-				case EXECUTION_RESULT_SILENT_EXIT_CODE:
-					campaign->res.nSilent++;
-					break;
-				case EXECUTION_RESULT_CRASH_EXIT_CODE:
-				default:
-					// printf("%u\n", exitCode);
-					campaign->res.nCrash++;
-				}
+	if (inj)
+	{
+		cancelThread(&injectorThread);
+	}
 
-				// pendingSimulations must contain full pending simulations
-				// in the first full positions => 'collapse' the empty indices
-				full--;
-				freeRTOSInstance tmp = pendingSimulations[pos];
-				pendingSimulations[pos] = pendingSimulations[full];
-				pendingSimulations[full] = tmp;
+	unsigned int exitCode = classifyOutcome(inj ? inj : &replica);
+	free(inj);
 
-				// no more injections to run ==> wait all the pending simulations
-			} while (full && stop);
-		}
+	// the task threads of a copy that cannot be reset may still use its globals
+	*reusable = xPortResetThreads();
+	if (*reusable)
+	{
+		restoreDataImage(&instanceImage);
 	}
 
-	printStatistics(injectionCampaigns, nInjectionCampaigns);
+	return exitCode;
 }
+#endif
 
 void vApplicationMallocFailedHook(void)
 {
@@ -580,6 +2517,11 @@ void vApplicationIdleHook(void)
 	/* If the only task remaining is the IDLE task, terminate the scheduler */
 	if (isIdleHighlander())
 	{
+		if (isForkServerMaster())
+		{
+			forkServerShutdown();
+		}
+
 		if (isGolden)
 		{
 			writeGoldenFile();
@@ -591,6 +2533,10 @@ void vApplicationIdleHook(void)
 		vTaskEndScheduler();
 		ERR_PRINT("Executing past vTaskEndScheduler.\n"); // Never executed
 	}
+
+	// nothing to do until the next tick: raised at once on the virtual clock,
+	// waited for on the wall clock
+	idleVirtualTime();
 }
 /*-----------------------------------------------------------*/
 
@@ -616,6 +2562,21 @@ void vApplicationTickHook(void)
 	code must not attempt to block, and only the interrupt safe FreeRTOS API
 	functions can be used (those that end in FromISR()). */
 
+	if (isForkServerMaster())
+	{
+		forkServerCheckpoint(ulGetRunTimeCounterValue());
+	}
+
+	if (isVirtualTime() || isTickTrigger())
+	{
+		injectOnTick(ulGetRunTimeCounterValue());
+	}
+
+	if (isVirtualTime() && isIrqLoad())
+	{
+		tickIrqLoad(ulGetRunTimeCounterValue());
+	}
+
 #ifdef WIN32
 	// deprected code for waking up the injector thread
 	int eventIsSet = 1;
@@ -979,41 +2940,87 @@ static void printApplicationArguments(int argc, char **argv)
 static void runSimulator(const thData_t *injectionArgs)
 {
 	/* Launch the FreeRTOS */
+	beginPhase(PHASE_SETUP);
 	prvInitialiseHeap();
 
 	DEBUG_PRINT("Calling mainSetup...\n");
 	mainSetup();
 	DEBUG_PRINT("Call to mainSetup completed\n");
+	endPhase(PHASE_SETUP);
 
 	if (injectionArgs)
 	{
 		// the simulation should perform an injection
-
-		// create the injection thread
-		thread_t injectorThread;
-		int resultCode = launchInjectorThread(&injectorFunction, injectionArgs, &injectorThread);
-
-		if (resultCode == INJECTOR_THREAD_FAILURE)
-		{
-			ERR_PRINT("Injector thread launch failure.\n");
-			exit(INJECTOR_THREAD_LAUNCH_FAILURE_EXIT_CODE);
-		}
-
-		// detach the injector thread
-		detachThread(&injectorThread);
+		launchInjector(injectionArgs, NULL);
+		notifyFreeRTOSInstanceReady();
 	}
 	else
 	{
 		isGolden = 1;
+		startIrqLoad();
 	}
 
 	DEBUG_PRINT("Calling mainRun...\n");
+	beginPhase(PHASE_START);
 	mainRun();
+	endPhase(PHASE_STOP);
 	DEBUG_PRINT("Call to mainRun completed\n");
 
 	if (isGolden)
 		exit(EXIT_SUCCESS);
 
+	classifySimulation(injectionArgs);
+}
+
+/**
+ * Launch the injector thread. The thread is detached, unless
+ * injectorThread is not NULL: its handle is returned there.
+ */
+static void launchInjector(const thData_t *injectionArgs, thread_t *injectorThread)
+{
+	// on the virtual clock or with a tick or event trigger the hooks perform the injection,
+	// and a replay at the recorded point
+	if (isReplaying())
+		scheduleReplayInjection(injectionArgs);
+	else if (isVirtualTime() || isTickTrigger() || IS_EVENT_POINT(injectionArgs->injTime))
+		scheduleHookInjection(injectionArgs);
+
+	startScheduleLog(injectionArgs);
+	startIrqLoad();
+
+	// create the injection thread
+	thread_t thread;
+	int resultCode = launchInjectorThread(&injectorFunction, injectionArgs, &thread);
+
+	if (resultCode == INJECTOR_THREAD_FAILURE)
+	{
+		ERR_PRINT("Injector thread launch failure.\n");
+		exit(INJECTOR_THREAD_LAUNCH_FAILURE_EXIT_CODE);
+	}
+
+	if (injectorThread)
+	{
+		*injectorThread = thread;
+		return;
+	}
+
+	// detach the injector thread
+	detachThread(&thread);
+}
+
+static void classifySimulation(const thData_t *injectionArgs)
+{
+	beginPhase(PHASE_CHECK);
+	unsigned int exitCode = classifyOutcome(injectionArgs);
+	endPhase(PHASE_CHECK);
+
+	publishOutcome(injectionArgs, exitCode);
+	notifyFreeRTOSInstanceExiting();
+	exit(exitCode);
+}
+
+static unsigned int classifyOutcome(const thData_t *injectionArgs)
+{
 	/**
 	 * Check trace and determine the outcome of the simulation.
 	 * Refer to simulator.h for the exit codes values.
@@ -1034,35 +3041,35 @@ static void runSimulator(const thData_t *injectionArgs)
 	{ // Correct Trace output, ISR worked
 		if (executionResultIsCorrect())
 		{										  // Execution result is correct
-			if (execTime < (1.05 * nanoGoldenEx)) // Silent execution, correct output
+			if (execTime < (DELAY_THRESHOLD * nanoGoldenEx)) // Silent execution, correct output
 			{
-				exit(EXECUTION_RESULT_SILENT_EXIT_CODE);
+				return EXECUTION_RESULT_SILENT_EXIT_CODE;
 			}
 			else // Delayed execution, correct output
 			{
-				exit(EXECUTION_RESULT_DELAY_EXIT_CODE);
+				return EXECUTION_RESULT_DELAY_EXIT_CODE;
 			}
 		}
 		else // Execution result is not correct
 		{
-			if (execTime < (1.05 * nanoGoldenEx)) // Error execution, incorrect output
+			if (execTime < (DELAY_THRESHOLD * nanoGoldenEx)) // Error execution, incorrect output
 			{
-				exit(EXECUTION_RESULT_ERROR_EXIT_CODE);
+				return EXECUTION_RESULT_ERROR_EXIT_CODE;
 			}
 			else // Hang execution, incorrect output
 			{
-				exit(EXECUTION_RESULT_HANG_EXIT_CODE);
+				return EXECUTION_RESULT_HANG_EXIT_CODE;
 			}
 		}
 	}
 	else // Incorrect Trace output, ISR didn't work
 	{
-		exit(EXECUTION_RESULT_CRASH_EXIT_CODE);
+		return EXECUTION_RESULT_CRASH_EXIT_CODE;
 	}
 
 	/* This should never be executed */
 	ERR_PRINT("BIG DANGER!\nSomehow, the execution of the RTOS produced an unexpected output.\n");
-	exit(EXIT_FAILURE);
+	return EXIT_FAILURE;
 }
 
 static int traceOutputIsCorrect()
@@ -1086,6 +3093,19 @@ static int traceOutputIsCorrect()
 static int executionResultIsCorrect()
 {
 	int result = 1;
+
+	if (goldenOutput)
+	{
+		for (int i = 0; i < MAXARRAY; i++)
+		{
+			if (strcmp(goldenOutput[i].qstring, array[i].qstring) != 0)
+			{
+				return 0;
+			}
+		}
+		return 1;
+	}
+
 	FILE *goldenfp = fopen(GOLDEN_FILE_PATH, "r");
 	if (goldenfp == NULL)
 	{
@@ -1094,7 +3114,7 @@ static int executionResultIsCorrect()
 	}
 
 	char buffer[LENBUF];
-	fscanf(goldenfp, "%s\n", buffer); // Ingore first line, the goldenExecutionTime
+	fgets(buffer, sizeof(buffer), goldenfp); // Ignore first line, the goldenExecutionTime and its mode
 	for (int i = 0; i < MAXARRAY; i++)
 	{
 		fscanf(goldenfp, "%s\n", buffer);
@@ -1109,6 +3129,32 @@ static int executionResultIsCorrect()
 	return result;
 }
 
+/**
+ * Read the golden output in memory, so that executionResultIsCorrect
+ * does not read the golden file.
+ */
+static void loadGoldenOutput()
+{
+	FILE *goldenfp = fopen(GOLDEN_FILE_PATH, "r");
+	if (goldenfp == NULL)
+	{
+		ERR_PRINT("Couldn't open %s for reading.\n", GOLDEN_FILE_PATH);
+		exit(EXIT_FAILURE);
+	}
+
+	goldenOutput = (struct myStringStruct *)malloc(sizeof(struct myStringStruct) * MAXARRAY);
+
+	char buffer[LENBUF];
+	fgets(buffer, sizeof(buffer), goldenfp); // Ignore first line, the goldenExecutionTime and its mode
+	for (int i = 0; i < MAXARRAY; i++)
+	{
+		fscanf(goldenfp, "%s\n", buffer);
+		strncpy(goldenOutput[i].qstring, buffer, sizeof(goldenOutput[i].qstring) - 1);
+		goldenOutput[i].qstring[sizeof(goldenOutput[i].qstring) - 1] = '\0';
+	}
+	fclose(goldenfp);
+}
+
 static void writeGoldenFile()
 {
 	unsigned long goldenTime = ulGetRunTimeCounterValue();
@@ -1121,7 +3167,10 @@ static void writeGoldenFile()
 		exit(EXIT_FAILURE);
 	}
 
-	fprintf(goldenfp, "%lu\n", goldenTime);
+	char mode[LENBUF];
+	formatGoldenMode(mode, sizeof(mode));
+
+	fprintf(goldenfp, "%lu %s\n", goldenTime, mode);
 	for (int i = 0; i < MAXARRAY; i++)
 	{
 		fprintf(goldenfp, "%s\n", array[i].qstring);
@@ -1173,9 +3222,19 @@ static int readInjectionCampaignList(const char *filename, injectionCampaign_t *
 		if (atol(token) >= 0)
 			campaign->nInjections = atol(token);
 
-		// read the injection time
+		// read the injection time, or the event point EVENT[:name]@N
 		token = strtok_s(rest, ",", &rest);
-		if (atol(token) >= 0)
+		campaign->eventPoint = 0;
+		if (strchr(token, '@'))
+		{
+			unsigned long point;
+			if (parseEventPoint(token, &point) != TRIGGER_SUCCESS)
+				exit(INVALID_PARAMETERS_EXIT_CODE);
+
+			campaign->eventPoint = point & ~EVENT_POINT_OCCURRENCE(point);
+			campaign->medTimeRange = EVENT_POINT_OCCURRENCE(point);
+		}
+		else if (atol(token) >= 0)
 			campaign->medTimeRange = atol(token);
 
 		// read the injection time variance
@@ -1241,6 +3300,31 @@ static void printProgressBar(double percentage)
 #endif
 }
 
+/**
+ * Parse what follows the tick of a tick trigger: nothing (inject at the
+ * tick) or +K (inject at the K-th task switched in after the tick).
+ *
+ * Returns:
+ *  0 if the specification is valid,
+ *  -1 otherwise.
+ */
+static int parseTriggerSwitches(const char *spec, unsigned long *nSwitches)
+{
+	char *end;
+
+	if (*spec == '\0')
+	{
+		*nSwitches = 0;
+		return 0;
+	}
+
+	if (spec[0] != '+' || spec[1] < '0' || spec[1] > '9')
+		return -1;
+
+	*nSwitches = strtoul(spec + 1, &end, 10);
+	return *end == '\0' ? 0 : -1;
+}
+
 /**
  * Read the golden execution time from the golden file and store
  * it in the region pointed by the value parameter.
@@ -1260,16 +3344,62 @@ static int readGoldenExecutionTime(unsigned long *value)
 
 	int nRead = fscanf(fp, "%lu", value);
 
-	fclose(fp);
-
 	// check the number of values read
 	if (nRead != 1)
 	{
 		// error during the reading operation
+		fclose(fp);
 		return 2;
 	}
 
+	// the golden run must have been executed in the same mode
+	int sameMode = checkGoldenMode(fp) == 0;
+
+	fclose(fp);
+
 	// ok
+	return sameMode ? 0 : 3;
+}
+
+/**
+ * Timing mode and interrupt load of this process, as written by the golden
+ * run after its execution time: the outcome of a run is only comparable
+ * with a golden run of the same mode.
+ */
+static void formatGoldenMode(char *mode, size_t size)
+{
+	snprintf(mode, size, "%s %s", isVirtualTime() ? "virtual-time" : "real-time",
+			 isIrqLoad() ? getIrqLoadSpec() : "no-irq-load");
+}
+
+/**
+ * Read the mode of the golden run, right after its execution time, and
+ * compare it with the mode of this process. A golden file without a mode
+ * was written in real time without interrupt load.
+ *
+ * Returns 0 if the modes match, 1 otherwise (with an error message).
+ */
+static int checkGoldenMode(FILE *goldenfp)
+{
+	char goldenMode[LENBUF], mode[LENBUF];
+
+	if (!fgets(goldenMode, sizeof(goldenMode), goldenfp))
+		goldenMode[0] = '\0';
+
+	// trim the spaces around the mode
+	char *start = goldenMode + strspn(goldenMode, " \t");
+	start[strcspn(start, "\r\n")] = '\0';
+	if (!*start)
+		start = "real-time no-irq-load";
+
+	formatGoldenMode(mode, sizeof(mode));
+	if (strcmp(start, mode) != 0)
+	{
+		ERR_PRINT("%s was written by a golden run in another mode (%s, this run: %s): run --golden again with the same --virtual-time and --irq-load options.\n",
+				  GOLDEN_FILE_PATH, start, mode);
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -1284,19 +3414,199 @@ static void printMany(FILE *fp, char c, int number)
 	}
 }
 
+/**
+ * Print the startup latency of the instances created with spawnMode, if any.
+ */
+static void printStartupLatency(FILE *fp, const char *label, int spawnMode)
+{
+	latencyStats_t latency;
+	getStartupLatency(spawnMode, &latency);
+
+	printLatency(fp, "Startup latency", label, &latency);
+}
+
+static void printLatency(FILE *fp, const char *title, const char *label, const latencyStats_t *latency)
+{
+	if (latency->count == 0 || !spawner.reportLatency)
+		return;
+
+	fprintf(fp, "%s %-14s %6lu runs, mean %10.1f us, min %10.1f us, max %10.1f us\n",
+			title, label, latency->count,
+			latency->sumNs / (1000.0 * latency->count),
+			latency->minNs / 1000.0,
+			latency->maxNs / 1000.0);
+}
+
+/**
+ * Print the makespan of the campaign (from the start of the first run to the
+ * completion of the last one) and compare it with the one of the input file
+ * order, by replaying the measured run times in both orders.
+ */
+static void printMakespan(FILE *fp, int order, unsigned long makespanNs, const unsigned long *durations,
+						  const unsigned long *dispatched, unsigned long n, int parallelism)
+{
+	if (n == 0 || !spawner.reportMakespan)
+		return;
+
+	double replayedNs = replayMakespan(durations, dispatched, n, parallelism);
+	double fifoNs = replayMakespan(durations, NULL, n, parallelism);
+
+	fprintf(fp, "Makespan %-21s %10.3f s, replayed %10.3f s, replayed in fifo order %10.3f s (%+.1f%%)\n",
+			order == ORDER_LPT ? "lpt" : "fifo",
+			makespanNs / 1e9, replayedNs / 1e9, fifoNs / 1e9,
+			fifoNs > 0 ? 100.0 * (replayedNs - fifoNs) / fifoNs : 0.0);
+}
+
+/**
+ * Makespan of n runs started in order (positions in durations, NULL for the
+ * input file order) on parallelism slots, each run starting on the first slot
+ * that becomes free.
+ */
+static double replayMakespan(const unsigned long *durations, const unsigned long *order, unsigned long n, int parallelism)
+{
+	double *slots = (double *)calloc(parallelism, sizeof(double));
+	double makespan = 0;
+
+	for (unsigned long k = 0; k < n; k++)
+	{
+		int first = 0;
+		for (int s = 1; s < parallelism; s++)
+		{
+			if (slots[s] < slots[first])
+				first = s;
+		}
+
+		slots[first] += durations[order ? order[k] : k];
+		if (slots[first] > makespan)
+			makespan = slots[first];
+	}
+
+	free(slots);
+	return makespan;
+}
+
+/**
+ * Start -j=auto with a limit of one instance per CPU (nCpus is 0 if
+ * -j=auto is not used).
+ */
+static void initAutoParallelism(autoParallelism_t *autoJ, int nCpus, unsigned long nowNs)
+{
+	memset(autoJ, 0, sizeof(autoParallelism_t));
+
+	autoJ->limit = max(1, nCpus);
+	autoJ->maxLimit = max(1, AUTO_PARALLELISM_FACTOR * nCpus);
+	autoJ->ceiling = autoJ->maxLimit;
+	autoJ->epochStartNs = nowNs;
+}
+
+/**
+ * Add the inflation of a probe and, at the end of the epoch, choose the
+ * limit of the next one.
+ */
+static void updateAutoParallelism(autoParallelism_t *autoJ, double inflation, unsigned long nowNs)
+{
+	autoJ->probing = 0;
+	autoJ->inflation[autoJ->nProbes++] = inflation;
+
+	if (autoJ->nProbes < AUTO_PROBE_WINDOW && inflation <= DELAY_THRESHOLD)
+		return;
+
+	// p99 of the inflation of the epoch (insertion sort of a few samples)
+	double sorted[AUTO_PROBE_WINDOW];
+	int n = autoJ->nProbes;
+	for (int i = 0; i < n; i++)
+	{
+		int j = i;
+		for (; j > 0 && sorted[j - 1] > autoJ->inflation[i]; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = autoJ->inflation[i];
+	}
+	double p99 = sorted[(int)ceil(0.99 * n) - 1];
+
+	double elapsed = (nowNs - autoJ->epochStartNs) / 1e9;
+	double throughput = elapsed > 0 ? autoJ->epochCompleted / elapsed : 0;
+
+	int next = autoJ->limit;
+	if (p99 > AUTO_TARGET_INFLATION)
+	{
+		// too much load: back off by a quarter, and stay below for a while
+		next = max(1, autoJ->limit - max(1, autoJ->limit / 4));
+		autoJ->ceiling = next;
+		autoJ->ceilingEpochs = AUTO_CEILING_EPOCHS;
+	}
+	else if (autoJ->lastThroughput > 0 && throughput < autoJ->lastThroughput && autoJ->limit > 1)
+	{
+		// the last step up did not pay off
+		next = autoJ->limit - 1;
+		autoJ->ceiling = next;
+		autoJ->ceilingEpochs = AUTO_CEILING_EPOCHS;
+	}
+	else if (autoJ->limit < autoJ->ceiling)
+	{
+		next = autoJ->limit + 1;
+	}
+	else if (autoJ->ceilingEpochs > 0 && --autoJ->ceilingEpochs == 0)
+	{
+		// try the limits above the ceiling again: the load may have changed
+		autoJ->ceiling = autoJ->maxLimit;
+	}
+
+	DEBUG_PRINT("-j=auto: p99 inflation %.3f, %.2f injections/s with %d slots, next %d\n", p99, throughput, autoJ->limit, next);
+
+	autoDecision_t *decisions = (autoDecision_t *)realloc(autoJ->decisions, (autoJ->nDecisions + 1) * sizeof(autoDecision_t));
+	if (decisions)
+	{
+		autoDecision_t *decision = &decisions[autoJ->nDecisions++];
+		decision->timeNs = nowNs;
+		decision->limit = autoJ->limit;
+		decision->nextLimit = next;
+		decision->nProbes = n;
+		decision->p99 = p99;
+		decision->throughput = throughput;
+		autoJ->decisions = decisions;
+	}
+
+	// a new epoch starts with the new limit: a step up is compared with this epoch
+	autoJ->lastThroughput = next > autoJ->limit ? throughput : 0;
+	autoJ->limit = next;
+	autoJ->nProbes = 0;
+	autoJ->epochStartNs = nowNs;
+	autoJ->epochCompleted = 0;
+}
+
+/**
+ * Print the limit chosen by -j=auto over time, with the p99 inflation
+ * and the throughput of each epoch.
+ */
+static void printAutoParallelism(FILE *fp, const autoParallelism_t *autoJ, unsigned long startNs)
+{
+	fprintf(fp, "Parallelism over time (-j=auto, at most %d, target p99 inflation %.3f):\n",
+			autoJ->maxLimit, AUTO_TARGET_INFLATION);
+	fprintf(fp, "%10s %6s %7s %12s %16s %6s\n", "Time (s)", "Slots", "Probes", "p99 infl.", "Injections/s", "Next");
+
+	for (int i = 0; i < autoJ->nDecisions; i++)
+	{
+		const autoDecision_t *decision = &autoJ->decisions[i];
+		fprintf(fp, "%10.3f %6d %7d %12.3f %16.2f %6d\n",
+				(decision->timeNs - startNs) / 1e9, decision->limit, decision->nProbes,
+				decision->p99, decision->throughput, decision->nextLimit);
+	}
+}
+
 static void printStatistics(injectionCampaign_t *injectionCampaigns, int nInjectionCampaigns)
 {
 	fprintf(stdout, "\n");
-	printMany(stdout, '-', 123);
-	fprintf(stdout, "\n| %-30s | %10s | %8s | %10s | %10s | %10s | %10s | %10s |\n",
-			"Target", "Time (ns)", "nExecs", "Silent %", "Delay %", "Error %", "Hang %", "Crash %");
+	printMany(stdout, '-', 145);
+	fprintf(stdout, "\n| %-30s | %32s | %8s | %10s | %10s | %10s | %10s | %10s |\n",
+			"Target", "Time (ns) or event@occurrence", "nExecs", "Silent %", "Delay %", "Error %", "Hang %", "Crash %");
 
 	for (int i = 0; i < nInjectionCampaigns; ++i)
 	{
-		printMany(stdout, '-', 123);
-		fprintf(stdout, "\n| %-30s | %10ld | %8d | %9.2f%% | %9.2f%% | %9.2f%% | %9.2f%% | %9.2f%% |\n",
+		char point[64];
+		printMany(stdout, '-', 145);
+		fprintf(stdout, "\n| %-30s | %32s | %8d | %9.2f%% | %9.2f%% | %9.2f%% | %9.2f%% | %9.2f%% |\n",
 				injectionCampaigns[i].targetStructure,
-				injectionCampaigns[i].medTimeRange,
+				formatInjectionPoint(&injectionCampaigns[i], point, sizeof(point)),
 				injectionCampaigns[i].nInjections,
 				(100.0 * injectionCampaigns[i].res.nSilent) / injectionCampaigns[i].nInjections,
 				(100.0 * injectionCampaigns[i].res.nDelay) / injectionCampaigns[i].nInjections,
@@ -1304,6 +3614,20 @@ static void printStatistics(injectionCampaign_t *injectionCampaigns, int nInject
 				(100.0 * injectionCampaigns[i].res.nHang) / injectionCampaigns[i].nInjections,
 				(100.0 * injectionCampaigns[i].res.nCrash) / injectionCampaigns[i].nInjections);
 	}
-	printMany(stdout, '-', 123);
+	printMany(stdout, '-', 145);
 	fprintf(stdout, "\n");
+}
+
+/**
+ * Injection point of a campaign, as printed in the tables: its median
+ * injection time (ns), or its event and the occurrence of the event.
+ */
+static const char *formatInjectionPoint(const injectionCampaign_t *campaign, char *buffer, size_t size)
+{
+	if (campaign->eventPoint)
+		snprintf(buffer, size, "%s@%lu", getEventName(campaign->eventPoint), campaign->medTimeRange);
+	else
+		snprintf(buffer, size, "%lu", campaign->medTimeRange);
+
+	return buffer;
 }
\ No newline at end of file
@@ -184,6 +184,12 @@ void mainSetup( void )
 		// checking if the os executes this ISR allows to distinguish
 		// between crash and hangs
 		vPortSetInterruptHandler( 5, prvInterruptHandler );
+
+		// the simulated-interrupt load, if any (see irqload.h)
+		if( setupIrqLoad() != IRQLOAD_SUCCESS )
+		{
+			exit( GENERIC_ERROR_EXIT_CODE );
+		}
 	}
 }
 
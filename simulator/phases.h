@@ -0,0 +1,120 @@
+#ifndef INJECTOR_PHASES_H
+#define INJECTOR_PHASES_H
+
+#define PHASES_SUCCESS 0
+#define PHASES_FAILURE -1
+
+// phases of a run, in the order they happen
+#define PHASE_FORK 0      // from fork() (or the request to the zygote) to the child
+#define PHASE_EXEC 1      // from the fork to main() of the --run image
+#define PHASE_TARGET 2    // getInjectionTarget
+#define PHASE_SETUP 3     // prvInitialiseHeap and mainSetup
+#define PHASE_START 4     // from mainRun to the first task switched in
+#define PHASE_SLEEP 5     // injector thread: waitUntilCounter up to the injection time
+#define PHASE_FLIP 6      // injector thread: bit flip
+#define PHASE_WORKLOAD 7  // from the first task switched in to the completion event
+#define PHASE_STOP 8      // from the completion event to the end of the scheduler
+#define PHASE_CHECK 9     // traceOutputIsCorrect and executionResultIsCorrect
+#define PHASE_REAP 10     // orchestrator: from the exit of the instance to its reaping
+#define PHASE_COUNT 11
+
+/**
+ * Timing of the phases of the runs.
+ *
+ * An instance measures the duration of its own phases with a monotonic
+ * clock and sends them to the orchestrator with its run record, including
+ * its fork, from the time the orchestrator started it; the orchestrator
+ * measures the reaping of the instances. The
+ * orchestrator aggregates the durations in one histogram per phase
+ * (log-linear buckets, 8 per power of two), from which the percentiles
+ * are estimated within 1/16 of their value.
+ *
+ * A phase that does not happen in a run (e.g. the setup of an instance
+ * forked from the zygote, or the workload of a run that hangs) is not
+ * measured.
+ */
+
+typedef struct
+{
+    unsigned long count;
+    unsigned long long meanNs, p50Ns, p90Ns, p99Ns, maxNs;
+} phaseStats_t;
+
+// exact buckets below 16 ns, then 8 buckets per power of two
+#define HISTOGRAM_BUCKETS (16 + (64 - 4) * 8)
+
+typedef struct
+{
+    unsigned long count;
+    unsigned long long sumNs, maxNs;
+    unsigned long buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+/**
+ * Monotonic clock shared by the processes of the host.
+ */
+unsigned long long phaseClockNs(void);
+
+/**
+ * Called by an instance: start and end the measure of a phase.
+ */
+void beginPhase(int phase);
+void endPhase(int phase);
+
+/**
+ * Called by an instance before a new run: forget the phases measured so far,
+ * but its fork.
+ */
+void resetPhases(void);
+
+/**
+ * Called by a forked instance as its first instruction, before it raises
+ * its priority and preempts the orchestrator: PHASE_FORK started at spawnNs.
+ */
+void endForkPhase(unsigned long long spawnNs);
+
+/**
+ * Called by a child right before execv: PHASE_EXEC ends when the new
+ * image calls endExecPhase.
+ */
+void beginExecPhase(void);
+void endExecPhase(void);
+
+/**
+ * Duration of the phases measured by this instance (0 if not measured).
+ */
+void getPhaseDurations(unsigned long long durations[PHASE_COUNT]);
+
+/**
+ * Called by the orchestrator: add the duration of a phase of a run to its
+ * histogram. May be called by any thread.
+ */
+void recordPhase(int phase, unsigned long long durationNs);
+
+/**
+ * Read the statistics of a phase, from its histogram.
+ */
+void getPhaseStats(int phase, phaseStats_t *stats);
+
+/**
+ * Short name of a phase.
+ */
+const char *getPhaseName(int phase);
+
+/**
+ * Called by the orchestrator: add the latency of an injection (from its
+ * requested time to the flip) to a histogram of the same kind, and read
+ * its statistics.
+ */
+void recordInjectionLatency(unsigned long long latencyNs);
+void getInjectionLatencyStats(phaseStats_t *stats);
+
+/**
+ * Add a duration to a histogram of the same kind, e.g. the latency of the
+ * simulated interrupts (see irqload.h), and read its statistics. May be
+ * called by any thread, and from a signal handler.
+ */
+void addToHistogram(histogram_t *histogram, unsigned long long ns);
+void readHistogram(const histogram_t *histogram, phaseStats_t *stats);
+
+#endif
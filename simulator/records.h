@@ -0,0 +1,85 @@
+#ifndef INJECTOR_RECORDS_H
+#define INJECTOR_RECORDS_H
+
+#include "phases.h"
+
+#define RECORDS_SUCCESS 0
+#define RECORDS_FAILURE -1
+
+// slots of the ring (a power of two)
+#define RUN_RECORDS_CAPACITY 4096
+
+/**
+ * Record of a completed run, written by the instance right before it exits.
+ *
+ * The exit code only tells the outcome of a run: the record also keeps the
+ * measurements the outcome was derived from. The times are values of the
+ * run-time counter of the instance (ns since it started).
+ */
+typedef struct
+{
+    int pid;
+    unsigned int exitCode;
+    // injection requested by the orchestrator
+    char target[64];
+    unsigned long injTime, offsetByte, offsetBit;
+    // when the bit was flipped (0 if the run ended before the injection)
+    unsigned long performedInjTime;
+    // tick count when the bit was flipped, with the tick trigger
+    unsigned long performedInjTick;
+    // last entry of the trace, compared with the golden execution time
+    unsigned long endTime;
+    unsigned long tickCount;
+    // ticks raised late to catch up with the wall clock, and the largest delay of a tick
+    unsigned long missedTicks, maxTickLagNs;
+    unsigned long nContextSwitches;
+    // the interrupt that completes the benchmark was served
+    int isrReceived;
+    // duration of the phases measured by the instance (see phases.h)
+    unsigned long long phaseNs[PHASE_COUNT];
+} runRecord_t;
+
+typedef void (*runRecordHandler_t)(const runRecord_t *record);
+
+/**
+ * Shared-memory ring of run records, from the instances to the orchestrator.
+ *
+ * The orchestrator creates the ring before creating any instance: the forked
+ * instances (zygote, workers, fork server) inherit its mapping, the --run
+ * instances map it again from a descriptor they inherit through execv.
+ * Any number of instances publish records concurrently (lock-free, bounded
+ * MPSC queue with a sequence number per slot) and a single thread of the
+ * orchestrator consumes them without any system call.
+ *
+ * A record is dropped if the ring is full: publishing never blocks an instance.
+ */
+
+/**
+ * Create the ring, with RUN_RECORDS_CAPACITY slots.
+ */
+int createRunRecordRing(void);
+
+/**
+ * Unmap the ring of the orchestrator.
+ */
+void destroyRunRecordRing(void);
+
+/**
+ * Called by an instance: publish its record, if the ring exists.
+ */
+int publishRunRecord(const runRecord_t *record);
+
+/**
+ * Pass the published records to onRecord, in the order they were published,
+ * and return their number. Once no instance is running (final), the slots
+ * reserved by instances that died before publishing are skipped.
+ */
+int consumeRunRecords(runRecordHandler_t onRecord, int final);
+
+/**
+ * Number of records lost so far, because the ring was full or their
+ * instance died while publishing them.
+ */
+unsigned long getDroppedRunRecords(void);
+
+#endif
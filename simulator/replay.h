@@ -0,0 +1,144 @@
+#ifndef INJECTOR_REPLAY_H
+#define INJECTOR_REPLAY_H
+
+#define REPLAY_SUCCESS 0
+#define REPLAY_FAILURE -1
+
+/**
+ * Record and replay of the schedule of a run.
+ *
+ * On the wall clock the tick signal lands wherever the tasks happen to be,
+ * and the injector flips the bit wherever the kernel happens to be: running
+ * the same injection again often gives another interleaving, and another
+ * outcome. The schedule log of a run records, against a logical clock that
+ * counts the trace hooks of the kernel (see FreeRTOSConfig.h), including the
+ * suspension and the resumption of the scheduler, which decide whether a
+ * tick is handled at once or pended:
+ * - every delivery of the tick signal, with the ticks it raised and the
+ *   value of the run-time counter,
+ * - every task switched in (a hash of its name),
+ * - the flip of the bit, and the end of the run by the injector.
+ *
+ * A replay runs the same injection with an external tick (see port.c): no
+ * timer, each recorded tick is raised when the logical clock reaches its
+ * delivery, and the run-time counter takes its recorded values. The bit is
+ * flipped at the recorded point, the run is ended where the recorded one
+ * was, and each task switched in is checked against the log: the replay
+ * reports the first event where it diverged, if any.
+ *
+ * The replay holds as long as the tasks only interact through the kernel:
+ * a tick is raised at the first point the recorded delivery can have
+ * happened, between the same two kernel events. The replay runs in a child
+ * process, which keeps its progress in shared memory: the parent reports it
+ * once the child exited, died of the injection (even in the tick handler,
+ * where all the signals are blocked) or was killed by its watchdog.
+ *
+ * Each instance writes its log to a file of the recording directory mapped
+ * in memory, so the log of an instance that crashes is kept; the log of a
+ * Silent run is removed when it completes.
+ */
+
+struct thData_s;
+
+typedef struct
+{
+    char target[64];
+    unsigned long injTime, offsetByte, offsetBit, timeoutNs;
+    // outcome of the recorded run (0 if its instance died)
+    unsigned int exitCode;
+} scheduleRun_t;
+
+/**
+ * Record the schedule of the runs of this process and of the instances it
+ * starts, in a log per run under dir (created if needed).
+ * Must be called before the scheduler is started.
+ */
+int enableScheduleRecording(const char *dir);
+
+/**
+ * Record the schedules if the process that started this one records them.
+ */
+void inheritScheduleRecording(void);
+
+/**
+ * Whether the schedules of the runs are recorded.
+ */
+int isScheduleRecording(void);
+
+/**
+ * Load the log at path to replay its run, whose injection is stored in run.
+ * Must be called before the scheduler is started.
+ */
+int loadScheduleReplay(const char *path, scheduleRun_t *run);
+
+/**
+ * Whether this process replays a schedule.
+ */
+int isReplaying(void);
+
+/**
+ * Called when the injector is launched: start the log of the run (recording),
+ * or rewind it (replay). The logical clock starts at 0.
+ */
+void startScheduleLog(const struct thData_s *data);
+
+/**
+ * Called once the outcome of the run is known: complete its log (recording).
+ */
+void closeScheduleLog(unsigned int exitCode);
+
+/**
+ * Called by the injector: log the flip of the bit, and the end of the run
+ * at its timeout.
+ */
+void logScheduleInjection(void);
+void logScheduleEnd(void);
+
+/**
+ * Replay the loaded log: run(data) in a child process, which exits with the
+ * outcome of the run, then report where the replay diverged and the recorded
+ * and replayed outcomes. The child is killed after watchdogNs.
+ * Returns the exit code of the child ((unsigned int)-1 if it died).
+ */
+unsigned int runScheduleReplay(void (*run)(const struct thData_s *), const struct thData_s *data, unsigned long watchdogNs);
+
+/**
+ * Replay: wait until the run is ended where the recorded one was, or for
+ * timeoutNs of wall-clock time.
+ */
+void waitScheduleReplay(unsigned long timeoutNs);
+
+/**
+ * A schedule log is written or replayed.
+ */
+extern volatile int scheduleLogging;
+
+/**
+ * Hooks of the logical clock: a kernel event, a task switched in, and the
+ * delivery of a tick signal raising nTicks ticks.
+ */
+#define scheduleEvent()              \
+    do                               \
+    {                                \
+        if (scheduleLogging)         \
+            countScheduleEvent(0);   \
+    } while (0)
+
+#define scheduleSwitch()             \
+    do                               \
+    {                                \
+        if (scheduleLogging)         \
+            countScheduleEvent(1);   \
+    } while (0)
+
+#define scheduleTick(nTicks)         \
+    do                               \
+    {                                \
+        if (scheduleLogging)         \
+            logScheduleTick(nTicks); \
+    } while (0)
+
+void countScheduleEvent(int isSwitch);
+void logScheduleTick(unsigned long nTicks);
+
+#endif
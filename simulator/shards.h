@@ -0,0 +1,45 @@
+#ifndef INJECTOR_SHARDS_H
+#define INJECTOR_SHARDS_H
+
+#include "injector.h"
+#include "worker.h"
+
+#define SHARDS_SUCCESS 0
+#define SHARDS_FAILURE -1
+
+/**
+ * Sharded execution of an injection campaign.
+ *
+ * The parallelism slots are split among nShards manager threads. Each
+ * manager starts the instances of its slots (SPAWN_EXEC or SPAWN_ZYGOTE),
+ * waits for them on its own event loop and stores their exit codes, so
+ * the orchestrator is no longer limited by a single thread.
+ *
+ * The plan is drawn upfront by the calling thread (the planner), which
+ * hands a contiguous range of it to each manager as its local queue. A
+ * manager takes the next injection from the front of its queue; once the
+ * queue is empty it steals half of the injections left at the back of the
+ * queue of a peer.
+ */
+
+/**
+ * Called by the planner with the number of injections completed so far,
+ * from time to time while the campaign runs.
+ */
+typedef void (*shardsProgress_t)(unsigned long nCompleted);
+
+/**
+ * Run all the injections in plan with nShards manager threads sharing
+ * parallelism slots. The exit code of plan[i] is stored in exitCodes[i],
+ * and also passed to onResult (if not NULL) by the manager that waited
+ * for it, i.e. concurrently with the other managers.
+ *
+ * Returns SHARDS_SUCCESS, or SHARDS_FAILURE if the managers are not
+ * supported or an instance could not be started or waited.
+ */
+int runShardedCampaign(const injection_t *plan, int size, int parallelism, int nShards,
+                       int spawnMode, const char *injectorPath,
+                       unsigned int *exitCodes, workerResult_t onResult,
+                       shardsProgress_t progress);
+
+#endif
@@ -20,7 +20,20 @@
 
 #include "injector.h"
 #include "fork.h"
+#include "forkserver.h"
+#include "worker.h"
+#include "shards.h"
+#include "distributed.h"
+#include "affinity.h"
+#include "phases.h"
+#include "records.h"
+#include "journal.h"
+#include "cache.h"
+#include "vtime.h"
+#include "trigger.h"
 #include "thread.h"
+#include "replay.h"
+#include "irqload.h"
 #include "loggingUtils.h"
 #include "sleep.h"
 
@@ -28,6 +41,17 @@
 #define CMD_RUN "--run"
 #define CMD_CAMPAIGN "--campaign"
 #define CMD_GOLDEN "--golden"
+#define CMD_COORDINATOR "--coordinator"
+#define CMD_WORKER "--worker"
+#define CMD_BENCH_PINNING "--bench-pinning"
+#define CMD_REPLAY "--replay"
+#define CMD_BENCH_SWITCH "--bench-switch"
+#define CMD_BENCH_IRQ "--bench-irq"
+
+// port of the kernel, reported by --bench-switch
+#ifndef SIM_KERNEL_PORT
+#define SIM_KERNEL_PORT "MSVC-MingW"
+#endif
 
 // exit codes:
 #define SUCCESSFUL_EXECUTION_EXIT_CODE 0
@@ -43,6 +67,9 @@
 #define EXECUTION_RESULT_HANG_EXIT_CODE 48
 #define EXECUTION_RESULT_CRASH_EXIT_CODE 50
 
+// a run longer than this fraction of the golden execution time is delayed (or hung)
+#define DELAY_THRESHOLD 1.05
+
 #ifdef DEBUG
 
 #ifdef POSIX
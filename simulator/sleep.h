@@ -3,6 +3,25 @@
 
 extern int eventIsSet;
 
+// default margin of waitUntilCounter: spin for the last 100 us
+#define DEFAULT_SPIN_MARGIN_NS 100000UL
+
 void sleepNanoseconds (unsigned long ns);
+
+/**
+ * Wait until the run-time counter reaches counterNs, from fromNs: sleep
+ * until the spin margin before it (on an absolute deadline), then spin on
+ * the counter. The sleep alone overshoots by the wake-up latency of the
+ * host. The counter is only read once the sleep is over (it starts with
+ * the scheduler). The sleep and the spin are both cancellation points.
+ */
+void waitUntilCounter(unsigned long fromNs, unsigned long counterNs);
+
+/**
+ * Set the spin margin of this process and of the instances it starts
+ * (0: sleep only), or inherit the one of the process that started this one.
+ */
+int setSpinMargin(unsigned long marginNs);
+void inheritSpinMargin(void);
 void injectorWait();
 void wakeInjector();
@@ -12,6 +12,10 @@ typedef struct thData_s
     void *address;
     unsigned long injTime, timeoutNs, offsetByte, offsetBit;
 
+    // value of the run-time counter when the injector is launched
+    // (nonzero when the instance was forked from a snapshot)
+    unsigned long startTime;
+
     // lists only
     int isList;
     int listPosition;
@@ -29,4 +33,31 @@ int launchInjectorThread(void* (*function) (void*),
 
 int detachThread(thread_t *id);
 
+// stop a thread that was not detached and wait for it to terminate
+int cancelThread(thread_t *id);
+
+// called by the injector thread: run action (e.g. the flip) unless
+// cancelThread was called, atomically with respect to it; returns
+// INJECTOR_THREAD_FAILURE without running action once cancelled
+int runUnlessCancelled(void (*action)(const thData_t *), const thData_t *data);
+
+// virtual time: period at which the injector thread checks the virtual
+// clock for the timeout of the run
+#define VIRTUAL_TIMEOUT_POLL_NS 1000000UL
+
+// virtual time, tick or event trigger: the injection of data is performed by
+// the tick hook (injectOnTick) once the virtual clock reaches its injection
+// time or the tick count reaches its tick, by the switch hook
+// (injectOnSwitch) at the task switch that triggers it, or by the hook of
+// its event (injectOnEvent) at the occurrence that triggers it
+void scheduleHookInjection(const thData_t *data);
+void injectOnTick(unsigned long currentTime);
+void injectOnSwitch(void);
+void injectOnEvent(void);
+
+// replay: the injection is performed by the replay of its schedule log
+// (injectOnReplay) at the point the recorded run flipped the bit
+void scheduleReplayInjection(const thData_t *data);
+void injectOnReplay(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef INJECTOR_TRIGGER_H
+#define INJECTOR_TRIGGER_H
+
+#define TRIGGER_SUCCESS 0
+#define TRIGGER_FAILURE -1
+
+/**
+ * Deterministic injection triggers.
+ *
+ * By default the injector thread sleeps until the injection time and flips
+ * the bit wherever the kernel happens to be at that moment: the sleep
+ * overshoots by the latency of the host, and the same injection lands on a
+ * different instruction of a different task from one run to the next. With
+ * a tick trigger the injection time is rounded up to tick N of the kernel,
+ * and the bit is flipped synchronously by the tick hook once the tick count
+ * reaches N or, with K > 0, by the K-th task switched in after tick N
+ * (traceTASK_SWITCHED_IN). The injector thread only waits for the timeout
+ * of the run.
+ *
+ * The tick count and the number of switches at the flip are recorded, so
+ * the point reached is reported next to the requested one.
+ */
+
+/**
+ * Enable the tick trigger in this process and in the instances it starts:
+ * inject at the nSwitches-th task switched in after the injection tick
+ * (0: at the injection tick). Must be called before the scheduler is started.
+ */
+int enableTickTrigger(unsigned long nSwitches);
+
+/**
+ * Enable the tick trigger if the process that started this one enabled it.
+ */
+void inheritTickTrigger(void);
+
+/**
+ * Whether the tick trigger is enabled.
+ */
+int isTickTrigger(void);
+
+/**
+ * Task switches from the injection tick to the injection.
+ */
+unsigned long getTriggerSwitches(void);
+
+/**
+ * Tick of an injection time: the first tick at or past injTimeNs.
+ */
+unsigned long getTriggerTick(unsigned long injTimeNs);
+
+/**
+ * Event triggers.
+ *
+ * An injection may also be triggered by the N-th occurrence of a kernel
+ * event since the injector was launched, instead of by a time: a trace hook
+ * of FreeRTOSConfig.h, the switch-in of a named task, or the entry to a
+ * kernel function (builds with -DSIM_INSTRUMENT_KERNEL=ON, which compile the
+ * kernel with -finstrument-functions). The hook of the armed event only
+ * compares and decrements a counter: the check is left in every run.
+ *
+ * An event point takes the place of the injection time in the campaigns,
+ * the instances and their records: the flag, the event, its argument (the
+ * hash of a task name, or the offset of a function in the image) and the
+ * occurrence are packed in the same unsigned long.
+ */
+
+// events (see FreeRTOSConfig.h for the hooks)
+#define TRIGGER_EVENT_NONE 0
+#define TRIGGER_EVENT_TASK_SWITCHED_OUT 1
+#define TRIGGER_EVENT_TASK_SWITCHED_IN 2
+#define TRIGGER_EVENT_QUEUE_SEND_FAILED 3
+#define TRIGGER_EVENT_QUEUE_RECEIVE_FAILED 4
+#define TRIGGER_EVENT_QUEUE_SEND_FROM_ISR_FAILED 5
+#define TRIGGER_EVENT_QUEUE_RECEIVE_FROM_ISR_FAILED 6
+#define TRIGGER_EVENT_QUEUE_SEND 7
+#define TRIGGER_EVENT_QUEUE_RECEIVE 8
+#define TRIGGER_EVENT_QUEUE_SEND_FROM_ISR 9
+#define TRIGGER_EVENT_QUEUE_RECEIVE_FROM_ISR 10
+#define TRIGGER_EVENT_BLOCKING_ON_QUEUE_SEND 11
+#define TRIGGER_EVENT_BLOCKING_ON_QUEUE_RECEIVE 12
+#define TRIGGER_EVENT_TASK_DELAY 13
+#define TRIGGER_EVENT_TASK_DELAY_UNTIL 14
+#define TRIGGER_EVENT_TASK_INCREMENT_TICK 15
+#define TRIGGER_EVENT_TASK_IN 16  // TASK:name, switch-in of the task
+#define TRIGGER_EVENT_FUNCTION 17 // FUNCTION:name, entry to the function
+#define TRIGGER_EVENT_COUNT 18
+
+#define TRIGGER_POINT_FLAG (1UL << 63)
+#define IS_EVENT_POINT(point) (((point) & TRIGGER_POINT_FLAG) != 0)
+#define EVENT_POINT(event, argument, occurrence) \
+    (TRIGGER_POINT_FLAG | ((unsigned long)(event) << 56) | (((unsigned long)(argument) & 0xFFFFFF) << 32) | ((occurrence) & 0xFFFFFFFF))
+#define EVENT_POINT_EVENT(point) ((int)(((point) >> 56) & 0x7F))
+#define EVENT_POINT_ARGUMENT(point) (((point) >> 32) & 0xFFFFFF)
+#define EVENT_POINT_OCCURRENCE(point) ((point) & 0xFFFFFFFF)
+
+/**
+ * Event armed in this process (TRIGGER_EVENT_NONE if none).
+ */
+extern volatile int armedTriggerEvent;
+
+/**
+ * Hook of an event: count its occurrence if it is armed.
+ */
+#define triggerEvent(event)                   \
+    do                                        \
+    {                                         \
+        if (armedTriggerEvent == (event))     \
+            countTriggerEvent(event);         \
+    } while (0)
+
+void countTriggerEvent(int event);
+
+/**
+ * Parse an event point, EVENT[:name]@N (e.g. QUEUE_SEND@3, TASK:qSort@2 or
+ * FUNCTION:xQueueReceive@1), with the names of the TRIGGER_EVENT_ macros.
+ */
+int parseEventPoint(const char *spec, unsigned long *point);
+
+/**
+ * Name of the event of an event point.
+ */
+const char *getEventName(unsigned long point);
+
+/**
+ * Arm the event of an event point: the injector (injectOnEvent) is called
+ * at its occurrence.
+ */
+void armEventTrigger(unsigned long point);
+void disarmEventTrigger(void);
+
+#endif
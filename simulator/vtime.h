@@ -0,0 +1,76 @@
+#ifndef INJECTOR_VTIME_H
+#define INJECTOR_VTIME_H
+
+#define VTIME_SUCCESS 0
+#define VTIME_FAILURE -1
+
+/**
+ * Virtual-time simulation.
+ *
+ * By default the tick is raised every millisecond of wall-clock time and the
+ * run-time counter reads the monotonic clock, so a run lasts as long as the
+ * simulated time (mostly idle) and its timing depends on the load of the
+ * host. With virtual time the simulated clock only advances by one tick
+ * period at each tick, and a tick is raised as soon as the kernel is idle or
+ * the process has consumed a tick period of CPU time: a run completes as
+ * fast as the CPU allows, and its outcome no longer depends on how many runs
+ * share the host.
+ *
+ * The run-time counter, the injection time and the timeout of the runs are
+ * all measured on the virtual clock, and the injection is performed by the
+ * tick hook instead of the injector thread. The golden run must be executed
+ * with virtual time as well.
+ */
+
+/**
+ * Enable virtual time in this process and in the instances it starts.
+ * Must be called before the scheduler is started.
+ */
+int enableVirtualTime(void);
+
+/**
+ * Enable virtual time if the process that started this one enabled it.
+ */
+void inheritVirtualTime(void);
+
+/**
+ * Whether virtual time is enabled.
+ */
+int isVirtualTime(void);
+
+/**
+ * Stop raising ticks from the Idle task once the run-time counter reaches
+ * limitNs (0: no limit), e.g. the timeout of the run: the Idle task yields
+ * the CPU to the injector thread instead of running the clock past it.
+ */
+void limitVirtualTime(unsigned long limitNs);
+
+/**
+ * Make sure the tick at (or right after) eventNs on the run-time counter is
+ * raised, e.g. the tick of the injection (0: no event).
+ */
+void markVirtualTime(unsigned long eventNs);
+
+/**
+ * Tickless idle: number of ticks the Idle task may skip when the next task
+ * unblocks in expectedIdleTicks ticks. Ticks are only skipped on the virtual
+ * clock, and never past the limit, the event set above or the next interrupt
+ * of the load (see irqload.h).
+ */
+unsigned long limitIdleTicks(unsigned long expectedIdleTicks);
+
+/**
+ * Called by the Idle task: raise the next tick at once on the virtual clock,
+ * or let the port wait for it on the wall clock.
+ */
+void idleVirtualTime(void);
+
+/**
+ * Drift of the tick on the wall clock, since the start of the scheduler:
+ * ticks whose signal was lost (raised late to catch up with the monotonic
+ * clock), and the largest delay of a tick behind its deadline. Both are 0
+ * with virtual time.
+ */
+void getTickDrift(unsigned long *missedTicks, unsigned long *maxLagNs);
+
+#endif
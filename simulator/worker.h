@@ -0,0 +1,60 @@
+#ifndef INJECTOR_WORKER_H
+#define INJECTOR_WORKER_H
+
+#include "injector.h"
+
+#define WORKER_SUCCESS 0
+#define WORKER_FAILURE -1
+
+/**
+ * Reuse-worker execution of an injection campaign.
+ *
+ * Each worker is a long-lived process that runs injection after injection.
+ * Before the first run it saves a pristine image of its writable data segment,
+ * which holds every kernel global (the tasks.c lists and counters, the timers.c
+ * lists and queue, the heap_5 regions) as well as loggerTrace and the qsort
+ * array. After each run it joins the threads of the Posix port and restores
+ * the image, so that the next run initialises FreeRTOS from scratch without
+ * creating a new process.
+ *
+ * A worker that cannot be reset safely (a task thread still running or
+ * preempted inside a shared library) reports the outcome of its last run and
+ * terminates; a worker that crashes or exceeds WATCHDOG_TIMEOUT_SEC is killed.
+ * Either way the orchestrator replaces it with a fresh one.
+ */
+
+/**
+ * Prepare a new worker process, before its image is saved: load everything
+ * that does not depend on the injection (e.g. the golden output).
+ */
+typedef void (*workerSetup_t)(void);
+
+/**
+ * Run a single injection in a worker: initialise FreeRTOS, launch the
+ * injector, run the scheduler and classify the simulation. Must return the
+ * exit code a --run instance would terminate with, once the scheduler has
+ * ended and the injector thread is gone.
+ */
+typedef unsigned int (*workerRun_t)(const injection_t *injection);
+
+/**
+ * Collect the exit code of a completed injection.
+ */
+typedef void (*workerResult_t)(const injection_t *injection, unsigned int exitCode);
+
+/**
+ * Run all the injections in plan on parallelism reuse workers.
+ *
+ * Returns WORKER_SUCCESS, or WORKER_FAILURE if reuse workers
+ * are not supported or could not be started.
+ */
+int runWorkerCampaign(injection_t *plan, int size, int parallelism,
+                      workerSetup_t setup, workerRun_t run,
+                      workerResult_t onResult);
+
+/**
+ * Called by a worker run when it is ready to start the scheduler.
+ */
+void notifyWorkerReady(void);
+
+#endif
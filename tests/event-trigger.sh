@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# Parse the event points of --run and of a campaign: the valid ones must run
+# the injection, the invalid ones must be rejected as invalid parameters, and
+# a campaign must report its event points in the tables and count the ones
+# reached.
+#
+# Usage: event-trigger.sh SIM INPUT_DATA_DIR
+# (registered with ctest by CMakeLists.txt)
+
+SIM=$1
+INPUT_DATA=$2
+INVALID_PARAMETERS=2
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# the instances read their input relative to the working directory, and
+# write golden.txt there
+mkdir -p "$WORK/simulator"
+ln -s "$INPUT_DATA" "$WORK/simulator/input_data"
+cd "$WORK" || exit 1
+
+"$SIM" --golden >/dev/null 2>&1 || { echo "golden run failed"; exit 1; }
+
+failures=0
+
+# event point, expected result: a run (any outcome but invalid parameters)
+# or invalid parameters. No build has a kernel function noSuchFunction.
+while read -r point expected; do
+    timeout 10 "$SIM" --run xNumOfOverflows "$point" 0 3 >/dev/null 2>&1
+    code=$?
+    if [ $code -eq $INVALID_PARAMETERS ]; then
+        result=invalid
+    else
+        result=run
+    fi
+    echo "$point: $result (exit code $code)"
+    if [ "$result" != "$expected" ]; then
+        failures=$((failures + 1))
+    fi
+done <<EOF2
+QUEUE_SEND@3 run
+TASK:IDLE@2 run
+TASK_DELAY@1 run
+BOGUS@1 invalid
+QUEUE_SEND@0 invalid
+QUEUE_SEND@x invalid
+QUEUE_SEND:foo@1 invalid
+TASK@1 invalid
+QUEUE_SEND@4294967296 invalid
+FUNCTION:noSuchFunction@1 invalid
+EOF2
+
+cat >plan.csv <<EOF2
+xNumOfOverflows,4,QUEUE_SEND@3,2,u
+EOF2
+"$SIM" --campaign plan.csv -y --no-pg-bar -j=2 >campaign.txt 2>&1 || { cat campaign.txt; echo "campaign failed"; exit 1; }
+grep "QUEUE_SEND@3" campaign.txt
+grep "^Events" campaign.txt
+if [ "$(grep -c "| *QUEUE_SEND@3 |" campaign.txt)" -ne 2 ] ||
+    ! grep -q "^Events  *4 runs triggered by a kernel event, [1-4] reached" campaign.txt; then
+    cat campaign.txt
+    failures=$((failures + 1))
+fi
+
+cat >invalid.csv <<EOF2
+xNumOfOverflows,4,QUEUE_SEND:foo@3,2,u
+EOF2
+"$SIM" --campaign invalid.csv -y --no-pg-bar -j=2 >/dev/null 2>&1
+code=$?
+echo "campaign with an invalid event point: exit code $code"
+if [ $code -ne $INVALID_PARAMETERS ]; then
+    failures=$((failures + 1))
+fi
+
+[ $failures -eq 0 ]
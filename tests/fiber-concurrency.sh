@@ -0,0 +1,78 @@
+#!/bin/sh
+#
+# Two instances of the fiber port run the same injection at the same time,
+# competing for the CPU as in a campaign with -j=2: each of them must
+# classify it as the threaded port does when it runs alone.
+#
+# Usage: fiber-concurrency.sh SIM SIM_FIBER INPUT_DATA_DIR
+# (registered with ctest by CMakeLists.txt)
+
+SIM=$1
+SIM_FIBER=$2
+INPUT_DATA=$3
+ROUNDS=4
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# the instances read their input relative to the working directory, and
+# write golden.txt there
+for port in threaded fiber; do
+    mkdir -p "$WORK/$port/simulator"
+    ln -s "$INPUT_DATA" "$WORK/$port/simulator/input_data"
+done
+
+# with a real-time policy (as the instances of a campaign, when allowed) an
+# instance that keeps the CPU delays the ticks of the other one
+RT=""
+if chrt -r 50 true 2>/dev/null; then
+    RT="chrt -r 50"
+fi
+
+# outcome of a run: a Delay depends on the load of the host as much as on
+# the injection, so it counts as a Silent run (correct output)
+classify() {
+    case $1 in
+        42|44) echo correct ;;
+        46) echo error ;;
+        48|124) echo hang ;;
+        *) echo crash ;;
+    esac
+}
+
+(cd "$WORK/threaded" && "$SIM" --golden >/dev/null 2>&1) || { echo "threaded golden run failed"; exit 1; }
+(cd "$WORK/fiber" && "$SIM_FIBER" --golden >/dev/null 2>&1) || { echo "fiber golden run failed"; exit 1; }
+
+failures=0
+
+# target, injection time (ns), byte, bit: silent, silent, delay and crash
+# runs on the threaded port
+while read -r target time byte bit; do
+    cd "$WORK/threaded"
+    timeout 10 "$SIM" --run "$target" "$time" "$byte" "$bit" >/dev/null 2>&1
+    expected=$(classify $?)
+
+    cd "$WORK/fiber"
+    round=0
+    while [ $round -lt $ROUNDS ]; do
+        $RT timeout 10 "$SIM_FIBER" --run "$target" "$time" "$byte" "$bit" >/dev/null 2>&1 &
+        first=$!
+        $RT timeout 10 "$SIM_FIBER" --run "$target" "$time" "$byte" "$bit" >/dev/null 2>&1 &
+        second=$!
+        wait $first; a=$(classify $?)
+        wait $second; b=$(classify $?)
+
+        echo "$target $time $byte $bit: threaded $expected, fiber $a $b"
+        if [ "$a" != "$expected" ] || [ "$b" != "$expected" ]; then
+            failures=$((failures + 1))
+        fi
+        round=$((round + 1))
+    done
+done <<EOF
+xNumOfOverflows 100000000 0 3
+xTickCount 100000000 0 12
+xDelayedTaskList2 50000000 0 0
+uxTopReadyPriority 100000000 0 5
+EOF
+
+[ $failures -eq 0 ]
@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# Kill a journaled campaign with SIGKILL once some of its injections are
+# journaled, then resume it: the resumed campaign must skip the journaled
+# injections and end with the results of an uninterrupted campaign. The runs
+# are on the virtual clock, on targets whose outcomes do not depend on the
+# load of the host.
+#
+# Usage: journal-resume.sh SIM INPUT_DATA_DIR
+# (registered with ctest by CMakeLists.txt)
+
+SIM=$1
+INPUT_DATA=$2
+OPTIONS="-y --no-pg-bar -j=1 --seed=5 --virtual-time"
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# the instances read their input relative to the working directory, and
+# write golden.txt there
+mkdir -p "$WORK/simulator"
+ln -s "$INPUT_DATA" "$WORK/simulator/input_data"
+cd "$WORK" || exit 1
+
+cat >plan.csv <<EOF
+xNumOfOverflows,200,60000000,40000000,u
+xDelayedTaskList2,200,60000000,40000000,u
+EOF
+
+# rows of the results table
+results() {
+    grep -E "^\| [a-zA-Z]" "$1" | tail -2
+}
+
+"$SIM" --golden --virtual-time >/dev/null 2>&1 || { echo "golden run failed"; exit 1; }
+"$SIM" --campaign plan.csv $OPTIONS >reference.txt 2>&1 || { echo "reference campaign failed"; exit 1; }
+
+"$SIM" --campaign plan.csv $OPTIONS --journal=journal >/dev/null 2>&1 &
+campaign=$!
+
+# the plan is journaled first, then the outcomes as they complete
+planned=0
+waited=0
+while [ $waited -lt 200 ]; do
+    size=$(stat -c %s journal 2>/dev/null || echo 0)
+    if [ "$planned" -eq 0 ]; then
+        planned=$size
+    elif [ "$size" -gt "$planned" ]; then
+        break
+    fi
+    sleep 0.05
+    waited=$((waited + 1))
+done
+kill -KILL $campaign 2>/dev/null
+wait $campaign 2>/dev/null
+
+# the instances of the killed campaign may still be running
+sleep 1
+
+"$SIM" --campaign plan.csv -y --no-pg-bar -j=1 --virtual-time --journal=journal --resume >resumed.txt 2>&1 ||
+    { cat resumed.txt; echo "resumed campaign failed"; exit 1; }
+
+line=$(grep "^Resuming the campaign:" resumed.txt)
+echo "$line"
+completed=$(echo "$line" | sed 's/.*: \([0-9]*\) of \([0-9]*\).*/\1/')
+total=$(echo "$line" | sed 's/.*: \([0-9]*\) of \([0-9]*\).*/\2/')
+if [ -z "$completed" ] || [ "$completed" -eq 0 ] || [ "$completed" -ge "$total" ]; then
+    echo "expected a campaign killed halfway"
+    exit 1
+fi
+
+results reference.txt >reference.rows
+results resumed.txt >resumed.rows
+cat resumed.rows
+if ! cmp -s reference.rows resumed.rows; then
+    echo "the resumed campaign differs from the uninterrupted one:"
+    cat reference.rows
+    exit 1
+fi
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Record the schedule of a run that crashes and of a run that hangs, then
+# replay each log: the replay must report how it went and end with the
+# outcome of the recorded run.
+#
+# Usage: replay.sh SIM INPUT_DATA_DIR
+# (registered with ctest by CMakeLists.txt)
+
+SIM=$1
+INPUT_DATA=$2
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# the instances read their input relative to the working directory, and
+# write golden.txt there
+mkdir -p "$WORK/simulator" "$WORK/rec"
+ln -s "$INPUT_DATA" "$WORK/simulator/input_data"
+cd "$WORK" || exit 1
+
+classify() {
+    case $1 in
+        42) echo silent ;;
+        44) echo delay ;;
+        46) echo error ;;
+        48|124) echo hang ;;
+        *) echo crash ;;
+    esac
+}
+
+"$SIM" --golden >/dev/null 2>&1 || { echo "golden run failed"; exit 1; }
+
+failures=0
+
+# target, injection time (ns), byte, bit: a crash (SIGSEGV in the kernel)
+# and a hang
+while read -r target time byte bit; do
+    # the recording directory that --record= passes to the instances
+    SIM_RECORD_DIR="$WORK/rec" timeout 10 "$SIM" --run "$target" "$time" "$byte" "$bit" >/dev/null 2>&1
+    recorded=$(classify $?)
+
+    log="$WORK/rec/$target-$time-$byte-$bit.sched"
+    if [ ! -f "$log" ]; then
+        echo "$target $time $byte $bit: no schedule log"
+        failures=$((failures + 1))
+        continue
+    fi
+
+    timeout 30 "$SIM" --replay "$log" >"$WORK/report" 2>&1
+    replayed=$(classify $?)
+
+    echo "$target $time $byte $bit: recorded $recorded, replayed $replayed"
+    grep "^Outcome:" "$WORK/report"
+    if [ "$recorded" != "$replayed" ] || ! grep -q "^Replayed [0-9]* entries" "$WORK/report" ||
+        ! grep -q "^Outcome: recorded" "$WORK/report"; then
+        cat "$WORK/report"
+        failures=$((failures + 1))
+    fi
+done <<EOF
+uxTopReadyPriority 100000000 0 5
+xNextTaskUnblockTime 20000000 2 0
+EOF
+
+[ $failures -eq 0 ]
@@ -0,0 +1,71 @@
+#!/bin/sh
+#
+# Run a campaign twice with the same result cache: the first campaign must
+# miss every injection and the second one must hit them all and report the
+# same results. A campaign on another clock must miss them again, since the
+# clock is part of the key of a cached outcome.
+#
+# Usage: result-cache.sh SIM INPUT_DATA_DIR
+# (registered with ctest by CMakeLists.txt)
+
+SIM=$1
+INPUT_DATA=$2
+OPTIONS="-y --no-pg-bar -j=2 --seed=7 --cache=cache"
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# the instances read their input relative to the working directory, and
+# write golden.txt there
+mkdir -p "$WORK/simulator"
+ln -s "$INPUT_DATA" "$WORK/simulator/input_data"
+cd "$WORK" || exit 1
+
+cat >plan.csv <<EOF2
+xNumOfOverflows,20,60000000,40000000,u
+xDelayedTaskList2,20,60000000,40000000,u
+EOF2
+
+# rows of the results table
+results() {
+    grep -E "^\| [a-zA-Z]" "$1" | tail -2
+}
+
+# hits of the result cache reported by a campaign
+hits() {
+    sed -n 's/^Result cache *\([0-9]*\) hits of \([0-9]*\) .*/\1 of \2/p' "$1"
+}
+
+"$SIM" --golden --virtual-time >/dev/null 2>&1 || { echo "golden run failed"; exit 1; }
+
+failures=0
+
+"$SIM" --campaign plan.csv $OPTIONS --virtual-time >first.txt 2>&1 || { cat first.txt; echo "first campaign failed"; exit 1; }
+echo "first campaign: hits $(hits first.txt)"
+if [ "$(hits first.txt)" != "0 of 40" ]; then
+    failures=$((failures + 1))
+fi
+
+"$SIM" --campaign plan.csv $OPTIONS --virtual-time >second.txt 2>&1 || { cat second.txt; echo "second campaign failed"; exit 1; }
+echo "second campaign: hits $(hits second.txt)"
+if [ "$(hits second.txt)" != "40 of 40" ]; then
+    failures=$((failures + 1))
+fi
+
+results first.txt >first.rows
+results second.txt >second.rows
+if ! cmp -s first.rows second.rows; then
+    echo "the cached outcomes differ from the ones they were cached from:"
+    cat first.rows second.rows
+    failures=$((failures + 1))
+fi
+
+# the wall clock, with the golden run of the wall clock
+"$SIM" --golden >/dev/null 2>&1 || { echo "golden run failed"; exit 1; }
+"$SIM" --campaign plan.csv $OPTIONS >third.txt 2>&1 || { cat third.txt; echo "third campaign failed"; exit 1; }
+echo "campaign on the wall clock: hits $(hits third.txt)"
+if [ "$(hits third.txt)" != "0 of 40" ]; then
+    failures=$((failures + 1))
+fi
+
+[ $failures -eq 0 ]
@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Run the same seeded campaign with each way of spawning the instances: on
+# the virtual clock, the zygote, the workers and the fork server must give
+# the outcomes of instances spawned with exec.
+#
+# Usage: spawn-modes.sh SIM INPUT_DATA_DIR
+# (registered with ctest by CMakeLists.txt)
+
+SIM=$1
+INPUT_DATA=$2
+OPTIONS="-y --no-pg-bar -j=2 --seed=11 --virtual-time"
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# the instances read their input relative to the working directory, and
+# write golden.txt there
+mkdir -p "$WORK/simulator"
+ln -s "$INPUT_DATA" "$WORK/simulator/input_data"
+cd "$WORK" || exit 1
+
+# silent runs, and crashes
+cat >plan.csv <<EOF2
+xNumOfOverflows,6,60000000,40000000,u
+xDelayedTaskList2,6,60000000,40000000,u
+uxTopReadyPriority,6,60000000,40000000,u
+EOF2
+
+# rows of the results table
+results() {
+    grep -E "^\| [a-zA-Z]" "$1" | tail -3
+}
+
+"$SIM" --golden --virtual-time >/dev/null 2>&1 || { echo "golden run failed"; exit 1; }
+
+failures=0
+
+for mode in exec zygote worker forkserver; do
+    "$SIM" --campaign plan.csv $OPTIONS --spawn=$mode >$mode.txt 2>&1 ||
+        { cat $mode.txt; echo "$mode: campaign failed"; exit 1; }
+    results $mode.txt >$mode.rows
+
+    if [ $mode = exec ]; then
+        cat exec.rows
+    elif cmp -s exec.rows $mode.rows; then
+        echo "$mode: same outcomes as exec"
+    else
+        echo "$mode: outcomes differ from exec:"
+        cat $mode.rows
+        failures=$((failures + 1))
+    fi
+done
+
+[ $failures -eq 0 ]